@@ -50,7 +50,8 @@ function(build_erf_lib erf_lib_name)
                    ${SRC_DIR}/IO/ReadFromMetgrid.cpp
                    ${SRC_DIR}/IO/ReadFromWRFBdy.cpp
                    ${SRC_DIR}/IO/ReadFromWRFInput.cpp
-                   ${SRC_DIR}/IO/NCColumnFile.cpp)
+                   ${SRC_DIR}/IO/NCColumnFile.cpp
+                   ${SRC_DIR}/IO/NCSliceFile.cpp)
     target_compile_definitions(${erf_lib_name} PUBLIC ERF_USE_NETCDF)
   endif()
 
@@ -62,7 +63,8 @@ function(build_erf_lib erf_lib_name)
        ${SRC_DIR}/Microphysics/Precip.cpp
        ${SRC_DIR}/Microphysics/PrecipFall.cpp
        ${SRC_DIR}/Microphysics/Diagnose.cpp
-       ${SRC_DIR}/Microphysics/Update.cpp)
+       ${SRC_DIR}/Microphysics/Update.cpp
+       ${SRC_DIR}/Microphysics/Kessler.cpp)
     target_compile_definitions(${erf_lib_name} PUBLIC ERF_USE_MOISTURE)
   endif()
 
@@ -74,6 +76,9 @@ function(build_erf_lib erf_lib_name)
                    ${SRC_DIR}/Radiation/Run_longwave_rrtmgp.cpp
                    ${SRC_DIR}/Radiation/Run_shortwave_rrtmgp.cpp
                    ${SRC_DIR}/Radiation/Cloud_rad_props.cpp
+                   ${SRC_DIR}/Radiation/Radiation.H
+                   ${SRC_DIR}/Radiation/Radiation.cpp
+                   ${SRC_DIR}/TimeIntegration/ERF_advance_radiation.cpp
                    ${CMAKE_SOURCE_DIR}/Submodules/RRTMGP/cpp/examples/mo_load_coefficients.cpp
                    ${CMAKE_SOURCE_DIR}/Submodules/RRTMGP/cpp/extensions/fluxes_byband/mo_fluxes_byband_kernels.cpp
                   )
@@ -132,6 +137,8 @@ function(build_erf_lib erf_lib_name)
        ${SRC_DIR}/IO/ERF_WriteBndryPlanes.cpp
        ${SRC_DIR}/IO/ERF_Write1DProfiles.cpp
        ${SRC_DIR}/IO/ERF_WriteScalarProfiles.cpp
+       ${SRC_DIR}/IO/ERF_TimeAvgStats.cpp
+       ${SRC_DIR}/IO/ERF_ProbeSampler.cpp
        ${SRC_DIR}/IO/Plotfile.cpp
        ${SRC_DIR}/IO/writeJobInfo.cpp
        ${SRC_DIR}/TimeIntegration/ERF_ComputeTimestep.cpp
@@ -149,6 +156,7 @@ function(build_erf_lib erf_lib_name)
        ${SRC_DIR}/TimeIntegration/ERF_fast_rhs_T.cpp
        ${SRC_DIR}/TimeIntegration/ERF_fast_rhs_MT.cpp
        ${SRC_DIR}/Utils/MomentumToVelocity.cpp
+       ${SRC_DIR}/Utils/MultiPlaneAverage.cpp
        ${SRC_DIR}/Utils/TerrainMetrics.cpp
        ${SRC_DIR}/Utils/VelocityToMomentum.cpp
        ${SRC_DIR}/Utils/InteriorGhostCells.cpp 
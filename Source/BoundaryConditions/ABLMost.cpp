@@ -1,16 +1,29 @@
 #include <ABLMost.H>
 #include <MOSTAverage.H>
 
+#ifdef ERF_USE_NETCDF
+#include <NCInterface.H>
+#endif
+
 using namespace amrex;
 
 /**
  * Function to update the fluxs (u^star and t^star) for Monin Obukhov similarity theory.
  *
+ * With most.flux_solver = fixed_point (default) u^star and the Obukhov length are
+ * iterated to a tolerance, starting from the previous solution on this level if
+ * most.warm_start is set. With most.flux_solver = newton the stability parameter
+ * zeta = z_ref/L is found instead from the bulk Richardson number (surface
+ * temperature) or the surface flux (heat flux) with a fixed number of Newton steps,
+ * so that every cell does the same amount of work.
+ *
  * @param[in] lev Current level
  * @param[in] max_iters maximum iterations to use
  */
 void ABLMost::update_fluxes(int lev, int max_iters)
 {
+    amrex::Real t_start = amrex::second();
+
     // Compute plane averages for all vars
     m_ma.compute_averages(lev);
 
@@ -29,118 +42,165 @@ void ABLMost::update_fluxes(int lev, int max_iters)
     constexpr amrex::Real eps = std::numeric_limits<Real>::epsilon();
     constexpr amrex::Real tol = 1.0e-5;
 
+    // Bounds on zeta for the Newton solver
+    constexpr amrex::Real zeta_min = -10.0;
+    constexpr amrex::Real zeta_max =  10.0;
+
+    // Which problem and how we solve it
+    const bool is_flux = (alg_type == HEAT_FLUX) && (std::abs(surf_temp_flux) > eps);
+    const bool is_temp = (alg_type == SURFACE_TEMPERATURE);
+    const bool newton  = (flux_solver == NEWTON);
+    const bool warm    = m_warm_start && m_have_fluxes[lev];
+    const int  n_newton = m_newton_iters;
+
     // Ghost cells for CC var
     amrex::IntVect ng = u_star[lev]->nGrowVect(); ng[2]=0;
 
-    // Initialize to the adiabatic q=0 case
+    // Iterations taken in each cell, only kept if we report them
+    const bool report = m_solver_report;
+    amrex::iMultiFab niter;
+    if (report) niter.define(u_star[lev]->boxArray(), u_star[lev]->DistributionMap(), 1, ng);
+
     for (MFIter mfi(*u_star[lev]); mfi.isValid(); ++mfi)
     {
         amrex::Box bx = mfi.growntilebox(ng);
 
+        auto t_surf_arr = t_surf[lev]->array(mfi);
         auto t_star_arr = t_star[lev]->array(mfi);
         auto u_star_arr = u_star[lev]->array(mfi);
         auto olen_arr   = olen[lev]->array(mfi);
 
-        const auto umm_arr = umm_ptr->array(mfi);
-        const auto z0_arr  = z_0[lev].array();
+        const auto tm_arr  = tm_ptr->const_array(mfi);
+        const auto umm_arr = umm_ptr->const_array(mfi);
+        const auto z0_arr  = z_0[lev]->const_array(mfi);
+
+        amrex::Array4<int> niter_arr;
+        if (report) niter_arr = niter.array(mfi);
 
         ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept
         {
-            t_star_arr(i,j,k) = 0.0;
-            olen_arr(i,j,k) = 0.0;
-            u_star_arr(i,j,k) = d_kappa * umm_arr(i,j,k) / std::log(d_zref / z0_arr(i,j,k));
-        });
-    }
+            const amrex::Real ln_z = std::log(d_zref / z0_arr(i,j,k));
+            const amrex::Real umm  = umm_arr(i,j,k);
+            const amrex::Real tm   = tm_arr(i,j,k);
 
-    // Specified finite heat flux
-    if ( (alg_type == HEAT_FLUX) && (std::abs(surf_temp_flux) > eps) ) {
-        for (MFIter mfi(*u_star[lev]); mfi.isValid(); ++mfi)
-        {
-            amrex::Box bx = mfi.growntilebox(ng);
+            // Previous solution, if we may start from it
+            const amrex::Real zeta_old = (warm && olen_arr(i,j,k) != 0.0) ? d_zref / olen_arr(i,j,k) : 0.0;
+            const amrex::Real ustar_old = warm ? u_star_arr(i,j,k) : d_kappa * umm / ln_z;
 
-            auto t_surf_arr = t_surf[lev]->array(mfi);
-            auto t_star_arr = t_star[lev]->array(mfi);
-            auto u_star_arr = u_star[lev]->array(mfi);
+            int iter = 0;
 
-            const auto tm_arr  = tm_ptr->array(mfi);
-            const auto umm_arr = umm_ptr->array(mfi);
-            const auto z0_arr  = z_0[lev].array();
+            // Specified finite heat flux
+            if (is_flux) {
+                amrex::Real ustar = ustar_old;
+                amrex::Real zeta  = 0.0;
+                amrex::Real psi_m = 0.0;
+                amrex::Real psi_h = 0.0;
+                amrex::Real Olen  = 0.0;
+                if (newton) {
+                    // zeta + A (ln(z/z0) - psi_m(zeta))^3 = 0
+                    amrex::Real A = d_gravity * d_surf_temp_flux * d_zref /
+                                    (d_kappa * d_kappa * umm * umm * umm * tm);
+                    zeta = zeta_old;
+                    for (iter = 0; iter < n_newton; ++iter) {
+                        amrex::Real a  = ln_z - d_most.calc_psi_m(zeta);
+                        amrex::Real F  = zeta + A * a * a * a;
+                        amrex::Real dF = 1.0 - 3.0 * A * a * a * d_most.calc_dpsi_m(zeta);
+                        zeta = amrex::min(amrex::max(zeta - F / dF, zeta_min), zeta_max);
+                    }
+                    psi_m = d_most.calc_psi_m(zeta);
+                    psi_h = d_most.calc_psi_h(zeta);
+                    ustar = d_kappa * umm / (ln_z - psi_m);
+                    Olen  = (zeta != 0.0) ? d_zref / zeta : 0.0;
+                } else {
+                    amrex::Real ustar_new = ustar;
+                    do {
+                        ustar = ustar_new;
+                        Olen = -ustar * ustar * ustar * tm /
+                               (d_kappa * d_gravity * d_surf_temp_flux);
+                        zeta  = d_zref / Olen;
+                        psi_m = d_most.calc_psi_m(zeta);
+                        psi_h = d_most.calc_psi_h(zeta);
+                        ustar_new = d_kappa * umm / (ln_z - psi_m);
+                        ++iter;
+                    } while ((std::abs(ustar_new - ustar) > tol) && iter <= max_iters);
+                    ustar = ustar_new;
+                }
 
-            auto olen_arr = olen[lev]->array(mfi);
+                u_star_arr(i,j,k) = ustar;
+                t_surf_arr(i,j,k) = d_surf_temp_flux * (ln_z - psi_h) / (ustar * d_kappa) + tm;
+                t_star_arr(i,j,k) = -d_surf_temp_flux / ustar;
+                olen_arr(i,j,k)   = Olen;
 
-            ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept
-            {
-                int iter = 0;
-                amrex::Real ustar = 0.0;
+            // Specified surface temperature; nothing to do unless the flux != 0
+            } else if (is_temp && (std::abs(t_surf_arr(i,j,k)-tm) > eps)) {
+                const amrex::Real dT = tm - t_surf_arr(i,j,k);
+                amrex::Real ustar = ustar_old;
                 amrex::Real zeta  = 0.0;
                 amrex::Real psi_m = 0.0;
                 amrex::Real psi_h = 0.0;
                 amrex::Real Olen  = 0.0;
-                do {
-                    ustar = u_star_arr(i,j,k);
-                    Olen = -ustar * ustar * ustar * tm_arr(i,j,k) /
-                           (d_kappa * d_gravity * d_surf_temp_flux);
-                    zeta  = d_zref / Olen;
+                if (newton) {
+                    // zeta (ln(z/z0) - psi_h) / (ln(z/z0) - psi_m)^2 = Ri_b
+                    amrex::Real Rib = d_gravity * d_zref * dT / (tm * umm * umm);
+                    zeta = zeta_old;
+                    for (iter = 0; iter < n_newton; ++iter) {
+                        amrex::Real a  = ln_z - d_most.calc_psi_m(zeta);
+                        amrex::Real b  = ln_z - d_most.calc_psi_h(zeta);
+                        amrex::Real F  = zeta * b / (a * a) - Rib;
+                        amrex::Real dF = (b - zeta * d_most.calc_dpsi_h(zeta)) / (a * a)
+                                       + 2.0 * zeta * b * d_most.calc_dpsi_m(zeta) / (a * a * a);
+                        zeta = amrex::min(amrex::max(zeta - F / dF, zeta_min), zeta_max);
+                    }
                     psi_m = d_most.calc_psi_m(zeta);
                     psi_h = d_most.calc_psi_h(zeta);
-                    u_star_arr(i,j,k) = d_kappa * umm_arr(i,j,k) / (std::log(d_zref / z0_arr(i,j,k)) - psi_m);
-                    ++iter;
-                } while ((std::abs(u_star_arr(i,j,k) - ustar) > tol) && iter <= max_iters);
-
-                t_surf_arr(i,j,k) = d_surf_temp_flux * (std::log(d_zref / z0_arr(i,j,k)) - psi_h) /
-                                    (u_star_arr(i,j,k) * d_kappa) + tm_arr(i,j,k);
-                t_star_arr(i,j,k) = -d_surf_temp_flux / u_star_arr(i,j,k);
-
-                olen_arr(i,j,k) = Olen;
-            });
-        }
-    // Specified surface temperature
-    } else if ( alg_type == SURFACE_TEMPERATURE ) {
-        for (MFIter mfi(*u_star[lev]); mfi.isValid(); ++mfi)
-        {
-            amrex::Box bx = mfi.growntilebox(ng);
-
-            auto t_surf_arr = t_surf[lev]->array(mfi);
-            auto t_star_arr = t_star[lev]->array(mfi);
-            auto u_star_arr = u_star[lev]->array(mfi);
-
-            const auto tm_arr  = tm_ptr->array(mfi);
-            const auto umm_arr = umm_ptr->array(mfi);
-            const auto z0_arr  = z_0[lev].array();
-
-            auto olen_arr = olen[lev]->array(mfi);
-
-            ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept
-            {
-                // Nothing to do unless the flux != 0
-                if (std::abs(t_surf_arr(i,j,k)-tm_arr(i,j,k)) > eps) {
-                    int iter = 0;
-                    amrex::Real ustar = 0.0;
-                    amrex::Real tflux = 0.0;
-                    amrex::Real zeta  = 0.0;
-                    amrex::Real psi_m = 0.0;
-                    amrex::Real psi_h = 0.0;
-                    amrex::Real Olen  = 0.0;
+                    ustar = d_kappa * umm / (ln_z - psi_m);
+                    Olen  = (zeta != 0.0) ? d_zref / zeta : 0.0;
+                } else {
+                    amrex::Real ustar_new = ustar;
+                    if (warm) psi_h = d_most.calc_psi_h(zeta_old);
                     do {
-                        ustar = u_star_arr(i,j,k);
-                        tflux = -(tm_arr(i,j,k) - t_surf_arr(i,j,k)) * ustar * d_kappa /
-                                 (std::log(d_zref / z0_arr(i,j,k)) - psi_h);
-                        Olen = -ustar * ustar * ustar * tm_arr(i,j,k) /
+                        ustar = ustar_new;
+                        amrex::Real tflux = -dT * ustar * d_kappa / (ln_z - psi_h);
+                        Olen = -ustar * ustar * ustar * tm /
                                (d_kappa * d_gravity * tflux);
                         zeta  = d_zref / Olen;
                         psi_m = d_most.calc_psi_m(zeta);
                         psi_h = d_most.calc_psi_h(zeta);
-                        u_star_arr(i,j,k) = d_kappa * umm_arr(i,j,k) / (std::log(d_zref / z0_arr(i,j,k)) - psi_m);
+                        ustar_new = d_kappa * umm / (ln_z - psi_m);
                         ++iter;
-                    } while ((std::abs(u_star_arr(i,j,k) - ustar) > tol) && iter <= max_iters);
+                    } while ((std::abs(ustar_new - ustar) > tol) && iter <= max_iters);
+                    ustar = ustar_new;
+                }
 
-                    t_star_arr(i,j,k) = d_kappa * (tm_arr(i,j,k) - t_surf_arr(i,j,k)) /
-                                        (std::log(d_zref / z0_arr(i,j,k)) - psi_h);
+                u_star_arr(i,j,k) = ustar;
+                t_star_arr(i,j,k) = d_kappa * dT / (ln_z - psi_h);
+                olen_arr(i,j,k)   = Olen;
 
-                    olen_arr(i,j,k) = Olen;
-                }
-            });
-        }
+            // Adiabatic q=0 case
+            } else {
+                u_star_arr(i,j,k) = d_kappa * umm / ln_z;
+                t_star_arr(i,j,k) = 0.0;
+                olen_arr(i,j,k)   = 0.0;
+            }
+
+            if (report) niter_arr(i,j,k) = iter;
+        });
+    }
+
+    m_have_fluxes[lev] = 1;
+
+    if (report) {
+        amrex::Long ncells  = niter.boxArray().numPts();
+        amrex::Long sum_it  = niter.sum(0);
+        int         max_it  = niter.max(0);
+        amrex::Real elapsed = amrex::second() - t_start;
+        ParallelDescriptor::ReduceRealMax(elapsed, ParallelDescriptor::IOProcessorNumber());
+        amrex::Print() << "MOST fluxes at level " << lev
+                       << " (" << (newton ? "newton" : "fixed_point")
+                       << (warm ? ", warm start" : "") << "):"
+                       << " mean iterations = " << static_cast<amrex::Real>(sum_it) / ncells
+                       << "  max iterations = " << max_it
+                       << "  time = " << elapsed << std::endl;
     }
 }
 
@@ -347,3 +407,187 @@ ABLMost::impose_most_bcs(const int lev,
         } // var_idx
     } // mf
 }
+
+/**
+ * Function to allocate and initialize the 2D MFs for Z0, U*, T*, L and T_surf at one level.
+ *
+ * @param[in] lev Current level
+ * @param[in] vars_old Conserved variables at each level
+ */
+void
+ABLMost::make_level_data(int lev,
+                         Vector<Vector<MultiFab>>& vars_old)
+{
+    clear_level(lev);
+
+    auto& mf = vars_old[lev][Vars::cons];
+    // Create a 2D ba, dm, & ghost cells
+    BoxList bl2d = mf.boxArray().boxList();
+    for (auto& b : bl2d) {
+        b.setRange(2,0);
+    }
+    BoxArray ba2d(std::move(bl2d));
+    const DistributionMapping& dm = mf.DistributionMap();
+    const int ncomp = 1;
+    IntVect ng = mf.nGrowVect(); ng[2]=0;
+
+    // Z0 heights -- distributed like the level grids so no rank holds the whole surface
+    z_0[lev] = new MultiFab(ba2d,dm,ncomp,ng);
+    z_0[lev]->setVal(z0_const);
+#ifdef ERF_USE_NETCDF
+    if (!m_z0_file.empty()) read_z0_from_netcdf(lev, m_z0_file);
+#endif
+
+    u_star[lev] = new MultiFab(ba2d,dm,ncomp,ng);
+    u_star[lev]->setVal(1.E34);
+
+    t_star[lev] = new MultiFab(ba2d,dm,ncomp,ng);
+    t_star[lev]->setVal(1.E34);
+
+    olen[lev] = new MultiFab(ba2d,dm,ncomp,ng);
+    olen[lev]->setVal(1.E34);
+
+    t_surf[lev] = new MultiFab(ba2d,dm,ncomp,ng);
+    if (alg_type == SURFACE_TEMPERATURE) {
+        t_surf[lev]->setVal(surf_temp);
+    } else {
+        t_surf[lev]->setVal(0.0);
+    }
+
+    // Nothing to warm start from on these grids
+    m_have_fluxes[lev] = 0;
+}
+
+/**
+ * Function to free the 2D MFs at one level.
+ *
+ * @param[in] lev Current level
+ */
+void
+ABLMost::clear_level(int lev)
+{
+    delete z_0[lev];    z_0[lev]    = nullptr;
+    delete u_star[lev]; u_star[lev] = nullptr;
+    delete t_star[lev]; t_star[lev] = nullptr;
+    delete olen[lev];   olen[lev]   = nullptr;
+    delete t_surf[lev]; t_surf[lev] = nullptr;
+}
+
+/**
+ * Function to rebuild one level after it has been created or regridded. Only this
+ * level's surface fields and averaging maps are remade; the fluxes themselves are
+ * recomputed on the next call to update_fluxes.
+ *
+ * @param[in] lev Current level
+ * @param[in] vars_old Conserved variables at each level
+ * @param[in] Theta_prim Primitive theta component at each level
+ * @param[in] z_phys_nd Physical heights at each level
+ */
+void
+ABLMost::regrid(int lev,
+                Vector<Vector<MultiFab>>& vars_old,
+                Vector<std::unique_ptr<MultiFab>>& Theta_prim,
+                Vector<std::unique_ptr<MultiFab>>& z_phys_nd)
+{
+    BL_PROFILE("ABLMost::regrid()");
+    make_level_data(lev, vars_old);
+    m_ma.remake_level(lev, vars_old, Theta_prim, z_phys_nd);
+}
+
+#ifdef ERF_USE_NETCDF
+/**
+ * Function to fill the roughness length at one level from a 2D field in a NetCDF file.
+ *
+ * The field (e.g. ZNT, or LU_INDEX with most.roughness_lu_table) is given at the
+ * resolution of level 0, with dimensions (..., south_north, west_east). Every rank
+ * reads only the part of it under its own grids, so no rank ever holds the whole
+ * surface; cells on finer levels take the value of the level 0 cell containing them.
+ *
+ * @param[in] lev Current level
+ * @param[in] fname Name of the NetCDF file
+ */
+void
+ABLMost::read_z0_from_netcdf(int lev, const std::string& fname)
+{
+    BL_PROFILE("ABLMost::read_z0_from_netcdf()");
+
+    const Box& dom0 = m_geom[0].Domain();
+    const Box& dom  = m_geom[lev].Domain();
+    const int rx = dom.length(0) / dom0.length(0);
+    const int ry = dom.length(1) / dom0.length(1);
+
+    // Every rank opens the file; the reads themselves are independent
+    auto ncf = ncutils::NCFile::open_par(fname, NC_NOWRITE);
+    auto var = ncf.var(m_z0_var);
+    var.par_access(NC_INDEPENDENT);
+
+    std::vector<size_t> shape = var.shape();
+    const int nd = static_cast<int>(shape.size());
+    if ( (nd < 2) ||
+         (static_cast<int>(shape[nd-1]) != dom0.length(0)) ||
+         (static_cast<int>(shape[nd-2]) != dom0.length(1)) ) {
+        amrex::Abort("ABLMost: " + m_z0_var + " in " + fname + " does not match the level 0 domain");
+    }
+
+    const int nlu = m_z0_lu_table.size();
+    Gpu::DeviceVector<Real> lu_table(nlu);
+    Gpu::copy(Gpu::hostToDevice, m_z0_lu_table.begin(), m_z0_lu_table.end(), lu_table.begin());
+    const Real* lu_ptr = lu_table.data();
+
+    for (MFIter mfi(*z_0[lev]); mfi.isValid(); ++mfi)
+    {
+        const Box& vbx = mfi.validbox();
+
+        // Level 0 cells under this grid; the file has no vertical dimension
+        Box cbx = amrex::coarsen(vbx, IntVect(AMREX_D_DECL(rx,ry,1))) & dom0;
+        cbx.setRange(2,0);
+
+        // First time level (if any) of the hyperslab under this grid
+        std::vector<size_t> start(nd, 0), count(nd, 1);
+        start[nd-2] = cbx.smallEnd(1) - dom0.smallEnd(1);
+        start[nd-1] = cbx.smallEnd(0) - dom0.smallEnd(0);
+        count[nd-2] = cbx.length(1);
+        count[nd-1] = cbx.length(0);
+
+        // The NetCDF layout (west_east fastest) matches the FArrayBox layout
+        FArrayBox host_fab(cbx, 1, The_Pinned_Arena());
+        var.get(host_fab.dataPtr(), start, count);
+
+        FArrayBox dev_fab(cbx, 1, The_Async_Arena());
+        Gpu::copyAsync(Gpu::hostToDevice, host_fab.dataPtr(), host_fab.dataPtr() + host_fab.size(),
+                       dev_fab.dataPtr());
+
+        const auto src_arr = dev_fab.const_array();
+        const auto z0_arr  = z_0[lev]->array(mfi);
+        ParallelFor(vbx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept
+        {
+            Real val = src_arr(i/rx, j/ry, 0);
+            if (nlu > 0) {
+                int cat = amrex::min(amrex::max(static_cast<int>(val), 1), nlu);
+                val = lu_ptr[cat-1];
+            }
+            z0_arr(i,j,k) = val;
+        });
+        Gpu::streamSynchronize();
+    }
+
+    ncf.close();
+
+    // Ghost cells: nearest valid value outside the domain, neighbors/periodic images elsewhere
+    for (MFIter mfi(*z_0[lev]); mfi.isValid(); ++mfi)
+    {
+        const Box& vbx = mfi.validbox();
+        const Box& gbx = mfi.fabbox();
+        const auto& vlo = lbound(vbx);
+        const auto& vhi = ubound(vbx);
+        const auto z0_arr = z_0[lev]->array(mfi);
+        ParallelFor(gbx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept
+        {
+            int ii = amrex::min(amrex::max(i, vlo.x), vhi.x);
+            int jj = amrex::min(amrex::max(j, vlo.y), vhi.y);
+            if (ii != i || jj != j) z0_arr(i,j,k) = z0_arr(ii,jj,k);
+        });
+    }
+    z_0[lev]->FillBoundary(m_geom[lev].periodicity());
+}
+#endif
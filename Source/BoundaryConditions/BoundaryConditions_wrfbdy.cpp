@@ -184,4 +184,25 @@ ERF::fill_from_wrfbdy (const Vector<MultiFab*>& mfs, const Real time)
         } // comp
     } // var
 }
+
+/*
+ * Make sure the owners of the level 0 grids hold the wrfbdy data they need
+ *
+ * @param[in] time  start of the time interval
+ * @param[in] dt    length of the time interval
+ */
+
+void
+ERF::update_wrfbdy (const Real time, const Real dt)
+{
+    // The ghost cells we fill and the reach of the relaxation zone stencils
+    int ng = 4;
+    for (const auto& mf : vars_new[0]) {
+        ng = std::max(ng, mf.nGrowVect().max());
+    }
+
+    m_wrfbdy->update(time, dt,
+                     vars_new[0][Vars::cons].boxArray(), vars_new[0][Vars::cons].DistributionMap(), ng+1,
+                     bdy_data_xlo, bdy_data_xhi, bdy_data_ylo, bdy_data_yhi);
+}
 #endif
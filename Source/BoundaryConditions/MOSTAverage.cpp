@@ -48,68 +48,131 @@ MOSTAverage::MOSTAverage (Vector<Geometry>  geom,
     m_j_indx.resize(m_maxlev);
     m_k_indx.resize(m_maxlev);
 
+    for (int lev(0); lev < m_maxlev; lev++) {
+        m_fields[lev].resize(m_nvar,nullptr);
+        m_averages[lev].resize(m_navg,nullptr);
+        m_z_phys_nd[lev] = z_phys_nd[lev].get();
+    }
 
+    // Setup normalization data for the chosen policy
+    //--------------------------------------------------------
+    switch(m_policy) {
+    case 0: // Plane average (cells per plane are set with each level)
+        m_ncell_plane.resize(m_maxlev);
+        m_plane_average.resize(m_maxlev);
+        break;
+    case 1: // Local region/point
+        set_region_normalization();
+        break;
+    default:
+        AMREX_ASSERT_WITH_MESSAGE(false, "Unknown policy for MOSTAverage!");
+    }
+
+    // Set up the exponential time filtering
+    //--------------------------------------------------------
+    if (m_t_avg) {
+        // m_time_window is normalized by the time-step "dt"
+        pp.query("most.time_window", m_time_window);
+
+        // Exponential filter function
+        m_fact_old = std::exp(-1.0 / m_time_window);
+
+        // Enforce discrete normalization: (mfn*val_new + mfo*val_old)
+        m_fact_new = 1.0 - m_fact_old;
+
+        // None of the averages are initialized
+        m_t_init.resize(m_maxlev,0);
+    }
+
+    // Build the 2D data and index/position maps on the levels that exist so far;
+    //     finer levels are added by remake_level when they are created
+    //--------------------------------------------------------
     for (int lev(0); lev < m_maxlev; lev++) {
-      m_fields[lev].resize(m_nvar);
-      m_averages[lev].resize(m_navg);
-      m_z_phys_nd[lev] = z_phys_nd[lev].get();
-      { // Nodal in x
-        auto& mf  = vars_old[lev][Vars::xvel];
-        MultiFab* mfp = &vars_old[lev][Vars::xvel];
-        // Create a 2D ba, dm, & ghost cells
-        const BoxArray& ba  = mf.boxArray();
+        if (Theta_prim[lev]) remake_level(lev, vars_old, Theta_prim, z_phys_nd);
+    }
+}
+
+
+/**
+ * Function to (re)build the 2D data, maps and normalization on one level.
+ * This is called at construction and whenever the level is created or regridded.
+ *
+ * @param[in] lev Current level
+ * @param[in] vars_old Conserved variables at each level
+ * @param[in] Theta_prim Primitive theta component at each level
+ * @param[in] z_phys_nd Physical heights at each level
+ */
+void
+MOSTAverage::remake_level (int lev,
+                           Vector<Vector<MultiFab>>& vars_old,
+                           Vector<std::unique_ptr<MultiFab>>& Theta_prim,
+                           Vector<std::unique_ptr<MultiFab>>& z_phys_nd)
+{
+    make_level_data(lev, vars_old, Theta_prim, z_phys_nd);
+
+    set_level_maps(lev);
+
+    if (m_policy == 0) set_plane_normalization(lev);
+
+    // The old averages belong to the old grids
+    if (m_t_avg) m_t_init[lev] = 0;
+}
+
+
+/**
+ * Function to allocate the 2D averages and index/position maps on one level.
+ *
+ * @param[in] lev Current level
+ * @param[in] vars_old Conserved variables at each level
+ * @param[in] Theta_prim Primitive theta component at each level
+ * @param[in] z_phys_nd Physical heights at each level
+ */
+void
+MOSTAverage::make_level_data (int lev,
+                              Vector<Vector<MultiFab>>& vars_old,
+                              Vector<std::unique_ptr<MultiFab>>& Theta_prim,
+                              Vector<std::unique_ptr<MultiFab>>& z_phys_nd)
+{
+    clear_level(lev);
+
+    m_z_phys_nd[lev] = z_phys_nd[lev].get();
+    update_field_ptrs(lev, vars_old, Theta_prim);
+
+    // Create a 2D ba, dm, & ghost cells
+    auto make_2d = [] (const BoxArray& ba) {
         BoxList bl2d = ba.boxList();
         for (auto& b : bl2d) b.setRange(2,0);
-        BoxArray ba2d(std::move(bl2d));
-        const DistributionMapping& dm = mf.DistributionMap();
-        const int ncomp   = 1;
-        IntVect ng = mf.nGrowVect(); ng[2]=0;
+        return BoxArray(std::move(bl2d));
+    };
+
+    const int ncomp  = 1;
+    const int incomp = 1;
 
-          m_fields[lev][0] = mfp;
-        m_averages[lev][0] = new MultiFab(ba2d,dm,ncomp,ng);
+    { // Nodal in x
+        auto& mf = vars_old[lev][Vars::xvel];
+        IntVect ng = mf.nGrowVect(); ng[2]=0;
+        m_averages[lev][0] = new MultiFab(make_2d(mf.boxArray()),mf.DistributionMap(),ncomp,ng);
         m_averages[lev][0]->setVal(1.E34);
-      }
-      { // Nodal in y
-        auto& mf  = vars_old[lev][Vars::yvel];
-        MultiFab* mfp = &vars_old[lev][Vars::yvel];
-        // Create a 2D ba, dm, & ghost cells
-        const BoxArray& ba  = mf.boxArray();
-        BoxList bl2d = ba.boxList();
-        for (auto& b : bl2d) b.setRange(2,0);
-        BoxArray ba2d(std::move(bl2d));
-        const DistributionMapping& dm = mf.DistributionMap();
-        const int ncomp   = 1;
+    }
+    { // Nodal in y
+        auto& mf = vars_old[lev][Vars::yvel];
         IntVect ng = mf.nGrowVect(); ng[2]=0;
-
-          m_fields[lev][1] = mfp;
-        m_averages[lev][1] = new MultiFab(ba2d,dm,ncomp,ng);
+        m_averages[lev][1] = new MultiFab(make_2d(mf.boxArray()),mf.DistributionMap(),ncomp,ng);
         m_averages[lev][1]->setVal(1.E34);
-      }
-      { // CC vars
-        auto& mf  = *Theta_prim[lev];
-        MultiFab* mfp = Theta_prim[lev].get();
-        // Create a 2D ba, dm, & ghost cells
-        const BoxArray& ba  = mf.boxArray();
-        BoxList bl2d = ba.boxList();
-        for (auto& b : bl2d) b.setRange(2,0);
-        BoxArray ba2d(std::move(bl2d));
+    }
+    { // CC vars
+        auto& mf = *Theta_prim[lev];
+        BoxArray ba2d = make_2d(mf.boxArray());
         const DistributionMapping& dm = mf.DistributionMap();
-        const int ncomp   = 1;
-        const int incomp  = 1;
         IntVect ng = mf.nGrowVect(); ng[2]=0;
 
-          m_fields[lev][2] = mfp;
         m_averages[lev][2] = new MultiFab(ba2d,dm,ncomp,ng);
         m_averages[lev][2]->setVal(1.E34);
 
         m_averages[lev][3] = new MultiFab(ba2d,dm,ncomp,ng);
         m_averages[lev][3]->setVal(1.E34);
 
-        if (m_z_phys_nd[0] && m_norm_vec && m_interp) {
-            m_x_pos[lev] = new MultiFab(ba2d,dm,ncomp,ng);
-            m_y_pos[lev] = new MultiFab(ba2d,dm,ncomp,ng);
-            m_z_pos[lev] = new MultiFab(ba2d,dm,ncomp,ng);
-        } else if (m_z_phys_nd[0] && m_interp) {
+        if (m_z_phys_nd[0] && m_interp) {
             m_x_pos[lev] = new MultiFab(ba2d,dm,ncomp,ng);
             m_y_pos[lev] = new MultiFab(ba2d,dm,ncomp,ng);
             m_z_pos[lev] = new MultiFab(ba2d,dm,ncomp,ng);
@@ -120,50 +183,52 @@ MOSTAverage::MOSTAverage (Vector<Geometry>  geom,
         } else {
             m_k_indx[lev] = new iMultiFab(ba2d,dm,incomp,ng);
         }
-      }
-    } // lev
-
-    // Setup auxiliary data for spatial configuration & policy
-    //--------------------------------------------------------
-    if (m_z_phys_nd[0] && m_norm_vec && m_interp) { // Terrain w/ norm & w/ interpolation
-        set_norm_positions_T();
-    } else if (m_z_phys_nd[0] && m_interp) {        // Terrain w/ interpolation
-        set_z_positions_T();
-    } else if (m_z_phys_nd[0] && m_norm_vec) {      // Terrain w/ norm & w/o interpolation
-        set_norm_indices_T();
-    } else if (m_z_phys_nd[0]) {                    // Terrain
-        set_k_indices_T();
-    } else {                                        // No Terrain
-        set_k_indices_N();
     }
+}
 
-    // Setup normalization data for the chosen policy
-    //--------------------------------------------------------
-    switch(m_policy) {
-    case 0: // Plane average
-        set_plane_normalization();
-        break;
-    case 1: // Local region/point
-        set_region_normalization();
-        break;
-    default:
-        AMREX_ASSERT_WITH_MESSAGE(false, "Unknown policy for MOSTAverage!");
+
+/**
+ * Function to release the 2D data on one level.
+ *
+ * @param[in] lev Current level
+ */
+void
+MOSTAverage::clear_level (int lev)
+{
+    for (int iavg(0); iavg<m_navg; ++iavg) {
+        delete m_averages[lev][iavg]; m_averages[lev][iavg] = nullptr;
     }
 
-    // Set up the exponential time filtering
-    //--------------------------------------------------------
-    if (m_t_avg) {
-        // m_time_window is normalized by the time-step "dt"
-        pp.query("most.time_window", m_time_window);
+    delete m_x_pos[lev]; m_x_pos[lev] = nullptr;
+    delete m_y_pos[lev]; m_y_pos[lev] = nullptr;
+    delete m_z_pos[lev]; m_z_pos[lev] = nullptr;
 
-        // Exponential filter function
-        m_fact_old = std::exp(-1.0 / m_time_window);
+    delete m_i_indx[lev]; m_i_indx[lev] = nullptr;
+    delete m_j_indx[lev]; m_j_indx[lev] = nullptr;
+    delete m_k_indx[lev]; m_k_indx[lev] = nullptr;
+}
 
-        // Enforce discrete normalization: (mfn*val_new + mfo*val_old)
-        m_fact_new = 1.0 - m_fact_old;
 
-        // None of the averages are initialized
-        m_t_init.resize(m_maxlev,0);
+/**
+ * Function to (re)compute the index or position maps on one level for the
+ * spatial configuration. With moving terrain this is called every time
+ * the terrain heights change.
+ *
+ * @param[in] lev Current level
+ */
+void
+MOSTAverage::set_level_maps (int lev)
+{
+    if (m_z_phys_nd[0] && m_norm_vec && m_interp) { // Terrain w/ norm & w/ interpolation
+        set_norm_positions_T(lev);
+    } else if (m_z_phys_nd[0] && m_interp) {        // Terrain w/ interpolation
+        set_z_positions_T(lev);
+    } else if (m_z_phys_nd[0] && m_norm_vec) {      // Terrain w/ norm & w/o interpolation
+        set_norm_indices_T(lev);
+    } else if (m_z_phys_nd[0]) {                    // Terrain
+        set_k_indices_T(lev);
+    } else {                                        // No Terrain
+        set_k_indices_N(lev);
     }
 }
 
@@ -189,54 +254,49 @@ MOSTAverage::update_field_ptrs(int lev,
 /**
  * Function to compute normalization for plane average.
  *
+ * @param[in] lev Current level
  */
 void
-MOSTAverage::set_plane_normalization()
+MOSTAverage::set_plane_normalization(int lev)
 {
-    // Cells per plane and temp avg storage
-    m_ncell_plane.resize(m_maxlev);
-    m_plane_average.resize(m_maxlev);
-
-    for (int lev(0); lev < m_maxlev; lev++) {
-        // Num components, plane avg, cells per plane
-        Array<int,AMREX_SPACEDIM> is_per = {0,0,0};
-        for (int idim(0); idim < AMREX_SPACEDIM-1; ++idim) {
-            if (m_geom[lev].isPeriodic(idim)) is_per[idim] = 1;
-        }
-        Box domain = m_geom[lev].Domain();
-        m_ncell_plane[lev].resize(m_navg);
-        m_plane_average[lev].resize(m_navg);
-        for (int iavg(0); iavg < m_navg; ++iavg) {
-            // Convert domain to current index type
-            IndexType ixt = m_averages[lev][iavg]->boxArray().ixType();
-            domain.convert(ixt);
-            IntVect dom_lo(domain.loVect());
-            IntVect dom_hi(domain.hiVect());
-
-            m_plane_average[lev][iavg] = 0.0;
-
-            m_ncell_plane[lev][iavg] = 1;
-            for (int idim(0); idim < AMREX_SPACEDIM; ++idim) {
-                if (idim != 2) {
-                    if (ixt.nodeCentered(idim) && is_per[idim]) {
-                        m_ncell_plane[lev][iavg] *= (dom_hi[idim] - dom_lo[idim]);
-                    } else {
-                        m_ncell_plane[lev][iavg] *= (dom_hi[idim] - dom_lo[idim] + 1);
-                    }
+    // Num components, plane avg, cells per plane
+    Array<int,AMREX_SPACEDIM> is_per = {0,0,0};
+    for (int idim(0); idim < AMREX_SPACEDIM-1; ++idim) {
+        if (m_geom[lev].isPeriodic(idim)) is_per[idim] = 1;
+    }
+    Box domain = m_geom[lev].Domain();
+    m_ncell_plane[lev].resize(m_navg);
+    m_plane_average[lev].resize(m_navg);
+    for (int iavg(0); iavg < m_navg; ++iavg) {
+        // Convert domain to current index type
+        IndexType ixt = m_averages[lev][iavg]->boxArray().ixType();
+        domain.convert(ixt);
+        IntVect dom_lo(domain.loVect());
+        IntVect dom_hi(domain.hiVect());
+
+        m_plane_average[lev][iavg] = 0.0;
+
+        m_ncell_plane[lev][iavg] = 1;
+        for (int idim(0); idim < AMREX_SPACEDIM; ++idim) {
+            if (idim != 2) {
+                if (ixt.nodeCentered(idim) && is_per[idim]) {
+                    m_ncell_plane[lev][iavg] *= (dom_hi[idim] - dom_lo[idim]);
+                } else {
+                    m_ncell_plane[lev][iavg] *= (dom_hi[idim] - dom_lo[idim] + 1);
                 }
-            } // idim
-        } // iavg
-    } // lev
-
+            }
+        } // idim
+    } // iavg
 }
 
 
 /**
  * Function to set K indices without terrain.
  *
+ * @param[in] lev Current level
  */
 void
-MOSTAverage::set_k_indices_N()
+MOSTAverage::set_k_indices_N(int lev)
 {
     ParmParse pp(m_pp_prefix);
     auto read_z = pp.query("most.zref",m_zref);
@@ -244,26 +304,22 @@ MOSTAverage::set_k_indices_N()
 
     // Specify z_ref & compute k_indx (z_ref takes precedence)
     if (read_z) {
-        for (int lev(0); lev < m_maxlev; lev++) {
-            Real m_zlo = m_geom[lev].ProbLo(2);
-            Real m_dz  = m_geom[lev].CellSize(2);
+        Real m_zlo = m_geom[lev].ProbLo(2);
+        Real m_dz  = m_geom[lev].CellSize(2);
 
-            AMREX_ASSERT_WITH_MESSAGE(m_zref >= m_zlo + 0.5 * m_dz,
-                                      "Query point must be past first z-cell!");
+        AMREX_ASSERT_WITH_MESSAGE(m_zref >= m_zlo + 0.5 * m_dz,
+                                  "Query point must be past first z-cell!");
 
-            int lk = static_cast<int>(floor((m_zref - m_zlo) / m_dz - 0.5));
+        int lk = static_cast<int>(floor((m_zref - m_zlo) / m_dz - 0.5));
 
-            AMREX_ALWAYS_ASSERT(lk >= m_radius);
+        AMREX_ALWAYS_ASSERT(lk >= m_radius);
 
-            m_k_indx[lev]->setVal(lk);
-        }
+        m_k_indx[lev]->setVal(lk);
     // Specified k_indx & compute z_ref
     } else if (read_k) {
-        for (int lev(0); lev < m_maxlev; lev++){
-            AMREX_ASSERT_WITH_MESSAGE(m_k_in[lev] >= m_radius,
-                                      "K index must be larger than averaging radius!");
-            m_k_indx[lev]->setVal(m_k_in[lev]);
-        }
+        AMREX_ASSERT_WITH_MESSAGE(m_k_in[lev] >= m_radius,
+                                  "K index must be larger than averaging radius!");
+        m_k_indx[lev]->setVal(m_k_in[lev]);
 
         // TODO: check that z_ref is constant across levels
         Real m_zlo = m_geom[0].ProbLo(2);
@@ -276,9 +332,10 @@ MOSTAverage::set_k_indices_N()
 /**
  * Function to set K indices with terrain.
  *
+ * @param[in] lev Current level
  */
 void
-MOSTAverage::set_k_indices_T()
+MOSTAverage::set_k_indices_T(int lev)
 {
     ParmParse pp(m_pp_prefix);
     auto read_z = pp.query("most.zref",m_zref);
@@ -290,29 +347,21 @@ MOSTAverage::set_k_indices_T()
 
     // Specify z_ref & compute k_indx (z_ref takes precedence)
     if (read_z) {
-        for (int lev(0); lev < m_maxlev; lev++) {
-            int kmax = m_geom[lev].Domain().bigEnd(2);
-            for (MFIter mfi(*m_k_indx[lev], TileNoZ()); mfi.isValid(); ++mfi) {
-                Box npbx  = mfi.tilebox(); npbx.convert({1,1,0});
-                const auto z_phys_arr = m_z_phys_nd[lev]->const_array(mfi);
-                auto k_arr = m_k_indx[lev]->array(mfi);
-                ParallelFor(npbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
-                {
-                    Real z_target = d_zref + z_phys_arr(i,j,k);
-                    for (int lk(0); lk<=kmax; ++lk) {
-                        Real z_lo = 0.25 * ( z_phys_arr(i,j  ,lk  ) + z_phys_arr(i+1,j  ,lk  )
-                                                  + z_phys_arr(i,j+1,lk  ) + z_phys_arr(i+1,j+1,lk  ) );
-                        Real z_hi = 0.25 * ( z_phys_arr(i,j  ,lk+1) + z_phys_arr(i+1,j  ,lk+1)
-                                                  + z_phys_arr(i,j+1,lk+1) + z_phys_arr(i+1,j+1,lk+1) );
-                        if (z_target > z_lo && z_target < z_hi){
-                            AMREX_ASSERT_WITH_MESSAGE(lk >= d_radius,
-                                                      "K index must be larger than averaging radius!");
-                            k_arr(i,j,k) = lk;
-                            break;
-                        }
-                    }
-                });
-            }
+        int kmax = m_geom[lev].Domain().bigEnd(2);
+        for (MFIter mfi(*m_k_indx[lev], TileNoZ()); mfi.isValid(); ++mfi) {
+            Box npbx  = mfi.tilebox(); npbx.convert({1,1,0});
+            const auto z_phys_arr = m_z_phys_nd[lev]->const_array(mfi);
+            auto k_arr = m_k_indx[lev]->array(mfi);
+            ParallelFor(npbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+            {
+                Real z_target = d_zref + z_phys_arr(i,j,k);
+                int lk = find_k_index(i, j, z_target, 0, kmax, z_phys_arr);
+                if (lk >= 0) {
+                    AMREX_ASSERT_WITH_MESSAGE(lk >= d_radius,
+                                              "K index must be larger than averaging radius!");
+                    k_arr(i,j,k) = lk;
+                }
+            });
         }
     // Specified k_indx & compute z_ref
     } else if (read_k) {
@@ -324,9 +373,10 @@ MOSTAverage::set_k_indices_T()
 /**
  * Function to set I,J,K indices with terrain normals.
  *
+ * @param[in] lev Current level
  */
 void
-MOSTAverage::set_norm_indices_T()
+MOSTAverage::set_norm_indices_T(int lev)
 {
     ParmParse pp(m_pp_prefix);
     pp.query("most.zref",m_zref);
@@ -335,57 +385,49 @@ MOSTAverage::set_norm_indices_T()
     Real d_zref   = m_zref;
     Real d_radius = m_radius;
 
-    for (int lev(0); lev < m_maxlev; lev++) {
-        int kmax = m_geom[lev].Domain().bigEnd(2);
-        const auto dxInv  = m_geom[lev].InvCellSizeArray();
-        IntVect ng = m_k_indx[lev]->nGrowVect(); ng[2]=0;
-        for (MFIter mfi(*m_k_indx[lev], TileNoZ()); mfi.isValid(); ++mfi) {
-            Box npbx  = mfi.tilebox(); npbx.convert({1,1,0});
-            Box gpbx  = mfi.growntilebox(ng);
-            const auto z_phys_arr = m_z_phys_nd[lev]->const_array(mfi);
-            auto i_arr = m_i_indx[lev]->array(mfi);
-            auto j_arr = m_j_indx[lev]->array(mfi);
-            auto k_arr = m_k_indx[lev]->array(mfi);
-            ParallelFor(npbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
-            {
-                // Elements of normal vector
-                Real met_h_xi  = Compute_h_xi_AtCellCenter (i,j,k,dxInv,z_phys_arr);
-                Real met_h_eta = Compute_h_eta_AtCellCenter(i,j,k,dxInv,z_phys_arr);
-                Real mag = std::sqrt(met_h_xi*met_h_xi + met_h_eta*met_h_eta + 1.0);
-
-                // Unit-normal vector scaled by z_ref
-                Real delta_x = -met_h_xi/mag  * d_zref;
-                Real delta_y = -met_h_eta/mag * d_zref;
-                Real delta_z = 1.0/mag * d_zref;
-
-                // Compute i & j as displacements (no grid stretching)
-                int delta_i  = static_cast<int>(std::round(delta_x*dxInv[0]));
-                int delta_j  = static_cast<int>(std::round(delta_y*dxInv[1]));
-                int i_new    = i + delta_i;
-                int j_new    = j + delta_j;
-                i_arr(i,j,k) = i_new;
-                j_arr(i,j,k) = j_new;
-
-                // Search for k (grid is stretched in z)
-                Real z_target = delta_z + z_phys_arr(i,j,k);
-                for (int lk(0); lk<=kmax; ++lk) {
-                    Real z_lo = 0.25 * ( z_phys_arr(i_new,j_new  ,lk  ) + z_phys_arr(i_new+1,j_new  ,lk  )
-                                              + z_phys_arr(i_new,j_new+1,lk  ) + z_phys_arr(i_new+1,j_new+1,lk  ) );
-                    Real z_hi = 0.25 * ( z_phys_arr(i_new,j_new  ,lk+1) + z_phys_arr(i_new+1,j_new  ,lk+1)
-                                              + z_phys_arr(i_new,j_new+1,lk+1) + z_phys_arr(i_new+1,j_new+1,lk+1) );
-                    if (z_target > z_lo && z_target < z_hi){
-                        AMREX_ASSERT_WITH_MESSAGE(lk >= d_radius,
-                                                  "K index must be larger than averaging radius!");
-                        k_arr(i,j,k) = lk;
-                        break;
-                    }
-                }
+    int kmax = m_geom[lev].Domain().bigEnd(2);
+    const auto dxInv  = m_geom[lev].InvCellSizeArray();
+    IntVect ng = m_k_indx[lev]->nGrowVect(); ng[2]=0;
+    for (MFIter mfi(*m_k_indx[lev], TileNoZ()); mfi.isValid(); ++mfi) {
+        Box npbx  = mfi.tilebox(); npbx.convert({1,1,0});
+        Box gpbx  = mfi.growntilebox(ng);
+        const auto z_phys_arr = m_z_phys_nd[lev]->const_array(mfi);
+        auto i_arr = m_i_indx[lev]->array(mfi);
+        auto j_arr = m_j_indx[lev]->array(mfi);
+        auto k_arr = m_k_indx[lev]->array(mfi);
+        ParallelFor(npbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            // Elements of normal vector
+            Real met_h_xi  = Compute_h_xi_AtCellCenter (i,j,k,dxInv,z_phys_arr);
+            Real met_h_eta = Compute_h_eta_AtCellCenter(i,j,k,dxInv,z_phys_arr);
+            Real mag = std::sqrt(met_h_xi*met_h_xi + met_h_eta*met_h_eta + 1.0);
+
+            // Unit-normal vector scaled by z_ref
+            Real delta_x = -met_h_xi/mag  * d_zref;
+            Real delta_y = -met_h_eta/mag * d_zref;
+            Real delta_z = 1.0/mag * d_zref;
+
+            // Compute i & j as displacements (no grid stretching)
+            int delta_i  = static_cast<int>(std::round(delta_x*dxInv[0]));
+            int delta_j  = static_cast<int>(std::round(delta_y*dxInv[1]));
+            int i_new    = i + delta_i;
+            int j_new    = j + delta_j;
+            i_arr(i,j,k) = i_new;
+            j_arr(i,j,k) = j_new;
+
+            // Search for k (grid is stretched in z)
+            Real z_target = delta_z + z_phys_arr(i,j,k);
+            int lk = find_k_index(i_new, j_new, z_target, 0, kmax, z_phys_arr);
+            if (lk >= 0) {
+                AMREX_ASSERT_WITH_MESSAGE(lk >= d_radius,
+                                          "K index must be larger than averaging radius!");
+                k_arr(i,j,k) = lk;
+            }
 
-                // Destination cell must be contained on the current process!
-                AMREX_ASSERT_WITH_MESSAGE(gpbx.contains(i_arr(i,j,k),j_arr(i,j,k),k_arr(i,j,k)),
-                                          "Query index outside of proc domain!");
-            });
-        }
+            // Destination cell must be contained on the current process!
+            AMREX_ASSERT_WITH_MESSAGE(gpbx.contains(i_arr(i,j,k),j_arr(i,j,k),k_arr(i,j,k)),
+                                      "Query index outside of proc domain!");
+        });
     }
 }
 
@@ -393,9 +435,10 @@ MOSTAverage::set_norm_indices_T()
 /**
  * Function to set positions with terrain and e_z vector.
  *
+ * @param[in] lev Current level
  */
 void
-MOSTAverage::set_z_positions_T()
+MOSTAverage::set_z_positions_T(int lev)
 {
     ParmParse pp(m_pp_prefix);
     pp.query("most.zref",m_zref);
@@ -403,32 +446,30 @@ MOSTAverage::set_z_positions_T()
     // Capture for device
     Real d_zref = m_zref;
 
-    for (int lev(0); lev < m_maxlev; lev++) {
-        RealVect base;
-        const auto dx = m_geom[lev].CellSizeArray();
-        IntVect ng = m_x_pos[lev]->nGrowVect(); ng[2]=0;
-        for (MFIter mfi(*m_x_pos[lev], TileNoZ()); mfi.isValid(); ++mfi) {
-            Box npbx  = mfi.tilebox(); npbx.convert({1,1,0});
-            Box gpbx  = mfi.growntilebox(ng);
-            RealBox grb{gpbx,dx.data(),base.dataPtr()};
-
-            const auto z_phys_arr = m_z_phys_nd[lev]->const_array(mfi);
-            auto x_pos_arr   = m_x_pos[lev]->array(mfi);
-            auto y_pos_arr   = m_y_pos[lev]->array(mfi);
-            auto z_pos_arr   = m_z_pos[lev]->array(mfi);
-            ParallelFor(npbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
-            {
-                // Final position at end of vector
-                x_pos_arr(i,j,k) = ((Real) i + 0.5) * dx[0];
-                y_pos_arr(i,j,k) = ((Real) j + 0.5) * dx[1];
-                z_pos_arr(i,j,k) = z_phys_arr(i,j,k) + d_zref;
-
-                // Destination position must be contained on the current process!
-                Real pos[] = {x_pos_arr(i,j,k),y_pos_arr(i,j,k),0.5*dx[2]};
-                AMREX_ASSERT_WITH_MESSAGE( grb.contains(&pos[0]),
-                                           "Query point outside of proc domain!");
-            });
-        }
+    RealVect base;
+    const auto dx = m_geom[lev].CellSizeArray();
+    IntVect ng = m_x_pos[lev]->nGrowVect(); ng[2]=0;
+    for (MFIter mfi(*m_x_pos[lev], TileNoZ()); mfi.isValid(); ++mfi) {
+        Box npbx  = mfi.tilebox(); npbx.convert({1,1,0});
+        Box gpbx  = mfi.growntilebox(ng);
+        RealBox grb{gpbx,dx.data(),base.dataPtr()};
+
+        const auto z_phys_arr = m_z_phys_nd[lev]->const_array(mfi);
+        auto x_pos_arr   = m_x_pos[lev]->array(mfi);
+        auto y_pos_arr   = m_y_pos[lev]->array(mfi);
+        auto z_pos_arr   = m_z_pos[lev]->array(mfi);
+        ParallelFor(npbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            // Final position at end of vector
+            x_pos_arr(i,j,k) = ((Real) i + 0.5) * dx[0];
+            y_pos_arr(i,j,k) = ((Real) j + 0.5) * dx[1];
+            z_pos_arr(i,j,k) = z_phys_arr(i,j,k) + d_zref;
+
+            // Destination position must be contained on the current process!
+            Real pos[] = {x_pos_arr(i,j,k),y_pos_arr(i,j,k),0.5*dx[2]};
+            AMREX_ASSERT_WITH_MESSAGE( grb.contains(&pos[0]),
+                                       "Query point outside of proc domain!");
+        });
     }
 }
 
@@ -436,9 +477,10 @@ MOSTAverage::set_z_positions_T()
 /**
  * Function to set positions with terrain and normal vector.
  *
+ * @param[in] lev Current level
  */
 void
-MOSTAverage::set_norm_positions_T()
+MOSTAverage::set_norm_positions_T(int lev)
 {
     ParmParse pp(m_pp_prefix);
     pp.query("most.zref",m_zref);
@@ -446,47 +488,45 @@ MOSTAverage::set_norm_positions_T()
     // Capture for device
     Real d_zref = m_zref;
 
-    for (int lev(0); lev < m_maxlev; lev++) {
-        RealVect base;
-        const auto dx = m_geom[lev].CellSizeArray();
-        const auto dxInv  = m_geom[lev].InvCellSizeArray();
-        IntVect ng = m_x_pos[lev]->nGrowVect(); ng[2]=0;
-        for (MFIter mfi(*m_x_pos[lev], TileNoZ()); mfi.isValid(); ++mfi) {
-            Box npbx  = mfi.tilebox(); npbx.convert({1,1,0});
-            Box gpbx  = mfi.growntilebox(ng);
-            RealBox grb{gpbx,dx.data(),base.dataPtr()};
-
-            const auto z_phys_arr = m_z_phys_nd[lev]->const_array(mfi);
-            auto x_pos_arr   = m_x_pos[lev]->array(mfi);
-            auto y_pos_arr   = m_y_pos[lev]->array(mfi);
-            auto z_pos_arr   = m_z_pos[lev]->array(mfi);
-            ParallelFor(npbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
-            {
-                // Elements of normal vector
-                Real met_h_xi  = Compute_h_xi_AtCellCenter (i,j,k,dxInv,z_phys_arr);
-                Real met_h_eta = Compute_h_eta_AtCellCenter(i,j,k,dxInv,z_phys_arr);
-                Real mag = std::sqrt(met_h_xi*met_h_xi + met_h_eta*met_h_eta + 1.0);
-
-                // Unit-normal vector scaled by z_ref
-                Real delta_x = -met_h_xi/mag  * d_zref;
-                Real delta_y = -met_h_eta/mag * d_zref;
-                Real delta_z = 1.0/mag * d_zref;
-
-                // Position of the current node (indx:0,0,1)
-                Real x0 = ((Real) i + 0.5) * dx[0];
-                Real y0 = ((Real) j + 0.5) * dx[1];
-
-                // Final position at end of vector
-                x_pos_arr(i,j,k) = x0 + delta_x;
-                y_pos_arr(i,j,k) = y0 + delta_y;
-                z_pos_arr(i,j,k) = z_phys_arr(i,j,k) + delta_z;
-
-                // Destination position must be contained on the current process!
-                Real pos[] = {x_pos_arr(i,j,k),y_pos_arr(i,j,k),0.5*dx[2]};
-                AMREX_ASSERT_WITH_MESSAGE( grb.contains(&pos[0]),
-                                           "Query point outside of proc domain!");
-            });
-        }
+    RealVect base;
+    const auto dx = m_geom[lev].CellSizeArray();
+    const auto dxInv  = m_geom[lev].InvCellSizeArray();
+    IntVect ng = m_x_pos[lev]->nGrowVect(); ng[2]=0;
+    for (MFIter mfi(*m_x_pos[lev], TileNoZ()); mfi.isValid(); ++mfi) {
+        Box npbx  = mfi.tilebox(); npbx.convert({1,1,0});
+        Box gpbx  = mfi.growntilebox(ng);
+        RealBox grb{gpbx,dx.data(),base.dataPtr()};
+
+        const auto z_phys_arr = m_z_phys_nd[lev]->const_array(mfi);
+        auto x_pos_arr   = m_x_pos[lev]->array(mfi);
+        auto y_pos_arr   = m_y_pos[lev]->array(mfi);
+        auto z_pos_arr   = m_z_pos[lev]->array(mfi);
+        ParallelFor(npbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            // Elements of normal vector
+            Real met_h_xi  = Compute_h_xi_AtCellCenter (i,j,k,dxInv,z_phys_arr);
+            Real met_h_eta = Compute_h_eta_AtCellCenter(i,j,k,dxInv,z_phys_arr);
+            Real mag = std::sqrt(met_h_xi*met_h_xi + met_h_eta*met_h_eta + 1.0);
+
+            // Unit-normal vector scaled by z_ref
+            Real delta_x = -met_h_xi/mag  * d_zref;
+            Real delta_y = -met_h_eta/mag * d_zref;
+            Real delta_z = 1.0/mag * d_zref;
+
+            // Position of the current node (indx:0,0,1)
+            Real x0 = ((Real) i + 0.5) * dx[0];
+            Real y0 = ((Real) j + 0.5) * dx[1];
+
+            // Final position at end of vector
+            x_pos_arr(i,j,k) = x0 + delta_x;
+            y_pos_arr(i,j,k) = y0 + delta_y;
+            z_pos_arr(i,j,k) = z_phys_arr(i,j,k) + delta_z;
+
+            // Destination position must be contained on the current process!
+            Real pos[] = {x_pos_arr(i,j,k),y_pos_arr(i,j,k),0.5*dx[2]};
+            AMREX_ASSERT_WITH_MESSAGE( grb.contains(&pos[0]),
+                                       "Query point outside of proc domain!");
+        });
     }
 }
 
@@ -518,11 +558,17 @@ MOSTAverage::compute_averages(int lev)
 /**
  * Function to compute average over a plane.
  *
+ * All four averages (U, V, T, Umag) are summed in a single pass over the
+ * plane with thread-private partial sums, followed by one reduction over
+ * the ranks.
+ *
  * @param[in] lev Current level
  */
 void
 MOSTAverage::compute_plane_averages(int lev)
 {
+    AMREX_ALWAYS_ASSERT(m_navg == 4);
+
     // Peel back the level
     auto& fields   = m_fields[lev];
     auto& averages = m_averages[lev];
@@ -550,13 +596,13 @@ MOSTAverage::compute_plane_averages(int lev)
         d_fact_old = 0.0;
     }
 
-    // GPU array to accumulate averages into
-    Gpu::DeviceVector<Real> pavg(plane_average.size(), 0.0);
-    Real* plane_avg = pavg.data();
-
     // Vectors for normalization and buffer storage
     Vector<Real> denom(plane_average.size(),0.0);
     Vector<Real> val_old(plane_average.size(),0.0);
+    for (int iavg(0); iavg < m_navg; ++iavg) {
+        denom[iavg]   = 1.0 / (Real)ncell_plane[iavg];
+        val_old[iavg] = plane_average[iavg]*d_fact_old;
+    }
 
     // Averages over all the fields
     //----------------------------------------------------------
@@ -567,129 +613,100 @@ MOSTAverage::compute_plane_averages(int lev)
         if (geom.isPeriodic(idim)) is_per[idim] = 1;
     }
 
-    for (int imf(0); imf < m_nvar; ++imf) {
-        denom[imf]   = 1.0 / (Real)ncell_plane[imf];
-        val_old[imf] = plane_average[imf]*d_fact_old;
+    const auto plo   = geom.ProbLoArray();
+    const auto dxInv = geom.InvCellSizeArray();
+
+    ReduceOps<ReduceOpSum, ReduceOpSum, ReduceOpSum, ReduceOpSum> reduce_op;
+    ReduceData<Real, Real, Real, Real> reduce_data(reduce_op);
+    using ReduceTuple = typename decltype(reduce_data)::Type;
 
 #ifdef _OPENMP
 #pragma omp parallel if (Gpu::notInLaunchRegion())
 #endif
-        for (MFIter mfi(*fields[imf], TileNoZ()); mfi.isValid(); ++mfi) {
-            Box vbx = mfi.validbox(); // This is the grid (not tile)
-            Box pbx = mfi.tilebox();  // This is the tile (not grid)
-            pbx.setSmall(2,0); pbx.setBig(2,0);
-
-            // Avoid double counting nodal data by changing the high end when we are
-            //     at the high side of the grid (not just of the tile)
-            IndexType ixt = averages[imf]->boxArray().ixType();
-            for (int idim(0); idim < AMREX_SPACEDIM-1; ++idim) {
-                if ( ixt.nodeCentered(idim)  && (pbx.bigEnd(idim) == vbx.bigEnd(idim)) ) {
-                    int dom_hi = domain.bigEnd(idim)+1;
-                    if (pbx.bigEnd(idim) < dom_hi || is_per[idim]) {
-                        pbx.growHi(idim,-1);
-                    }
-                }
-            }
-
-            auto mf_arr = fields[imf]->const_array(mfi);
-
-            if (m_interp) {
-                const auto plo   = geom.ProbLoArray();
-                const auto dxInv = geom.InvCellSizeArray();
-                const auto z_phys_arr = z_phys->const_array(mfi);
-                auto x_pos_arr = x_pos->array(mfi);
-                auto y_pos_arr = y_pos->array(mfi);
-                auto z_pos_arr = z_pos->array(mfi);
-                ParallelFor(Gpu::KernelInfo().setReduction(true), pbx, [=]
-                AMREX_GPU_DEVICE(int i, int j, int k, Gpu::Handler const& handler) noexcept
-                {
-                    Real interp{0};
-                    trilinear_interp_T(x_pos_arr(i,j,k), y_pos_arr(i,j,k), z_pos_arr(i,j,k),
-                                       &interp, mf_arr, z_phys_arr, plo, dxInv, 1);
-                    Real val = interp;
-                    Gpu::deviceReduceSum(&plane_avg[imf], val, handler);
-                });
-            } else {
-                auto k_arr  = k_indx->const_array(mfi);
-                auto j_arr  = j_indx ? j_indx->const_array(mfi) : Array4<const int> {};
-                auto i_arr  = i_indx ? i_indx->const_array(mfi) : Array4<const int> {};
-                ParallelFor(Gpu::KernelInfo().setReduction(true), pbx, [=]
-                AMREX_GPU_DEVICE(int i, int j, int k, Gpu::Handler const& handler) noexcept
-                {
-                    int mk = k_arr(i,j,k);
-                    int mj = j_arr ? j_arr(i,j,k) : j;
-                    int mi = i_arr ? i_arr(i,j,k) : i;
-                    Real val = mf_arr(mi,mj,mk);
-                    Gpu::deviceReduceSum(&plane_avg[imf], val, handler);
-                });
+    for (MFIter mfi(*averages[2], TileNoZ()); mfi.isValid(); ++mfi) {
+        Box vbx = mfi.validbox(); // This is the grid (not tile)
+        Box tbx = mfi.tilebox();  // This is the tile (not grid)
+        tbx.setSmall(2,0); tbx.setBig(2,0);
+
+        // U is nodal in x and V in y. Avoid double counting nodal data by only including
+        //     the last node of the grid at a non-periodic domain boundary
+        Box ubx = tbx;
+        Box wbx = tbx;
+        for (int idim(0); idim < AMREX_SPACEDIM-1; ++idim) {
+            Box& nbx = (idim == 0) ? ubx : wbx;
+            if ( (tbx.bigEnd(idim) == vbx.bigEnd(idim)) &&
+                 (vbx.bigEnd(idim) == domain.bigEnd(idim)) && !is_per[idim] ) {
+                nbx.growHi(idim,1);
             }
         }
-    }
 
-    //
-    //------------------------------------------------------------------------
-    // Averages for the tangential velocity magnitude
-    // (This is cell-centered so we don't need to worry about double-counting)
-    //------------------------------------------------------------------------
-    //
-    {
-        int imf  = 0;
-        int iavg = m_navg - 1;
-        denom[iavg]   = 1.0 / (Real)ncell_plane[iavg];
-        val_old[iavg] = plane_average[iavg]*d_fact_old;
+        // The union of the boxes; T and Umag are cell centered (tbx)
+        Box gbx = tbx; gbx.growHi(0,1); gbx.growHi(1,1);
 
-#ifdef _OPENMP
-#pragma omp parallel if (Gpu::notInLaunchRegion())
-#endif
-        for (MFIter mfi(*averages[iavg], TileNoZ()); mfi.isValid(); ++mfi)
-        {
-            Box pbx = mfi.tilebox();
-            pbx.setSmall(2,0); pbx.setBig(2,0);
+        auto u_mf_arr = fields[0]->const_array(mfi);
+        auto v_mf_arr = fields[1]->const_array(mfi);
+        auto t_mf_arr = fields[2]->const_array(mfi);
 
-            // Last element is Umag and always cell centered
-            auto u_mf_arr = fields[imf  ]->const_array(mfi);
-            auto v_mf_arr = fields[imf+1]->const_array(mfi);
+        if (m_interp) {
+            const auto z_phys_arr = z_phys->const_array(mfi);
+            auto x_pos_arr = x_pos->const_array(mfi);
+            auto y_pos_arr = y_pos->const_array(mfi);
+            auto z_pos_arr = z_pos->const_array(mfi);
+            reduce_op.eval(gbx, reduce_data,
+            [=] AMREX_GPU_DEVICE (int i, int j, int k) -> ReduceTuple
+            {
+                const Real xp = x_pos_arr(i,j,k);
+                const Real yp = y_pos_arr(i,j,k);
+                const Real zp = z_pos_arr(i,j,k);
 
-            if (m_interp) {
-                const auto plo   = m_geom[lev].ProbLoArray();
-                const auto dxInv = m_geom[lev].InvCellSizeArray();
-                const auto z_phys_arr = z_phys->const_array(mfi);
-                auto x_pos_arr = x_pos->array(mfi);
-                auto y_pos_arr = y_pos->array(mfi);
-                auto z_pos_arr = z_pos->array(mfi);
-                ParallelFor(Gpu::KernelInfo().setReduction(true), pbx, [=]
-                AMREX_GPU_DEVICE(int i, int j, int k, Gpu::Handler const& handler) noexcept
-                {
+                Real u_val{0}, v_val{0}, t_val{0}, m_val{0};
+                if (ubx.contains(i,j,k)) {
+                    trilinear_interp_T(xp, yp, zp, &u_val, u_mf_arr, z_phys_arr, plo, dxInv, 1);
+                }
+                if (wbx.contains(i,j,k)) {
+                    trilinear_interp_T(xp, yp, zp, &v_val, v_mf_arr, z_phys_arr, plo, dxInv, 1);
+                }
+                if (tbx.contains(i,j,k)) {
                     Real u_interp{0};
                     Real v_interp{0};
-                    trilinear_interp_T(x_pos_arr(i,j,k), y_pos_arr(i,j,k), z_pos_arr(i,j,k),
-                                            &u_interp, u_mf_arr, z_phys_arr, plo, dxInv, 1);
-                    trilinear_interp_T(x_pos_arr(i,j,k), y_pos_arr(i,j,k), z_pos_arr(i,j,k),
-                                            &v_interp, v_mf_arr, z_phys_arr, plo, dxInv, 1);
-                    const Real val   = std::sqrt(u_interp*u_interp + v_interp*v_interp);
-                    Gpu::deviceReduceSum(&plane_avg[iavg], val, handler);
-                });
-            } else {
-                auto k_arr = k_indx->const_array(mfi);
-                auto j_arr = j_indx ? j_indx->const_array(mfi) : Array4<const int> {};
-                auto i_arr = i_indx ? i_indx->const_array(mfi) : Array4<const int> {};
-                ParallelFor(Gpu::KernelInfo().setReduction(true), pbx, [=]
-                AMREX_GPU_DEVICE(int i, int j, int k, Gpu::Handler const& handler) noexcept
-                {
-                    int mk = k_arr(i,j,k);
-                    int mj = j_arr ? j_arr(i,j,k) : j;
-                    int mi = i_arr ? i_arr(i,j,k) : i;
-                    const Real u_val = 0.5 * (u_mf_arr(mi,mj,mk) + u_mf_arr(mi+1,mj  ,mk));
-                    const Real v_val = 0.5 * (v_mf_arr(mi,mj,mk) + v_mf_arr(mi  ,mj+1,mk));
-                    const Real val   = std::sqrt(u_val*u_val + v_val*v_val);
-                    Gpu::deviceReduceSum(&plane_avg[iavg], val, handler);
-                });
-            }
+                    trilinear_interp_T(xp, yp, zp, &t_val   , t_mf_arr, z_phys_arr, plo, dxInv, 1);
+                    trilinear_interp_T(xp, yp, zp, &u_interp, u_mf_arr, z_phys_arr, plo, dxInv, 1);
+                    trilinear_interp_T(xp, yp, zp, &v_interp, v_mf_arr, z_phys_arr, plo, dxInv, 1);
+                    m_val = std::sqrt(u_interp*u_interp + v_interp*v_interp);
+                }
+                return {u_val, v_val, t_val, m_val};
+            });
+        } else {
+            auto k_arr = k_indx->const_array(mfi);
+            auto j_arr = j_indx ? j_indx->const_array(mfi) : Array4<const int> {};
+            auto i_arr = i_indx ? i_indx->const_array(mfi) : Array4<const int> {};
+            reduce_op.eval(gbx, reduce_data,
+            [=] AMREX_GPU_DEVICE (int i, int j, int k) -> ReduceTuple
+            {
+                int mk = k_arr(i,j,k);
+                int mj = j_arr ? j_arr(i,j,k) : j;
+                int mi = i_arr ? i_arr(i,j,k) : i;
+
+                Real u_val{0}, v_val{0}, t_val{0}, m_val{0};
+                if (ubx.contains(i,j,k)) u_val = u_mf_arr(mi,mj,mk);
+                if (wbx.contains(i,j,k)) v_val = v_mf_arr(mi,mj,mk);
+                if (tbx.contains(i,j,k)) {
+                    t_val = t_mf_arr(mi,mj,mk);
+                    const Real u_cc = 0.5 * (u_mf_arr(mi,mj,mk) + u_mf_arr(mi+1,mj  ,mk));
+                    const Real v_cc = 0.5 * (v_mf_arr(mi,mj,mk) + v_mf_arr(mi  ,mj+1,mk));
+                    m_val = std::sqrt(u_cc*u_cc + v_cc*v_cc);
+                }
+                return {u_val, v_val, t_val, m_val};
+            });
         }
     }
 
-    // Copy to host and sum across procs
-    Gpu::copy(Gpu::deviceToHost, pavg.begin(), pavg.end(), plane_average.begin());
+    // Combine the partial sums and sum across procs
+    ReduceTuple hv = reduce_data.value(reduce_op);
+    plane_average[0] = amrex::get<0>(hv);
+    plane_average[1] = amrex::get<1>(hv);
+    plane_average[2] = amrex::get<2>(hv);
+    plane_average[3] = amrex::get<3>(hv);
     ParallelDescriptor::ReduceRealSum(plane_average.data(), plane_average.size());
 
     // No spatial variation with plane averages
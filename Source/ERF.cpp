@@ -20,6 +20,10 @@
 #include <MultiBlockContainer.H>
 #endif
 
+#ifdef ERF_USE_RRTMGP
+#include <Radiation.H>
+#endif
+
 using namespace amrex;
 
 amrex::Real ERF::startCPUTime        = 0.0;
@@ -55,6 +59,7 @@ amrex::Real ERF::sum_per       = -1.0;
 
 // Native AMReX vs NetCDF
 std::string ERF::plotfile_type    = "amrex";
+std::string ERF::plotfile_nc_layout = "blocks";
 
 // init_type:  "ideal", "real", "input_sounding", "metgrid" or ""
 std::string ERF::init_type;
@@ -75,8 +80,9 @@ bool ERF::init_sounding_ideal = false;
 int         ERF::output_1d_column = 0;
 int         ERF::column_interval  = -1;
 amrex::Real ERF::column_per       = -1.0;
-amrex::Real ERF::column_loc_x     = 0.0;
-amrex::Real ERF::column_loc_y     = 0.0;
+amrex::Vector<amrex::Real> ERF::column_loc_x;
+amrex::Vector<amrex::Real> ERF::column_loc_y;
+int         ERF::column_buffer    = 1;
 std::string ERF::column_file_name = "column_data.nc";
 
 // 2D BndryRegister output (for ingestion by AMR-Wind)
@@ -88,6 +94,9 @@ amrex::Real ERF::bndry_output_planes_start_time =  0.0;
 // 2D BndryRegister input
 int         ERF::input_bndry_planes             = 0;
 
+// Running time averages on level 0
+int         ERF::output_stats                   = 0;
+
 amrex::Vector<std::string> BCNames = {"xlo", "ylo", "zlo", "xhi", "yhi", "zhi"};
 
 // constructor - reads in parameters from inputs file
@@ -118,6 +127,16 @@ ERF::ERF ()
     ReadParameters();
     const std::string& pv1 = "plot_vars_1"; setPlotVariables(pv1,plot_var_names_1);
     const std::string& pv2 = "plot_vars_2"; setPlotVariables(pv2,plot_var_names_2);
+    setPlotKeepBits("plot_keep_bits_1", plot_var_names_1, plot_keep_bits_1);
+    setPlotKeepBits("plot_keep_bits_2", plot_var_names_2, plot_keep_bits_2);
+    for (auto& reg : plot_regions) {
+        setPlotVariables("plot_region." + reg.name + ".vars", reg.var_names);
+    }
+#ifdef ERF_USE_NETCDF
+    for (auto& slc : slices) {
+        setPlotVariables("slice." + slc.name + ".vars", slc.var_names);
+    }
+#endif
 
     amrex_probinit(geom[0].ProbLo(),geom[0].ProbHi());
 
@@ -161,6 +180,11 @@ ERF::ERF ()
     qmoist.resize(nlevs_max);
 #endif
 
+    m_plane_avg.resize(nlevs_max);
+    for (int lev = 0; lev < nlevs_max; ++lev) {
+        m_plane_avg[lev] = std::make_unique<MultiPlaneAverage>(geom[lev]);
+    }
+
     mri_integrator_mem.resize(nlevs_max);
     physbcs.resize(nlevs_max);
 
@@ -216,7 +240,10 @@ ERF::ERF ()
 }
 
 ERF::~ERF ()
-= default;
+{
+    // The background writes may still refer to our data
+    WaitForCheckpoints();
+}
 
 // advance solution to final time
 void
@@ -240,6 +267,14 @@ ERF::Evolve ()
             m_r2d->read_input_files(cur_time,dt[0],m_bc_extdir_vals);
         }
 
+#ifdef ERF_USE_NETCDF
+        // Make sure we hold enough of the wrfbdy data to make it through this timestep
+        if (init_type == "real")
+        {
+            update_wrfbdy(cur_time,dt[0]);
+        }
+#endif
+
         int lev = 0;
         int iteration = 1;
         timeStep(lev, cur_time, iteration);
@@ -259,10 +294,19 @@ ERF::Evolve ()
             last_plot_file_step_2 = step+1;
             WritePlotFile(2,plot_var_names_2);
         }
+        WriteRegionPlotFiles(step+1);
+        if (m_stats && m_stats->is_time_to_write(step+1)) {
+            m_stats->write_plotfile(step+1, cur_time);
+        }
 
         if (check_int > 0 && (step+1) % check_int == 0) {
             last_check_file_step = step+1;
+            // Boundary planes held in memory must be on disk before we can restart from here
+            if (m_w2d) m_w2d->flush();
+            if (m_probes) m_probes->flush();
 #ifdef ERF_USE_NETCDF
+            flush_slices();
+            flush_columns();
             if (check_type == "netcdf") {
                WriteNCCheckpointFile();
             }
@@ -289,6 +333,16 @@ ERF::Evolve ()
     if (plot_int_2 > 0 && istep[0] > last_plot_file_step_2) {
         WritePlotFile(2,plot_var_names_2);
     }
+    WriteRegionPlotFiles(istep[0], true);
+    if (m_stats && m_stats->plot_int() > 0) {
+        m_stats->write_plotfile(istep[0], t_new[0]);
+    }
+    if (m_w2d) m_w2d->flush();
+    if (m_probes) m_probes->flush();
+#ifdef ERF_USE_NETCDF
+    flush_slices();
+    flush_columns();
+#endif
 
     if (check_int > 0 && istep[0] > last_check_file_step) {
 #ifdef ERF_USE_NETCDF
@@ -301,6 +355,9 @@ ERF::Evolve ()
         }
     }
 
+    // Make sure the last checkpoint is on disk before we report we're done
+    WaitForCheckpoints();
+
     BL_PROFILE_VAR_STOP(evolve);
 }
 
@@ -328,6 +385,12 @@ ERF::post_timestep (int nstep, Real time, Real dt_lev0)
         sum_integrated_quantities(time);
     }
 
+    if (m_probes && is_it_time_for_action(nstep, time, dt_lev0, m_probes->interval(), m_probes->per())) {
+        m_probes->sample(time, vars_new[0],
+                         {Tau11_lev[0].get(), Tau22_lev[0].get(), Tau33_lev[0].get(),
+                          Tau12_lev[0].get(), Tau13_lev[0].get(), Tau23_lev[0].get()});
+    }
+
     if (profile_int > 0 && (nstep+1) % profile_int == 0) {
         write_1D_profiles(time);
     }
@@ -336,22 +399,17 @@ ERF::post_timestep (int nstep, Real time, Real dt_lev0)
 #ifdef ERF_USE_NETCDF
       if (is_it_time_for_action(nstep, time, dt_lev0, column_interval, column_per))
       {
-         int lev_column = 0;
-         for (int lev = finest_level; lev >= 0; lev--)
-         {
-            Real dx_lev = geom[lev].CellSize(0);
-            Real dy_lev = geom[lev].CellSize(1);
-            int i_lev = static_cast<int>(std::floor(column_loc_x / dx_lev));
-            int j_lev = static_cast<int>(std::floor(column_loc_y / dy_lev));
-            if (grids[lev].contains(IntVect(i_lev,j_lev,0))) lev_column = lev;
-         }
-         writeToNCColumnFile(lev_column, column_file_name, column_loc_x, column_loc_y, time);
+         write_columns(time);
       }
 #else
       amrex::Abort("To output 1D column files ERF must be compiled with NetCDF");
 #endif
     }
 
+#ifdef ERF_USE_NETCDF
+    write_slices(nstep, time, dt_lev0);
+#endif
+
     if (output_bndry_planes)
     {
       if (is_it_time_for_action(istep[0], time, dt_lev0, bndry_output_planes_interval, bndry_output_planes_per) &&
@@ -361,6 +419,16 @@ ERF::post_timestep (int nstep, Real time, Real dt_lev0)
       }
     }
 
+    if (m_stats)
+    {
+#if defined(ERF_USE_MOISTURE)
+        MultiFab qvapor(qmoist[0], make_alias, 0, 1);
+        m_stats->accumulate(nstep+1, time, vars_new[0], &qvapor);
+#else
+        m_stats->accumulate(nstep+1, time, vars_new[0], nullptr);
+#endif
+    }
+
     // Moving terrain
     if ( solverChoice.use_terrain &&  (solverChoice.terrain_type == 1) )
     {
@@ -529,19 +597,36 @@ ERF::InitData ()
 #ifdef ERF_USE_MOISTURE
     // Initialize microphysics here
     micro.define(solverChoice);
+    kessler.define(solverChoice);
 
     // Call Init which will call Diagnose to fill qmoist
     for (int lev = 0; lev <= finest_level; ++lev)
     {
         // If not restarting we need to fill qmoist given qt and qp.
         if (restart_chkfile.empty()) {
-            micro.Init(vars_new[lev][Vars::cons], qmoist[lev],
-                       grids_to_evolve[lev], Geom(lev), 0.0); // dummy value, not needed just to diagnose
-            micro.Update(vars_new[lev][Vars::cons], qmoist[lev]);
+            if (solverChoice.moisture_type == MoistureType::Kessler) {
+                kessler.Init(vars_new[lev][Vars::cons], qmoist[lev],
+                             grids_to_evolve[lev], Geom(lev), 0.0); // dummy value, not needed just to diagnose
+                kessler.Update(vars_new[lev][Vars::cons], qmoist[lev]);
+            } else {
+                m_plane_avg[lev]->compute(vars_new[lev][Vars::cons], &qmoist[lev], t_new[lev]);
+                micro.Init(vars_new[lev][Vars::cons], qmoist[lev],
+                           grids_to_evolve[lev], Geom(lev), *m_plane_avg[lev],
+                           0.0); // dummy value, not needed just to diagnose
+                micro.Update(vars_new[lev][Vars::cons], qmoist[lev]);
+                m_plane_avg[lev]->invalidate();
+            }
         }
     }
 #endif
 
+#ifdef ERF_USE_RRTMGP
+    // Set up the radiation driver; the heating rates themselves are computed in Advance
+    if (solverChoice.use_radiation) {
+        m_rad = std::make_unique<Radiation>(max_level+1, solverChoice);
+    }
+#endif
+
     // Configure ABLMost params if used MostWall boundary condition
     // NOTE: we must set up the MOST routine before calling WritePlotFile because
     //       WritePlotFile calls FillPatch in order to compute gradients
@@ -576,6 +661,11 @@ ERF::InitData ()
         write_1D_profiles(t_new[0]);
     }
 
+#ifdef ERF_USE_NETCDF
+    init_slices();
+    if (output_1d_column) init_columns();
+#endif
+
     // We only write the file at level 0 for now
     if (output_bndry_planes)
     {
@@ -588,6 +678,12 @@ ERF::InitData ()
         }
     }
 
+    // On restart this was already made (and filled) when reading the checkpoint
+    if (output_stats && !m_stats)
+    {
+        m_stats = std::make_unique<TimeAvgStats>(grids[0],dmap[0],geom[0]);
+    }
+
 #ifdef ERF_USE_POISSON_SOLVE
     if (restart_chkfile == "")
     {
@@ -670,6 +766,7 @@ ERF::InitData ()
             WritePlotFile(2,plot_var_names_2);
             last_plot_file_step_2 = istep[0];
         }
+        WriteRegionPlotFiles(istep[0], true);
     }
 
     // Set these up here because we need to know which MPI rank "cell" is on...
@@ -684,64 +781,11 @@ ERF::InitData ()
             setRecordDataInfo(i,datalogname[i]);
     }
 
-    if (pp.contains("sample_point_log") && pp.contains("sample_point"))
+    // The probes are found on the grids when they are first sampled
+    if (!m_probes && (pp.contains("sample_point") || pp.contains("sample_line")))
     {
-        int lev = 0;
-
-        int num_samplepts = pp.countval("sample_point") / AMREX_SPACEDIM;
-        if (num_samplepts > 0) {
-            Vector<int> index; index.resize(num_samplepts*AMREX_SPACEDIM);
-            samplepoint.resize(num_samplepts);
-
-            pp.queryarr("sample_point",index,0,num_samplepts*AMREX_SPACEDIM);
-            for (int i = 0; i < num_samplepts; i++) {
-                IntVect iv(index[AMREX_SPACEDIM*i+0],index[AMREX_SPACEDIM*i+1],index[AMREX_SPACEDIM*i+2]);
-                samplepoint[i] = iv;
-            }
-        }
-
-        int num_sampleptlogs = pp.countval("sample_point_log");
-        AMREX_ALWAYS_ASSERT(num_sampleptlogs == num_samplepts);
-        if (num_sampleptlogs > 0) {
-            sampleptlog.resize(num_sampleptlogs);
-            sampleptlogname.resize(num_sampleptlogs);
-            pp.queryarr("sample_point_log",sampleptlogname,0,num_sampleptlogs);
-
-            for (int i = 0; i < num_sampleptlogs; i++) {
-                setRecordSamplePointInfo(i,lev,samplepoint[i],sampleptlogname[i]);
-            }
-        }
-
-    }
-
-    if (pp.contains("sample_line_log") && pp.contains("sample_line"))
-    {
-        int lev = 0;
-
-        int num_samplelines = pp.countval("sample_line") / AMREX_SPACEDIM;
-        if (num_samplelines > 0) {
-            Vector<int> index; index.resize(num_samplelines*AMREX_SPACEDIM);
-            sampleline.resize(num_samplelines);
-
-            pp.queryarr("sample_line",index,0,num_samplelines*AMREX_SPACEDIM);
-            for (int i = 0; i < num_samplelines; i++) {
-                IntVect iv(index[AMREX_SPACEDIM*i+0],index[AMREX_SPACEDIM*i+1],index[AMREX_SPACEDIM*i+2]);
-                sampleline[i] = iv;
-            }
-        }
-
-        int num_samplelinelogs = pp.countval("sample_line_log");
-        AMREX_ALWAYS_ASSERT(num_samplelinelogs == num_samplelines);
-        if (num_samplelinelogs > 0) {
-            samplelinelog.resize(num_samplelinelogs);
-            samplelinelogname.resize(num_samplelinelogs);
-            pp.queryarr("sample_line_log",samplelinelogname,0,num_samplelinelogs);
-
-            for (int i = 0; i < num_samplelinelogs; i++) {
-                setRecordSampleLineInfo(i,lev,sampleline[i],samplelinelogname[i]);
-            }
-        }
-
+        m_probes = std::make_unique<ProbeSampler>(geom[0], cons_names,
+                                                  restart_chkfile.empty() ? -1.0 : t_new[0]);
     }
 
     BL_PROFILE_VAR_STOP(InitData);
@@ -793,7 +837,11 @@ ERF::init_only (int lev, Real time)
         init_from_input_sounding(lev);
 #ifdef ERF_USE_NETCDF
     } else if (init_type == "ideal" || init_type == "real") {
-        init_from_wrfinput(lev);
+        // Level 0 may come from the cache written by an earlier run with the same inputs
+        if (lev > 0 || !ReadRealInitCache()) {
+            init_from_wrfinput(lev);
+            if (lev == 0) WriteRealInitCache();
+        }
     } else if (init_type == "metgrid") {
         init_from_metgrid(lev);
 #endif
@@ -836,6 +884,12 @@ ERF::ReadParameters ()
         pp.query("regrid_int", regrid_int);
         pp.query("check_file", check_file);
         pp.query("check_type", check_type);
+        pp.query("check_async", check_async);
+        pp.query("check_max_in_flight", check_max_in_flight);
+        pp.query("check_static", check_static);
+        if (check_max_in_flight < 1) {
+            amrex::Abort("erf.check_max_in_flight must be at least 1");
+        }
 
         // The regression tests use "amr.restart" and "amr.check_int" so we allow
         //    for those or "erf.restart" / "erf.check_int" with the former taking
@@ -953,6 +1007,9 @@ ERF::ReadParameters ()
 
         // NetCDF wrfbdy lateral boundary file
         pp.query("nc_bdy_file", nc_bdy_file);
+
+        // Cache of level 0 as initialized from the NetCDF files
+        pp.query("real_init_cache", real_init_cache);
 #endif
 
         // Text input_sounding file
@@ -970,18 +1027,121 @@ ERF::ReadParameters ()
             amrex::Print() << "User selected plotfile_type = " << plotfile_type << std::endl;
             amrex::Abort("Dont know this plotfile_type");
         }
+        pp.query("plotfile_nc_layout", plotfile_nc_layout);
+        if (plotfile_nc_layout != "blocks" && plotfile_nc_layout != "chunked") {
+            amrex::Abort("plotfile_nc_layout must be blocks or chunked");
+        }
         pp.query("plot_file_1", plot_file_1);
         pp.query("plot_file_2", plot_file_2);
         pp.query("plot_int_1", plot_int_1);
         pp.query("plot_int_2", plot_int_2);
+        pp.query("plot_precision_1", plot_precision_1);
+        pp.query("plot_precision_2", plot_precision_2);
+        if ( (plot_precision_1 != "double" && plot_precision_1 != "single") ||
+             (plot_precision_2 != "double" && plot_precision_2 != "single") ) {
+            amrex::Abort("plot_precision must be double or single");
+        }
+        // Only native plotfiles can be written in either precision; NetCDF plotfiles are
+        //    always single and HDF5 plotfiles always double
+        if ( (plotfile_type == "hdf5" || plotfile_type == "HDF5") &&
+             (plot_precision_1 == "single" || plot_precision_2 == "single") ) {
+            amrex::Abort("plot_precision = single is not available with plotfile_type = hdf5;"
+                         " use plot_keep_bits with plot_compression to shrink HDF5 plotfiles");
+        }
+        pp.query("plot_compression_1", plot_compression_1);
+        pp.query("plot_compression_2", plot_compression_2);
+
+        // Plotfile series over regions of interest, each with its own variables, stride and interval
+        if (pp.contains("plot_regions")) {
+            std::vector<std::string> region_names;
+            pp.queryarr("plot_regions", region_names);
+            for (const auto& rname : region_names) {
+                ParmParse ppr(pp_prefix + ".plot_region." + rname);
+                PlotRegion reg;
+                reg.name = rname;
+                reg.file = "plt_" + rname + "_";
+                ppr.query("file", reg.file);
+                ppr.query("int", reg.interval);
+                ppr.query("level", reg.lev);
+                if (reg.lev < 0 || reg.lev > max_level) {
+                    amrex::Abort("plot_region." + rname + ".level must be between 0 and max_level");
+                }
+
+                Vector<Real> lo(geom[0].ProbLo(), geom[0].ProbLo()+AMREX_SPACEDIM);
+                Vector<Real> hi(geom[0].ProbHi(), geom[0].ProbHi()+AMREX_SPACEDIM);
+                ppr.queryarr("lo", lo, 0, AMREX_SPACEDIM);
+                ppr.queryarr("hi", hi, 0, AMREX_SPACEDIM);
+                reg.box = RealBox(lo.data(), hi.data());
+
+                Vector<int> stride(AMREX_SPACEDIM, 1);
+                ppr.queryarr("stride", stride, 0, AMREX_SPACEDIM);
+                for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+                    if (stride[d] < 1) amrex::Abort("plot_region." + rname + ".stride must be >= 1");
+                    reg.stride[d] = stride[d];
+                }
+                plot_regions.push_back(reg);
+            }
+        }
+
+#ifdef ERF_USE_NETCDF
+        // Planes written every few steps to a NetCDF time series, each with its own variables
+        if (pp.contains("slices")) {
+            std::vector<std::string> slice_names;
+            pp.queryarr("slices", slice_names);
+            for (const auto& sname : slice_names) {
+                ParmParse pps(pp_prefix + ".slice." + sname);
+                SliceOutput slc;
+                slc.name = sname;
+                slc.file = "slice_" + sname + ".nc";
+                pps.query("file", slc.file);
+
+                std::string normal {"z"};
+                pps.query("normal", normal);
+                if (normal == "x") {
+                    slc.normal = 0;
+                } else if (normal == "y") {
+                    slc.normal = 1;
+                } else if (normal == "z") {
+                    slc.normal = 2;
+                } else {
+                    amrex::Abort("slice." + sname + ".normal must be x, y or z");
+                }
+                pps.get("location", slc.location);
+
+                std::string height_type {"terrain"};
+                pps.query("height_type", height_type);
+                if (height_type != "terrain" && height_type != "fixed") {
+                    amrex::Abort("slice." + sname + ".height_type must be terrain or fixed");
+                }
+                slc.fixed_height = (height_type == "fixed" && slc.normal == 2);
+
+                pps.query("int", slc.interval);
+                pps.query("per", slc.per);
+                pps.query("level", slc.lev);
+                if (slc.lev < 0 || slc.lev > max_level) {
+                    amrex::Abort("slice." + sname + ".level must be between 0 and max_level");
+                }
+                pps.query("buffer", slc.buffer);
+                if (slc.buffer < 1) amrex::Abort("slice." + sname + ".buffer must be >= 1");
+                slices.push_back(slc);
+            }
+        }
+#endif
 
         pp.query("profile_int", profile_int);
 
         pp.query("output_1d_column", output_1d_column);
         pp.query("column_per", column_per);
         pp.query("column_interval", column_interval);
-        pp.query("column_loc_x", column_loc_x);
-        pp.query("column_loc_y", column_loc_y);
+        pp.queryarr("column_loc_x", column_loc_x);
+        pp.queryarr("column_loc_y", column_loc_y);
+        if (column_loc_x.empty()) column_loc_x.push_back(0.0);
+        if (column_loc_y.empty()) column_loc_y.push_back(0.0);
+        if (column_loc_x.size() != column_loc_y.size()) {
+            amrex::Abort("erf.column_loc_x and erf.column_loc_y must have the same length");
+        }
+        pp.query("column_buffer", column_buffer);
+        column_buffer = std::max(column_buffer, 1);
         pp.query("column_file_name", column_file_name);
 
         // Specify information about outputting planes of data
@@ -993,6 +1153,9 @@ ERF::ReadParameters ()
         // Specify whether ingest boundary planes of data
         pp.query("input_bndry_planes", input_bndry_planes);
 
+        // Specify whether to accumulate time averages (the fields are read by TimeAvgStats)
+        pp.query("output_stats", output_stats);
+
         // Query the set and total widths for wrfbdy interior ghost cells
         pp.query("wrfbdy_width", wrfbdy_width);
         pp.query("wrfbdy_set_width", wrfbdy_set_width);
@@ -1030,79 +1193,33 @@ ERF::MakeHorizontalAverages ()
     // First, average down all levels (if doing two-way coupling)
     if (coupling_type == "TwoWay") {
         AverageDown();
+        m_plane_avg[lev]->invalidate();
     }
 
-    MultiFab mf(grids[lev], dmap[lev], 5, 0);
-
-#if defined(ERF_USE_MOISTURE)
-    MultiFab qv(qmoist[lev], make_alias, 0, 1);
-#endif
-
-    for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
-        const Box& bx = mfi.validbox();
-        auto  fab_arr = mf.array(mfi);
-        auto cons_arr = vars_new[lev][Vars::cons].array(mfi);
-#if defined(ERF_USE_MOISTURE)
-        auto   qv_arr = qv.array(mfi);
-#endif
-        ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) {
-            Real dens = cons_arr(i, j, k, Cons::Rho);
-            fab_arr(i, j, k, 0) = dens;
-            fab_arr(i, j, k, 1) = cons_arr(i, j, k, Cons::RhoTheta) / dens;
+    // All five come out of the same pass as the averages used by the physics
 #if defined(ERF_USE_MOISTURE)
-            fab_arr(i, j, k, 2) = getPgivenRTh(cons_arr(i, j, k, Cons::RhoTheta), qv_arr(i,j,k));
+    m_plane_avg[lev]->compute(vars_new[lev][Vars::cons], &qmoist[lev], t_new[lev]);
 #else
-            fab_arr(i, j, k, 2) = getPgivenRTh(cons_arr(i, j, k, Cons::RhoTheta));
-#endif
-#if defined(ERF_USE_MOISTURE)
-            fab_arr(i, j, k, 3) = cons_arr(i, j, k, Cons::RhoQt) / dens;
-            fab_arr(i, j, k, 4) = cons_arr(i, j, k, Cons::RhoQp) / dens;
-#endif
-        });
-    }
-
-    int zdir = 2;
-    auto domain = geom[0].Domain();
-
-    // Sum in the horizontal plane
-    Gpu::HostVector<Real> h_avg_density     = sumToLine(mf,0,1,domain,zdir);
-    Gpu::HostVector<Real> h_avg_temperature = sumToLine(mf,1,1,domain,zdir);
-    Gpu::HostVector<Real> h_avg_pressure    = sumToLine(mf,2,1,domain,zdir);
-#ifdef ERF_USE_MOISTURE
-    Gpu::HostVector<Real> h_avg_qv          = sumToLine(mf,3,1,domain,zdir);
-    Gpu::HostVector<Real> h_avg_qc          = sumToLine(mf,4,1,domain,zdir);
+    m_plane_avg[lev]->compute(vars_new[lev][Vars::cons], nullptr, t_new[lev]);
 #endif
 
-    // Divide by the total number of cells we are averaging over
-     int size_z = domain.length(zdir);
-    Real area_z = static_cast<Real>(domain.length(0)*domain.length(1));
-    int klen = static_cast<int>(h_avg_density.size());
-    for (int k = 0; k < klen; ++k) {
-        h_havg_density[k]     /= area_z;
-        h_havg_temperature[k] /= area_z;
-        h_havg_pressure[k]    /= area_z;
-#if defined(ERF_USE_MOISTURE)
-        h_havg_qc[k]          /= area_z;
-        h_havg_qv[k]          /= area_z;
-#endif
-    }
+    const MultiPlaneAverage& plane_avg = *m_plane_avg[lev];
+    int size_z = plane_avg.ncell_line();
 
-    // resize device vectors
-    d_havg_density.resize(size_z, 0.0_rt);
-    d_havg_temperature.resize(size_z, 0.0_rt);
-    d_havg_pressure.resize(size_z, 0.0_rt);
-#if defined(ERF_USE_MOISTURE)
-    d_havg_qv.resize(size_z, 0.0_rt);
-    d_havg_qc.resize(size_z, 0.0_rt);
-#endif
-
-    // copy host vectors to device vectors
-    amrex::Gpu::copy(amrex::Gpu::hostToDevice, h_havg_density.begin(), h_havg_density.end(), d_havg_density.begin());
-    amrex::Gpu::copy(amrex::Gpu::hostToDevice, h_havg_temperature.begin(), h_havg_temperature.end(), d_havg_temperature.begin());
-    amrex::Gpu::copy(amrex::Gpu::hostToDevice, h_havg_pressure.begin(), h_havg_pressure.end(), d_havg_pressure.begin());
+    auto copy_line = [&] (int n, Vector<Real>& h_havg, Gpu::DeviceVector<Real>& d_havg)
+    {
+        const Real* line = plane_avg.line_average_host(n);
+        h_havg.assign(line, line + size_z);
+        d_havg.resize(size_z);
+        Gpu::copy(Gpu::hostToDevice, h_havg.begin(), h_havg.end(), d_havg.begin());
+    };
+
+    copy_line(PlaneAvg::rho  , h_havg_density    , d_havg_density);
+    copy_line(PlaneAvg::theta, h_havg_temperature, d_havg_temperature);
+    copy_line(PlaneAvg::pres , h_havg_pressure   , d_havg_pressure);
 #if defined(ERF_USE_MOISTURE)
-    amrex::Gpu::copy(amrex::Gpu::hostToDevice, h_havg_qv.begin(), h_havg_qv.end(), d_havg_qv.begin());
-    amrex::Gpu::copy(amrex::Gpu::hostToDevice, h_havg_qc.begin(), h_havg_qc.end(), d_havg_qc.begin());
+    copy_line(PlaneAvg::qv   , h_havg_qv         , d_havg_qv);
+    copy_line(PlaneAvg::qc   , h_havg_qc         , d_havg_qc);
 #endif
 }
 
@@ -1322,6 +1439,16 @@ ERF::ERF (const amrex::RealBox& rb, int max_level_in,
     ReadParameters();
     const std::string& pv1 = "plot_vars_1"; setPlotVariables(pv1,plot_var_names_1);
     const std::string& pv2 = "plot_vars_2"; setPlotVariables(pv2,plot_var_names_2);
+    setPlotKeepBits("plot_keep_bits_1", plot_var_names_1, plot_keep_bits_1);
+    setPlotKeepBits("plot_keep_bits_2", plot_var_names_2, plot_keep_bits_2);
+    for (auto& reg : plot_regions) {
+        setPlotVariables("plot_region." + reg.name + ".vars", reg.var_names);
+    }
+#ifdef ERF_USE_NETCDF
+    for (auto& slc : slices) {
+        setPlotVariables("slice." + slc.name + ".vars", slc.var_names);
+    }
+#endif
 
     amrex_probinit(geom[0].ProbLo(),geom[0].ProbHi());
 
@@ -1453,6 +1580,14 @@ ERF::Evolve_MB (int MBstep, int max_block_step)
             m_r2d->read_input_files(cur_time,dt[0],m_bc_extdir_vals);
         }
 
+#ifdef ERF_USE_NETCDF
+        // Make sure we hold enough of the wrfbdy data to make it through this timestep
+        if (init_type == "real")
+        {
+            update_wrfbdy(cur_time,dt[0]);
+        }
+#endif
+
         int lev = 0;
         int iteration = 1;
         timeStep(lev, cur_time, iteration);
@@ -1479,10 +1614,19 @@ ERF::Evolve_MB (int MBstep, int max_block_step)
             last_plot_file_step_2 = step+1;
             WritePlotFile(2,plot_var_names_2);
         }
+        WriteRegionPlotFiles(step+1);
+        if (m_stats && m_stats->is_time_to_write(step+1)) {
+            m_stats->write_plotfile(step+1, cur_time);
+        }
 
         if (check_int > 0 && (step+1) % check_int == 0) {
             last_check_file_step = step+1;
+            // Boundary planes held in memory must be on disk before we can restart from here
+            if (m_w2d) m_w2d->flush();
+            if (m_probes) m_probes->flush();
 #ifdef ERF_USE_NETCDF
+            flush_slices();
+            flush_columns();
             if (check_type == "netcdf") {
                WriteNCCheckpointFile();
             }
@@ -1509,6 +1653,16 @@ ERF::Evolve_MB (int MBstep, int max_block_step)
     if (plot_int_2 > 0 && istep[0] > last_plot_file_step_2) {
         WritePlotFile(2,plot_var_names_2);
     }
+    WriteRegionPlotFiles(istep[0], true);
+    if (m_stats && m_stats->plot_int() > 0) {
+        m_stats->write_plotfile(istep[0], t_new[0]);
+    }
+    if (m_w2d) m_w2d->flush();
+    if (m_probes) m_probes->flush();
+#ifdef ERF_USE_NETCDF
+    flush_slices();
+    flush_columns();
+#endif
 
     if (check_int > 0 && istep[0] > last_check_file_step) {
 #ifdef ERF_USE_NETCDF
@@ -1521,5 +1675,6 @@ ERF::Evolve_MB (int MBstep, int max_block_step)
         }
     }
 
+    WaitForCheckpoints();
 }
 #endif
@@ -20,6 +20,10 @@
 #include <MultiBlockContainer.H>
 #endif
 
+#ifdef ERF_USE_RRTMGP
+#include <Radiation.H>
+#endif
+
 using namespace amrex;
 
 // Make a new level from scratch using provided BoxArray and DistributionMapping.
@@ -195,6 +199,11 @@ void
 ERF::MakeNewLevelFromCoarse (int lev, Real time, const BoxArray& ba,
                              const DistributionMapping& dm)
 {
+#if defined(ERF_USE_RRTMGP)
+    // A radiation calculation in flight was started on the old grids
+    if (m_rad) m_rad->discard_heating_rate(lev);
+#endif
+
     const auto& crse_new = vars_new[lev-1];
     auto& lev_new = vars_new[lev];
     auto& lev_old = vars_old[lev];
@@ -240,6 +249,15 @@ ERF::MakeNewLevelFromCoarse (int lev, Real time, const BoxArray& ba,
     FillCoarsePatch(lev, time, {&lev_new[Vars::cons],&lev_new[Vars::xvel],
                                 &lev_new[Vars::yvel],&lev_new[Vars::zvel]});
 
+    // ********************************************************************************************
+    // Build the MOST surface data and averaging maps on the new level
+    // ********************************************************************************************
+    if (phys_bc_type[Orientation(Direction::z,Orientation::low)] == ERF_BC::MOST) {
+        int ngrow_state = ComputeGhostCells(solverChoice) + 1;
+        Theta_prim[lev] = std::make_unique<MultiFab>(ba,dm,1,IntVect(ngrow_state,ngrow_state,0));
+        if (m_most) m_most->regrid(lev, vars_old, Theta_prim, z_phys_nd);
+    }
+
     initialize_integrator(lev, lev_new[Vars::cons], lev_new[Vars::xvel]);
 }
 
@@ -250,6 +268,11 @@ ERF::MakeNewLevelFromCoarse (int lev, Real time, const BoxArray& ba,
 void
 ERF::RemakeLevel (int lev, Real time, const BoxArray& ba, const DistributionMapping& dm)
 {
+#if defined(ERF_USE_RRTMGP)
+    // A radiation calculation in flight was started on the old grids
+    if (m_rad) m_rad->discard_heating_rate(lev);
+#endif
+
     define_grids_to_evolve(lev, ba);
 
     Vector<MultiFab> temp_lev_new(Vars::NumTypes);
@@ -343,6 +366,14 @@ ERF::RemakeLevel (int lev, Real time, const BoxArray& ba, const DistributionMapp
         mapfac_v[lev]->setVal(1.);
     }
 
+    // ********************************************************************************************
+    // Rebuild the MOST surface data and averaging maps on the new grids
+    // ********************************************************************************************
+    if (phys_bc_type[Orientation(Direction::z,Orientation::low)] == ERF_BC::MOST) {
+        Theta_prim[lev] = std::make_unique<MultiFab>(ba,dm,1,IntVect(ngrow_state,ngrow_state,0));
+        if (m_most) m_most->regrid(lev, vars_old, Theta_prim, z_phys_nd);
+    }
+
     initialize_integrator(lev, vars_new[lev][Vars::cons], vars_new[lev][Vars::xvel]);
 }
 
@@ -467,6 +498,10 @@ ERF::initialize_integrator(int lev, MultiFab& cons_mf, MultiFab& vel_mf)
 void
 ERF::ClearLevel (int lev)
 {
+#if defined(ERF_USE_RRTMGP)
+    if (m_rad) m_rad->discard_heating_rate(lev);
+#endif
+
     for (int var_idx = 0; var_idx < Vars::NumTypes; ++var_idx) {
         vars_new[lev][var_idx].clear();
         vars_old[lev][var_idx].clear();
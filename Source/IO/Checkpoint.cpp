@@ -1,11 +1,103 @@
 #include <ERF.H>
+#include <Utils.H>
 #include "AMReX_PlotFileUtil.H"
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <functional>
+#include <future>
+#include <cstring>
+#include <cstdint>
+#include <set>
 
 using namespace amrex;
 
+namespace {
+    // Communicator for the barriers of the tasks on the background I/O thread, so they can
+    //    never match a collective call of the main thread. It is duplicated on the main
+    //    thread the first time an asynchronous checkpoint is written.
+#ifdef AMREX_USE_MPI
+    MPI_Comm
+    CheckAsyncComm ()
+    {
+        static MPI_Comm comm = MPI_COMM_NULL;
+        if (comm == MPI_COMM_NULL) {
+            MPI_Comm_dup(ParallelDescriptor::Communicator(), &comm);
+            amrex::ExecOnFinalize([] () { MPI_Comm_free(&comm); });
+        }
+        return comm;
+    }
+#endif
+
+    // FNV-1a hash, a 64-bit word at a time
+    std::uint64_t
+    fnv1a (std::uint64_t h, const void* data, std::size_t nbytes)
+    {
+        constexpr std::uint64_t prime = 1099511628211ULL;
+        const auto* p = static_cast<const unsigned char*>(data);
+        std::size_t nwords = nbytes / sizeof(std::uint64_t);
+        for (std::size_t n = 0; n < nwords; ++n) {
+            std::uint64_t w;
+            std::memcpy(&w, p + n*sizeof(std::uint64_t), sizeof(w));
+            h ^= w; h *= prime;
+        }
+        for (std::size_t n = nwords*sizeof(std::uint64_t); n < nbytes; ++n) {
+            h ^= p[n]; h *= prime;
+        }
+        return h;
+    }
+
+    // Hash of the data (and box) of a host FAB that belongs to field "name" at "lev";
+    //    these are summed over FABs and ranks so we keep 48 bits to avoid overflow
+    Long
+    static_hash (const FArrayBox& fab, const std::string& name, int lev)
+    {
+        std::uint64_t h = 14695981039346656037ULL;
+        h = fnv1a(h, name.data(), name.size());
+        h = fnv1a(h, &lev, sizeof(int));
+        h = fnv1a(h, fab.box().loVect(), AMREX_SPACEDIM*sizeof(int));
+        h = fnv1a(h, fab.box().hiVect(), AMREX_SPACEDIM*sizeof(int));
+        h = fnv1a(h, fab.dataPtr(), fab.nBytes());
+        return static_cast<Long>(h & 0xFFFFFFFFFFFFULL);
+    }
+
+    // Sum of the hashes of the local FABs of a MultiFab (including ghost cells)
+    Long
+    static_hash (const MultiFab& mf, const std::string& name, int lev)
+    {
+        Long hsum = 0;
+        for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
+#ifdef AMREX_USE_GPU
+            FArrayBox hfab(mf[mfi].box(), mf.nComp(), The_Pinned_Arena());
+            Gpu::dtoh_memcpy(hfab.dataPtr(), mf[mfi].dataPtr(), hfab.nBytes());
+            hsum += static_hash(hfab, name, lev);
+#else
+            hsum += static_hash(mf[mfi], name, lev);
+#endif
+        }
+        return hsum;
+    }
+
+    // Directory that a path lives in, with a trailing slash (or empty)
+    std::string
+    parent_dir (std::string path)
+    {
+        while (path.size() > 1 && path.back() == '/') path.pop_back();
+        auto pos = path.rfind('/');
+        return (pos == std::string::npos) ? std::string() : path.substr(0, pos+1);
+    }
+
+    // The last component of a path
+    std::string
+    base_name (std::string path)
+    {
+        while (path.size() > 1 && path.back() == '/') path.pop_back();
+        auto pos = path.rfind('/');
+        return (pos == std::string::npos) ? path : path.substr(pos+1);
+    }
+}
+
 /**
  * Utility to skip to next line in Header file input stream.
  */
@@ -16,8 +108,33 @@ ERF::GotoNextLine (std::istream& is)
     is.ignore(bl_ignore_max, '\n');
 }
 
+/**
+ * Block until at most n of the checkpoints written in the background are still in flight.
+ *
+ * @param[in] n number of checkpoints that may still be in flight
+ */
+void
+ERF::WaitForCheckpoints (int n) const
+{
+    while (static_cast<int>(m_check_in_flight.size()) > std::max(n,0)) {
+        m_check_in_flight.front().wait();
+        m_check_in_flight.pop_front();
+    }
+}
+
 /**
  * ERF function for writing a checkpoint file.
+ *
+ * With erf.check_async (and amrex.async_out = 1) the data are copied into host buffers
+ * and written by the AMReX background I/O thread while the run continues; at most
+ * erf.check_max_in_flight checkpoints are in flight at once, older ones are waited for
+ * before a new one is started. The Header is written by the I/O rank once the data of
+ * every rank are on disk.
+ *
+ * With erf.check_static the fields that only change on regrid (static terrain, map
+ * factors, the base state without moving terrain and the wrfbdy data) are written once
+ * to a separate directory (e.g. chk_static00010) that later checkpoints refer to through
+ * their "Static" file for as long as the hash of those fields is unchanged.
  */
 void
 ERF::WriteCheckpointFile () const
@@ -29,11 +146,20 @@ ERF::WriteCheckpointFile () const
     // chk00010/Level_1/
     // etc.                these subdirectories will hold the MultiFab data at each level of refinement
 
+    BL_PROFILE("ERF::WriteCheckpointFile()");
+
+    Real t_start = amrex::second();
+
     // checkpoint file name, e.g., chk00010
     const std::string& checkpointname = amrex::Concatenate(check_file,istep[0],5);
 
     amrex::Print() << "Writing checkpoint " << checkpointname << "\n";
 
+    const bool async = check_async && AsyncOut::UseAsyncOut();
+
+    // Don't let the snapshots pile up if the file system can't keep up
+    if (async) WaitForCheckpoints(check_max_in_flight-1);
+
     const int nlevels = finest_level+1;
 
     // ---- prebuild a hierarchy of directories
@@ -44,106 +170,74 @@ ERF::WriteCheckpointFile () const
     // ---- ParallelDescriptor::IOProcessor() creates the directories
     amrex::PreBuildDirectorHierarchy(checkpointname, "Level_", nlevels, true);
 
-    // write Header file
-   if (ParallelDescriptor::IOProcessor()) {
-
-       std::string HeaderFileName(checkpointname + "/Header");
-       VisMF::IO_Buffer io_buffer(VisMF::IO_Buffer_Size);
-       std::ofstream HeaderFile;
-       HeaderFile.rdbuf()->pubsetbuf(io_buffer.dataPtr(), io_buffer.size());
-       HeaderFile.open(HeaderFileName.c_str(), std::ofstream::out   |
-                                               std::ofstream::trunc |
-                                               std::ofstream::binary);
-       if( ! HeaderFile.good()) {
-           amrex::FileOpenFailed(HeaderFileName);
-       }
-
-       HeaderFile.precision(17);
-
-       // write out title line
-       HeaderFile << "Checkpoint file for ERF\n";
-
-       // write out finest_level
-       HeaderFile << finest_level << "\n";
-
-       // write the number of components
-       // for each variable we store
-
-       // conservative, cell-centered vars
-       HeaderFile << Cons::NumVars << "\n";
-
-       // x-velocity on faces
-       HeaderFile << 1 << "\n";
-
-       // y-velocity on faces
-       HeaderFile << 1 << "\n";
+    // write the MultiFab data to, e.g., chk00010/Level_0/
+    // Here we make copies of the MultiFab with no ghost cells; when writing in the
+    //    background the copies are handed over to the I/O thread
+    auto write_mf = [async] (MultiFab&& mf, const std::string& name)
+    {
+        if (async) {
+            VisMF::AsyncWrite(std::move(mf), name);
+        } else {
+            VisMF::Write(mf, name);
+        }
+    };
 
-       // z-velocity on faces
-       HeaderFile << 1 << "\n";
+    // Fields that only change on regrid are held back until we know whether the
+    //    static directory of an earlier checkpoint still holds them
+    struct StaticField {
+        int         lev;
+        std::string name;
+        MultiFab    mf;
+    };
+    Vector<StaticField> static_fields;
 
-       // write out array of istep
-       for (int i = 0; i < istep.size(); ++i) {
-           HeaderFile << istep[i] << " ";
-       }
-       HeaderFile << "\n";
+    const bool static_terrain = solverChoice.use_terrain && (solverChoice.terrain_type == 0);
+    const bool static_base    = !(solverChoice.use_terrain && (solverChoice.terrain_type > 0));
 
-       // write out array of dt
-       for (int i = 0; i < dt.size(); ++i) {
-           HeaderFile << dt[i] << " ";
-       }
-       HeaderFile << "\n";
-
-       // write out array of t_new
-       for (int i = 0; i < t_new.size(); ++i) {
-           HeaderFile << t_new[i] << " ";
-       }
-       HeaderFile << "\n";
-
-       // write the BoxArray at each level
-       for (int lev = 0; lev <= finest_level; ++lev) {
-           boxArray(lev).writeOn(HeaderFile);
-           HeaderFile << '\n';
-       }
-   }
-
-   // write the MultiFab data to, e.g., chk00010/Level_0/
-   // Here we make copies of the MultiFab with no ghost cells
    for (int lev = 0; lev <= finest_level; ++lev)
    {
        MultiFab cons(grids[lev],dmap[lev],Cons::NumVars,0);
        MultiFab::Copy(cons,vars_new[lev][Vars::cons],0,0,NVAR,0);
-       VisMF::Write(cons, amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "Cell"));
+       write_mf(std::move(cons), amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "Cell"));
 
        MultiFab xvel(convert(grids[lev],IntVect(1,0,0)),dmap[lev],1,0);
        MultiFab::Copy(xvel,vars_new[lev][Vars::xvel],0,0,1,0);
-       VisMF::Write(xvel, amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "XFace"));
+       write_mf(std::move(xvel), amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "XFace"));
 
        MultiFab yvel(convert(grids[lev],IntVect(0,1,0)),dmap[lev],1,0);
        MultiFab::Copy(yvel,vars_new[lev][Vars::yvel],0,0,1,0);
-       VisMF::Write(yvel, amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "YFace"));
+       write_mf(std::move(yvel), amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "YFace"));
 
        MultiFab zvel(convert(grids[lev],IntVect(0,0,1)),dmap[lev],1,0);
        MultiFab::Copy(zvel,vars_new[lev][Vars::zvel],0,0,1,0);
-       VisMF::Write(zvel, amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "ZFace"));
+       write_mf(std::move(zvel), amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "ZFace"));
 
 #ifdef ERF_USE_MOISTURE
        MultiFab moist_vars(grids[lev],dmap[lev],qmoist[lev].nComp(),0);
        MultiFab::Copy(moist_vars,qmoist[lev],0,0,qmoist[lev].nComp(),0);
-       VisMF::Write(moist_vars, amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "MoistVars"));
+       write_mf(std::move(moist_vars), amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "MoistVars"));
 #endif
 
        // Note that we write the ghost cells of the base state (unlike above)
        IntVect ngvect_base = base_state[lev].nGrowVect();
        MultiFab base(grids[lev],dmap[lev],base_state[lev].nComp(),ngvect_base);
        MultiFab::Copy(base,base_state[lev],0,0,base.nComp(),ngvect_base);
-       VisMF::Write(base, amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "BaseState"));
+       if (static_base) {
+           static_fields.push_back(StaticField{lev, "BaseState", std::move(base)});
+       } else {
+           write_mf(std::move(base), amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "BaseState"));
+       }
 
        if (solverChoice.use_terrain)  {
            // Note that we also write the ghost cells of z_phys_nd
            IntVect ngvect = z_phys_nd[lev]->nGrowVect();
            MultiFab z_height(convert(grids[lev],IntVect(1,1,1)),dmap[lev],1,ngvect);
            MultiFab::Copy(z_height,*z_phys_nd[lev],0,0,1,ngvect);
-           VisMF::Write(z_height, amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "Z_Phys_nd"));
+           if (static_terrain) {
+               static_fields.push_back(StaticField{lev, "Z_Phys_nd", std::move(z_height)});
+           } else {
+               write_mf(std::move(z_height), amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "Z_Phys_nd"));
+           }
        }
 
        // Note that we also write the ghost cells of the mapfactors (2D)
@@ -156,19 +250,79 @@ ERF::WriteCheckpointFile () const
        IntVect ngvect_mf = mapfac_m[lev]->nGrowVect();
        MultiFab mf_m(ba2d,dmap[lev],1,ngvect_mf);
        MultiFab::Copy(mf_m,*mapfac_m[lev],0,0,1,ngvect_mf);
-       VisMF::Write(mf_m, amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "MapFactor_m"));
+       static_fields.push_back(StaticField{lev, "MapFactor_m", std::move(mf_m)});
 
        ngvect_mf = mapfac_u[lev]->nGrowVect();
        MultiFab mf_u(convert(ba2d,IntVect(1,0,0)),dmap[lev],1,ngvect_mf);
        MultiFab::Copy(mf_u,*mapfac_u[lev],0,0,1,ngvect_mf);
-       VisMF::Write(mf_u, amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "MapFactor_u"));
+       static_fields.push_back(StaticField{lev, "MapFactor_u", std::move(mf_u)});
 
        ngvect_mf = mapfac_v[lev]->nGrowVect();
        MultiFab mf_v(convert(ba2d,IntVect(0,1,0)),dmap[lev],1,ngvect_mf);
        MultiFab::Copy(mf_v,*mapfac_v[lev],0,0,1,ngvect_mf);
-       VisMF::Write(mf_v, amrex::MultiFabFileFullPrefix(lev, checkpointname, "Level_", "MapFactor_v"));
+       static_fields.push_back(StaticField{lev, "MapFactor_v", std::move(mf_v)});
+   }
+
+   // Running time integrals on level 0 (see TimeAvgStats)
+   if (m_stats) m_stats->write_checkpoint(checkpointname, async);
+
+   bool has_bdy = false;
+#ifdef ERF_USE_NETCDF
+   has_bdy = (init_type == "real");
+#endif
+
+   // Write the static fields to this checkpoint, or to (or not at all if we
+   //    still have it) the static directory
+   std::string static_dir = checkpointname;
+   bool write_static = true;
+   if (check_static) {
+       Long hash = 0;
+       for (const auto& sf : static_fields) {
+           hash += static_hash(sf.mf, sf.name, sf.lev);
+       }
+#ifdef ERF_USE_NETCDF
+       if (has_bdy && ParallelDescriptor::IOProcessor()) {
+           auto fields = m_wrfbdy->conversion_fields();
+           for (int n(0); n<fields.size(); ++n) {
+               hash += static_hash(*fields[n], "bdy", n);
+           }
+       }
+#endif
+       ParallelDescriptor::ReduceLongSum(hash);
+
+       if (!m_check_static_dir.empty() && hash == m_check_static_hash &&
+           parent_dir(m_check_static_dir) == parent_dir(checkpointname)) {
+           write_static = false;
+       } else {
+           m_check_static_dir  = amrex::Concatenate(check_file + "_static", istep[0], 5);
+           m_check_static_hash = hash;
+           amrex::Print() << "Writing static checkpoint data to " << m_check_static_dir << "\n";
+           amrex::PreBuildDirectorHierarchy(m_check_static_dir, "Level_", nlevels, true);
+       }
+       static_dir = m_check_static_dir;
+
+       if (ParallelDescriptor::IOProcessor()) {
+           // The static directory sits next to the checkpoint so only its name is recorded
+           std::set<std::string> names;
+           for (const auto& sf : static_fields) names.insert(sf.name);
+           if (has_bdy) names.insert("bdy");
+
+           std::ofstream static_file(checkpointname + "/Static");
+           static_file << base_name(static_dir) << "\n";
+           static_file << m_check_static_hash << "\n";
+           for (const auto& name : names) static_file << name << " ";
+           static_file << "\n";
+           if (!static_file.good()) amrex::FileOpenFailed(checkpointname + "/Static");
+       }
    }
 
+   if (write_static) {
+       for (auto& sf : static_fields) {
+           write_mf(std::move(sf.mf), amrex::MultiFabFileFullPrefix(sf.lev, static_dir, "Level_", sf.name));
+       }
+   }
+   static_fields.clear();
+
 #ifdef ERF_USE_PARTICLES
    if (use_tracer_particles) {
        tracer_particles->Checkpoint(checkpointname, "tracers", true, tracer_particle_varnames);
@@ -176,41 +330,140 @@ ERF::WriteCheckpointFile () const
 #endif
 
 #ifdef ERF_USE_NETCDF
-   // Write bdy_data files
-   if (ParallelDescriptor::IOProcessor() && (init_type == "real")) {
-
-     // Vector dimensions
-     int num_time = bdy_data_xlo.size();
-     int num_var  = bdy_data_xlo[0].size();
-
-     // Open header file and write to it
-     std::ofstream bdy_h_file(amrex::MultiFabFileFullPrefix(0, checkpointname, "Level_", "bdy_H"));
-     bdy_h_file << std::setprecision(1) << std::fixed;
-     bdy_h_file << num_time << "\n";
-     bdy_h_file << num_var  << "\n";
-     bdy_h_file << start_bdy_time << "\n";
-     bdy_h_file << bdy_time_interval << "\n";
-     bdy_h_file << wrfbdy_width << "\n";
-     for (int ivar(0); ivar<num_var; ++ivar) {
-       bdy_h_file << bdy_data_xlo[0][ivar].box() << "\n";
-       bdy_h_file << bdy_data_xhi[0][ivar].box() << "\n";
-       bdy_h_file << bdy_data_ylo[0][ivar].box() << "\n";
-       bdy_h_file << bdy_data_yhi[0][ivar].box() << "\n";
+   // Write the bdy files; the boundary data are read from the wrfbdy file again on
+   //    restart, so only the wrfinput fields needed to convert them are saved
+   if (ParallelDescriptor::IOProcessor() && has_bdy && write_static) {
+
+     // These don't change during the run (and we wait for the writes to finish
+     //    before they go away) so the I/O thread can read them in place
+     auto f = [this, checkpointname = static_dir] ()
+     {
+       // Open header file and write to it
+       std::ofstream bdy_h_file(amrex::MultiFabFileFullPrefix(0, checkpointname, "Level_", "bdy_H"));
+       bdy_h_file << std::setprecision(1) << std::fixed;
+       bdy_h_file << start_bdy_time << "\n";
+       bdy_h_file << bdy_time_interval << "\n";
+       bdy_h_file << wrfbdy_width << "\n";
+
+       // Open data file and write to it
+       std::ofstream bdy_d_file(amrex::MultiFabFileFullPrefix(0, checkpointname, "Level_", "bdy_D"));
+       for (const auto* fab : m_wrfbdy->conversion_fields()) {
+         fab->writeOn(bdy_d_file);
+       }
+     };
+
+     if (async) {
+         AsyncOut::Submit(std::move(f));
+     } else {
+         f();
      }
+   }
+#endif
+
+   // write Header file
+   std::function<void()> write_header;
+   if (ParallelDescriptor::IOProcessor()) {
+
+       std::ostringstream HeaderFile;
+
+       HeaderFile.precision(17);
+
+       // write out title line
+       HeaderFile << "Checkpoint file for ERF\n";
+
+       // write out finest_level
+       HeaderFile << finest_level << "\n";
 
-     // Open data file and write to it
-     std::ofstream bdy_d_file(amrex::MultiFabFileFullPrefix(0, checkpointname, "Level_", "bdy_D"));
-     for (int itime(0); itime<num_time; ++itime) {
-       for (int ivar(0); ivar<num_var; ++ivar) {
-         bdy_data_xlo[itime][ivar].writeOn(bdy_d_file,0,1);
-         bdy_data_xhi[itime][ivar].writeOn(bdy_d_file,0,1);
-         bdy_data_ylo[itime][ivar].writeOn(bdy_d_file,0,1);
-         bdy_data_yhi[itime][ivar].writeOn(bdy_d_file,0,1);
+       // write the number of components
+       // for each variable we store
+
+       // conservative, cell-centered vars
+       HeaderFile << Cons::NumVars << "\n";
+
+       // x-velocity on faces
+       HeaderFile << 1 << "\n";
+
+       // y-velocity on faces
+       HeaderFile << 1 << "\n";
+
+       // z-velocity on faces
+       HeaderFile << 1 << "\n";
+
+       // write out array of istep
+       for (int i = 0; i < istep.size(); ++i) {
+           HeaderFile << istep[i] << " ";
        }
-     }
+       HeaderFile << "\n";
+
+       // write out array of dt
+       for (int i = 0; i < dt.size(); ++i) {
+           HeaderFile << dt[i] << " ";
+       }
+       HeaderFile << "\n";
+
+       // write out array of t_new
+       for (int i = 0; i < t_new.size(); ++i) {
+           HeaderFile << t_new[i] << " ";
+       }
+       HeaderFile << "\n";
+
+       // write the BoxArray at each level
+       for (int lev = 0; lev <= finest_level; ++lev) {
+           boxArray(lev).writeOn(HeaderFile);
+           HeaderFile << '\n';
+       }
+
+       // write the step each plot region was last written at
+       for (const auto& reg : plot_regions) {
+           HeaderFile << "plot_region " << reg.name << " " << reg.last_step << "\n";
+       }
+
+       write_header = [HeaderFileName = checkpointname + "/Header", header = HeaderFile.str()] ()
+       {
+           VisMF::IO_Buffer io_buffer(VisMF::IO_Buffer_Size);
+           std::ofstream ofs;
+           ofs.rdbuf()->pubsetbuf(io_buffer.dataPtr(), io_buffer.size());
+           ofs.open(HeaderFileName.c_str(), std::ofstream::out   |
+                                            std::ofstream::trunc |
+                                            std::ofstream::binary);
+           if( ! ofs.good()) {
+               amrex::FileOpenFailed(HeaderFileName);
+           }
+           ofs << header;
+       };
+
+       if (!async) write_header();
    }
+
+   if (async) {
+       // Everything for this checkpoint on this rank is queued ahead of this task. The
+       //    first barrier waits for the data of all ranks, so a Header on disk always
+       //    means a complete checkpoint, and the second makes the completion marker
+       //    global, so no rank moves past it before the Header is written.
+#ifdef AMREX_USE_MPI
+       MPI_Comm comm = CheckAsyncComm();
+#endif
+       auto done = std::make_shared<std::promise<void>>();
+       m_check_in_flight.push_back(done->get_future());
+       AsyncOut::Submit([=, write_header = std::move(write_header)] ()
+       {
+#ifdef AMREX_USE_MPI
+           MPI_Barrier(comm);
 #endif
+           if (write_header) write_header();
+#ifdef AMREX_USE_MPI
+           MPI_Barrier(comm);
+#endif
+           done->set_value();
+       });
+   }
 
+   if (verbose > 0) {
+       Real t_chk = amrex::second() - t_start;
+       ParallelDescriptor::ReduceRealMax(t_chk, ParallelDescriptor::IOProcessorNumber());
+       amrex::Print() << "Checkpoint " << checkpointname << (async ? " queued in " : " written in ")
+                      << t_chk << " s" << std::endl;
+   }
 }
 
 /**
@@ -308,6 +561,46 @@ ERF::ReadCheckpointFile ()
         MakeNewLevelFromScratch (lev, t_new[lev], ba, dm);
     }
 
+    // read in the step each plot region was last written at (older checkpoints have none)
+    while (std::getline(is, line)) {
+        std::istringstream lis(line);
+        std::string key, name;
+        int last_step;
+        if ((lis >> key >> name >> last_step) && key == "plot_region") {
+            for (auto& reg : plot_regions) {
+                if (reg.name == name) reg.last_step = last_step;
+            }
+        }
+    }
+
+    // Fields that were written to a separate static directory (see WriteCheckpointFile)
+    std::string static_dir = restart_chkfile;
+    std::set<std::string> static_names;
+    Long static_hash_in = 0;
+    if (amrex::FileExists(restart_chkfile + "/Static")) {
+        Vector<char> staticCharPtr;
+        ParallelDescriptor::ReadAndBcastFile(restart_chkfile + "/Static", staticCharPtr);
+        std::istringstream sis(std::string(staticCharPtr.dataPtr()), std::istringstream::in);
+
+        std::string static_name;
+        sis >> static_name >> static_hash_in;
+        while (sis >> word) static_names.insert(word);
+        static_dir = parent_dir(restart_chkfile) + static_name;
+
+        amrex::Print() << "Reading static checkpoint data from " << static_dir << "\n";
+    }
+
+    // Where to find a field, and the hash of what we read from the static directory
+    auto field_dir = [&] (const std::string& name) -> const std::string&
+    {
+        return (static_names.count(name) > 0) ? static_dir : restart_chkfile;
+    };
+    Long static_hash_read = 0;
+    auto hash_static = [&] (const MultiFab& mf, const std::string& name, int lev)
+    {
+        if (static_names.count(name) > 0) static_hash_read += static_hash(mf, name, lev);
+    };
+
     // read in the MultiFab data
     for (int lev = 0; lev <= finest_level; ++lev)
     {
@@ -336,7 +629,8 @@ ERF::ReadCheckpointFile ()
         // Note that we read the ghost cells of the base state (unlike above)
         IntVect ngvect_base = base_state[lev].nGrowVect();
         MultiFab base(grids[lev],dmap[lev],base_state[lev].nComp(),ngvect_base);
-        VisMF::Read(base, amrex::MultiFabFileFullPrefix(lev, restart_chkfile, "Level_", "BaseState"));
+        VisMF::Read(base, amrex::MultiFabFileFullPrefix(lev, field_dir("BaseState"), "Level_", "BaseState"));
+        hash_static(base, "BaseState", lev);
         MultiFab::Copy(base_state[lev],base,0,0,base.nComp(),ngvect_base);
         base_state[lev].FillBoundary(geom[lev].periodicity());
 
@@ -344,7 +638,8 @@ ERF::ReadCheckpointFile ()
            // Note that we also read the ghost cells of z_phys_nd
            IntVect ngvect = z_phys_nd[lev]->nGrowVect();
            MultiFab z_height(convert(grids[lev],IntVect(1,1,1)),dmap[lev],1,ngvect);
-           VisMF::Read(z_height, amrex::MultiFabFileFullPrefix(lev, restart_chkfile, "Level_", "Z_Phys_nd"));
+           VisMF::Read(z_height, amrex::MultiFabFileFullPrefix(lev, field_dir("Z_Phys_nd"), "Level_", "Z_Phys_nd"));
+           hash_static(z_height, "Z_Phys_nd", lev);
            MultiFab::Copy(*z_phys_nd[lev],z_height,0,0,1,ngvect);
            update_terrain_arrays(lev, t_new[lev]);
         }
@@ -358,17 +653,20 @@ ERF::ReadCheckpointFile ()
 
         IntVect ngvect_mf = mapfac_m[lev]->nGrowVect();
         MultiFab mf_m(ba2d,dmap[lev],1,ngvect_mf);
-        VisMF::Read(mf_m, amrex::MultiFabFileFullPrefix(lev, restart_chkfile, "Level_", "MapFactor_m"));
+        VisMF::Read(mf_m, amrex::MultiFabFileFullPrefix(lev, field_dir("MapFactor_m"), "Level_", "MapFactor_m"));
+        hash_static(mf_m, "MapFactor_m", lev);
         MultiFab::Copy(*mapfac_m[lev],mf_m,0,0,1,ngvect_mf);
 
         ngvect_mf = mapfac_u[lev]->nGrowVect();
         MultiFab mf_u(convert(ba2d,IntVect(1,0,0)),dmap[lev],1,ngvect_mf);
-        VisMF::Read(mf_u, amrex::MultiFabFileFullPrefix(lev, restart_chkfile, "Level_", "MapFactor_u"));
+        VisMF::Read(mf_u, amrex::MultiFabFileFullPrefix(lev, field_dir("MapFactor_u"), "Level_", "MapFactor_u"));
+        hash_static(mf_u, "MapFactor_u", lev);
         MultiFab::Copy(*mapfac_u[lev],mf_u,0,0,1,ngvect_mf);
 
         ngvect_mf = mapfac_v[lev]->nGrowVect();
         MultiFab mf_v(convert(ba2d,IntVect(0,1,0)),dmap[lev],1,ngvect_mf);
-        VisMF::Read(mf_v, amrex::MultiFabFileFullPrefix(lev, restart_chkfile, "Level_", "MapFactor_v"));
+        VisMF::Read(mf_v, amrex::MultiFabFileFullPrefix(lev, field_dir("MapFactor_v"), "Level_", "MapFactor_v"));
+        hash_static(mf_v, "MapFactor_v", lev);
         MultiFab::Copy(*mapfac_v[lev],mf_v,0,0,1,ngvect_mf);
     }
 
@@ -381,99 +679,233 @@ ERF::ReadCheckpointFile ()
 #endif
 
 #ifdef ERF_USE_NETCDF
-    // Read bdy_data files
+    // Read bdy files
     if (init_type == "real") {
         int ioproc = ParallelDescriptor::IOProcessorNumber();  // I/O rank
-        int num_time;
-        int num_var;
-        Vector<Box> bx_v;
+        m_wrfbdy = std::make_unique<ReadWRFBdy>(nc_bdy_file,geom[0].Domain());
         if (ParallelDescriptor::IOProcessor()) {
             // Open header file and read from it
-            std::ifstream bdy_h_file(amrex::MultiFabFileFullPrefix(0, restart_chkfile, "Level_", "bdy_H"));
-            bdy_h_file >> num_time;
-            bdy_h_file >> num_var;
+            std::ifstream bdy_h_file(amrex::MultiFabFileFullPrefix(0, field_dir("bdy"), "Level_", "bdy_H"));
             bdy_h_file >> start_bdy_time;
             bdy_h_file >> bdy_time_interval;
             bdy_h_file >> wrfbdy_width;
-            bx_v.resize(4*num_var);
-            for (int ivar(0); ivar<num_var; ++ivar) {
-                bdy_h_file >> bx_v[4*ivar  ];
-                bdy_h_file >> bx_v[4*ivar+1];
-                bdy_h_file >> bx_v[4*ivar+2];
-                bdy_h_file >> bx_v[4*ivar+3];
-            }
-
-            // IO size the FABs
-            bdy_data_xlo.resize(num_time);
-            bdy_data_xhi.resize(num_time);
-            bdy_data_ylo.resize(num_time);
-            bdy_data_yhi.resize(num_time);
-            for (int itime(0); itime<num_time; ++itime) {
-                bdy_data_xlo[itime].resize(num_var);
-                bdy_data_xhi[itime].resize(num_var);
-                bdy_data_ylo[itime].resize(num_var);
-                bdy_data_yhi[itime].resize(num_var);
-                for (int ivar(0); ivar<num_var; ++ivar) {
-                    bdy_data_xlo[itime][ivar].resize(bx_v[4*ivar  ]);
-                    bdy_data_xhi[itime][ivar].resize(bx_v[4*ivar+1]);
-                    bdy_data_ylo[itime][ivar].resize(bx_v[4*ivar+2]);
-                    bdy_data_yhi[itime][ivar].resize(bx_v[4*ivar+3]);
-                }
-            }
 
             // Open data file and read from it
-            std::ifstream bdy_d_file(amrex::MultiFabFileFullPrefix(0, restart_chkfile, "Level_", "bdy_D"));
-            for (int itime(0); itime<num_time; ++itime) {
-                for (int ivar(0); ivar<num_var; ++ivar) {
-                    bdy_data_xlo[itime][ivar].readFrom(bdy_d_file);
-                    bdy_data_xhi[itime][ivar].readFrom(bdy_d_file);
-                    bdy_data_ylo[itime][ivar].readFrom(bdy_d_file);
-                    bdy_data_yhi[itime][ivar].readFrom(bdy_d_file);
+            std::ifstream bdy_d_file(amrex::MultiFabFileFullPrefix(0, field_dir("bdy"), "Level_", "bdy_D"));
+            auto fields = m_wrfbdy->conversion_fields();
+            for (int n(0); n<fields.size(); ++n) {
+                fields[n]->readFrom(bdy_d_file);
+                if (static_names.count("bdy") > 0) {
+                    static_hash_read += static_hash(*fields[n], "bdy", n);
                 }
             }
         } // IO
 
-        // Broadcast the data
-        ParallelDescriptor::Barrier();
         ParallelDescriptor::Bcast(&start_bdy_time,1,ioproc);
         ParallelDescriptor::Bcast(&bdy_time_interval,1,ioproc);
         ParallelDescriptor::Bcast(&wrfbdy_width,1,ioproc);
-        ParallelDescriptor::Bcast(&num_time,1,ioproc);
-        ParallelDescriptor::Bcast(&num_var,1,ioproc);
-
-        // Everyone size their boxes
-        bx_v.resize(4*num_var);
-
-        ParallelDescriptor::Bcast(bx_v.dataPtr(),bx_v.size(),ioproc);
-
-        // Everyone but IO size their FABs
-        if (!ParallelDescriptor::IOProcessor()) {
-          bdy_data_xlo.resize(num_time);
-          bdy_data_xhi.resize(num_time);
-          bdy_data_ylo.resize(num_time);
-          bdy_data_yhi.resize(num_time);
-          for (int itime(0); itime<num_time; ++itime) {
-            bdy_data_xlo[itime].resize(num_var);
-            bdy_data_xhi[itime].resize(num_var);
-            bdy_data_ylo[itime].resize(num_var);
-            bdy_data_yhi[itime].resize(num_var);
-            for (int ivar(0); ivar<num_var; ++ivar) {
-              bdy_data_xlo[itime][ivar].resize(bx_v[4*ivar  ]);
-              bdy_data_xhi[itime][ivar].resize(bx_v[4*ivar+1]);
-              bdy_data_ylo[itime][ivar].resize(bx_v[4*ivar+2]);
-              bdy_data_yhi[itime][ivar].resize(bx_v[4*ivar+3]);
+
+        // Hand out what we need to fill the ghost cells at the restart time
+        update_wrfbdy(t_new[0], 0.0);
+    } // init real
+#endif
+
+    // Make sure the static directory holds what this checkpoint was written with
+    if (!static_names.empty()) {
+        ParallelDescriptor::ReduceLongSum(static_hash_read);
+        if (static_hash_read != static_hash_in) {
+            amrex::Abort("ReadCheckpointFile: the data in " + static_dir +
+                         " do not match the checkpoint " + restart_chkfile);
+        }
+
+        // Later checkpoints can keep referring to it
+        m_check_static_dir  = static_dir;
+        m_check_static_hash = static_hash_in;
+    }
+
+    // Time averaging carries on from where the checkpoint left it
+    if (output_stats) {
+        m_stats = std::make_unique<TimeAvgStats>(grids[0],dmap[0],geom[0]);
+        m_stats->read_checkpoint(restart_chkfile);
+    }
+}
+
+#ifdef ERF_USE_NETCDF
+/**
+ * Key of the inputs that level 0 is initialized from. The wrfinput (and for "real"
+ * the wrfbdy) files are hashed in 16 MB chunks, each rank taking every nprocs-th chunk,
+ * so the key does not depend on the number of ranks. The options and the layout of the
+ * level 0 data are hashed in as well.
+ */
+Long
+ERF::real_init_cache_key () const
+{
+    BL_PROFILE("ERF::real_init_cache_key()");
+
+    Vector<std::string> files = nc_init_file[0];
+    if (init_type == "real") files.push_back(nc_bdy_file);
+
+    constexpr Long chunk_size = 16*1024*1024;
+    const int nprocs = ParallelDescriptor::NProcs();
+    const int myproc = ParallelDescriptor::MyProc();
+
+    Long key = 0;
+    Vector<char> buffer(chunk_size);
+    for (int n = 0; n < files.size(); ++n) {
+        std::ifstream ifs(files[n], std::ios::in | std::ios::binary);
+        if (!ifs.good()) amrex::FileOpenFailed(files[n]);
+        ifs.seekg(0, std::ios::end);
+        const Long nbytes = ifs.tellg();
+        const Long nchunks = (nbytes + chunk_size - 1) / chunk_size;
+        for (Long c = myproc; c < nchunks; c += nprocs) {
+            const Long len = std::min(chunk_size, nbytes - c*chunk_size);
+            ifs.seekg(c*chunk_size, std::ios::beg);
+            ifs.read(buffer.data(), len);
+            std::uint64_t h = 14695981039346656037ULL;
+            h = fnv1a(h, &n, sizeof(int));
+            h = fnv1a(h, &c, sizeof(Long));
+            h = fnv1a(h, buffer.data(), len);
+            key += static_cast<Long>(h & 0xFFFFFFFFFFFFULL);
+        }
+    }
+    ParallelDescriptor::ReduceLongSum(key);
+
+    // What else the initialized data depend on
+    std::ostringstream opts;
+    opts << std::setprecision(17);
+    opts << init_type << " " << NVAR << " " << solverChoice.use_terrain << " "
+         << solverChoice.rdOcp << " " << wrfbdy_width << " " << wrfbdy_set_width << "\n";
+    for (const auto& mf : vars_new[0]) opts << mf.nGrowVect() << " ";
+    opts << base_state[0].nGrowVect() << " " << mapfac_m[0]->nGrowVect() << " "
+         << mapfac_u[0]->nGrowVect() << " " << mapfac_v[0]->nGrowVect() << "\n";
+    if (solverChoice.use_terrain) opts << z_phys_nd[0]->nGrowVect() << "\n";
+    grids[0].writeOn(opts);
+
+    const std::string opts_str = opts.str();
+    std::uint64_t h = fnv1a(14695981039346656037ULL, opts_str.data(), opts_str.size());
+    key += static_cast<Long>(h & 0xFFFFFFFFFFFFULL);
+
+    return key;
+}
+
+/**
+ * Load level 0 from erf.real_init_cache if the cache was written for the same inputs.
+ * This replaces init_from_wrfinput at level 0; the wrfbdy times themselves are still
+ * read from the wrfbdy file as the run reaches them.
+ *
+ * @return Whether level 0 was loaded from the cache
+ */
+bool
+ERF::ReadRealInitCache ()
+{
+    if (real_init_cache.empty()) return false;
+
+    BL_PROFILE("ERF::ReadRealInitCache()");
+
+    m_real_init_cache_key = real_init_cache_key();
+
+    // The Header is written last, so without it the cache is not complete
+    const std::string header_name = real_init_cache + "/Header";
+    if (!amrex::FileExists(header_name)) return false;
+
+    Vector<char> fileCharPtr;
+    ParallelDescriptor::ReadAndBcastFile(header_name, fileCharPtr);
+    std::istringstream is(std::string(fileCharPtr.dataPtr()), std::istringstream::in);
+
+    std::string line;
+    std::getline(is, line);
+
+    Long key_in;
+    is >> key_in;
+    if (key_in != m_real_init_cache_key) {
+        amrex::Print() << "Real init cache " << real_init_cache
+                       << " was written for other inputs; reading the NetCDF files\n";
+        return false;
+    }
+    is >> start_bdy_time >> bdy_time_interval >> wrfbdy_width >> wrfbdy_set_width;
+
+    amrex::Print() << "Reading level 0 from real init cache " << real_init_cache << "\n";
+
+    // Same BoxArray and ghost cells as the data were written with (they are in the key)
+    const int lev = 0;
+    auto& lev_new = vars_new[lev];
+    VisMF::Read(lev_new[Vars::cons], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "Cell"));
+    VisMF::Read(lev_new[Vars::xvel], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "XFace"));
+    VisMF::Read(lev_new[Vars::yvel], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "YFace"));
+    VisMF::Read(lev_new[Vars::zvel], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "ZFace"));
+    VisMF::Read(base_state[lev], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "BaseState"));
+    VisMF::Read(*mapfac_m[lev], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "MapFactor_m"));
+    VisMF::Read(*mapfac_u[lev], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "MapFactor_u"));
+    VisMF::Read(*mapfac_v[lev], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "MapFactor_v"));
+
+    if (solverChoice.use_terrain) {
+        VisMF::Read(*z_phys_nd[lev], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "Z_Phys_nd"));
+        make_J  (geom[lev],*z_phys_nd[lev],*  detJ_cc[lev]);
+        make_zcc(geom[lev],*z_phys_nd[lev],*z_phys_cc[lev]);
+    }
+
+    if (init_type == "real") {
+        m_wrfbdy = std::make_unique<ReadWRFBdy>(nc_bdy_file,geom[0].Domain());
+        if (ParallelDescriptor::IOProcessor()) {
+            std::ifstream bdy_d_file(amrex::MultiFabFileFullPrefix(0, real_init_cache, "Level_", "bdy_D"));
+            for (auto* fab : m_wrfbdy->conversion_fields()) {
+                fab->readFrom(bdy_d_file);
             }
-          }
         }
 
-        for (int itime(0); itime<num_time; ++itime) {
-            for (int ivar(0); ivar<num_var; ++ivar) {
-                ParallelDescriptor::Bcast(bdy_data_xlo[itime][ivar].dataPtr(),bdy_data_xlo[itime][ivar].box().numPts(),ioproc);
-                ParallelDescriptor::Bcast(bdy_data_xhi[itime][ivar].dataPtr(),bdy_data_xhi[itime][ivar].box().numPts(),ioproc);
-                ParallelDescriptor::Bcast(bdy_data_ylo[itime][ivar].dataPtr(),bdy_data_ylo[itime][ivar].box().numPts(),ioproc);
-                ParallelDescriptor::Bcast(bdy_data_yhi[itime][ivar].dataPtr(),bdy_data_yhi[itime][ivar].box().numPts(),ioproc);
+        // Hand out what we need to fill the ghost cells at the initial time
+        update_wrfbdy(t_new[0], 0.0);
+    }
+
+    return true;
+}
+
+/**
+ * Write level 0 as initialized from wrfinput to erf.real_init_cache, together with
+ * the key of the inputs, so later runs with the same inputs can skip the NetCDF path.
+ * An existing cache directory is renamed first.
+ */
+void
+ERF::WriteRealInitCache () const
+{
+    if (real_init_cache.empty()) return;
+
+    BL_PROFILE("ERF::WriteRealInitCache()");
+
+    amrex::Print() << "Writing real init cache " << real_init_cache << "\n";
+
+    const int lev = 0;
+    amrex::PreBuildDirectorHierarchy(real_init_cache, "Level_", 1, true);
+
+    // We keep the ghost cells since they were filled from the NetCDF data too
+    const auto& lev_new = vars_new[lev];
+    VisMF::Write(lev_new[Vars::cons], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "Cell"));
+    VisMF::Write(lev_new[Vars::xvel], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "XFace"));
+    VisMF::Write(lev_new[Vars::yvel], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "YFace"));
+    VisMF::Write(lev_new[Vars::zvel], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "ZFace"));
+    VisMF::Write(base_state[lev], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "BaseState"));
+    VisMF::Write(*mapfac_m[lev], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "MapFactor_m"));
+    VisMF::Write(*mapfac_u[lev], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "MapFactor_u"));
+    VisMF::Write(*mapfac_v[lev], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "MapFactor_v"));
+    if (solverChoice.use_terrain) {
+        VisMF::Write(*z_phys_nd[lev], amrex::MultiFabFileFullPrefix(lev, real_init_cache, "Level_", "Z_Phys_nd"));
+    }
+
+    if (ParallelDescriptor::IOProcessor()) {
+        if (init_type == "real") {
+            std::ofstream bdy_d_file(amrex::MultiFabFileFullPrefix(0, real_init_cache, "Level_", "bdy_D"));
+            for (const auto* fab : m_wrfbdy->conversion_fields()) {
+                fab->writeOn(bdy_d_file);
             }
         }
-    } // init real
-#endif
+
+        std::ofstream header_file(real_init_cache + "/Header");
+        header_file.precision(17);
+        header_file << "Real init cache for ERF\n";
+        header_file << m_real_init_cache_key << "\n";
+        header_file << start_bdy_time << " " << bdy_time_interval << " "
+                    << wrfbdy_width << " " << wrfbdy_set_width << "\n";
+        if (!header_file.good()) amrex::FileOpenFailed(real_init_cache + "/Header");
+    }
 }
+#endif
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+#include "AMReX_ParmParse.H"
+#include "AMReX_Utility.H"
+#include "ERF_ProbeSampler.H"
+#include "IndexDefines.H"
+
+using namespace amrex;
+
+namespace {
+    // Variables sampled along a line after the conserved ones
+    const Vector<std::string> line_extra_names {"x_velocity", "y_velocity", "z_velocity",
+                                                "tau11", "tau22", "tau33", "tau12", "tau13", "tau23"};
+
+    // Cells given as triples of indices
+    Vector<IntVect> read_cells (ParmParse& pp, const std::string& name)
+    {
+        Vector<IntVect> cells;
+        if (!pp.contains(name.c_str())) return cells;
+
+        const int ncells = pp.countval(name.c_str()) / AMREX_SPACEDIM;
+        Vector<int> index(ncells*AMREX_SPACEDIM);
+        pp.queryarr(name.c_str(), index, 0, ncells*AMREX_SPACEDIM);
+        for (int n = 0; n < ncells; ++n) {
+            cells.push_back(IntVect(index[AMREX_SPACEDIM*n+0],
+                                    index[AMREX_SPACEDIM*n+1],
+                                    index[AMREX_SPACEDIM*n+2]));
+        }
+        return cells;
+    }
+}
+
+/**
+ * Constructor for the ProbeSampler class, which reads the probes and opens the output
+ *
+ * @param geom Geometry of level 0
+ * @param cons_names Names of the conserved variables
+ * @param restart_time Time we restart from, or negative for a new run
+ */
+ProbeSampler::ProbeSampler (const Geometry& geom,
+                            const Vector<std::string>& cons_names,
+                            Real restart_time)
+    : m_geom(geom)
+{
+    ParmParse pp("erf");
+
+    m_points = read_cells(pp, "sample_point");
+    m_lines  = read_cells(pp, "sample_line");
+
+    pp.query("sample_file", m_file);
+    pp.query("sum_interval", m_interval);
+    pp.query("sum_period", m_per);
+    pp.query("sample_interval", m_interval);
+    pp.query("sample_period", m_per);
+    pp.query("sample_flush_int", m_flush_int);
+    m_flush_int = std::max(m_flush_int, 1);
+
+    // The per-probe text logs are gone; make sure an old inputs file does not silently
+    //    write its samples somewhere else
+    if (pp.contains("sample_point_log") || pp.contains("sample_line_log")) {
+        Abort("erf.sample_point_log and erf.sample_line_log are no longer supported;"
+              " set erf.sample_point and erf.sample_line for the probes and"
+              " erf.sample_file for the file they are all written to");
+    }
+
+    const Box& domain = m_geom.Domain();
+    for (const auto& iv : m_points) {
+        if (!domain.contains(iv)) Abort("erf.sample_point is outside the domain");
+    }
+    for (const auto& iv : m_lines) {
+        if (!domain.contains(IntVect(iv[0], iv[1], domain.smallEnd(2)))) {
+            Abort("erf.sample_line is outside the domain");
+        }
+    }
+
+    m_ncons = cons_names.size();
+    m_nz = domain.length(2);
+    const int nline_vars = m_ncons + static_cast<int>(line_extra_names.size());
+    m_nvalues = static_cast<int>(m_points.size()) * m_ncons
+              + static_cast<int>(m_lines.size()) * nline_vars * m_nz;
+
+    if (ParallelDescriptor::IOProcessor())
+    {
+        // A new run starts the file afresh; a restart carries on from the restart time
+        std::ios::openmode mode = std::ios::out | std::ios::binary;
+        if (restart_time >= 0.0) {
+            if (FileExists(m_file)) truncate_file(restart_time);
+            mode |= std::ios::app;
+        } else {
+            mode |= std::ios::trunc;
+        }
+
+        m_ofs.open(m_file.c_str(), mode);
+        if (!m_ofs.good()) FileOpenFailed(m_file);
+
+        write_header(cons_names);
+    }
+}
+
+ProbeSampler::~ProbeSampler ()
+{
+    flush();
+}
+
+/**
+ * Describes the layout of the binary file in a text header next to it
+ *
+ * @param cons_names Names of the conserved variables
+ */
+void
+ProbeSampler::write_header (const Vector<std::string>& cons_names) const
+{
+    const std::string hdr_name = m_file + ".hdr";
+    std::ofstream hdr(hdr_name.c_str());
+    if (!hdr.good()) FileOpenFailed(hdr_name);
+
+    hdr << "ERF probe samples\n";
+    hdr << "bytes_per_value " << sizeof(double) << "\n";
+    hdr << "values_per_sample " << m_nvalues << " (after the time)\n";
+    hdr << "npoints " << m_points.size() << "\n";
+    for (const auto& iv : m_points) {
+        hdr << iv[0] << " " << iv[1] << " " << iv[2] << "\n";
+    }
+    hdr << "nlines " << m_lines.size() << " nz " << m_nz << "\n";
+    for (const auto& iv : m_lines) {
+        hdr << iv[0] << " " << iv[1] << "\n";
+    }
+    hdr << "point_vars";
+    for (const auto& name : cons_names) hdr << " " << name;
+    hdr << "\nline_vars";
+    for (const auto& name : cons_names) hdr << " " << name;
+    for (const auto& name : line_extra_names) hdr << " " << name;
+    hdr << "\n";
+}
+
+/**
+ * Keeps the samples in an existing file up to the restart time and drops the rest, so
+ * that the samples taken after the restart carry on from there
+ *
+ * @param restart_time Time we restart from
+ */
+void
+ProbeSampler::truncate_file (Real restart_time)
+{
+    // Samples of a different set of probes cannot be carried on
+    std::ifstream old_hdr((m_file + ".hdr").c_str());
+    std::string line;
+    while (std::getline(old_hdr, line)) {
+        std::istringstream is(line);
+        std::string key;
+        int nvalues;
+        if ((is >> key >> nvalues) && key == "values_per_sample" && nvalues != m_nvalues) {
+            Abort("ProbeSampler: the probes in " + m_file + " differ from those in the inputs");
+        }
+    }
+
+    const std::streamoff rec_bytes = static_cast<std::streamoff>(m_nvalues + 1) * sizeof(double);
+
+    std::ifstream ifs(m_file.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    const std::streamoff fsize = ifs.tellg();
+    const std::streamoff nrec = fsize / rec_bytes;
+
+    // The samples are in time order, so keep those up to the first one after the restart
+    std::streamoff nkeep = 0;
+    for (; nkeep < nrec; ++nkeep) {
+        double t;
+        ifs.seekg(nkeep * rec_bytes);
+        ifs.read(reinterpret_cast<char*>(&t), sizeof(double));
+        if (t > restart_time * (1.0 + 1.e-12)) break;
+    }
+
+    if (nkeep * rec_bytes == fsize) return;
+
+    // Copy what we keep to a new file one sample at a time
+    const std::string tmp_name = m_file + ".tmp";
+    {
+        std::ofstream ofs(tmp_name.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!ofs.good()) FileOpenFailed(tmp_name);
+        Vector<char> rec(static_cast<std::size_t>(rec_bytes));
+        ifs.seekg(0);
+        for (std::streamoff n = 0; n < nkeep; ++n) {
+            ifs.read(rec.data(), rec_bytes);
+            ofs.write(rec.data(), rec_bytes);
+        }
+    }
+    ifs.close();
+
+    if (std::rename(tmp_name.c_str(), m_file.c_str()) != 0) {
+        Abort("ProbeSampler: unable to replace " + m_file);
+    }
+}
+
+/**
+ * Finds which grid holds each probe cell, and keeps the cells held by this rank
+ *
+ * @param cons Level 0 conserved variables
+ */
+void
+ProbeSampler::locate (const MultiFab& cons)
+{
+    BL_PROFILE("ProbeSampler::locate()");
+
+    m_ba = cons.boxArray();
+    m_dm = cons.DistributionMap();
+
+    const Box& domain = m_geom.Domain();
+    const int myproc = ParallelDescriptor::MyProc();
+
+    Vector<ProbeCell> cells;
+
+    // Each probe is a box of cells: one cell for a point, one column of cells for a line
+    auto add_probe = [&] (const Box& probe_box, int offset, int stride, int line)
+    {
+        for (const auto& isect : m_ba.intersections(probe_box)) {
+            if (m_dm[isect.first] != myproc) continue;
+            const int box = cons.localindex(isect.first);
+            const Box& bx = isect.second;
+            for (int k = bx.smallEnd(2); k <= bx.bigEnd(2); ++k) {
+                cells.push_back(ProbeCell{box, bx.smallEnd(0), bx.smallEnd(1), k,
+                                          offset + (k - domain.smallEnd(2)) * line, stride, line});
+            }
+        }
+    };
+
+    int offset = 0;
+    for (const auto& iv : m_points) {
+        add_probe(Box(iv, iv), offset, 1, 0);
+        offset += m_ncons;
+    }
+    const int nline_vars = m_ncons + static_cast<int>(line_extra_names.size());
+    for (const auto& iv : m_lines) {
+        const IntVect lo(iv[0], iv[1], domain.smallEnd(2));
+        const IntVect hi(iv[0], iv[1], domain.bigEnd(2));
+        add_probe(Box(lo, hi), offset, m_nz, 1);
+        offset += nline_vars * m_nz;
+    }
+    AMREX_ALWAYS_ASSERT(offset == m_nvalues);
+
+    m_cells.resize(cells.size());
+    Gpu::copy(Gpu::hostToDevice, cells.begin(), cells.end(), m_cells.begin());
+}
+
+/**
+ * Samples all the probes into the buffer on the I/O rank, and appends the buffer to
+ * the file once it holds erf.sample_flush_int samples
+ *
+ * @param time Current time
+ * @param vars Level 0 state (the velocities are averaged to cell centres)
+ * @param tau Stress components on level 0, or nullptr without diffusion
+ */
+void
+ProbeSampler::sample (Real time,
+                      const Vector<MultiFab>& vars,
+                      const Array<const MultiFab*,6>& tau)
+{
+    BL_PROFILE("ProbeSampler::sample()");
+
+    const MultiFab& cons = vars[Vars::cons];
+
+    // The probes are only located again when the grids have changed
+    if (m_ba != cons.boxArray() || m_dm != cons.DistributionMap()) locate(cons);
+
+    Gpu::DeviceVector<Real> d_sample(m_nvalues, 0.0);
+    Vector<Real> h_sample(m_nvalues, 0.0);
+
+    const int ncells = m_cells.size();
+    if (ncells > 0)
+    {
+        Real* values = d_sample.data();
+        const ProbeCell* probe_cells = m_cells.data();
+        const int ncons = m_ncons;
+
+        const auto& cons_ma = cons.const_arrays();
+        const auto& u_ma = vars[Vars::xvel].const_arrays();
+        const auto& v_ma = vars[Vars::yvel].const_arrays();
+        const auto& w_ma = vars[Vars::zvel].const_arrays();
+
+        // Without diffusion there is no stress; cons stands in for it but is not read
+        const bool has_tau = (tau[0] != nullptr);
+        const auto& t11_ma = has_tau ? tau[0]->const_arrays() : cons_ma;
+        const auto& t22_ma = has_tau ? tau[1]->const_arrays() : cons_ma;
+        const auto& t33_ma = has_tau ? tau[2]->const_arrays() : cons_ma;
+        const auto& t12_ma = has_tau ? tau[3]->const_arrays() : cons_ma;
+        const auto& t13_ma = has_tau ? tau[4]->const_arrays() : cons_ma;
+        const auto& t23_ma = has_tau ? tau[5]->const_arrays() : cons_ma;
+
+        // Each probe cell writes its own values, so there is nothing to reduce here
+        ParallelFor(ncells, [=] AMREX_GPU_DEVICE (int n) noexcept
+        {
+            const ProbeCell& pc = probe_cells[n];
+            const int b = pc.box;
+            const int i = pc.i;
+            const int j = pc.j;
+            const int k = pc.k;
+            Real* val = values + pc.offset;
+
+            for (int nc = 0; nc < ncons; ++nc) {
+                val[nc*pc.stride] = cons_ma[b](i,j,k,nc);
+            }
+
+            if (pc.line) {
+                val += ncons*pc.stride;
+                val[0]           = 0.5 * (u_ma[b](i,j,k) + u_ma[b](i+1,j,k));
+                val[  pc.stride] = 0.5 * (v_ma[b](i,j,k) + v_ma[b](i,j+1,k));
+                val[2*pc.stride] = 0.5 * (w_ma[b](i,j,k) + w_ma[b](i,j,k+1));
+                if (has_tau) {
+                    val[3*pc.stride] = t11_ma[b](i,j,k);
+                    val[4*pc.stride] = t22_ma[b](i,j,k);
+                    val[5*pc.stride] = t33_ma[b](i,j,k);
+                    val[6*pc.stride] = t12_ma[b](i,j,k);
+                    val[7*pc.stride] = t13_ma[b](i,j,k);
+                    val[8*pc.stride] = t23_ma[b](i,j,k);
+                }
+            }
+        });
+    }
+
+    // Communicate values to CPU then to the IO processor
+    Gpu::copy(Gpu::deviceToHost, d_sample.begin(), d_sample.end(), h_sample.begin());
+    ParallelDescriptor::ReduceRealSum(h_sample.data(), h_sample.size(),
+                                      ParallelDescriptor::IOProcessorNumber());
+
+    if (ParallelDescriptor::IOProcessor()) {
+        m_buffer.push_back(time);
+        m_buffer.insert(m_buffer.end(), h_sample.begin(), h_sample.end());
+        if (++m_nbuffered >= m_flush_int) flush();
+    }
+}
+
+/**
+ * Appends the samples held on the I/O rank to the binary file in one write
+ */
+void
+ProbeSampler::flush ()
+{
+    if (!ParallelDescriptor::IOProcessor() || m_nbuffered == 0) return;
+
+    BL_PROFILE("ProbeSampler::flush()");
+
+    m_ofs.write(reinterpret_cast<const char*>(m_buffer.data()),
+                static_cast<std::streamsize>(m_buffer.size() * sizeof(double)));
+    m_ofs.flush();
+    if (!m_ofs.good()) Abort("ProbeSampler: error writing " + m_file);
+
+    m_buffer.clear();
+    m_nbuffered = 0;
+}
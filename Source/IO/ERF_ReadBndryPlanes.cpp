@@ -1,6 +1,10 @@
+#include <chrono>
+#include <fstream>
+
 #include "AMReX_Gpu.H"
 #include "AMReX_ParmParse.H"
 #include <AMReX_PlotFileUtil.H>
+#include <AMReX_VisMF.H>
 #include "ERF_ReadBndryPlanes.H"
 #include "IndexDefines.H"
 #include "AMReX_MultiFabUtil.H"
@@ -55,6 +59,7 @@ void ReadBndryPlanes::define_level_data(int /*lev*/)
             m_data_np1[ori]    = std::make_unique<PlaneVector>();
             m_data_np2[ori]    = std::make_unique<PlaneVector>();
             m_data_interp[ori] = std::make_unique<PlaneVector>();
+            m_data_next[ori]   = std::make_unique<PlaneVector>();
 
             const auto& lo = domain.loVect();
             const auto& hi = domain.hiVect();
@@ -69,6 +74,7 @@ void ReadBndryPlanes::define_level_data(int /*lev*/)
             m_data_np1[ori]->push_back(FArrayBox(pbx, ncomp));
             m_data_np2[ori]->push_back(FArrayBox(pbx, ncomp));
             m_data_interp[ori]->push_back(FArrayBox(pbx, ncomp));
+            m_data_next[ori]->push_back(FArrayBox(pbx, ncomp));
         }
     }
 }
@@ -150,6 +156,9 @@ ReadBndryPlanes::ReadBndryPlanes(const Geometry& geom, const Real& rdOcp_in)
     // What folder will the time series of planes be read from
     pp.get("bndry_file", m_filename);
 
+    // Read the next file in a background thread while the current ones are in use
+    pp.query("bndry_read_ahead", m_read_ahead_on);
+
     is_velocity_read     = 0;
     is_density_read      = 0;
     is_temperature_read  = 0;
@@ -198,6 +207,7 @@ ReadBndryPlanes::ReadBndryPlanes(const Geometry& geom, const Real& rdOcp_in)
     m_data_np1.resize(size);
     m_data_np2.resize(size);
     m_data_interp.resize(size);
+    m_data_next.resize(size);
 }
 
 /**
@@ -260,6 +270,28 @@ void ReadBndryPlanes::read_time_file()
         ParallelDescriptor::IOProcessorNumber(),
         ParallelDescriptor::Communicator());
 
+    // If the planes were written several steps per file, the index says where each step is
+    if (ParallelDescriptor::IOProcessor()) {
+        std::ifstream index_file(m_filename + "/bndry_index.dat");
+        if (index_file.good()) {
+            m_batched = 1;
+            int t_step, slot;
+            std::string batch_name;
+            while (index_file >> t_step >> batch_name >> slot) {
+                m_batch_index[t_step] = std::make_pair(batch_name, slot);
+            }
+            for (int i = 0; i < time_file_length; ++i) {
+                if (m_batch_index.count(m_in_timesteps[i]) == 0)
+                    Error("Timestep in time.dat file missing from bndry_index.dat file");
+            }
+        }
+    }
+
+    ParallelDescriptor::Bcast(
+        &m_batched, 1,
+        ParallelDescriptor::IOProcessorNumber(),
+        ParallelDescriptor::Communicator());
+
     // Allocate data we will need -- for now just at one level
     int lev = 0;
     define_level_data(lev);
@@ -314,8 +346,18 @@ void ReadBndryPlanes::read_input_files(Real time, Real dt,
     // Compute the index such that time falls between times[idx] and times[idx+1]
     const int idx = closest_index(m_in_times, time);
 
+    // Do we need to read another file
+    const bool need_new_file = (idx >= last_file_read-1 && last_file_read != m_in_times.size()-1);
+
+    // Convert the file read ahead into the spare buffer as soon as it is on hand, or
+    //    wait for it if we need it now
+    if (m_read_ahead_file >= 0 &&
+        read_ahead_done(need_new_file && m_read_ahead_file == last_file_read+1)) {
+        finish_read_ahead(m_bc_extdir_vals);
+    }
+
     // Now we need to read another file
-    if (idx >= last_file_read-1 && last_file_read != m_in_times.size()-1) {
+    if (need_new_file) {
         int new_read = last_file_read+1;
 
         // We need to change which data the pointers point to before we read in the new data
@@ -331,10 +373,25 @@ void ReadBndryPlanes::read_input_files(Real time, Real dt,
         m_tnp1 = m_tnp2;
         m_tnp2 = m_in_times[new_read];
 
-        read_file(new_read,m_data_np2,m_bc_extdir_vals);
+        if (m_next_file == new_read) {
+            // The new file is already in the spare buffer
+            for (OrientationIter oit; oit != nullptr; ++oit) {
+                auto ori = oit();
+                std::swap(m_data_np2[ori],m_data_next[ori]);
+            }
+            m_next_file = -1;
+        } else {
+            read_file(new_read,m_data_np2,m_bc_extdir_vals);
+        }
         last_file_read = new_read;
     }
 
+    // Start reading the file after the last one we hold
+    if (m_read_ahead_on && m_read_ahead_file < 0 && m_next_file < 0 &&
+        last_file_read+1 < m_in_times.size()) {
+        start_read_ahead(last_file_read+1);
+    }
+
     AMREX_ASSERT(time    >= m_tn && time    <= m_tnp2);
     AMREX_ASSERT(time+dt >= m_tn && time+dt <= m_tnp2);
 }
@@ -346,9 +403,11 @@ void ReadBndryPlanes::read_input_files(Real time, Real dt,
  * @param idx Specifies the index corresponding to the timestep we want
  * @param data_to_fill Container for face data on boundaries
  * @param m_bc_extdir_vals Container storing the external dirichlet boundary conditions we are reading from the input files
+ * @param raw Faces of the file already read into host memory on the I/O rank (if not null)
  */
 void ReadBndryPlanes::read_file(const int idx, Vector<std::unique_ptr<PlaneVector>>& data_to_fill,
-    Array<Array<Real, AMREX_SPACEDIM*2>,AMREX_SPACEDIM+NVAR> m_bc_extdir_vals)
+    Array<Array<Real, AMREX_SPACEDIM*2>,AMREX_SPACEDIM+NVAR> m_bc_extdir_vals,
+    const RawFaces* raw)
 {
     const int t_step = m_in_timesteps[idx];
     const std::string chkname1 = m_filename + Concatenate("/bndry_output", t_step);
@@ -356,9 +415,26 @@ void ReadBndryPlanes::read_file(const int idx, Vector<std::unique_ptr<PlaneVecto
     const std::string level_prefix = "Level_";
     const int lev = 0;
 
+    // Batched files are only read into host memory on the I/O rank
+    RawFaces batch_raw;
+    if (m_batched && !raw) {
+        int ok = 1;
+        if (ParallelDescriptor::IOProcessor()) {
+            ok = read_raw_faces(idx, batch_raw);
+        }
+        ParallelDescriptor::Bcast(&ok, 1, ParallelDescriptor::IOProcessorNumber(),
+                                  ParallelDescriptor::Communicator());
+        if (!ok) Abort("ReadBndryPlanes: cannot read boundary planes of timestep " + std::to_string(t_step));
+        raw = &batch_raw;
+    }
+
     const Box& domain = m_geom.Domain();
     BoxArray ba(domain);
-    DistributionMapping dm{ba};
+
+    // Faces read ahead live on the I/O rank, so it owns the boundary registers then
+    DistributionMapping dm = (raw) ?
+        DistributionMapping(Vector<int>(ba.size(), ParallelDescriptor::IOProcessorNumber())) :
+        DistributionMapping{ba};
 
     GpuArray<GpuArray<Real, AMREX_SPACEDIM*2>,
                                                  AMREX_SPACEDIM+NVAR> l_bc_extdir_vals_d;
@@ -434,8 +510,16 @@ void ReadBndryPlanes::read_file(const int idx, Vector<std::unique_ptr<PlaneVecto
           auto ori = oit();
           if (ori.coordDir() < 2) {
 
-            std::string facename1 = Concatenate(filename1 + '_', ori, 1);
-            bndry[ori].read(facename1);
+            if (raw) {
+                for (FabSetIter fsi(bndry[ori]); fsi.isValid(); ++fsi) {
+                    for (const auto& raw_fab : (*raw)[ivar][ori]) {
+                        bndry[ori][fsi].template copy<RunOn::Device>(raw_fab);
+                    }
+                }
+            } else {
+                std::string facename1 = Concatenate(filename1 + '_', ori, 1);
+                bndry[ori].read(facename1);
+            }
 
             const int normal = ori.coordDir();
             const IntVect v_offset = offset(ori.faceDir(), normal);
@@ -538,3 +622,158 @@ void ReadBndryPlanes::read_file(const int idx, Vector<std::unique_ptr<PlaneVecto
         } // ori
     } // var_name
 }
+
+/**
+ * Function in ReadBndryPlanes to read the faces of one file into host memory.
+ * This only touches the file system, so it may run in a background thread.
+ *
+ * @param idx Specifies the index corresponding to the timestep we want
+ * @param raw Container for the faces of each variable
+ * @return Whether the faces could be read this way
+ */
+bool ReadBndryPlanes::read_raw_faces(const int idx, RawFaces& raw) const
+{
+    const int t_step = m_in_timesteps[idx];
+    const std::string chkname1 = m_filename + Concatenate("/bndry_output", t_step);
+
+    const std::string level_prefix = "Level_";
+    const int lev = 0;
+
+    raw.clear();
+    raw.resize(m_var_names.size());
+
+    if (m_batched) {
+        auto it = m_batch_index.find(t_step);
+        if (it == m_batch_index.end()) return false;
+        const std::string batch_dir = m_filename + "/" + it->second.first;
+        const int slot = it->second.second;
+
+        // The Header holds the offset of each step in each face file
+        std::ifstream hdr_file(batch_dir + "/Header");
+        if (!hdr_file.good()) return false;
+        int nslots;
+        hdr_file >> nslots;
+        if (slot >= nslots) return false;
+
+        std::map<std::string, long> offsets;
+        std::string var_name;
+        int face;
+        while (hdr_file >> var_name >> face) {
+            Vector<long> off(nslots);
+            for (auto& o : off) hdr_file >> o;
+            offsets[var_name + '_' + std::to_string(face)] = off[slot];
+        }
+
+        for (int ivar = 0; ivar < m_var_names.size(); ivar++)
+        {
+            raw[ivar].resize(2*AMREX_SPACEDIM);
+            for (OrientationIter oit; oit != nullptr; ++oit) {
+                auto ori = oit();
+                if (ori.coordDir() < 2) {
+                    auto off = offsets.find(m_var_names[ivar] + '_' + std::to_string(static_cast<int>(ori)));
+                    if (off == offsets.end()) return false;
+
+                    std::string facename1 = Concatenate(batch_dir + "/" + m_var_names[ivar] + '_', ori, 1);
+                    std::ifstream fab_file(facename1, std::ios::in | std::ios::binary);
+                    if (!fab_file.good()) return false;
+                    fab_file.seekg(off->second, std::ios::beg);
+
+                    raw[ivar][ori].emplace_back(The_Pinned_Arena());
+                    raw[ivar][ori].back().readFrom(fab_file);
+                }
+            }
+        }
+        return true;
+    }
+
+    for (int ivar = 0; ivar < m_var_names.size(); ivar++)
+    {
+        std::string filename1 = MultiFabFileFullPrefix(lev, chkname1, level_prefix, m_var_names[ivar]);
+
+        raw[ivar].resize(2*AMREX_SPACEDIM);
+        for (OrientationIter oit; oit != nullptr; ++oit) {
+            auto ori = oit();
+            if (ori.coordDir() < 2) {
+                std::string facename1 = Concatenate(filename1 + '_', ori, 1);
+
+                // Parse the header ourselves -- VisMF::Read would broadcast it
+                std::ifstream hdr_file(facename1 + "_H");
+                if (!hdr_file.good()) return false;
+                VisMF::Header hdr;
+                hdr_file >> hdr;
+                if (hdr.m_vers != VisMF::Header::Version_v1) return false;
+
+                for (const auto& fod : hdr.m_fod) {
+                    std::ifstream fab_file(VisMF::DirName(facename1) + fod.m_name,
+                                           std::ios::in | std::ios::binary);
+                    if (!fab_file.good()) return false;
+                    fab_file.seekg(fod.m_head, std::ios::beg);
+
+                    raw[ivar][ori].emplace_back(The_Pinned_Arena());
+                    raw[ivar][ori].back().readFrom(fab_file);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Function in ReadBndryPlanes to start reading a file in a background thread
+ * on the I/O rank.
+ *
+ * @param idx Specifies the index corresponding to the timestep we want
+ */
+void ReadBndryPlanes::start_read_ahead(const int idx)
+{
+    m_read_ahead_file = idx;
+    if (ParallelDescriptor::IOProcessor()) {
+        m_read_ahead = std::async(std::launch::async, [this, idx] ()
+        {
+            return read_raw_faces(idx, m_raw);
+        });
+    }
+}
+
+/**
+ * Function in ReadBndryPlanes to check whether the background read is done.
+ * Every rank must call this since the answer comes from the I/O rank.
+ *
+ * @param wait Wait for the read to finish
+ */
+bool ReadBndryPlanes::read_ahead_done(bool wait)
+{
+    int done = 1;
+    if (ParallelDescriptor::IOProcessor() && !wait) {
+        done = (m_read_ahead.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    }
+    ParallelDescriptor::Bcast(&done, 1, ParallelDescriptor::IOProcessorNumber(),
+                              ParallelDescriptor::Communicator());
+    return (done != 0);
+}
+
+/**
+ * Function in ReadBndryPlanes to convert the file read ahead into the spare buffer.
+ * If the faces could not be read ahead we read them the usual way here.
+ *
+ * @param m_bc_extdir_vals Container storing the external dirichlet boundary conditions we are reading from the input files
+ */
+void ReadBndryPlanes::finish_read_ahead(
+    Array<Array<Real, AMREX_SPACEDIM*2>,AMREX_SPACEDIM+NVAR> m_bc_extdir_vals)
+{
+    BL_PROFILE("ERF::ReadBndryPlanes::finish_read_ahead");
+
+    int ok = 0;
+    if (ParallelDescriptor::IOProcessor()) {
+        ok = m_read_ahead.get();
+    }
+    ParallelDescriptor::Bcast(&ok, 1, ParallelDescriptor::IOProcessorNumber(),
+                              ParallelDescriptor::Communicator());
+
+    read_file(m_read_ahead_file, m_data_next, m_bc_extdir_vals, (ok) ? &m_raw : nullptr);
+    Gpu::streamSynchronize();
+
+    m_raw.clear();
+    m_next_file = m_read_ahead_file;
+    m_read_ahead_file = -1;
+}
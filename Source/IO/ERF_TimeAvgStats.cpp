@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "AMReX_ParmParse.H"
+#include "AMReX_PlotFileUtil.H"
+#include "AMReX_VisMF.H"
+#include "ERF_TimeAvgStats.H"
+#include "IndexDefines.H"
+#include "EOS.H"
+
+using namespace amrex;
+
+namespace {
+    // Input/output names of the fields in TimeAvgStats::StatVar order
+    Vector<std::string> stat_var_names ()
+    {
+        return {"x_velocity", "y_velocity", "z_velocity", "density", "theta", "pressure", "scalar"
+#if defined(ERF_USE_MOISTURE)
+               , "qt", "qp"
+#elif defined(ERF_USE_WARM_NO_PRECIP)
+               , "qv", "qc"
+#endif
+        };
+    }
+
+    int stat_var_index (const std::string& name)
+    {
+        const auto names = stat_var_names();
+        for (int n = 0; n < names.size(); ++n) {
+            if (names[n] == name) return n;
+        }
+        Abort("TimeAvgStats: unknown field " + name + " in erf.stats_vars or erf.stats_products");
+        return -1;
+    }
+}
+
+/**
+ * Constructor for the TimeAvgStats class, which holds the running time integrals on level 0
+ *
+ * @param ba BoxArray of level 0
+ * @param dm DistributionMapping of level 0
+ * @param geom Geometry of level 0
+ */
+TimeAvgStats::TimeAvgStats (const BoxArray& ba, const DistributionMapping& dm,
+                            const Geometry& geom)
+    : m_geom(geom)
+{
+    ParmParse pp("erf");
+
+    Vector<std::string> var_names;
+    pp.getarr("stats_vars", var_names);
+    for (const auto& name : var_names) {
+        int n = stat_var_index(name);
+        if (std::find(m_vars.begin(), m_vars.end(), n) == m_vars.end()) m_vars.push_back(n);
+    }
+
+    // Products are given as pairs "a:b"; by default we keep the variance of each field
+    Vector<std::string> prod_names;
+    if (pp.contains("stats_products")) {
+        pp.getarr("stats_products", prod_names);
+    } else {
+        for (const auto& name : var_names) prod_names.push_back(name + ":" + name);
+    }
+    for (const auto& prod : prod_names) {
+        auto colon = prod.find(':');
+        if (colon == std::string::npos) {
+            Abort("TimeAvgStats: erf.stats_products entries must be of the form a:b, not " + prod);
+        }
+        int a = stat_var_index(prod.substr(0, colon));
+        int b = stat_var_index(prod.substr(colon+1));
+        m_prod_a.push_back(a);
+        m_prod_b.push_back(b);
+
+        // The covariance needs the mean of both factors
+        if (std::find(m_vars.begin(), m_vars.end(), a) == m_vars.end()) m_vars.push_back(a);
+        if (std::find(m_vars.begin(), m_vars.end(), b) == m_vars.end()) m_vars.push_back(b);
+    }
+    if (static_cast<int>(m_prod_a.size()) > MaxProducts) {
+        Abort("TimeAvgStats: too many entries in erf.stats_products");
+    }
+
+    pp.query("stats_interval", m_interval);
+    pp.query("stats_start_time", m_start_time);
+    pp.query("stats_plot_int", m_plot_int);
+    pp.query("stats_file", m_plot_file);
+    if (m_interval < 1) Error("TimeAvgStats: stats_interval must be at least 1");
+
+    m_moments.define(ba, dm, static_cast<int>(m_vars.size() + m_prod_a.size()), 0);
+    m_moments.setVal(0.0);
+}
+
+/**
+ * Names of the components of the running moments, as recorded in checkpoints
+ */
+Vector<std::string>
+TimeAvgStats::moment_names () const
+{
+    const auto names = stat_var_names();
+    Vector<std::string> moments;
+    for (int n : m_vars) moments.push_back(names[n] + "_mean");
+    for (int m = 0; m < m_prod_a.size(); ++m) {
+        moments.push_back(names[m_prod_a[m]] + "_" + names[m_prod_b[m]] + "_comoment");
+    }
+    return moments;
+}
+
+/**
+ * Advance the running moments with the level 0 state at the end of a step. Each sample
+ *    stands for the time since the previous one, so the first sample only starts the clock.
+ *
+ * The means and the co-moments C_ab = sum w (a - <a>)(b - <b>) are updated in place with
+ *    West's weighted form of Welford's algorithm: with r = w / (W + w) and the deviations
+ *    da, db of the sample from the old means, <a> += r da and C_ab += w (1 - r) da db. This
+ *    avoids the cancellation in <ab> - <a><b> when the fluctuations are small compared
+ *    with the means.
+ *
+ * @param nstep level 0 step just completed
+ * @param time time at the end of that step
+ * @param vars level 0 state (cons, xvel, yvel, zvel)
+ * @param qvapor water vapor (may be null)
+ */
+void
+TimeAvgStats::accumulate (int nstep, Real time, const Vector<MultiFab>& vars,
+                          const MultiFab* qvapor)
+{
+    if (nstep % m_interval != 0 || time < m_start_time) return;
+
+    if (!m_started) {
+        m_started   = true;
+        m_last_time = time;
+        return;
+    }
+
+    const Real w = time - m_last_time;
+    if (w <= 0.0) return;
+
+    BL_PROFILE("TimeAvgStats::accumulate()");
+
+    m_last_time  = time;
+    m_weight    += w;
+    const Real r = w / m_weight;
+
+    const int nv = static_cast<int>(m_vars.size());
+    const int np = static_cast<int>(m_prod_a.size());
+
+    // Field of each mean, and the means the factors of each product are in
+    GpuArray<int,NumStatVars> var_ids{}, mean_comp{};
+    GpuArray<int,MaxProducts> ia{}, ib{};
+    for (int n = 0; n < nv; ++n) {
+        var_ids[n] = m_vars[n];
+        mean_comp[m_vars[n]] = n;
+    }
+    for (int m = 0; m < np; ++m) {
+        ia[m] = mean_comp[m_prod_a[m]];
+        ib[m] = mean_comp[m_prod_b[m]];
+    }
+
+    const bool has_qv = (qvapor != nullptr);
+
+#ifdef _OPENMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(m_moments, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+
+        const Array4<const Real>& cons = vars[Vars::cons].const_array(mfi);
+        const Array4<const Real>& u    = vars[Vars::xvel].const_array(mfi);
+        const Array4<const Real>& v    = vars[Vars::yvel].const_array(mfi);
+        const Array4<const Real>& w_   = vars[Vars::zvel].const_array(mfi);
+        const Array4<const Real>  qv_arr = has_qv ? qvapor->const_array(mfi) : Array4<const Real>{};
+        const Array4<Real>&       mom  = m_moments.array(mfi);
+
+        ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            const Real rho = cons(i,j,k,Rho_comp);
+
+            Real f[NumStatVars];
+            f[xvel]   = 0.5 * (u (i,j,k) + u (i+1,j  ,k  ));
+            f[yvel]   = 0.5 * (v (i,j,k) + v (i  ,j+1,k  ));
+            f[zvel]   = 0.5 * (w_(i,j,k) + w_(i  ,j  ,k+1));
+            f[dens]   = rho;
+            f[theta]  = cons(i,j,k,RhoTheta_comp) / rho;
+#if defined(ERF_USE_WARM_NO_PRECIP)
+            const Real qv_loc = cons(i,j,k,RhoQv_comp) / rho;
+#else
+            const Real qv_loc = has_qv ? qv_arr(i,j,k) : 0.0;
+#endif
+            f[pres]   = getPgivenRTh(cons(i,j,k,RhoTheta_comp), qv_loc);
+            f[scalar] = cons(i,j,k,RhoScalar_comp) / rho;
+#if defined(ERF_USE_MOISTURE)
+            f[qt]     = cons(i,j,k,RhoQt_comp) / rho;
+            f[qp]     = cons(i,j,k,RhoQp_comp) / rho;
+#elif defined(ERF_USE_WARM_NO_PRECIP)
+            f[qv]     = qv_loc;
+            f[qc]     = cons(i,j,k,RhoQc_comp) / rho;
+#endif
+            Real d[NumStatVars];
+            for (int n = 0; n < nv; ++n) {
+                d[n] = f[var_ids[n]] - mom(i,j,k,n);
+                mom(i,j,k,n) += r * d[n];
+            }
+            for (int m = 0; m < np; ++m) {
+                mom(i,j,k,nv+m) += w * (1.0 - r) * d[ia[m]] * d[ib[m]];
+            }
+        });
+    }
+}
+
+/**
+ * Write the time means of the fields and the covariances of the products
+ *
+ * @param nstep level 0 step, used in the plotfile name
+ * @param time current time
+ */
+void
+TimeAvgStats::write_plotfile (int nstep, Real time)
+{
+    if (nstep == m_last_write_step) return;
+    m_last_write_step = nstep;
+
+    if (m_weight <= 0.0) {
+        Print() << "TimeAvgStats: nothing accumulated yet, not writing statistics at step " << nstep << "\n";
+        return;
+    }
+
+    BL_PROFILE("TimeAvgStats::write_plotfile()");
+
+    const int nv = static_cast<int>(m_vars.size());
+    const int np = static_cast<int>(m_prod_a.size());
+
+    const auto names = stat_var_names();
+    Vector<std::string> plot_names;
+    for (int n : m_vars) plot_names.push_back(names[n] + "_mean");
+    for (int m = 0; m < np; ++m) {
+        if (m_prod_a[m] == m_prod_b[m]) {
+            plot_names.push_back(names[m_prod_a[m]] + "_var");
+        } else {
+            plot_names.push_back(names[m_prod_a[m]] + "_" + names[m_prod_b[m]] + "_cov");
+        }
+    }
+
+    MultiFab stats(m_moments.boxArray(), m_moments.DistributionMap(), nv+np, 0);
+    const Real inv_weight = 1.0 / m_weight;
+
+#ifdef _OPENMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(stats, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        const Array4<const Real>& mom = m_moments.const_array(mfi);
+        const Array4<Real>&       out = stats.array(mfi);
+
+        ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            for (int n = 0; n < nv; ++n) {
+                out(i,j,k,n) = mom(i,j,k,n);
+            }
+            for (int m = 0; m < np; ++m) {
+                out(i,j,k,nv+m) = mom(i,j,k,nv+m) * inv_weight;
+            }
+        });
+    }
+
+    const std::string& plotname = amrex::Concatenate(m_plot_file, nstep, 5);
+    Print() << "Writing statistics over " << m_weight << " s to " << plotname << "\n";
+
+    WriteSingleLevelPlotfile(plotname, stats, plot_names, m_geom, time, nstep);
+}
+
+/**
+ * Save the running moments in Level_0/Stats of a checkpoint, along with a Stats file that
+ *    holds the time averaged over and the names of the components
+ *
+ * @param chkname checkpoint directory (already created)
+ * @param async whether to hand the data to the background I/O thread
+ */
+void
+TimeAvgStats::write_checkpoint (const std::string& chkname, bool async) const
+{
+    MultiFab moments(m_moments.boxArray(), m_moments.DistributionMap(), m_moments.nComp(), 0);
+    MultiFab::Copy(moments, m_moments, 0, 0, m_moments.nComp(), 0);
+
+    const std::string& name = amrex::MultiFabFileFullPrefix(0, chkname, "Level_", "Stats");
+    if (async) {
+        VisMF::AsyncWrite(std::move(moments), name);
+    } else {
+        VisMF::Write(moments, name);
+    }
+
+    if (ParallelDescriptor::IOProcessor()) {
+        std::ofstream stats_file(chkname + "/Stats");
+        stats_file.precision(17);
+        stats_file << m_started << " " << m_weight << " " << m_last_time << "\n";
+        for (const auto& mname : moment_names()) stats_file << mname << " ";
+        stats_file << "\n";
+        if (!stats_file.good()) amrex::FileOpenFailed(chkname + "/Stats");
+    }
+}
+
+/**
+ * Restore the running moments from a checkpoint. If the checkpoint has none, or holds
+ *    different fields (or the time integrals kept by older versions), averaging starts
+ *    afresh.
+ *
+ * @param chkname checkpoint directory
+ */
+void
+TimeAvgStats::read_checkpoint (const std::string& chkname)
+{
+    if (!amrex::FileExists(chkname + "/Stats")) {
+        Print() << "TimeAvgStats: no statistics in " << chkname << ", starting afresh\n";
+        return;
+    }
+
+    Vector<char> fileCharPtr;
+    ParallelDescriptor::ReadAndBcastFile(chkname + "/Stats", fileCharPtr);
+    std::istringstream is(std::string(fileCharPtr.dataPtr()), std::istringstream::in);
+
+    int started;
+    Real weight, last_time;
+    is >> started >> weight >> last_time;
+
+    Vector<std::string> names_in;
+    std::string word;
+    while (is >> word) names_in.push_back(word);
+
+    if (names_in != moment_names()) {
+        Print() << "TimeAvgStats: the statistics in " << chkname
+                << " are of different fields, starting afresh\n";
+        return;
+    }
+
+    // The moments are read on the grids they were written on, which need not be
+    //    the grids we restart with
+    MultiFab moments;
+    VisMF::Read(moments, amrex::MultiFabFileFullPrefix(0, chkname, "Level_", "Stats"));
+    AMREX_ALWAYS_ASSERT(moments.nComp() == m_moments.nComp());
+    m_moments.ParallelCopy(moments, 0, 0, m_moments.nComp());
+
+    m_started   = (started != 0);
+    m_weight    = weight;
+    m_last_time = last_time;
+}
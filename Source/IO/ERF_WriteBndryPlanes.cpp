@@ -1,3 +1,5 @@
+#include <fstream>
+
 #include "AMReX_Gpu.H"
 #include "AMReX_ParmParse.H"
 #include "AMReX_PlotFileUtil.H"
@@ -105,6 +107,23 @@ WriteBndryPlanes::WriteBndryPlanes(Vector<BoxArray>& grids,
         m_var_names.resize(num_vars);
         pp.queryarr("bndry_output_var_names",m_var_names,0,num_vars);
     }
+
+    // How many steps to hold in memory and write to each file
+    pp.query("bndry_output_planes_per_file", m_steps_per_file);
+    if (m_steps_per_file < 1)
+        Error("WriteBndryPlanes: bndry_output_planes_per_file must be at least 1");
+
+    if (m_steps_per_file > 1 && ParallelDescriptor::IOProcessor()) {
+        if (!UtilCreateDirectory(m_filename, 0755)) CreateDirectoryFailed(m_filename);
+    }
+}
+
+/**
+ * Destructor for the WriteBndryPlanes class; writes any steps still held in memory
+ */
+WriteBndryPlanes::~WriteBndryPlanes()
+{
+    flush();
 }
 
 /**
@@ -124,18 +143,31 @@ void WriteBndryPlanes::write_planes(const int t_step, const Real time,
     MultiFab& yvel = vars_new[bndry_lev][Vars::yvel];
     MultiFab& zvel = vars_new[bndry_lev][Vars::zvel];
 
+    const bool buffered = (m_steps_per_file > 1);
+
     const std::string chkname =
         m_filename + Concatenate("/bndry_output", t_step);
 
     //amrex::Print() << "Writing boundary planes at time " << time << std::endl;
 
     const std::string level_prefix = "Level_";
-    PreBuildDirectorHierarchy(chkname, level_prefix, 1, true);
+    if (!buffered) {
+        PreBuildDirectorHierarchy(chkname, level_prefix, 1, true);
+    }
 
     // note: by using the entire domain box we end up using 1 processor
-    // to hold all boundaries
+    // to hold all boundaries; when we hold steps in memory that is the I/O rank
     BoxArray ba(target_box);
-    DistributionMapping dm{ba};
+    DistributionMapping dm = (buffered) ?
+        DistributionMapping(Vector<int>(ba.size(), ParallelDescriptor::IOProcessorNumber())) :
+        DistributionMapping{ba};
+
+    // Planes of this step [var][orientation] to hold in memory
+    Vector<Vector<FArrayBox>> planes;
+    if (buffered && ParallelDescriptor::IOProcessor()) {
+        planes.resize(m_var_names.size());
+        for (auto& p : planes) p.resize(2*AMREX_SPACEDIM);
+    }
 
     IntVect new_hi = target_box.bigEnd() - target_box.smallEnd();
     Box target_box_shifted(IntVect(0,0,0),new_hi);
@@ -188,12 +220,31 @@ void WriteBndryPlanes::write_planes(const int t_step, const Real time,
             if (ori.coordDir() < 2) {
                 std::string facename = Concatenate(filename + '_', ori, 1);
                 br_shift(oit, bndry, bndry_shifted);
-                bndry_shifted[ori].write(facename);
+                if (buffered) {
+                    // Keep a host copy on the I/O rank, which owns the planes here
+                    for (FabSetIter fsi(bndry_shifted[ori]); fsi.isValid(); ++fsi) {
+                        const FArrayBox& src = bndry_shifted[ori][fsi];
+                        FArrayBox& dst = planes[i][ori];
+                        dst = FArrayBox(src.box(), src.nComp(), The_Cpu_Arena());
+                        Gpu::copy(Gpu::deviceToHost, src.dataPtr(), src.dataPtr() + src.size(),
+                                  dst.dataPtr());
+                    }
+                } else {
+                    bndry_shifted[ori].write(facename);
+                }
             }
         }
 
     } // loop over num_vars
 
+    if (buffered) {
+        m_buffer_steps.push_back(t_step);
+        m_buffer_times.push_back(time);
+        m_buffer.push_back(std::move(planes));
+        if (static_cast<int>(m_buffer_steps.size()) >= m_steps_per_file) flush();
+        return;
+    }
+
     // Writing time.dat
     if (ParallelDescriptor::IOProcessor()) {
         std::ofstream oftime(m_time_file, std::ios::out | std::ios::app);
@@ -201,3 +252,58 @@ void WriteBndryPlanes::write_planes(const int t_step, const Real time,
         oftime.close();
     }
 }
+
+/**
+ * Function to write the steps held in memory. Each variable and face goes to one
+ * file in a directory named after the first step; the Header there holds the offset
+ * of each step in each file, and bndry_index.dat maps each step to its directory
+ * and slot. The steps are added to time.dat only once their data is on disk.
+ */
+void WriteBndryPlanes::flush()
+{
+    if (m_buffer_steps.empty()) return;
+
+    BL_PROFILE("ERF::WriteBndryPlanes::flush");
+
+    if (ParallelDescriptor::IOProcessor())
+    {
+        const int nsteps = m_buffer_steps.size();
+        const std::string batch_name = Concatenate("bndry_batch", m_buffer_steps[0]);
+        const std::string batch_dir  = m_filename + "/" + batch_name;
+        if (!UtilCreateDirectory(batch_dir, 0755)) CreateDirectoryFailed(batch_dir);
+
+        std::ofstream ofhdr(batch_dir + "/Header");
+        ofhdr << nsteps << '\n';
+        for (int i = 0; i < m_var_names.size(); i++) {
+            for (OrientationIter oit; oit != nullptr; ++oit) {
+                auto ori = oit();
+                if (ori.coordDir() < 2) {
+                    std::string facename = Concatenate(batch_dir + "/" + m_var_names[i] + '_', ori, 1);
+                    std::ofstream ofs(facename, std::ios::out | std::ios::trunc | std::ios::binary);
+                    if (!ofs.good()) FileOpenFailed(facename);
+                    ofhdr << m_var_names[i] << ' ' << static_cast<int>(ori);
+                    for (int n = 0; n < nsteps; ++n) {
+                        ofhdr << ' ' << static_cast<long>(ofs.tellp());
+                        m_buffer[n][i][ori].writeOn(ofs);
+                    }
+                    ofhdr << '\n';
+                    ofs.close();
+                }
+            }
+        }
+        ofhdr.close();
+
+        std::ofstream ofindex(m_filename + "/bndry_index.dat", std::ios::out | std::ios::app);
+        std::ofstream oftime(m_time_file, std::ios::out | std::ios::app);
+        for (int n = 0; n < nsteps; ++n) {
+            ofindex << m_buffer_steps[n] << ' ' << batch_name << ' ' << n << '\n';
+            oftime  << m_buffer_steps[n] << ' ' << m_buffer_times[n] << '\n';
+        }
+        ofindex.close();
+        oftime.close();
+    }
+
+    m_buffer_steps.clear();
+    m_buffer_times.clear();
+    m_buffer.clear();
+}
@@ -100,149 +100,6 @@ ERF::sum_integrated_quantities(Real time)
         });
 #endif
     } // if verbose
-
-    // This is just an alias for convenience
-    int lev = 0;
-    if (NumSamplePointLogs() > 0 && NumSamplePoints() > 0) {
-        for (int i = 0; i < NumSamplePoints(); ++i)
-        {
-            sample_points(lev, time, SamplePoint(i), vars_new[lev][Vars::cons]);
-        }
-    }
-    if (NumSampleLineLogs() > 0 && NumSampleLines() > 0) {
-        for (int i = 0; i < NumSampleLines(); ++i)
-        {
-            sample_lines(lev, time, SampleLine(i), vars_new[lev][Vars::cons]);
-        }
-    }
-}
-
-/**
- * Utility function for sampling MultiFab data at a specified cell index.
- *
- * @param lev Level for the associated MultiFab data
- * @param time Current time
- * @param cell IntVect containing the indexes for the cell where we want to sample
- * @param mf MultiFab from which we wish to sample data
- */
-void
-ERF::sample_points(int lev, Real time, IntVect cell, MultiFab& mf)
-{
-    int datwidth = 14;
-
-    int ifile = 0;
-
-    //
-    // Sample the data at a single point in space
-    //
-    int ncomp = mf.nComp();
-    Vector<Real> my_point = get_cell_data(mf, cell);
-
-    if (!my_point.empty()) {
-
-        // HERE DO WHATEVER YOU WANT TO THE DATA BEFORE WRITING
-
-        std::ostream& sample_log = SamplePointLog(ifile);
-        if (sample_log.good()) {
-          sample_log << std::setw(datwidth) << time;
-          for (int i = 0; i < ncomp; ++i)
-          {
-              sample_log << std::setw(datwidth) << my_point[i];
-          }
-          sample_log << std::endl;
-        } // if good
-    } // only write from processor that holds the cell
-}
-
-/**
- * Utility function for sampling data along a line along the z-dimension
- * at the (x,y) indices specified and writes it to an output file.
- *
- * @param lev Current level
- * @param time Current time
- * @param cell IntVect containing the x,y-dimension indices to sample along z
- * @param mf MultiFab from which we sample the data
- */
-void
-ERF::sample_lines(int lev, Real time, IntVect cell, MultiFab& mf)
-{
-    int datwidth = 14;
-    int datprecision = 6;
-
-    int ifile = 0;
-
-    const int ncomp = mf.nComp(); // cell-centered state vars
-
-    MultiFab mf_vels(grids[lev], dmap[lev], AMREX_SPACEDIM, 0);
-    average_face_to_cellcenter(mf_vels, 0,
-                               Array<const MultiFab*,3>{&vars_new[lev][Vars::xvel],&vars_new[lev][Vars::yvel],&vars_new[lev][Vars::zvel]});
-
-    //
-    // Sample the data at a line (in direction "dir") in space
-    // In this case we sample in the vertical direction so dir = 2
-    // The "k" value of "cell" is ignored
-    //
-    int dir = 2;
-    MultiFab my_line       = get_line_data(mf,              dir, cell);
-    MultiFab my_line_vels  = get_line_data(mf_vels,         dir, cell);
-    MultiFab my_line_tau11 = get_line_data(*Tau11_lev[lev], dir, cell);
-    MultiFab my_line_tau12 = get_line_data(*Tau12_lev[lev], dir, cell);
-    MultiFab my_line_tau13 = get_line_data(*Tau13_lev[lev], dir, cell);
-    MultiFab my_line_tau22 = get_line_data(*Tau22_lev[lev], dir, cell);
-    MultiFab my_line_tau23 = get_line_data(*Tau23_lev[lev], dir, cell);
-    MultiFab my_line_tau33 = get_line_data(*Tau33_lev[lev], dir, cell);
-
-    for (MFIter mfi(my_line, false); mfi.isValid(); ++mfi)
-    {
-        // HERE DO WHATEVER YOU WANT TO THE DATA BEFORE WRITING
-
-        std::ostream& sample_log = SampleLineLog(ifile);
-        if (sample_log.good()) {
-          sample_log << std::setw(datwidth) << std::setprecision(datprecision) << time;
-          const auto& my_line_arr = my_line[0].const_array();
-          const auto& my_line_vels_arr = my_line_vels[0].const_array();
-          const auto& my_line_tau11_arr = my_line_tau11[0].const_array();
-          const auto& my_line_tau12_arr = my_line_tau12[0].const_array();
-          const auto& my_line_tau13_arr = my_line_tau13[0].const_array();
-          const auto& my_line_tau22_arr = my_line_tau22[0].const_array();
-          const auto& my_line_tau23_arr = my_line_tau23[0].const_array();
-          const auto& my_line_tau33_arr = my_line_tau33[0].const_array();
-          const Box&  my_box = my_line[0].box();
-          const int klo = my_box.smallEnd(2);
-          const int khi = my_box.bigEnd(2);
-          int i = cell[0];
-          int j = cell[1];
-          for (int n = 0; n < ncomp; n++) {
-              for (int k = klo; k <= khi; k++) {
-                  sample_log << std::setw(datwidth) << std::setprecision(datprecision) << my_line_arr(i,j,k,n);
-              }
-          }
-          for (int n = 0; n < AMREX_SPACEDIM; n++) {
-              for (int k = klo; k <= khi; k++) {
-                  sample_log << std::setw(datwidth) << std::setprecision(datprecision) << my_line_vels_arr(i,j,k,n);
-              }
-          }
-          for (int k = klo; k <= khi; k++) {
-              sample_log << std::setw(datwidth) << std::setprecision(datprecision) << my_line_tau11_arr(i,j,k);
-          }
-          for (int k = klo; k <= khi; k++) {
-              sample_log << std::setw(datwidth) << std::setprecision(datprecision) << my_line_tau12_arr(i,j,k);
-          }
-          for (int k = klo; k <= khi; k++) {
-              sample_log << std::setw(datwidth) << std::setprecision(datprecision) << my_line_tau13_arr(i,j,k);
-          }
-          for (int k = klo; k <= khi; k++) {
-              sample_log << std::setw(datwidth) << std::setprecision(datprecision) << my_line_tau22_arr(i,j,k);
-          }
-          for (int k = klo; k <= khi; k++) {
-              sample_log << std::setw(datwidth) << std::setprecision(datprecision) << my_line_tau23_arr(i,j,k);
-          }
-          for (int k = klo; k <= khi; k++) {
-              sample_log << std::setw(datwidth) << std::setprecision(datprecision) << my_line_tau33_arr(i,j,k);
-          }
-          sample_log << std::endl;
-        } // if good
-    } // mfi
 }
 
 /**
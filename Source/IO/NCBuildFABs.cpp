@@ -8,118 +8,210 @@
 #include "NCWpsFile.H"
 #include "AMReX_FArrayBox.H"
 #include "AMReX_IndexType.H"
+#include "AMReX_ParallelDescriptor.H"
 #include "AMReX_Print.H"
 
 using namespace amrex;
 
-using RARRAY = NDArray<float>;
+Box
+nc_file_box(const std::string& var_name,
+            const NC_Data_Dims_Type& NC_dim_type,
+            const std::vector<size_t>& shape);
 
-void
-fill_fab_from_arrays(int iv, Vector<RARRAY>& nc_arrays,
-                     const std::string& var_name,
-                     NC_Data_Dims_Type& NC_dim_type,
-                     FArrayBox& temp);
+namespace {
+    // The full columns of a variable under a region, on the points of that variable
+    Box
+    region_columns (const Box& file_box, const Box& region, NC_Data_Dims_Type dim_type)
+    {
+        Box bx(file_box);
+        if (dim_type != NC_Data_Dims_Type::Time_BT) {
+            Box col = amrex::convert(region, file_box.ixType());
+            col.setRange(2, file_box.smallEnd(2), file_box.length(2));
+            bx &= col;
+        }
+        return bx;
+    }
+
+    // Hyperslab of the first time level holding bx (west_east varies fastest, as in a fab)
+    void
+    hyperslab (const Box& bx, const Dim3& dom_lb, NC_Data_Dims_Type dim_type, int nd,
+               std::vector<size_t>& start, std::vector<size_t>& count)
+    {
+        start.assign(nd, 0);
+        count.assign(nd, 1);
+        if (dim_type == NC_Data_Dims_Type::Time_BT) {
+            count[1]    = bx.length(2);
+        } else {
+            start[nd-1] = bx.smallEnd(0) - dom_lb.x;
+            start[nd-2] = bx.smallEnd(1) - dom_lb.y;
+            count[nd-1] = bx.length(0);
+            count[nd-2] = bx.length(1);
+            if (dim_type == NC_Data_Dims_Type::Time_BT_SN_WE) {
+                start[1] = bx.smallEnd(2) - dom_lb.z;
+                count[1] = bx.length(2);
+            }
+        }
+    }
+
+    // Copy host data covering bx into the device fab
+    void
+    deposit (const FArrayBox& host_fab, const Box& bx, FArrayBox& fab)
+    {
+        fab.resize(bx,1);
+        if (host_fab.box() == bx) {
+            Gpu::copy(Gpu::hostToDevice, host_fab.dataPtr(), host_fab.dataPtr() + host_fab.size(),
+                      fab.dataPtr());
+        } else {
+            FArrayBox tmp(bx, 1, The_Pinned_Arena());
+            tmp.copy<RunOn::Host>(host_fab, bx, 0, bx, 0, 1);
+            Gpu::copy(Gpu::hostToDevice, tmp.dataPtr(), tmp.dataPtr() + tmp.size(), fab.dataPtr());
+        }
+    }
+}
 
 /**
- * Function to read NetCDF variables and fill the corresponding Array4's
+ * Function to read the parts of NetCDF variables under the grids of this rank
  *
+ * Every rank opens the file and reads, independently of the others, only the
+ * columns under its own regions, so no rank ever holds the whole domain. Files that
+ * cannot be opened for parallel access (netCDF classic or 64-bit offset files when
+ * NetCDF is built without PnetCDF) are read whole on the I/O rank and broadcast
+ * instead.
+ *
+ * @param domain Box whose lower corner is the first point in the file
  * @param fname Name of the NetCDF file to be read
+ * @param regions Cell-centered boxes (only x and y matter) to read on this rank;
+ *                the fabs of regions that are not ok are left untouched
  * @param nc_var_names Variable names in the NetCDF file
  * @param NC_dim_types NetCDF data dimension types
- * @param fab_vars Fab data we are to fill
+ * @param fab_vars Fab data we are to fill, one fab per region for each variable
  */
 void
 BuildFABsFromNetCDFFile(const Box& domain,
                         const std::string &fname,
+                        const Vector<Box>& regions,
                         Vector<std::string> nc_var_names,
                         Vector<enum NC_Data_Dims_Type> NC_dim_types,
-                        Vector<amrex::FArrayBox*> fab_vars)
+                        Vector<Vector<FArrayBox>*> fab_vars)
 {
-    int ioproc = ParallelDescriptor::IOProcessorNumber();  // I/O rank
-
-    amrex::Vector<RARRAY> nc_arrays(nc_var_names.size());
-
-    if (amrex::ParallelDescriptor::IOProcessor())
-    {
-        ReadNetCDFFile(fname, nc_var_names, nc_arrays);
+    const Dim3 dom_lb = lbound(domain);
+    const int ioproc = ParallelDescriptor::IOProcessorNumber();
+
+    // The format decides whether the parallel open works, so it fails on every rank or none
+    auto ncf_par = ncutils::NCFile::try_open_par(fname, NC_NOWRITE);
+    bool parallel = (ncf_par != nullptr);
+    ParallelDescriptor::ReduceBoolAnd(parallel);
+    if (!parallel) {
+        ncf_par.reset();
+        amrex::Print() << "Cannot open " << fname << " for parallel access;"
+                       << " reading it on the I/O rank instead" << std::endl;
     }
 
     for (int iv = 0; iv < nc_var_names.size(); iv++)
     {
-        amrex::FArrayBox tmp;
-        if (amrex::ParallelDescriptor::IOProcessor()) {
-            fill_fab_from_arrays(iv, nc_arrays, nc_var_names[iv], NC_dim_types[iv], tmp);
-        }
+        AMREX_ALWAYS_ASSERT(fab_vars[iv]->size() >= regions.size());
 
-        Box box = tmp.box();
-        int ncomp = tmp.nComp();
-        ParallelDescriptor::Bcast(&box, 1, ioproc);
-        ParallelDescriptor::Bcast(&ncomp, 1, ioproc);
-
-        if (!amrex::ParallelDescriptor::IOProcessor()) {
-#ifdef AMREX_USE_GPU
-            tmp.resize(box,ncomp, The_Pinned_Arena());
-#else
-            tmp.resize(box,ncomp);
-#endif
-        }
+        if (parallel)
+        {
+            auto var = ncf_par->var(nc_var_names[iv]);
+            var.par_access(NC_INDEPENDENT);
+
+            std::vector<size_t> shape = var.shape();
+            const int nd = static_cast<int>(shape.size());
+
+            // Extent of the data in the file, shifted by the domain lower corner
+            Box file_box = nc_file_box(nc_var_names[iv], NC_dim_types[iv], shape);
+            file_box += IntVect(dom_lb.x,dom_lb.y,dom_lb.z);
 
-        ParallelDescriptor::Bcast(tmp.dataPtr(), tmp.size(), ioproc);
-
-        // Shift box by the domain lower corner
-        Box  fab_bx = tmp.box();
-        Dim3 dom_lb = lbound(domain);
-        fab_bx += IntVect(dom_lb.x,dom_lb.y,dom_lb.z);
-        // fab_vars points to data on device
-        fab_vars[iv]->resize(fab_bx,1);
-#ifdef AMREX_USE_GPU
-        Gpu::copy(Gpu::hostToDevice, tmp.dataPtr(), tmp.dataPtr() + tmp.size(), fab_vars[iv]->dataPtr());
-#else
-        // Provided by BaseFab inheritance through FArrayBox
-        fab_vars[iv]->copy(tmp,tmp.box(),0,fab_bx,0,1);
-#endif
+            for (int n = 0; n < regions.size(); n++)
+            {
+                if (!regions[n].ok()) continue;
+                const Box bx = region_columns(file_box, regions[n], NC_dim_types[iv]);
+                if (!bx.ok()) continue;
+
+                std::vector<size_t> start, count;
+                hyperslab(bx, dom_lb, NC_dim_types[iv], nd, start, count);
+
+                FArrayBox host_fab(bx, 1, The_Pinned_Arena());
+                var.get(host_fab.dataPtr(), start, count);
+
+                // fab_vars points to data on device
+                deposit(host_fab, bx, (*fab_vars[iv])[n]);
+            }
+        }
+        else
+        {
+            // The first time level of the whole variable, read on the I/O rank
+            Vector<Long> shape_l;
+            if (ParallelDescriptor::IOProcessor()) {
+                auto ncf = ncutils::NCFile::open(fname, NC_NOWRITE);
+                for (const auto len : ncf.var(nc_var_names[iv]).shape()) {
+                    shape_l.push_back(static_cast<Long>(len));
+                }
+            }
+            int nd = static_cast<int>(shape_l.size());
+            ParallelDescriptor::Bcast(&nd, 1, ioproc);
+            shape_l.resize(nd);
+            ParallelDescriptor::Bcast(shape_l.data(), nd, ioproc);
+            const std::vector<size_t> shape(shape_l.begin(), shape_l.end());
+
+            Box file_box = nc_file_box(nc_var_names[iv], NC_dim_types[iv], shape);
+            file_box += IntVect(dom_lb.x,dom_lb.y,dom_lb.z);
+
+            FArrayBox full_fab(file_box, 1, The_Pinned_Arena());
+            if (ParallelDescriptor::IOProcessor()) {
+                std::vector<size_t> start, count;
+                hyperslab(file_box, dom_lb, NC_dim_types[iv], nd, start, count);
+                auto ncf = ncutils::NCFile::open(fname, NC_NOWRITE);
+                ncf.var(nc_var_names[iv]).get(full_fab.dataPtr(), start, count);
+            }
+            ParallelDescriptor::Bcast(full_fab.dataPtr(), full_fab.size(), ioproc);
+
+            for (int n = 0; n < regions.size(); n++)
+            {
+                if (!regions[n].ok()) continue;
+                const Box bx = region_columns(file_box, regions[n], NC_dim_types[iv]);
+                if (!bx.ok()) continue;
+                deposit(full_fab, bx, (*fab_vars[iv])[n]);
+            }
+        }
     }
+
+    if (ncf_par) ncf_par->close();
 }
 
 /**
- * Helper function for reading data from NetCDF file into a
- * provided FAB.
+ * Helper function returning the box of the data of a variable in a NetCDF file,
+ * starting at (0,0,0) and staggered according to the variable name.
  *
- * @param iv Index for which variable we are going to fill
- * @param nc_arrays Arrays of data from NetCDF file
  * @param var_name Variable name
  * @param NC_dim_type Dimension type for the variable as stored in the NetCDF file
- * @param temp FAB where we store the variable data from the NetCDF Arrays
+ * @param shape Shape of the variable in the NetCDF file
  */
-void
-fill_fab_from_arrays(int iv, Vector<RARRAY>& nc_arrays,
-                     const std::string& var_name,
-                     NC_Data_Dims_Type& NC_dim_type,
-                     FArrayBox& temp)
+Box
+nc_file_box(const std::string& var_name,
+            const NC_Data_Dims_Type& NC_dim_type,
+            const std::vector<size_t>& shape)
 {
     int ns1, ns2, ns3;
     if (NC_dim_type == NC_Data_Dims_Type::Time_BT) {
-        ns1 = nc_arrays[iv].get_vshape()[1];
+        ns1 = shape[1];
         ns2 = 1;
         ns3 = 1;
-        // amrex::Print() << "TYPE BT " << ns1 << std::endl;
     } else if (NC_dim_type == NC_Data_Dims_Type::Time_SN_WE) {
         ns1 = 1;
-        ns2 = nc_arrays[iv].get_vshape()[1];
-        ns3 = nc_arrays[iv].get_vshape()[2];
-        // amrex::Print() << "TYPE SN WE " << ns2 << " " << ns3 << std::endl;
+        ns2 = shape[1];
+        ns3 = shape[2];
     } else if (NC_dim_type == NC_Data_Dims_Type::Time_BT_SN_WE) {
-        ns1 = nc_arrays[iv].get_vshape()[1];
-        ns2 = nc_arrays[iv].get_vshape()[2];
-        ns3 = nc_arrays[iv].get_vshape()[3];
-        // amrex::Print() << "TYPE BT SN WE " << ns1 << " " << ns2 << " " << ns3 << std::endl;
+        ns1 = shape[1];
+        ns2 = shape[2];
+        ns3 = shape[3];
     } else {
         amrex::Abort("Dont know this NC_Data_Dims_Type");
     }
 
     // TODO:  The box will only start at (0,0,0) at level 0 -- we need to generalize this
     Box my_box(IntVect(0,0,0), IntVect(ns3-1,ns2-1,ns1-1));
-    // amrex::Print() <<" MY BOX " << my_box << std::endl;
 
     if (var_name == "U" || var_name == "UU" ||
         var_name == "MACFAC_U" || var_name == "MAPFAC_UY") my_box.setType(amrex::IndexType(IntVect(1,0,0)));
@@ -127,26 +219,5 @@ fill_fab_from_arrays(int iv, Vector<RARRAY>& nc_arrays,
         var_name == "MACFAC_V" || var_name == "MAPFAC_VY") my_box.setType(amrex::IndexType(IntVect(0,1,0)));
     if (var_name == "W" || var_name == "WW") my_box.setType(amrex::IndexType(IntVect(0,0,1)));
 
-#ifdef AMREX_USE_GPU
-    // Make sure temp lives on CPU since nc_arrays lives on CPU only
-    temp.resize(my_box,1,The_Pinned_Arena());
-#else
-    temp.resize(my_box,1);
-#endif
-    Array4<Real> fab_arr = temp.array();
-
-    int ioff = temp.box().smallEnd()[0];
-    int joff = temp.box().smallEnd()[1];
-
-    auto num_pts = my_box.numPts();
-
-    // amrex::Print() <<" ns1 * ns2 * ns3 " << ns1 * ns2 * ns3 << std::endl;
-    // amrex::Print() <<" NUMPTS " << num_pts << std::endl;
-
-    for (int n(0); n < num_pts; ++n) {
-        int k  = n / (ns2*ns3);
-        int j  = (n - k*(ns2*ns3)) / ns3 + joff;
-        int i  = n - k*(ns2*ns3) - (j-joff) * ns3 + ioff;
-        fab_arr(i,j,k,0) = static_cast<Real>(*(nc_arrays[iv].get_data()+n));
-    }
+    return my_box;
 }
@@ -1,193 +1,326 @@
+#include <AMReX_Utility.H>
+
 #include "ERF.H"
 #include "NCInterface.H"
 #include "IndexDefines.H"
 
 using namespace amrex;
 
+namespace {
+    // u, v and theta are saved in each column
+    constexpr int ncolumn_vars = 3;
+    const std::string column_var_names[ncolumn_vars] = {"wrf_momentum_u", "wrf_momentum_v",
+                                                        "wrf_temperature"};
+
+    // Where one column sits on the level that samples it, and its bilinear weights
+    struct ColumnStencil {
+        int col;          // index of the column in column_loc_x/y
+        int iloc, jloc;   // lower left cell centre of the interpolation stencil
+        int ishift, jshift;
+        Real alpha_x, alpha_y, alpha_x_u, alpha_y_v;
+    };
+
+    // The stencil of the column at (x,y) on a level
+    ColumnStencil make_stencil (int col, Real x, Real y, const Geometry& geom)
+    {
+        const Box& dom = geom.Domain();
+        const Real x_cell_loc = dom.smallEnd(0) + (x - geom.ProbLo(0)) * geom.InvCellSize(0);
+        const Real y_cell_loc = dom.smallEnd(1) + (y - geom.ProbLo(1)) * geom.InvCellSize(1);
+        ColumnStencil st;
+        st.col = col;
+        st.iloc = static_cast<int>(std::floor(x_cell_loc - 0.5));
+        st.jloc = static_cast<int>(std::floor(y_cell_loc - 0.5));
+        st.alpha_x = x_cell_loc - 0.5 - st.iloc;
+        st.alpha_y = y_cell_loc - 0.5 - st.jloc;
+        // may need different indices for u,v due to not being collocated
+        st.ishift = static_cast<int>(std::floor(x_cell_loc)) - st.iloc;
+        st.jshift = static_cast<int>(std::floor(y_cell_loc)) - st.jloc;
+        st.alpha_x_u = x_cell_loc - st.iloc - st.ishift;
+        st.alpha_y_v = y_cell_loc - st.jloc - st.jshift;
+        return st;
+    }
+}
+
 /**
- * Creates a NetCDF file containing column data we write to during runtime
+ * Creates the NetCDF file for the 1D columns and keeps it open on the I/O rank.
  *
- * @param lev Current level
- * @param colfile_name Name of the NetCDF file containing column data
- * @param xloc Location of the column in the x-dimension
- * @param yloc Location of the column in the y-dimension
+ * With one column the file keeps the (ntime, nheight) layout read by AMR-Wind; with
+ * several the data variables are (ntime, ncolumn, nheight). On restart an existing file
+ * is kept and the samples taken after the restart time are overwritten.
  */
 void
-ERF::createNCColumnFile(int lev,
-                        const std::string& colfile_name,
-                        const Real xloc,
-                        const Real yloc)
+ERF::init_columns ()
 {
-  // Create file to which column data will be written every timestep
-  if (amrex::ParallelDescriptor::IOProcessor()) {
-    auto ncf = ncutils::NCFile::create(colfile_name, NC_CLOBBER | NC_NETCDF4);
+    const int ncol = column_loc_x.size();
+    for (int c = 0; c < ncol; ++c) {
+        // Requested point must be inside problem domain
+        if (column_loc_x[c] < geom[0].ProbLo(0) || column_loc_x[c] > geom[0].ProbHi(0) ||
+            column_loc_y[c] < geom[0].ProbLo(1) || column_loc_y[c] > geom[0].ProbHi(1)) {
+            Abort("Invalid xy location to save column data - outside of domain");
+        }
+    }
+
+    m_column_nwritten = 0;
+    m_column_buf_times.clear();
+    m_column_buf_data.clear();
+
+    if (!ParallelDescriptor::IOProcessor()) return;
+
+    if (!restart_chkfile.empty() && FileExists(column_file_name))
+    {
+        m_column_ncf = std::make_unique<ncutils::NCFile>(
+            ncutils::NCFile::open(column_file_name, NC_WRITE | NC_NETCDF4));
+
+        const int ncol_file = m_column_ncf->has_dim("ncolumn")
+            ? static_cast<int>(m_column_ncf->dim("ncolumn").len()) : 1;
+        if (ncol_file != ncol) {
+            Abort("The number of columns in " + column_file_name + " does not match erf.column_loc_x");
+        }
+
+        const size_t nt = m_column_ncf->dim("ntime").len();
+        Vector<double> times(nt);
+        if (nt > 0) m_column_ncf->var("times").get(times.data());
+        while (m_column_nwritten < nt && times[m_column_nwritten] <= t_new[0] + 1.e-6*dt[0]) {
+            ++m_column_nwritten;
+        }
+        return;
+    }
+
+    m_column_ncf = std::make_unique<ncutils::NCFile>(
+        ncutils::NCFile::create(column_file_name, NC_CLOBBER | NC_NETCDF4));
+    auto& ncf = *m_column_ncf;
+
     const std::string nt_name = "ntime";
+    const std::string nc_name = "ncolumn";
     const std::string nh_name = "nheight";
     // Use one grow cell (on either side) to allow interpolation to boundaries
-    const int nheights = geom[lev].Domain().length(2) + 2;
+    const int nheights = geom[0].Domain().length(2) + 2;
+    const std::vector<std::string> data_dims = (ncol == 1)
+        ? std::vector<std::string>{nt_name, nh_name}
+        : std::vector<std::string>{nt_name, nc_name, nh_name};
+
     ncf.enter_def_mode();
     ncf.put_attr("title", "ERF NetCDF Vertical Column Output");
     ncf.put_attr("units", "mks");
-    amrex::Vector<Real> loc = {xloc, yloc};
-    ncf.put_attr("location", loc);
+    if (ncol == 1) {
+        Vector<Real> loc = {column_loc_x[0], column_loc_y[0]};
+        ncf.put_attr("location", loc);
+    }
     ncf.def_dim(nt_name, NC_UNLIMITED);
+    if (ncol > 1) ncf.def_dim(nc_name, ncol);
     ncf.def_dim(nh_name, nheights);
-    ncf.def_var("times", NC_FLOAT, {nt_name});
+    ncf.def_var("times", NC_DOUBLE, {nt_name});
     ncf.def_var("heights", NC_FLOAT, {nh_name});
-    ncf.def_var("wrf_momentum_u", NC_FLOAT, {nt_name, nh_name});
-    ncf.def_var("wrf_momentum_v", NC_FLOAT, {nt_name, nh_name});
-    ncf.def_var("wrf_temperature", NC_FLOAT, {nt_name, nh_name});
+    if (ncol > 1) {
+        ncf.def_var("column_x", NC_FLOAT, {nc_name});
+        ncf.def_var("column_y", NC_FLOAT, {nc_name});
+    }
+    for (const auto& vname : column_var_names) {
+        ncf.def_var(vname, NC_FLOAT, data_dims);
+    }
     ncf.def_var("wrf_tflux", NC_FLOAT, {nt_name});
     ncf.exit_def_mode();
 
-    // Put in the Z grid, but not any actual data yet
-    Real zmin = geom[lev].ProbLo(2);
-    Real dz = geom[lev].CellSize(2);
-    amrex::Vector<Real> zvalues(nheights, zmin-0.5*dz);
+    // Put in the Z grid and the column locations, but not any actual data yet
+    Real zmin = geom[0].ProbLo(2);
+    Real dz = geom[0].CellSize(2);
+    Vector<Real> zvalues(nheights, zmin-0.5*dz);
     for (int ii = 0; ii < nheights; ++ii) {
       zvalues[ii] += ii * dz;
     }
     ncf.var("heights").put(zvalues.data());
-    ncf.close();
-  }
+    if (ncol > 1) {
+        ncf.var("column_x").put(column_loc_x.data());
+        ncf.var("column_y").put(column_loc_y.data());
+    }
+    ncf.sync();
 }
 
 /**
- * Writes column data from a given level to the NetCDF column data file
+ * Samples all the columns into the buffer on the I/O rank, and appends the buffer to
+ * the file once it holds erf.column_buffer samples.
+ *
+ * Each column is read on the finest level whose grids hold its whole 2x2 interpolation
+ * stencil over the full height, among the levels with the vertical resolution of level 0
+ * (the heights in the file are those of level 0). The ranks owning the cells of a column
+ * interpolate u, v and theta bilinearly in one kernel per grid over all the columns that
+ * grid touches, and a single reduction brings every column to the I/O rank. Interior
+ * cells are only read inside the valid boxes, so no ghost cells need filling there; at
+ * the domain boundaries the ghost cells are those set by the time integrator at the end
+ * of the step.
  *
- * @param lev Current level
- * @param colfile_name Name of the NetCDF file containing column data
- * @param xloc Location of the column in the x-dimension
- * @param yloc Location of the column in the y-dimension
- * @param cumtime Current time
+ * @param time Current time
  */
 void
-ERF::writeToNCColumnFile(const int lev,
-                         const std::string& colfile_name, const Real xloc, const Real yloc,
-                         const Real cumtime)
+ERF::write_columns (const Real time)
 {
-  //
-  // This routine assumes that we can grab the whole column of data from the MultiFabs at
-  //     a single level, "lev".  This assumption is true as long as we don't refine only
-  //     partway up a column, which is the plan.
-  //
-
-  // All processors: look for the requested column and get data if it's there
-  amrex::Box probBox = geom[lev].Domain();
-  const size_t nheights = probBox.length(2) + 2;
-  amrex::Gpu::DeviceVector<Real> d_column_data(nheights*3, 0.0);
-  amrex::Vector<Real> h_column_data(nheights*3, 0.0);
-  Real* ucol = &d_column_data[0];
-  Real* vcol = &d_column_data[nheights];
-  Real* thetacol = &d_column_data[nheights*2];
-
-  // Requested point must be inside problem domain
-  if (xloc < geom[0].ProbLo(0) || xloc > geom[0].ProbHi(0) ||
-      yloc < geom[0].ProbLo(1) || yloc > geom[0].ProbHi(1)) {
-    amrex::Error("Invalid xy location to save column data - outside of domain");
-  }
-
-  // get indices and interpolation coefficients
-  const Real x_cell_loc = probBox.smallEnd(0) + (xloc - geom[lev].ProbLo(0))* geom[lev].InvCellSize(0);
-  const Real y_cell_loc = probBox.smallEnd(1) + (yloc - geom[lev].ProbLo(1))* geom[lev].InvCellSize(1);
-  const int iloc = static_cast<int>(floor(x_cell_loc - 0.5));
-  const int jloc = static_cast<int>(floor(y_cell_loc - 0.5));
-  const Real alpha_x = x_cell_loc - 0.5 - iloc;
-  const Real alpha_y = y_cell_loc - 0.5 - jloc;
-  amrex::Array2D<Real, 0, 1, 0, 1> alpha_theta;
-  alpha_theta(0,0) = (1.0 - alpha_x) * (1.0-alpha_y);
-  alpha_theta(1,0) = (alpha_x) * (1.0-alpha_y);
-  alpha_theta(0,1) = (1.0 - alpha_x) * (alpha_y);
-  alpha_theta(1,1) = (alpha_x) * (alpha_y);
-  // may need different indices for u,v due to not being collocated
-  const int iloc_shift = static_cast<int>(floor(x_cell_loc)) - iloc;
-  const int jloc_shift = static_cast<int>(floor(y_cell_loc)) - jloc;
-  const Real alpha_x_u = x_cell_loc - iloc - iloc_shift;
-  const Real alpha_y_v = y_cell_loc - jloc - jloc_shift;
-  amrex::Array2D<Real, 0, 1, 0, 1> alpha_u;
-  alpha_u(0,0) = (1.0 - alpha_x_u) * (1.0-alpha_y);
-  alpha_u(1,0) = (alpha_x_u) * (1.0-alpha_y);
-  alpha_u(0,1) = (1.0 - alpha_x_u) * (alpha_y);
-  alpha_u(1,1) = (alpha_x_u) * (alpha_y);
-  amrex::Array2D<Real, 0, 1, 0, 1> alpha_v;
-  alpha_v(0,0) = (1.0 - alpha_x) * (1.0-alpha_y_v);
-  alpha_v(1,0) = (alpha_x) * (1.0-alpha_y_v);
-  alpha_v(0,1) = (1.0 - alpha_x) * (alpha_y_v);
-  alpha_v(1,1) = (alpha_x) * (alpha_y_v);
-  const int kstart = probBox.smallEnd(2)-1;
-  const int kend = probBox.bigEnd(2)+1;
-  const amrex::Box target_box(IntVect{iloc, jloc, kstart},
-                              IntVect{iloc+1, jloc+1, kend});
-
-  //  Need data in one grow cell for interpolation
-  FillPatch(lev, t_new[lev], {&vars_new[lev][Vars::cons], &vars_new[lev][Vars::xvel],
-                              &vars_new[lev][Vars::yvel], &vars_new[lev][Vars::zvel]});
-
-  MultiFab& S_new = vars_new[lev][Vars::cons];
-  MultiFab& U_new = vars_new[lev][Vars::xvel];
-  MultiFab& V_new = vars_new[lev][Vars::yvel];
-
-  // No tiling - we're just interested in one location
-  for ( MFIter mfi(S_new); mfi.isValid(); ++mfi){
-    const amrex::Array4<Real const> & state = S_new.array(mfi);
-    const amrex::Array4<Real const> & velx  = U_new.array(mfi);
-    const amrex::Array4<Real const> & vely  = V_new.array(mfi);
-
-    // we want to include data at physical boundary ghost cells
-    // for interpolation (i,j) or saving (k)
-    amrex::Box vbox = mfi.validbox();
-    for (int idir = 0; idir <=2; idir++) {
-      if (vbox.smallEnd(idir) == probBox.smallEnd(idir)) {
-        vbox.growLo(idir,1);
-      }
-      if (vbox.bigEnd(idir) == probBox.bigEnd(idir)) {
-        vbox.growHi(idir,1);
-      }
+    BL_PROFILE("ERF::write_columns()");
+
+    const int ncol = column_loc_x.size();
+    const int nz0 = geom[0].Domain().length(2);
+    const int nheights = nz0 + 2;
+    const size_t ncolumn_data = static_cast<size_t>(ncolumn_vars) * nheights;
+
+    // Find the level and the interpolation stencil of each column
+    Vector<Vector<ColumnStencil>> stencils(finest_level+1);
+    for (int c = 0; c < ncol; ++c)
+    {
+        int lev_column = 0;
+        ColumnStencil st = make_stencil(c, column_loc_x[c], column_loc_y[c], geom[0]);
+        for (int lev = finest_level; lev > 0; --lev) {
+            const Box& dom = geom[lev].Domain();
+            if (dom.length(2) != nz0) continue;
+
+            // The stencil cells inside the domain must all be on this level; those
+            //    outside are the ghost cells at the domain boundary
+            const ColumnStencil st_lev = make_stencil(c, column_loc_x[c], column_loc_y[c], geom[lev]);
+            const Box stencil_box = Box(IntVect(st_lev.iloc  , st_lev.jloc  , dom.smallEnd(2)),
+                                        IntVect(st_lev.iloc+1, st_lev.jloc+1, dom.bigEnd(2))) & dom;
+            if (grids[lev].contains(stencil_box)) {
+                lev_column = lev;
+                st = st_lev;
+                break;
+            }
+        }
+        stencils[lev_column].push_back(st);
+    }
+
+    Gpu::DeviceVector<Real> d_column_data(ncol*ncolumn_data, 0.0);
+    Vector<Real> h_column_data(ncol*ncolumn_data, 0.0);
+    Real* coldata = d_column_data.data();
+
+    for (int lev = 0; lev <= finest_level; ++lev)
+    {
+        if (stencils[lev].empty()) continue;
+
+        const Box& dom = geom[lev].Domain();
+        const int kstart = dom.smallEnd(2)-1;
+        const int kend   = dom.bigEnd(2)+1;
+        MultiFab& S_new = vars_new[lev][Vars::cons];
+        MultiFab& U_new = vars_new[lev][Vars::xvel];
+        MultiFab& V_new = vars_new[lev][Vars::yvel];
+
+        Vector<ColumnStencil> h_local;
+        Gpu::DeviceVector<ColumnStencil> d_local;
+
+        // No tiling - each grid only holds a few columns. Grids are done one after the
+        //     other, so those sharing a column add to it in turn.
+        for (MFIter mfi(S_new); mfi.isValid(); ++mfi)
+        {
+            // we want to include data at physical boundary ghost cells
+            // for interpolation (i,j) or saving (k)
+            Box vbox = mfi.validbox();
+            for (int idir = 0; idir <= 2; idir++) {
+                if (vbox.smallEnd(idir) == dom.smallEnd(idir)) {
+                    vbox.growLo(idir,1);
+                }
+                if (vbox.bigEnd(idir) == dom.bigEnd(idir)) {
+                    vbox.growHi(idir,1);
+                }
+            }
+
+            // The columns whose stencil this grid holds part of
+            h_local.clear();
+            for (const auto& st : stencils[lev]) {
+                const Box target_box(IntVect{st.iloc, st.jloc, kstart},
+                                     IntVect{st.iloc+1, st.jloc+1, kend});
+                if (vbox.intersects(target_box)) h_local.push_back(st);
+            }
+            if (h_local.empty()) continue;
+
+            d_local.resize(h_local.size());
+            Gpu::copy(Gpu::hostToDevice, h_local.begin(), h_local.end(), d_local.begin());
+            const ColumnStencil* local = d_local.data();
+
+            const Array4<Real const>& state = S_new.const_array(mfi);
+            const Array4<Real const>& velx  = U_new.const_array(mfi);
+            const Array4<Real const>& vely  = V_new.const_array(mfi);
+
+            const int nlocal = h_local.size();
+            ParallelFor(nlocal*nheights, [=] AMREX_GPU_DEVICE (int n) noexcept
+            {
+                const ColumnStencil& st = local[n / nheights];
+                const int idx_vec = n % nheights;
+                const int k = kstart + idx_vec;
+                Real* ucol     = coldata + st.col*ncolumn_data;
+                Real* vcol     = ucol + nheights;
+                Real* thetacol = vcol + nheights;
+
+                for (int jalpha = 0; jalpha <= 1; ++jalpha) {
+                    for (int ialpha = 0; ialpha <= 1; ++ialpha) {
+                        const int i = st.iloc + ialpha;
+                        const int j = st.jloc + jalpha;
+                        if (!vbox.contains(IntVect(i,j,k))) continue;
+                        const Real wx   = ialpha ? st.alpha_x   : 1.0 - st.alpha_x;
+                        const Real wy   = jalpha ? st.alpha_y   : 1.0 - st.alpha_y;
+                        const Real wx_u = ialpha ? st.alpha_x_u : 1.0 - st.alpha_x_u;
+                        const Real wy_v = jalpha ? st.alpha_y_v : 1.0 - st.alpha_y_v;
+                        ucol[idx_vec]     += velx(i+st.ishift,j,k) * wx_u * wy;
+                        vcol[idx_vec]     += vely(i,j+st.jshift,k) * wx * wy_v;
+                        thetacol[idx_vec] += state(i,j,k,RhoTheta_comp) / state(i,j,k,Rho_comp)
+                                           * wx * wy;
+                    }
+                }
+            });
+            Gpu::streamSynchronize();
+        }
     }
 
-    // Loop over indices where our box contains data needed for interpolation
-    const amrex::Box overlap_box = vbox & target_box;
-    if (overlap_box.ok()) {
-      amrex::ParallelFor(overlap_box,
-      [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
-        const int idx_vec = k - kstart;
-        const int ialpha = i - iloc;
-        const int jalpha = j - jloc;
-        ucol[idx_vec] += velx(i+iloc_shift,j,k) * alpha_u(ialpha, jalpha);
-        vcol[idx_vec] += vely(i,j+jloc_shift,k) * alpha_v(ialpha, jalpha);
-        thetacol[idx_vec] += state(i,j,k,RhoTheta_comp) / state(i,j,k,Rho_comp)
-          * alpha_theta(ialpha, jalpha);
-      });
+    // Communicate values to CPU then to the IO processor
+    Gpu::copy(Gpu::deviceToHost, d_column_data.begin(), d_column_data.end(), h_column_data.begin());
+    ParallelDescriptor::ReduceRealSum(h_column_data.data(), h_column_data.size(),
+                                      ParallelDescriptor::IOProcessorNumber());
+
+    if (ParallelDescriptor::IOProcessor()) {
+        m_column_buf_times.push_back(time);
+        m_column_buf_data.insert(m_column_buf_data.end(), h_column_data.begin(), h_column_data.end());
+        if (static_cast<int>(m_column_buf_times.size()) >= column_buffer) {
+            flush_columns();
+        }
     }
-  }
+}
 
-  // Communicate values to CPU then to the IO processor
-  amrex::Gpu::copy(amrex::Gpu::deviceToHost, d_column_data.begin(),
-    d_column_data.end(), h_column_data.begin());
-  amrex::ParallelDescriptor::ReduceRealSum(h_column_data.data(),
-    h_column_data.size(), amrex::ParallelDescriptor::IOProcessorNumber());
+/**
+ * Appends the buffered column samples to the NetCDF file in one write per variable
+ */
+void
+ERF::flush_columns ()
+{
+    if (!m_column_ncf || m_column_buf_times.empty()) return;
+
+    BL_PROFILE("ERF::flush_columns()");
 
-  // IO processor only: write the relevant data to file
-  if (amrex::ParallelDescriptor::IOProcessor()) {
-    auto ncf = ncutils::NCFile::open(colfile_name, NC_WRITE | NC_NETCDF4);
-    size_t putloc = ncf.dim("ntime").len();
+    auto& ncf = *m_column_ncf;
+    const size_t ncol = column_loc_x.size();
+    const size_t nheights = geom[0].Domain().length(2) + 2;
+    const size_t nbuf = m_column_buf_times.size();
+    const size_t nt0 = m_column_nwritten;
 
-    // Time
-    amrex::Vector<size_t> start_t {putloc};
-    amrex::Vector<size_t> count_t {1};
-    ncf.var("times").put(&cumtime, start_t, count_t);
+    ncf.var("times").put(m_column_buf_times.data(), {nt0}, {nbuf});
 
     // T flux
     // TODO: Make this the actual flux rather than just a placeholder
-    Real Tflux = 0.0;
-    ncf.var("wrf_tflux").put(&Tflux, start_t, count_t);
-
-    // U, V, Theta
-    std::vector<size_t> start = {putloc, 0};
-    std::vector<size_t> count = {1, nheights};
-    ncf.var("wrf_momentum_u").put(&h_column_data[0], start, count);
-    ncf.var("wrf_momentum_v").put(&h_column_data[nheights], start, count);
-    ncf.var("wrf_temperature").put(&h_column_data[2*nheights], start, count);
-    ncf.close();
-  }
+    Vector<Real> Tflux(nbuf, 0.0);
+    ncf.var("wrf_tflux").put(Tflux.data(), {nt0}, {nbuf});
+
+    // The buffer holds u, v and theta of one column after another for each sample
+    Vector<Real> var_data(nbuf*ncol*nheights);
+    for (int n = 0; n < ncolumn_vars; ++n) {
+        for (size_t t = 0; t < nbuf; ++t) {
+            for (size_t c = 0; c < ncol; ++c) {
+                std::copy_n(&m_column_buf_data[((t*ncol + c)*ncolumn_vars + n)*nheights], nheights,
+                            &var_data[(t*ncol + c)*nheights]);
+            }
+        }
+        if (ncol == 1) {
+            ncf.var(column_var_names[n]).put(var_data.data(), {nt0, 0}, {nbuf, nheights});
+        } else {
+            ncf.var(column_var_names[n]).put(var_data.data(), {nt0, 0, 0}, {nbuf, ncol, nheights});
+        }
+    }
+    ncf.sync();
+
+    m_column_nwritten += nbuf;
+    m_column_buf_times.clear();
+    m_column_buf_data.clear();
 }
@@ -458,6 +458,16 @@ void NCVar::par_access(const int cmode) const
     check_nc_error(nc_var_par_access(ncid, varid, cmode));
 }
 
+/**
+ * Error-checking wrapper for NetCDF function nc_def_var_chunking
+ *
+ * @param chunks Chunk size in each dimension of the variable
+ */
+void NCVar::def_chunking(const std::vector<size_t>& chunks) const
+{
+    check_nc_error(nc_def_var_chunking(ncid, varid, NC_CHUNKED, chunks.data()));
+}
+
 std::string NCGroup::name() const
 {
     size_t nlen;
@@ -735,6 +745,14 @@ NCFile NCFile::open_par(
     return NCFile(ncid);
 }
 
+std::unique_ptr<NCFile> NCFile::try_open_par(
+    const std::string& name, const int cmode, MPI_Comm comm, MPI_Info info)
+{
+    int ncid;
+    if (nc_open_par(name.data(), cmode, comm, info, &ncid) != NC_NOERR) return nullptr;
+    return std::unique_ptr<NCFile>(new NCFile(ncid));
+}
+
 NCFile::~NCFile()
 {
     if (is_open) check_nc_error(nc_close(ncid));
@@ -745,4 +763,6 @@ void NCFile::close()
     is_open = false;
     check_nc_error(nc_close(ncid));
 }
+
+void NCFile::sync() const { check_nc_error(nc_sync(ncid)); }
 } // namespace ncutils
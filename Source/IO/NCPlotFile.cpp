@@ -24,6 +24,11 @@ ERF::writeNCPlotFile(int lev, int which_subdomain, const std::string& dir,
                      const Vector<std::string> &plot_var_names,
                      const Vector<int>& level_steps, const Real time) const
 {
+     if (plotfile_nc_layout == "chunked") {
+         writeNCPlotFileChunked(lev, which_subdomain, dir, plotMF, plot_var_names, level_steps, time);
+         return;
+     }
+
      // get the processor number
      int iproc = amrex::ParallelContext::MyProcAll();
      int nproc = amrex::ParallelDescriptor::NProcs();
@@ -243,3 +248,145 @@ ERF::writeNCPlotFile(int lev, int which_subdomain, const std::string& dir,
    }
    ncf.close();
 }
+
+// Write one level (or one subdomain of a level) with 1D coordinates and a single 3D variable
+//    per field, stored as (z,y,x) in chunks the size of the largest grid.  Every rank writes its
+//    own boxes as hyperslabs in collective calls.
+void
+ERF::writeNCPlotFileChunked (int lev, int which_subdomain, const std::string& dir,
+                             const Vector<const MultiFab*> &plotMF,
+                             const Vector<std::string> &plot_var_names,
+                             const Vector<int>& level_steps, const Real time) const
+{
+     BL_PROFILE("ERF::writeNCPlotFileChunked()");
+
+     std::string FullPath = dir;
+     if (lev == 0) {
+         FullPath += amrex::Concatenate("_d",lev+1,2) + ".nc";
+     } else {
+         FullPath += amrex::Concatenate("_d",lev+1+which_subdomain,2) + ".nc";
+     }
+
+     amrex::Print() << "Writing level " << lev << " NetCDF plot file " << FullPath << std::endl;
+
+     const Box subdomain = (lev == 0) ? geom[lev].Domain() : boxes_at_level[lev][which_subdomain];
+     const IntVect slo = subdomain.smallEnd();
+     const IntVect len = subdomain.length();
+
+     const MultiFab& mf = *plotMF[lev];
+     AMREX_ALWAYS_ASSERT(mf.nGrowVect() == 0);
+     const int ncomp = mf.nComp();
+     if (ncomp == 0) {
+         amrex::Error("Must specify at least one valid data item to plot");
+     }
+
+     // Chunk with the largest grid so that most boxes fill whole chunks
+     IntVect chunk(1);
+     for (int i = 0; i < grids[lev].size(); ++i) {
+         if (subdomain.contains(grids[lev][i])) {
+             chunk = amrex::max(chunk, grids[lev][i].length());
+         }
+     }
+     const std::vector<size_t> chunks {static_cast<size_t>(chunk[2]),
+                                       static_cast<size_t>(chunk[1]),
+                                       static_cast<size_t>(chunk[0])};
+
+     // With terrain the height of each cell centre is written as a 3D field
+     MultiFab z_cc;
+     if (solverChoice.use_terrain) {
+         z_cc.define(mf.boxArray(), mf.DistributionMap(), 1, 0);
+         MultiFab::Copy(z_cc, *z_phys_cc[lev], 0, 0, 1, 0);
+     }
+
+     auto ncf = ncutils::NCFile::create_par(FullPath, NC_NETCDF4 | NC_MPIIO,
+                                            amrex::ParallelContext::CommunicatorSub(), MPI_INFO_NULL);
+
+     const Real* dx = geom[lev].CellSize();
+     const RealBox rb(subdomain, dx, geom[lev].ProbLo());
+
+     ncf.enter_def_mode();
+     ncf.put_attr("title", "ERF NetCDF Plot data output");
+     ncf.put_attr("number_variables", std::vector<int>{ncomp});
+     ncf.put_attr("space_dimension", std::vector<int>{AMREX_SPACEDIM});
+     ncf.put_attr("current_time", std::vector<double>{time});
+     ncf.put_attr("CurrentLevel", std::vector<int>{lev});
+     ncf.put_attr("step", std::vector<int>{level_steps[lev]});
+     ncf.put_attr("probLo", std::vector<double>{rb.lo(0), rb.lo(1), rb.lo(2)});
+     ncf.put_attr("probHi", std::vector<double>{rb.hi(0), rb.hi(1), rb.hi(2)});
+     ncf.put_attr("CellSize", std::vector<double>{dx[0], dx[1], dx[2]});
+     ncf.put_attr("DefaultGeometry", std::vector<int>{amrex::DefaultGeometry().Coord()});
+
+     const std::vector<std::string> coord_names {"x", "y", "z"};
+     for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+         ncf.def_dim(coord_names[d], len[d]);
+         ncf.def_var(coord_names[d], NC_DOUBLE, {coord_names[d]});
+     }
+     for (int n = 0; n < ncomp; ++n) {
+         auto nc_var = ncf.def_var(plot_var_names[n], NC_FLOAT, {"z", "y", "x"});
+         nc_var.def_chunking(chunks);
+     }
+     if (solverChoice.use_terrain) {
+         auto nc_var = ncf.def_var("z_phys", NC_FLOAT, {"z", "y", "x"});
+         nc_var.def_chunking(chunks);
+     }
+     ncf.exit_def_mode();
+
+     // Cell-centred coordinates, written by the I/O rank
+     for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+         std::vector<double> coord(len[d]);
+         for (int i = 0; i < len[d]; ++i) {
+             coord[i] = geom[lev].ProbLo(d) + (slo[d] + i + 0.5) * dx[d];
+         }
+         const size_t count = ParallelDescriptor::IOProcessor() ? len[d] : 0;
+         auto nc_coord = ncf.var(coord_names[d]);
+         nc_coord.par_access(NC_COLLECTIVE);
+         nc_coord.put(coord.data(), {0}, {count});
+     }
+
+     // Collective writes need every rank to make the same number of calls, so ranks
+     //    with fewer boxes pad with empty writes
+     Vector<int> my_boxes;
+     for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
+         if (subdomain.contains(mfi.validbox())) my_boxes.push_back(mfi.index());
+     }
+     const int nmine = static_cast<int>(my_boxes.size());
+     int nwrites = nmine;
+     ParallelDescriptor::ReduceIntMax(nwrites);
+
+     auto put_field = [&] (const std::string& name, const MultiFab& src, int comp)
+     {
+         auto nc_var = ncf.var(name);
+         nc_var.par_access(NC_COLLECTIVE);
+         for (int n = 0; n < nwrites; ++n) {
+             if (n < nmine) {
+                 const Box& bx = src.boxArray()[my_boxes[n]];
+                 const std::vector<size_t> start {static_cast<size_t>(bx.smallEnd(2) - slo[2]),
+                                                  static_cast<size_t>(bx.smallEnd(1) - slo[1]),
+                                                  static_cast<size_t>(bx.smallEnd(0) - slo[0])};
+                 const std::vector<size_t> count {static_cast<size_t>(bx.length(2)),
+                                                  static_cast<size_t>(bx.length(1)),
+                                                  static_cast<size_t>(bx.length(0))};
+#ifdef AMREX_USE_GPU
+                 FArrayBox host_fab(bx, 1, The_Pinned_Arena());
+                 host_fab.copy<RunOn::Device>(src[my_boxes[n]], bx, comp, bx, 0, 1);
+                 Gpu::streamSynchronize();
+                 nc_var.put(host_fab.dataPtr(), start, count);
+#else
+                 nc_var.put(src[my_boxes[n]].dataPtr(comp), start, count);
+#endif
+             } else {
+                 const Real dummy = 0.0;
+                 nc_var.put(&dummy, {0, 0, 0}, {0, 0, 0});
+             }
+         }
+     };
+
+     for (int n = 0; n < ncomp; ++n) {
+         put_field(plot_var_names[n], mf, n);
+     }
+     if (solverChoice.use_terrain) {
+         put_field("z_phys", z_cc, 0);
+     }
+
+     ncf.close();
+}
@@ -0,0 +1,365 @@
+#include <climits>
+
+#include <AMReX_Utility.H>
+
+#include "ERF.H"
+#include "NCInterface.H"
+#include "IndexDefines.H"
+
+using namespace amrex;
+
+namespace {
+    const std::string coord_names[3] = {"x", "y", "z"};
+
+    // The directions spanning a plane with this normal, in increasing order
+    void plane_dirs (int normal, int& a, int& b)
+    {
+        a = (normal == 0) ? 1 : 0;
+        b = (normal == 2) ? 1 : 2;
+    }
+}
+
+/**
+ * Creates the NetCDF file of each slice, holding the cell centres of the plane and
+ * one (time, n2, n1) variable per plot variable. On restart an existing file is kept
+ * and the samples taken after the restart time are overwritten.
+ */
+void
+ERF::init_slices ()
+{
+    for (auto& slc : slices)
+    {
+        const int lev = slc.lev;
+        const int d = slc.normal;
+        int a, b;
+        plane_dirs(d, a, b);
+
+        if (!slc.fixed_height &&
+            (slc.location < geom[lev].ProbLo(d) || slc.location > geom[lev].ProbHi(d))) {
+            Abort("slice." + slc.name + ".location is outside the domain");
+        }
+
+        if (slc.var_names.empty()) {
+            Abort("slice." + slc.name + ".vars must name at least one available variable");
+        }
+        CheckPointwisePlotVars("slice." + slc.name + ".vars:", slc.var_names);
+
+        slc.nwritten = 0;
+        slc.kmin = -1;
+        slc.buf_times.clear();
+        slc.buf_data.clear();
+
+        if (!ParallelDescriptor::IOProcessor()) continue;
+
+        if (!restart_chkfile.empty() && FileExists(slc.file))
+        {
+            auto ncf = ncutils::NCFile::open(slc.file, NC_NOWRITE);
+            const size_t nt = ncf.dim("time").len();
+            Vector<double> times(nt);
+            if (nt > 0) ncf.var("time").get(times.data());
+            ncf.close();
+
+            while (slc.nwritten < nt && times[slc.nwritten] <= t_new[0] + 1.e-6*dt[0]) {
+                ++slc.nwritten;
+            }
+            continue;
+        }
+
+        const Box& dom = geom[lev].Domain();
+        const int n1 = dom.length(a);
+        const int n2 = dom.length(b);
+
+        auto ncf = ncutils::NCFile::create(slc.file, NC_CLOBBER | NC_NETCDF4);
+        ncf.enter_def_mode();
+        ncf.put_attr("title", "ERF NetCDF Slice Output");
+        ncf.put_attr("units", "mks");
+        ncf.put_attr("normal", coord_names[d]);
+        ncf.put_attr("height_type", slc.fixed_height ? "fixed" : "terrain");
+        Vector<Real> loc = {slc.location};
+        ncf.put_attr("location", loc);
+        ncf.put_attr("level", std::vector<int>{lev});
+        ncf.def_dim("time", NC_UNLIMITED);
+        ncf.def_dim(coord_names[a], n1);
+        ncf.def_dim(coord_names[b], n2);
+        ncf.def_var("time", NC_DOUBLE, {"time"});
+        ncf.def_var(coord_names[a], NC_FLOAT, {coord_names[a]});
+        ncf.def_var(coord_names[b], NC_FLOAT, {coord_names[b]});
+        for (const auto& vname : slc.var_names) {
+            auto nc_var = ncf.def_var(vname, NC_FLOAT, {"time", coord_names[b], coord_names[a]});
+            nc_var.put_attr("_FillValue", std::vector<float>{NC_FILL_FLOAT});
+        }
+        ncf.exit_def_mode();
+
+        // Cell centres in the plane (the computational coordinate in z if there is terrain)
+        for (const int dir : {a, b}) {
+            Vector<Real> centres(dom.length(dir));
+            for (int i = 0; i < dom.length(dir); ++i) {
+                centres[i] = geom[lev].ProbLo(dir) + (i + 0.5) * geom[lev].CellSize(dir);
+            }
+            ncf.var(coord_names[dir]).put(centres.data());
+        }
+        ncf.close();
+    }
+}
+
+/**
+ * Samples the slices that are due at this step and appends those whose buffer is full
+ *
+ * @param nstep Current level 0 step
+ * @param time Current time
+ * @param dt_lev0 Level 0 time step
+ */
+void
+ERF::write_slices (int nstep, Real time, Real dt_lev0)
+{
+    for (auto& slc : slices)
+    {
+        if (is_it_time_for_action(nstep, time, dt_lev0, slc.interval, slc.per))
+        {
+            write_slice(slc, time);
+            if (static_cast<int>(slc.buf_times.size()) >= slc.buffer) {
+                flush_slice(slc);
+            }
+        }
+    }
+}
+
+/**
+ * Samples one slice into its buffer on the I/O rank.
+ *
+ * Only the pieces of the level grids within the cells on either side of the plane are
+ * touched: the plot variables are evaluated there and linearly interpolated onto the
+ * plane, and only the footprints of those pieces are sent to the I/O rank. Points the
+ * level does not cover hold the NetCDF fill value. A fixed-height plane over terrain is
+ * interpolated in each column between the cell centres that bracket it; otherwise the
+ * plane is at a fixed computational coordinate. Outside the cell centres the nearest
+ * cell is used.
+ *
+ * @param slc Slice to sample
+ * @param time Current time
+ */
+void
+ERF::write_slice (SliceOutput& slc, Real time)
+{
+    BL_PROFILE("ERF::write_slice()");
+
+    const int lev = slc.lev;
+    const int d = slc.normal;
+    int a, b;
+    plane_dirs(d, a, b);
+
+    const Box& dom = geom[lev].Domain();
+    const int dlo = dom.smallEnd(d);
+    const int dhi = dom.bigEnd(d);
+    const int ncomp = slc.var_names.size();
+
+    const bool fixed_height = slc.fixed_height && solverChoice.use_terrain && (lev <= finest_level);
+    const Real zloc = slc.location;
+
+    // Cells along the normal that hold the plane, and the weight of the upper one
+    int ilo, ihi;
+    Real wgt = 0.0;
+    if (fixed_height)
+    {
+        // The terrain only moves with terrain_type 1, so otherwise this is done once
+        if (slc.kmin < 0 || solverChoice.terrain_type == 1)
+        {
+            ReduceOps<ReduceOpMin, ReduceOpMax> reduce_op;
+            ReduceData<int, int> reduce_data(reduce_op);
+            using ReduceTuple = typename decltype(reduce_data)::Type;
+
+            for (MFIter mfi(*z_phys_cc[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+            {
+                const Box& bx = mfi.tilebox();
+                const Array4<Real const>& z_cc = z_phys_cc[lev]->const_array(mfi);
+                reduce_op.eval(bx, reduce_data,
+                [=] AMREX_GPU_DEVICE (int i, int j, int k) -> ReduceTuple
+                {
+                    // Is k the lower of the two cells bracketing the plane in this column?
+                    const bool lower = (k == dlo || z_cc(i,j,k) <= zloc) &&
+                                       (k == dhi || z_cc(i,j,k+1) > zloc);
+                    return lower ? ReduceTuple{k, amrex::min(k+1, dhi)} : ReduceTuple{INT_MAX, INT_MIN};
+                });
+            }
+
+            ReduceTuple hv = reduce_data.value(reduce_op);
+            slc.kmin = amrex::get<0>(hv);
+            slc.kmax = amrex::get<1>(hv);
+            ParallelDescriptor::ReduceIntMin(slc.kmin);
+            ParallelDescriptor::ReduceIntMax(slc.kmax);
+        }
+        ilo = slc.kmin;
+        ihi = slc.kmax;
+    }
+    else
+    {
+        const Real xc = (zloc - geom[lev].ProbLo(d)) * geom[lev].InvCellSize(d) - 0.5 + dlo;
+        ilo = static_cast<int>(std::floor(xc));
+        wgt = xc - ilo;
+        if (ilo < dlo) {
+            ilo = dlo;
+            wgt = 0.0;
+        }
+        if (ilo >= dhi) {
+            ilo = dhi;
+            wgt = 0.0;
+        }
+        ihi = (wgt > 0.0) ? ilo+1 : ilo;
+    }
+
+    Box slab(dom);
+    slab.setSmall(d, ilo);
+    slab.setBig(d, ihi);
+
+    // The pieces of the level grids that hold the plane, on the ranks that own them
+    BoxList bl;
+    Vector<int> parent;
+    Vector<int> owner;
+    if (lev <= finest_level) {
+        for (int n = 0; n < grids[lev].size(); ++n) {
+            const Box bx = grids[lev][n] & slab;
+            if (bx.ok()) {
+                bl.push_back(bx);
+                parent.push_back(n);
+                owner.push_back(dmap[lev][n]);
+            }
+        }
+    }
+
+    // The plane in index space, with the normal direction collapsed to index 0. Its cells
+    //    are stored in the same order as the (n2, n1) NetCDF variables.
+    Box plane_box(dom);
+    plane_box.setSmall(d, 0);
+    plane_box.setBig(d, 0);
+    const size_t nplane = plane_box.numPts();
+
+    // Sum of the interpolation weights of each plane point in the last component, so
+    //    points the level does not cover can be told apart
+    const int nsum = ncomp + 1;
+    MultiFab plane(BoxArray(plane_box),
+                   DistributionMapping(Vector<int>{ParallelDescriptor::IOProcessorNumber()}),
+                   nsum, 0, MFInfo().SetArena(The_Pinned_Arena()));
+    plane.setVal(0.0);
+
+    if (!bl.isEmpty())
+    {
+        BoxArray ba_slab(std::move(bl));
+        DistributionMapping dm_slab(std::move(owner));
+
+        MultiFab sdata(ba_slab, dm_slab, ncomp, 0);
+        ComputePlotVars(lev, slc.var_names, sdata, &parent);
+
+        // The footprint of each piece on the plane, on the rank that owns the piece
+        BoxArray ba_patch(ba_slab);
+        for (int n = 0; n < ba_patch.size(); ++n) {
+            Box pbx = ba_patch[n];
+            pbx.setSmall(d, 0);
+            pbx.setBig(d, 0);
+            ba_patch.set(n, pbx);
+        }
+        MultiFab patch(ba_patch, dm_slab, nsum, 0);
+        patch.setVal(0.0);
+
+        for (MFIter mfi(sdata); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.validbox();
+            const Array4<Real const>& sarr = sdata.const_array(mfi);
+            const Array4<Real      >& parr = patch.array(mfi);
+            const Array4<Real const>  z_cc = fixed_height ? z_phys_cc[lev]->const_array(parent[mfi.index()])
+                                                          : Array4<Real const>{};
+
+            // Cells along the normal add to the same point
+            ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+            {
+                IntVect iv(AMREX_D_DECL(i,j,k));
+                Real w = 0.0;
+                if (fixed_height) {
+                    if (k < dhi && z_cc(i,j,k) <= zloc && zloc < z_cc(i,j,k+1)) {
+                        w += (z_cc(i,j,k+1) - zloc) / (z_cc(i,j,k+1) - z_cc(i,j,k));
+                    }
+                    if (k > dlo && z_cc(i,j,k-1) <= zloc && zloc < z_cc(i,j,k)) {
+                        w += (zloc - z_cc(i,j,k-1)) / (z_cc(i,j,k) - z_cc(i,j,k-1));
+                    }
+                    if ((k == dlo && zloc < z_cc(i,j,k)) || (k == dhi && zloc >= z_cc(i,j,k))) {
+                        w = 1.0;
+                    }
+                } else {
+                    w = (iv[d] == ilo) ? 1.0 - wgt : wgt;
+                }
+                if (w != 0.0) {
+                    iv[d] = 0;
+                    for (int n = 0; n < ncomp; ++n) {
+                        Gpu::Atomic::AddNoRet(&parr(iv,n), w * sarr(i,j,k,n));
+                    }
+                    Gpu::Atomic::AddNoRet(&parr(iv,ncomp), w);
+                }
+            });
+        }
+
+        // Only the patches travel to the I/O rank; pieces stacked along the normal on
+        //    different grids add up there
+        plane.ParallelAdd(patch, 0, 0, nsum);
+    }
+
+    if (ParallelDescriptor::IOProcessor()) {
+        Gpu::streamSynchronize();
+        // Points the level does not cover (no weight) get the fill value
+        const Real* pdata = plane[0].dataPtr();
+        const Real* wsum  = plane[0].dataPtr(ncomp);
+        slc.buf_times.push_back(time);
+        for (int n = 0; n < ncomp; ++n) {
+            for (size_t idx = 0; idx < nplane; ++idx) {
+                slc.buf_data.push_back(wsum[idx] > 0.0 ? pdata[n*nplane + idx]
+                                                       : static_cast<Real>(NC_FILL_FLOAT));
+            }
+        }
+    }
+}
+
+void
+ERF::flush_slices ()
+{
+    for (auto& slc : slices) {
+        flush_slice(slc);
+    }
+}
+
+/**
+ * Appends the buffered samples of one slice to its NetCDF file
+ *
+ * @param slc Slice to write
+ */
+void
+ERF::flush_slice (SliceOutput& slc)
+{
+    if (!ParallelDescriptor::IOProcessor() || slc.buf_times.empty()) return;
+
+    BL_PROFILE("ERF::flush_slice()");
+
+    int a, b;
+    plane_dirs(slc.normal, a, b);
+    const Box& dom = geom[slc.lev].Domain();
+    const size_t n1 = dom.length(a);
+    const size_t n2 = dom.length(b);
+    const size_t nplane = n1 * n2;
+    const size_t nbuf = slc.buf_times.size();
+    const int ncomp = slc.var_names.size();
+
+    auto ncf = ncutils::NCFile::open(slc.file, NC_WRITE | NC_NETCDF4);
+
+    ncf.var("time").put(slc.buf_times.data(), {slc.nwritten}, {nbuf});
+
+    // The buffer holds all the variables of one sample after another
+    Vector<Real> var_data(nbuf*nplane);
+    for (int n = 0; n < ncomp; ++n) {
+        for (size_t t = 0; t < nbuf; ++t) {
+            std::copy_n(&slc.buf_data[(t*ncomp + n)*nplane], nplane, &var_data[t*nplane]);
+        }
+        ncf.var(slc.var_names[n]).put(var_data.data(), {slc.nwritten, 0, 0}, {nbuf, n2, n1});
+    }
+    ncf.close();
+
+    slc.nwritten += nbuf;
+    slc.buf_times.clear();
+    slc.buf_data.clear();
+}
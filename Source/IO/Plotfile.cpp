@@ -1,3 +1,6 @@
+#include <cstdint>
+#include <fstream>
+
 #include <EOS.H>
 #include <ERF.H>
 #include "AMReX_Interp_3D_C.H"
@@ -12,6 +15,76 @@ bool containerHasElement(const V& iterable, const T& query) {
     return std::find(iterable.begin(), iterable.end(), query) != iterable.end();
 }
 
+namespace {
+
+// Round v to its nb most significant mantissa bits (to nearest) and zero the rest,
+//    which makes the data compress well; zero, infinity and NaN are left alone
+AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+Real keep_mantissa_bits (Real v, int nb) noexcept
+{
+#ifdef AMREX_USE_FLOAT
+    using UInt = std::uint32_t;
+    constexpr int  nmant   = 23;
+    constexpr UInt expmask = 0x7f800000u;
+#else
+    using UInt = std::uint64_t;
+    constexpr int  nmant   = 52;
+    constexpr UInt expmask = 0x7ff0000000000000ull;
+#endif
+    const int ndrop = nmant - nb;
+    if (nb <= 0 || ndrop <= 0) return v;
+
+    // std::memcpy is not available in device code, so we reinterpret through a union
+    union { Real f; UInt u; } bits;
+    bits.f = v;
+    if ((bits.u & expmask) == expmask) return v;
+
+    bits.u += UInt(1) << (ndrop-1);
+    bits.u &= ~((UInt(1) << ndrop) - 1);
+    return bits.f;
+}
+
+// Bytes of data (not counting headers) in a plotfile holding these MultiFabs
+Long plot_data_bytes (const Vector<const MultiFab*>& mfs, int bytes_per_value)
+{
+    Long nbytes = 0;
+    for (const auto* mf : mfs) {
+        if (mf) nbytes += mf->boxArray().numPts() * mf->nComp() * bytes_per_value;
+    }
+    return nbytes;
+}
+
+// Plot variables that are evaluated point by point in ComputePlotVars, in the order of
+//    derived_names in ERF.H
+namespace PlotVar {
+    enum {
+        x_velocity = 0, y_velocity, z_velocity,
+        pressure, soundspeed, temp, theta, KE, QKE, scalar,
+        pres_hse, dens_hse, pert_pres, pert_dens,
+        z_phys, detJ, mapfac,
+#if defined(ERF_USE_MOISTURE)
+        qt, qp, qv, qc, qi, qrain, qsnow, qgraup,
+#elif defined(ERF_USE_WARM_NO_PRECIP)
+        qv, qc,
+#endif
+        NumVars
+    };
+}
+
+const Vector<std::string> pointwise_plot_names {
+    "x_velocity", "y_velocity", "z_velocity",
+    "pressure", "soundspeed", "temp", "theta", "KE", "QKE", "scalar",
+    "pres_hse", "dens_hse", "pert_pres", "pert_dens",
+    "z_phys", "detJ", "mapfac"
+#if defined(ERF_USE_MOISTURE)
+    ,"qt", "qp", "qv", "qc", "qi", "qrain", "qsnow", "qgraup"
+#elif defined(ERF_USE_WARM_NO_PRECIP)
+    ,"qv", "qc"
+#endif
+};
+
+} // namespace
+
 void
 ERF::setPlotVariables (const std::string& pp_plot_var_names, Vector<std::string>& plot_var_names)
 {
@@ -76,6 +149,27 @@ ERF::setPlotVariables (const std::string& pp_plot_var_names, Vector<std::string>
     plot_var_names = tmp_plot_names;
 }
 
+// set the number of mantissa bits kept for each plot variable (0 keeps all of them)
+void
+ERF::setPlotKeepBits (const std::string& pp_keep_bits, const Vector<std::string>& plot_var_names,
+                      Vector<int>& keep_bits)
+{
+    ParmParse pp(pp_prefix);
+
+    // erf.plot_keep_bits_1 sets the default, erf.plot_keep_bits_1.<var> overrides it for <var>
+    int nb_default = 0;
+    pp.query(pp_keep_bits.c_str(), nb_default);
+
+    keep_bits.resize(plot_var_names.size());
+    for (int i = 0; i < plot_var_names.size(); ++i) {
+        keep_bits[i] = nb_default;
+        pp.query((pp_keep_bits + "." + plot_var_names[i]).c_str(), keep_bits[i]);
+        if (keep_bits[i] < 0) {
+            Abort("plot_keep_bits must be >= 0");
+        }
+    }
+}
+
 // set plotfile variable names
 Vector<std::string>
 ERF::PlotFileVarNames ( Vector<std::string> plot_var_names )
@@ -92,6 +186,9 @@ ERF::PlotFileVarNames ( Vector<std::string> plot_var_names )
 void
 ERF::WritePlotFile (int which, Vector<std::string> plot_var_names)
 {
+    BL_PROFILE("ERF::WritePlotFile()");
+    const Real t_start = amrex::second();
+
     const Vector<std::string> varnames = PlotFileVarNames(plot_var_names);
     const int ncomp_mf = varnames.size();
 
@@ -120,789 +217,952 @@ ERF::WritePlotFile (int which, Vector<std::string> plot_var_names)
     }
 
     for (int lev = 0; lev <= finest_level; ++lev) {
-        int mf_comp = 0;
-
-        // First, copy any of the conserved state variables into the output plotfile
-        AMREX_ALWAYS_ASSERT(cons_names.size() == Cons::NumVars);
-        for (int i = 0; i < Cons::NumVars; ++i) {
-            if (containerHasElement(plot_var_names, cons_names[i])) {
-                MultiFab::Copy(mf[lev],vars_new[lev][Vars::cons],i,mf_comp,1,0);
-                mf_comp++;
+        ComputePlotVars(lev, plot_var_names, mf[lev]);
+    }
+
+    // Fill terrain distortion MF
+    if (solverChoice.use_terrain) {
+        for (int lev(0); lev <= finest_level; ++lev) {
+            MultiFab::Copy(mf_nd[lev],*z_phys_nd[lev],0,2,1,0);
+            Real dz = Geom()[lev].CellSizeArray()[2];
+            for (MFIter mfi(mf_nd[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+                const Box& bx = mfi.tilebox();
+                Array4<      Real> mf_arr = mf_nd[lev].array(mfi);
+                ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) {
+                    mf_arr(i,j,k,2) -= k * dz;
+                });
             }
         }
+    }
 
-        // Next, check for velocities and if desired, output them -- note we output none or all, not just some
-        if (containerHasElement(plot_var_names, "x_velocity") ||
-            containerHasElement(plot_var_names, "y_velocity") ||
-            containerHasElement(plot_var_names, "z_velocity")) {
+    std::string plotfilename;
+    if (which == 1)
+       plotfilename = Concatenate(plot_file_1, istep[0], 5);
+    else if (which == 2)
+       plotfilename = Concatenate(plot_file_2, istep[0], 5);
 
-            average_face_to_cellcenter(mf[lev],mf_comp,
-                Array<const MultiFab*,3>{&vars_new[lev][Vars::xvel],&vars_new[lev][Vars::yvel],&vars_new[lev][Vars::zvel]});
-            mf_comp += AMREX_SPACEDIM;
-        }
+    const std::string& plot_precision   = (which == 1) ? plot_precision_1   : plot_precision_2;
+    const std::string& plot_compression = (which == 1) ? plot_compression_1 : plot_compression_2;
+    const Vector<int>& keep_bits        = (which == 1) ? plot_keep_bits_1   : plot_keep_bits_2;
+    amrex::ignore_unused(plot_compression);
 
-        // Finally, check for any derived quantities and compute them, inserting
-        // them into our output multifab
-        auto calculate_derived = [&](const std::string& der_name,
-                                     decltype(derived::erf_dernull)& der_function)
-        {
-            if (containerHasElement(plot_var_names, der_name)) {
-                MultiFab dmf(mf[lev], make_alias, mf_comp, 1);
+    // Drop the trailing mantissa bits of the variables that do not need them
+    AMREX_ALWAYS_ASSERT(keep_bits.size() == ncomp_mf);
+    for (int lev = 0; lev <= finest_level; ++lev) {
+        for (int n = 0; n < ncomp_mf; ++n) {
+            const int nb = keep_bits[n];
+            if (nb <= 0) continue;
 #ifdef _OPENMP
 #pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
-                for (MFIter mfi(dmf, TilingIfNotGPU()); mfi.isValid(); ++mfi)
-                {
-                    const Box& bx = mfi.tilebox();
-                    auto& dfab = dmf[mfi];
-                    auto& sfab = vars_new[lev][Vars::cons][mfi];
-                    der_function(bx, dfab, 0, 1, sfab, Geom(lev), t_new[0], nullptr, lev);
-                }
-
-                mf_comp++;
+            for (MFIter mfi(mf[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+                const Box& bx = mfi.tilebox();
+                const Array4<Real>& mf_arr = mf[lev].array(mfi);
+                ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
+                    mf_arr(i,j,k,n) = keep_mantissa_bits(mf_arr(i,j,k,n), nb);
+                });
             }
-        };
-
-        // Note: All derived variables must be computed in order of "derived_names" defined in ERF.H
-        calculate_derived("pressure",    derived::erf_derpres);
-        calculate_derived("soundspeed",  derived::erf_dersoundspeed);
-        calculate_derived("temp",        derived::erf_dertemp);
-        calculate_derived("theta",       derived::erf_dertheta);
-        calculate_derived("KE",          derived::erf_derKE);
-        calculate_derived("QKE",         derived::erf_derQKE);
-        calculate_derived("scalar",      derived::erf_derscalar);
-
-        MultiFab r_hse(base_state[lev], make_alias, 0, 1); // r_0 is first  component
-        MultiFab p_hse(base_state[lev], make_alias, 1, 1); // p_0 is second component
-        if (containerHasElement(plot_var_names, "pres_hse"))
-        {
-            // p_0 is second component of base_state
-            MultiFab::Copy(mf[lev],p_hse,0,mf_comp,1,0);
-            mf_comp += 1;
-        }
-        if (containerHasElement(plot_var_names, "dens_hse"))
-        {
-            // r_0 is first component of base_state
-            MultiFab::Copy(mf[lev],r_hse,0,mf_comp,1,0);
-            mf_comp += 1;
         }
-        if (containerHasElement(plot_var_names, "pert_pres"))
-        {
-#ifdef _OPENMP
-#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
-#endif
-            for ( MFIter mfi(mf[lev],TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                const Box& bx = mfi.tilebox();
-                const Array4<Real>& derdat = mf[lev].array(mfi);
-                const Array4<Real const>& p0_arr = p_hse.const_array(mfi);
-                const Array4<Real const>& S_arr = vars_new[lev][Vars::cons].const_array(mfi);
+    }
 
-                ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+    // Native plotfiles may be written in single precision; this is not available for
+    //    the asynchronous writer, which always writes the data as they are in memory
+    const bool write_single = (plot_precision == "single") && !AsyncOut::UseAsyncOut();
+    const int  bytes_per_value = write_single ? 4 : static_cast<int>(sizeof(Real));
+    const FABio::Format fab_format = FArrayBox::getFormat();
+    if (write_single) FArrayBox::setFormat(FABio::FAB_NATIVE_32);
 
-                    const Real rhotheta = S_arr(i,j,k,RhoTheta_comp);
-                    derdat(i, j, k, mf_comp) = getPgivenRTh(rhotheta) - p0_arr(i,j,k);
-                });
+    Long nbytes = 0;
+
+    if (finest_level == 0)
+    {
+        if (plotfile_type == "amrex") {
+            amrex::Print() << "Writing plotfile " << plotfilename << "\n";
+            if (solverChoice.use_terrain) {
+                WriteMultiLevelPlotfileWithTerrain(plotfilename, finest_level+1,
+                                                   GetVecOfConstPtrs(mf),
+                                                   GetVecOfConstPtrs(mf_nd),
+                                                   varnames,
+                                                   t_new[0], istep);
+                nbytes = plot_data_bytes(GetVecOfConstPtrs(mf), bytes_per_value)
+                       + plot_data_bytes(GetVecOfConstPtrs(mf_nd), bytes_per_value);
+            } else {
+                WriteMultiLevelPlotfile(plotfilename, finest_level+1,
+                                        GetVecOfConstPtrs(mf),
+                                        varnames,
+                                        Geom(), t_new[0], istep, refRatio());
+                nbytes = plot_data_bytes(GetVecOfConstPtrs(mf), bytes_per_value);
+            }
+            writeJobInfo(plotfilename);
+
+#ifdef ERF_USE_PARTICLES
+            if (use_tracer_particles) {
+                tracer_particles->Checkpoint(plotfilename, "tracers", true, tracer_particle_varnames);
             }
-            mf_comp += 1;
-        }
-        if (containerHasElement(plot_var_names, "pert_dens"))
-        {
-#ifdef _OPENMP
-#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
-            for ( MFIter mfi(mf[lev],TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                const Box& bx = mfi.tilebox();
-                const Array4<Real>& derdat  = mf[lev].array(mfi);
-                const Array4<Real const>& S_arr = vars_new[lev][Vars::cons].const_array(mfi);
-                const Array4<Real const>& r0_arr = r_hse.const_array(mfi);
-                ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
-                    derdat(i, j, k, mf_comp) = S_arr(i,j,k,Rho_comp) - r0_arr(i,j,k);
-                });
+#ifdef ERF_USE_HDF5
+        } else if (plotfile_type == "hdf5" || plotfile_type == "HDF5") {
+            amrex::Print() << "Writing plotfile " << plotfilename+"d01.h5" << "\n";
+            WriteMultiLevelPlotfileHDF5(plotfilename, finest_level+1,
+                                        GetVecOfConstPtrs(mf),
+                                        varnames,
+                                        Geom(), t_new[0], istep, refRatio(),
+                                        plot_compression);
+            // With compression the size on disk is what we want to know
+            if (ParallelDescriptor::IOProcessor()) {
+                std::ifstream h5file(plotfilename + ".h5", std::ios::binary | std::ios::ate);
+                nbytes = h5file.good() ? static_cast<Long>(h5file.tellg())
+                                       : plot_data_bytes(GetVecOfConstPtrs(mf), sizeof(Real));
             }
-            mf_comp ++;
+#endif
+#ifdef ERF_USE_NETCDF
+        } else if (plotfile_type == "netcdf" || plotfile_type == "NetCDF") {
+             int lev   = 0;
+             int l_which = 0;
+             writeNCPlotFile(lev, l_which, plotfilename, GetVecOfConstPtrs(mf), varnames, istep, t_new[0]);
+             // Only level 0 is written, and the fields are stored as NC_FLOAT
+             nbytes = plot_data_bytes({&mf[0]}, sizeof(float));
+#endif
+        } else {
+            amrex::Print() << "User specified plot_filetype = " << plotfile_type << std::endl;
+            amrex::Abort("Dont know this plot_filetype");
         }
 
-        int klo = geom[lev].Domain().smallEnd(2);
-        int khi = geom[lev].Domain().bigEnd(2);
+    } else { // multilevel
 
-        if (containerHasElement(plot_var_names, "dpdx"))
-        {
-            auto dxInv = geom[lev].InvCellSizeArray();
-            MultiFab pres(vars_new[lev][Vars::cons].boxArray(), vars_new[lev][Vars::cons].DistributionMap(), 1, 1);
-#ifdef _OPENMP
-#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
-#endif
-            for ( MFIter mfi(mf[lev],TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                // First define pressure on grown box
-                const Box& gbx = mfi.growntilebox(1);
-                const Array4<Real> & p_arr  = pres.array(mfi);
-                const Array4<Real const>& S_arr = vars_new[lev][Vars::cons].const_array(mfi);
-                amrex::ParallelFor(gbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
-                    p_arr(i,j,k) = getPgivenRTh(S_arr(i,j,k,RhoTheta_comp));
-                });
-            }
-            pres.FillBoundary(geom[lev].periodicity());
+        Vector<IntVect>   r2(finest_level);
+        Vector<Geometry>  g2(finest_level+1);
+        Vector<MultiFab> mf2(finest_level+1);
 
-#ifdef _OPENMP
-#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
-#endif
-            for ( MFIter mfi(mf[lev],TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                // Now compute pressure gradient on valid box
-                const Box& bx = mfi.tilebox();
-                const Array4<Real>& derdat = mf[lev].array(mfi);
-                const Array4<Real> & p_arr  = pres.array(mfi);
-
-                if (solverChoice.use_terrain) {
-                    const Array4<Real const>& z_nd = z_phys_nd[lev]->const_array(mfi);
-
-                    ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
-
-                        // Pgrad at lower I face
-                        Real met_h_xi_lo   = Compute_h_xi_AtIface  (i, j, k, dxInv, z_nd);
-                        Real met_h_zeta_lo = Compute_h_zeta_AtIface(i, j, k, dxInv, z_nd);
-                        Real gp_xi_lo = dxInv[0] * (p_arr(i,j,k) - p_arr(i-1,j,k));
-                        Real gp_zeta_on_iface_lo;
-                        if(k == klo) {
-                            gp_zeta_on_iface_lo = 0.5 * dxInv[2] * (
-                                p_arr(i-1,j,k+1) + p_arr(i,j,k+1)
-                                - p_arr(i-1,j,k  ) - p_arr(i,j,k  ) );
-                        } else if (k == khi) {
-                            gp_zeta_on_iface_lo = 0.5 * dxInv[2] * (
-                                p_arr(i-1,j,k  ) + p_arr(i,j,k  )
-                                - p_arr(i-1,j,k-1) - p_arr(i,j,k-1) );
-                        } else {
-                            gp_zeta_on_iface_lo = 0.25 * dxInv[2] * (
-                                p_arr(i-1,j,k+1) + p_arr(i,j,k+1)
-                                - p_arr(i-1,j,k-1) - p_arr(i,j,k-1) );
-                        }
-                        amrex::Real gpx_lo = gp_xi_lo - (met_h_xi_lo/ met_h_zeta_lo) * gp_zeta_on_iface_lo;
-
-                        // Pgrad at higher I face
-                        Real met_h_xi_hi   = Compute_h_xi_AtIface  (i+1, j, k, dxInv, z_nd);
-                        Real met_h_zeta_hi = Compute_h_zeta_AtIface(i+1, j, k, dxInv, z_nd);
-                        Real gp_xi_hi = dxInv[0] * (p_arr(i+1,j,k) - p_arr(i,j,k));
-                        Real gp_zeta_on_iface_hi;
-                        if(k == klo) {
-                            gp_zeta_on_iface_hi = 0.5 * dxInv[2] * (
-                                p_arr(i+1,j,k+1) + p_arr(i,j,k+1)
-                                - p_arr(i+1,j,k  ) - p_arr(i,j,k  ) );
-                        } else if (k == khi) {
-                            gp_zeta_on_iface_hi = 0.5 * dxInv[2] * (
-                                p_arr(i+1,j,k  ) + p_arr(i,j,k  )
-                                - p_arr(i+1,j,k-1) - p_arr(i,j,k-1) );
-                        } else {
-                            gp_zeta_on_iface_hi = 0.25 * dxInv[2] * (
-                                p_arr(i+1,j,k+1) + p_arr(i,j,k+1)
-                                - p_arr(i+1,j,k-1) - p_arr(i,j,k-1) );
-                        }
-                        amrex::Real gpx_hi = gp_xi_hi - (met_h_xi_hi/ met_h_zeta_hi) * gp_zeta_on_iface_hi;
-
-                        // Average P grad to CC
-                        derdat(i ,j ,k, mf_comp) = 0.5 * (gpx_lo + gpx_hi);
-                    });
-                } else {
-                    ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
-                        derdat(i ,j ,k, mf_comp) = 0.5 * (p_arr(i+1,j,k) - p_arr(i-1,j,k)) * dxInv[0];
-                    });
-                }
-            } // mfi
-            mf_comp ++;
-        } // dpdx
+        mf2[0].define(grids[0], dmap[0], ncomp_mf, 0);
 
-        if (containerHasElement(plot_var_names, "dpdy"))
-        {
-            auto dxInv = geom[lev].InvCellSizeArray();
+        // Copy level 0 as is
+        MultiFab::Copy(mf2[0],mf[0],0,0,mf[0].nComp(),0);
 
-            MultiFab pres(vars_new[lev][Vars::cons].boxArray(), vars_new[lev][Vars::cons].DistributionMap(), 1, 1);
-#ifdef _OPENMP
-#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
-#endif
-            for ( MFIter mfi(mf[lev],TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                // First define pressure on grown box
-                const Box& gbx = mfi.growntilebox(1);
-                const Array4<Real> & p_arr  = pres.array(mfi);
-                const Array4<Real const>& S_arr = vars_new[lev][Vars::cons].const_array(mfi);
-                amrex::ParallelFor(gbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
-                    p_arr(i,j,k) = getPgivenRTh(S_arr(i,j,k,RhoTheta_comp));
-                });
-            }
-            pres.FillBoundary(geom[lev].periodicity());
+        // Define a new multi-level array of Geometry's so that we pass the new "domain" at lev > 0
+        Array<int,AMREX_SPACEDIM> periodicity =
+                     {Geom()[0].isPeriodic(0),Geom()[0].isPeriodic(1),Geom()[0].isPeriodic(2)};
+        g2[0].define(Geom()[0].Domain(),&(Geom()[0].ProbDomain()),0,periodicity.data());
 
-#ifdef _OPENMP
-#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
-#endif
-            for ( MFIter mfi(mf[lev],TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                // Now compute pressure gradient on valid box
-                const Box& bx = mfi.tilebox();
-                const Array4<Real>& derdat = mf[lev].array(mfi);
-                const Array4<Real> & p_arr  = pres.array(mfi);
-
-                if (solverChoice.use_terrain) {
-                    const Array4<Real const>& z_nd = z_phys_nd[lev]->const_array(mfi);
-
-                    ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
-
-                        Real met_h_eta_lo  = Compute_h_eta_AtJface (i, j, k, dxInv, z_nd);
-                        Real met_h_zeta_lo = Compute_h_zeta_AtJface(i, j, k, dxInv, z_nd);
-                        Real gp_eta_lo = dxInv[1] * (p_arr(i,j,k) - p_arr(i,j-1,k));
-                        Real gp_zeta_on_jface_lo;
-                        if (k == klo) {
-                            gp_zeta_on_jface_lo = 0.5 * dxInv[2] * (
-                                p_arr(i,j,k+1) + p_arr(i,j-1,k+1)
-                                - p_arr(i,j,k  ) - p_arr(i,j-1,k  ) );
-                        } else if (k == khi) {
-                            gp_zeta_on_jface_lo = 0.5 * dxInv[2] * (
-                                p_arr(i,j,k  ) + p_arr(i,j-1,k  )
-                                - p_arr(i,j,k-1) - p_arr(i,j-1,k-1) );
-                        } else {
-                            gp_zeta_on_jface_lo = 0.25 * dxInv[2] * (
-                                p_arr(i,j,k+1) + p_arr(i,j-1,k+1)
-                                - p_arr(i,j,k-1) - p_arr(i,j-1,k-1) );
-                        }
-                        amrex::Real gpy_lo = gp_eta_lo - (met_h_eta_lo / met_h_zeta_lo) * gp_zeta_on_jface_lo;
-
-                        Real met_h_eta_hi  = Compute_h_eta_AtJface (i, j+1, k, dxInv, z_nd);
-                        Real met_h_zeta_hi = Compute_h_zeta_AtJface(i, j+1, k, dxInv, z_nd);
-                        Real gp_eta_hi = dxInv[1] * (p_arr(i,j+1,k) - p_arr(i,j,k));
-                        Real gp_zeta_on_jface_hi;
-                        if (k == klo) {
-                            gp_zeta_on_jface_hi = 0.5 * dxInv[2] * (
-                                p_arr(i,j+1,k+1) + p_arr(i,j,k+1)
-                                - p_arr(i,j+1,k  ) - p_arr(i,j,k  ) );
-                        } else if (k == khi) {
-                            gp_zeta_on_jface_hi = 0.5 * dxInv[2] * (
-                                p_arr(i,j+1,k  ) + p_arr(i,j,k  )
-                                - p_arr(i,j+1,k-1) - p_arr(i,j,k-1) );
-                        } else {
-                            gp_zeta_on_jface_hi = 0.25 * dxInv[2] * (
-                                p_arr(i,j+1,k+1) + p_arr(i,j,k+1)
-                                - p_arr(i,j+1,k-1) - p_arr(i,j,k-1) );
-                        }
-                        amrex::Real gpy_hi = gp_eta_hi - (met_h_eta_hi / met_h_zeta_hi) * gp_zeta_on_jface_hi;
-
-                        derdat(i ,j ,k, mf_comp) = 0.5 * (gpy_lo + gpy_hi);
-                    });
-                } else {
-                    ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
-                        derdat(i ,j ,k, mf_comp) = 0.5 * (p_arr(i,j+1,k) - p_arr(i,j-1,k)) * dxInv[1];
-                    });
+        if (plotfile_type == "amrex") {
+            r2[0] = IntVect(1,1,ref_ratio[0][0]);
+            for (int lev = 1; lev <= finest_level; ++lev) {
+                if (lev > 1) {
+                    r2[lev-1][0] = 1;
+                    r2[lev-1][1] = 1;
+                    r2[lev-1][2] = r2[lev-2][2] * ref_ratio[lev-1][0];
                 }
-            } // mf
-            mf_comp ++;
-        } // dpdy
-
-        if (containerHasElement(plot_var_names, "pres_hse_x"))
-        {
-            auto dxInv = geom[lev].InvCellSizeArray();
-#ifdef _OPENMP
-#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
-#endif
-            for ( MFIter mfi(mf[lev],TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                const Box& bx = mfi.tilebox();
-                const Array4<Real      >&  derdat = mf[lev].array(mfi);
-                const Array4<Real const>&   p_arr = p_hse.const_array(mfi);
-
-                //USE_TERRAIN POSSIBLE ISSUE HERE
-                const Array4<Real const>& z_nd  = z_phys_nd[lev]->const_array(mfi);
 
-                ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
-                    Real met_h_xi_lo   = Compute_h_xi_AtIface  (i, j, k, dxInv, z_nd);
-                    Real met_h_zeta_lo = Compute_h_zeta_AtIface(i, j, k, dxInv, z_nd);
-                    Real gp_xi_lo = dxInv[0] * (p_arr(i,j,k) - p_arr(i-1,j,k));
-                    Real gp_zeta_on_iface_lo;
-                    if (k == klo) {
-                      gp_zeta_on_iface_lo = 0.5 * dxInv[2] * (
-                                                              p_arr(i-1,j,k+1) + p_arr(i,j,k+1)
-                                                            - p_arr(i-1,j,k  ) - p_arr(i,j,k  ) );
-                    } else if (k == khi) {
-                      gp_zeta_on_iface_lo = 0.5 * dxInv[2] * (
-                                                              p_arr(i-1,j,k  ) + p_arr(i,j,k  )
-                                                            - p_arr(i-1,j,k-1) - p_arr(i,j,k-1) );
-                    } else {
-                      gp_zeta_on_iface_lo = 0.25 * dxInv[2] * (
-                                                               p_arr(i-1,j,k+1) + p_arr(i,j,k+1)
-                                                             - p_arr(i-1,j,k-1) - p_arr(i,j,k-1) );
-                    }
-                    amrex::Real gpx_lo = gp_xi_lo - (met_h_xi_lo/ met_h_zeta_lo) * gp_zeta_on_iface_lo;
+                mf2[lev].define(refine(grids[lev],r2[lev-1]), dmap[lev], ncomp_mf, 0);
 
-                    Real met_h_xi_hi   = Compute_h_xi_AtIface  (i+1, j, k, dxInv, z_nd);
-                    Real met_h_zeta_hi = Compute_h_zeta_AtIface(i+1, j, k, dxInv, z_nd);
-                    Real gp_xi_hi = dxInv[0] * (p_arr(i+1,j,k) - p_arr(i,j,k));
-                    Real gp_zeta_on_iface_hi;
-                    if (k == klo) {
-                      gp_zeta_on_iface_hi = 0.5 * dxInv[2] * (
-                                                              p_arr(i+1,j,k+1) + p_arr(i,j,k+1)
-                                                            - p_arr(i+1,j,k  ) - p_arr(i,j,k  ) );
-                    } else if (k == khi) {
-                      gp_zeta_on_iface_hi = 0.5 * dxInv[2] * (
-                                                              p_arr(i+1,j,k  ) + p_arr(i,j,k  )
-                                                            - p_arr(i+1,j,k-1) - p_arr(i,j,k-1) );
-                    } else {
-                      gp_zeta_on_iface_hi = 0.25 * dxInv[2] * (
-                                                               p_arr(i+1,j,k+1) + p_arr(i,j,k+1)
-                                                             - p_arr(i+1,j,k-1) - p_arr(i,j,k-1) );
-                    }
-                    amrex::Real gpx_hi = gp_xi_hi - (met_h_xi_hi/ met_h_zeta_hi) * gp_zeta_on_iface_hi;
+                // Set the new problem domain
+                Box d2(Geom()[lev].Domain());
+                d2.refine(r2[lev-1]);
 
-                    derdat(i ,j ,k, mf_comp) = 0.5 * (gpx_lo + gpx_hi);
-                });
+                g2[lev].define(d2,&(Geom()[lev].ProbDomain()),0,periodicity.data());
             }
-            mf_comp += 1;
-        } // pres_hse_x
 
-        if (containerHasElement(plot_var_names, "pres_hse_y"))
-        {
-            auto dxInv = geom[lev].InvCellSizeArray();
+            // Do piecewise interpolation of mf into mf2
+            for (int lev = 1; lev <= finest_level; ++lev) {
 #ifdef _OPENMP
 #pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
-            for ( MFIter mfi(mf[lev],TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                const Box& bx = mfi.tilebox();
-                const Array4<Real      >& derdat = mf[lev].array(mfi);
-                const Array4<Real const>&   p_arr = p_hse.const_array(mfi);
-                const Array4<Real const>& z_nd    = z_phys_nd[lev]->const_array(mfi);
-                ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
-                    Real met_h_eta_lo  = Compute_h_eta_AtJface (i, j, k, dxInv, z_nd);
-                    Real met_h_zeta_lo = Compute_h_zeta_AtJface(i, j, k, dxInv, z_nd);
-                    Real gp_eta_lo = dxInv[1] * (p_arr(i,j,k) - p_arr(i,j-1,k));
-                    Real gp_zeta_on_jface_lo;
-                    if (k == klo) {
-                      gp_zeta_on_jface_lo = 0.5 * dxInv[2] * (
-                                                              p_arr(i,j,k+1) + p_arr(i,j-1,k+1)
-                                                            - p_arr(i,j,k  ) - p_arr(i,j-1,k  ) );
-                    } else if (k == khi) {
-                      gp_zeta_on_jface_lo = 0.5 * dxInv[2] * (
-                                                              p_arr(i,j,k  ) + p_arr(i,j-1,k  )
-                                                            - p_arr(i,j,k-1) - p_arr(i,j-1,k-1) );
-                    } else {
-                      gp_zeta_on_jface_lo = 0.25 * dxInv[2] * (
-                                                               p_arr(i,j,k+1) + p_arr(i,j-1,k+1)
-                                                             - p_arr(i,j,k-1) - p_arr(i,j-1,k-1) );
-                    }
-                    amrex::Real gpy_lo = gp_eta_lo - (met_h_eta_lo / met_h_zeta_lo) * gp_zeta_on_jface_lo;
-
-                    Real met_h_eta_hi  = Compute_h_eta_AtJface (i, j+1, k, dxInv, z_nd);
-                    Real met_h_zeta_hi = Compute_h_zeta_AtJface(i, j+1, k, dxInv, z_nd);
-                    Real gp_eta_hi = dxInv[1] * (p_arr(i,j+1,k) - p_arr(i,j,k));
-                    Real gp_zeta_on_jface_hi;
-                    if (k == klo) {
-                      gp_zeta_on_jface_hi = 0.5 * dxInv[2] * (
-                                                              p_arr(i,j+1,k+1) + p_arr(i,j,k+1)
-                                                            - p_arr(i,j+1,k  ) - p_arr(i,j,k  ) );
-                    } else if (k == khi) {
-                      gp_zeta_on_jface_hi = 0.5 * dxInv[2] * (
-                                                              p_arr(i,j+1,k  ) + p_arr(i,j,k  )
-                                                            - p_arr(i,j+1,k-1) - p_arr(i,j,k-1) );
-                    } else {
-                      gp_zeta_on_jface_hi = 0.25 * dxInv[2] * (
-                                                               p_arr(i,j+1,k+1) + p_arr(i,j,k+1)
-                                                             - p_arr(i,j+1,k-1) - p_arr(i,j,k-1) );
-                    }
-                    amrex::Real gpy_hi = gp_eta_hi - (met_h_eta_hi / met_h_zeta_hi) * gp_zeta_on_jface_hi;
-
-                    derdat(i ,j ,k, mf_comp) = 0.5 * (gpy_lo + gpy_hi);
-                });
+                for (MFIter mfi(mf2[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+                    const Box& bx = mfi.tilebox();
+                    pcinterp_interp(bx,mf2[lev].array(mfi), 0, mf[lev].nComp(), mf[lev].const_array(mfi),0,r2[lev-1]);
+                }
             }
-            mf_comp += 1;
-        } // pres_hse_y
 
-        if (solverChoice.use_terrain) {
-            if (containerHasElement(plot_var_names, "z_phys"))
-            {
-                MultiFab::Copy(mf[lev],*z_phys_cc[lev],0,mf_comp,1,0);
-                mf_comp ++;
+            // Define an effective ref_ratio which is isotropic to be passed into WriteMultiLevelPlotfile
+            Vector<IntVect> rr(finest_level);
+            for (int lev = 0; lev < finest_level; ++lev) {
+                rr[lev] = IntVect(ref_ratio[lev][0],ref_ratio[lev][1],ref_ratio[lev][0]);
             }
 
-            if (containerHasElement(plot_var_names, "detJ"))
-            {
-                MultiFab::Copy(mf[lev],*detJ_cc[lev],0,mf_comp,1,0);
-                mf_comp ++;
+            amrex::Print() << "Writing plotfile " << plotfilename << "\n";
+            if (solverChoice.use_terrain) {
+                WriteMultiLevelPlotfileWithTerrain(plotfilename, finest_level+1,
+                                                   GetVecOfConstPtrs(mf),
+                                                   GetVecOfConstPtrs(mf_nd),
+                                                   varnames,
+                                                   t_new[0], istep);
+                nbytes = plot_data_bytes(GetVecOfConstPtrs(mf), bytes_per_value)
+                       + plot_data_bytes(GetVecOfConstPtrs(mf_nd), bytes_per_value);
+            } else {
+                WriteMultiLevelPlotfile(plotfilename, finest_level+1,
+                                        GetVecOfConstPtrs(mf2), varnames,
+                                        g2, t_new[0], istep, rr);
+                nbytes = plot_data_bytes(GetVecOfConstPtrs(mf2), bytes_per_value);
             }
-        } // use_terrain
 
-        if (containerHasElement(plot_var_names, "mapfac")) {
-#ifdef _OPENMP
-#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+            writeJobInfo(plotfilename);
+
+#ifdef ERF_USE_PARTICLES
+            if (use_tracer_particles) {
+                tracer_particles->Checkpoint(plotfilename, "tracers", true, tracer_particle_varnames);
+            }
+#endif
+#ifdef ERF_USE_NETCDF
+        } else if (plotfile_type == "netcdf" || plotfile_type == "NetCDF") {
+             for (int lev = 0; lev <= finest_level; ++lev) {
+                 for (int which_box = 0; which_box < num_boxes_at_level[lev]; which_box++) {
+                     writeNCPlotFile(lev, which_box, plotfilename, GetVecOfConstPtrs(mf), varnames, istep, t_new[0]);
+                 }
+             }
+             // The fields are stored as NC_FLOAT
+             nbytes = plot_data_bytes(GetVecOfConstPtrs(mf), sizeof(float));
 #endif
-            for ( MFIter mfi(mf[lev],TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                const Box& bx = mfi.tilebox();
-                const Array4<Real>& derdat = mf[lev].array(mfi);
-                const Array4<Real>& mf_m   = mapfac_m[lev]->array(mfi);
-                ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
-                   derdat(i ,j ,k, mf_comp) = mf_m(i,j,0);
-                });
-            }
-            mf_comp ++;
         }
+    } // end multi-level
 
-#if defined(ERF_USE_MOISTURE)
-        calculate_derived("qt",          derived::erf_derQt);
-        calculate_derived("qp",          derived::erf_derQp);
+    if (write_single) FArrayBox::setFormat(fab_format);
 
-        MultiFab qv_mf(qmoist[lev], make_alias, 0, 1);
-        MultiFab qc_mf(qmoist[lev], make_alias, 1, 1);
-        MultiFab qi_mf(qmoist[lev], make_alias, 2, 1);
-        MultiFab qr_mf(qmoist[lev], make_alias, 3, 1);
-        MultiFab qs_mf(qmoist[lev], make_alias, 4, 1);
-        MultiFab qg_mf(qmoist[lev], make_alias, 5, 1);
+    // Report what we wrote and how long it took (with amrex.async_out = 1 this is only the
+    //    time to hand the data to the I/O thread)
+    ParallelDescriptor::ReduceLongMax(nbytes, ParallelDescriptor::IOProcessorNumber());
+    Real t_write = amrex::second() - t_start;
+    ParallelDescriptor::ReduceRealMax(t_write, ParallelDescriptor::IOProcessorNumber());
+    amrex::Print() << "Wrote plotfile " << plotfilename << ": " << nbytes << " bytes of data in "
+                   << t_write << " s" << std::endl;
+}
 
-        if (containerHasElement(plot_var_names, "qv"))
-        {
-            MultiFab::Copy(mf[lev],qv_mf,0,mf_comp,1,0);
-            mf_comp += 1;
+// Write the region plotfiles that are due at this step; with at_end = true, write those
+//    that have not yet been written at this step
+void
+ERF::WriteRegionPlotFiles (int nstep, bool at_end)
+{
+    for (auto& reg : plot_regions) {
+        if (reg.interval <= 0 || reg.var_names.empty()) continue;
+        const bool due = at_end ? (nstep > reg.last_step) : (nstep % reg.interval == 0);
+        if (due) {
+            reg.last_step = nstep;
+            WriteRegionPlotFile(reg);
         }
+    }
+}
 
-        if (containerHasElement(plot_var_names, "qc"))
-        {
-            MultiFab::Copy(mf[lev],qc_mf,0,mf_comp,1,0);
-            mf_comp += 1;
-        }
+// Write a single-level plotfile of the part of a level inside the region, keeping every
+//    stride-th cell in each direction
+void
+ERF::WriteRegionPlotFile (const PlotRegion& reg)
+{
+    BL_PROFILE("ERF::WriteRegionPlotFile()");
+    const Real t_start = amrex::second();
 
-        if (containerHasElement(plot_var_names, "qi"))
-        {
-            MultiFab::Copy(mf[lev],qi_mf,0,mf_comp,1,0);
-            mf_comp += 1;
+    if (reg.lev > finest_level) {
+        Warning("Plot region " + reg.name + ": level " + std::to_string(reg.lev)
+                + " does not exist yet, writing level " + std::to_string(finest_level));
+    }
+    const int lev   = std::min(reg.lev, finest_level);
+    const int ncomp = reg.var_names.size();
+
+    // Cells of this level whose centres lie inside the region
+    const auto dx  = geom[lev].CellSizeArray();
+    const auto plo = geom[lev].ProbLoArray();
+    IntVect lo_idx, hi_idx;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        lo_idx[d] = static_cast<int>(std::ceil ((reg.box.lo(d) - plo[d]) / dx[d] - 0.5));
+        hi_idx[d] = static_cast<int>(std::floor((reg.box.hi(d) - plo[d]) / dx[d] - 0.5));
+    }
+    const Box roi = Box(lo_idx, hi_idx) & geom[lev].Domain();
+    if (roi.isEmpty()) {
+        Warning("Plot region " + reg.name + " does not contain any cells at level " + std::to_string(lev));
+        return;
+    }
+
+    // Cells of the region that the level does not cover are written as zero
+    if (!grids[lev].contains(roi)) {
+        Warning("Plot region " + reg.name + " is not fully covered by level " + std::to_string(lev)
+                + "; the cells outside its grids are written as zero");
+    }
+
+    // The plot variables on the pieces of the level grids inside the region, on the ranks
+    //    that own them. Variables that are not evaluated cell by cell need the whole level.
+    bool pointwise = true;
+    for (const auto& name : reg.var_names) {
+        pointwise = pointwise && (containerHasElement(cons_names, name) ||
+                                  containerHasElement(pointwise_plot_names, name));
+    }
+    MultiFab mf;
+    Vector<int> parent;
+    if (pointwise) {
+        BoxList bl;
+        Vector<int> owner;
+        for (const auto& is : grids[lev].intersections(roi)) {
+            bl.push_back(is.second);
+            parent.push_back(is.first);
+            owner.push_back(dmap[lev][is.first]);
         }
+        mf.define(BoxArray(std::move(bl)), DistributionMapping(std::move(owner)), ncomp, 0);
+        ComputePlotVars(lev, reg.var_names, mf, &parent);
+    } else {
+        FillPatch(lev, t_new[lev], {&vars_new[lev][Vars::cons], &vars_new[lev][Vars::xvel],
+                                    &vars_new[lev][Vars::yvel], &vars_new[lev][Vars::zvel]});
+        mf.define(grids[lev], dmap[lev], ncomp, 0);
+        ComputePlotVars(lev, reg.var_names, mf);
+    }
 
-        if (containerHasElement(plot_var_names, "qrain"))
-        {
-            MultiFab::Copy(mf[lev],qr_mf,0,mf_comp,1,0);
-            mf_comp += 1;
+    // Output cell (i,j,k) is cell roi.smallEnd() + stride * (i,j,k) of the level
+    const IntVect s = reg.stride;
+    const IntVect rlo = roi.smallEnd();
+    const IntVect nout = (roi.length() + s - 1) / s;
+    const Box out_domain(IntVect(0), nout - 1);
+
+    // The output cells each box of mf holds, picked out on the rank that owns it so only
+    //    those are sent
+    BoxList bl_pick;
+    Vector<int> pick_src;
+    Vector<int> pick_owner;
+    for (int n = 0; n < mf.boxArray().size(); ++n) {
+        const Box b = mf.boxArray()[n] & roi;
+        if (!b.ok()) continue;
+        IntVect plo_out, phi_out;
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+            plo_out[d] = (b.smallEnd(d) - rlo[d] + s[d] - 1) / s[d];
+            phi_out[d] = (b.bigEnd(d)   - rlo[d]) / s[d];
+        }
+        const Box pbx(plo_out, phi_out);
+        if (pbx.ok()) {
+            bl_pick.push_back(pbx);
+            pick_src.push_back(n);
+            pick_owner.push_back(mf.DistributionMap()[n]);
         }
+    }
 
-        if (containerHasElement(plot_var_names, "qsnow"))
-        {
-            MultiFab::Copy(mf[lev],qs_mf,0,mf_comp,1,0);
-            mf_comp += 1;
+    BoxArray ba_out(out_domain);
+    ba_out.maxSize(maxGridSize(lev));
+    DistributionMapping dm_out(ba_out);
+    MultiFab mf_out(ba_out, dm_out, ncomp, 0);
+    mf_out.setVal(0.0);
+
+    if (!bl_pick.isEmpty())
+    {
+        MultiFab mf_pick(BoxArray(std::move(bl_pick)), DistributionMapping(std::move(pick_owner)), ncomp, 0);
+#ifdef _OPENMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+        for (MFIter mfi(mf_pick, TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+            const Box& bx = mfi.tilebox();
+            const Array4<Real      >& dst = mf_pick.array(mfi);
+            const Array4<Real const>& src = mf.const_array(pick_src[mfi.index()]);
+            ParallelFor(bx, ncomp, [=] AMREX_GPU_DEVICE (int i, int j, int k, int n) noexcept {
+                dst(i,j,k,n) = src(rlo[0]+s[0]*i, rlo[1]+s[1]*j, rlo[2]+s[2]*k, n);
+            });
         }
+        mf_out.ParallelCopy(mf_pick, 0, 0, ncomp);
+    }
 
-        if (containerHasElement(plot_var_names, "qgraup"))
-        {
-            MultiFab::Copy(mf[lev],qg_mf,0,mf_comp,1,0);
-            mf_comp += 1;
+    // Place the output cells at the centres of the cells they were taken from
+    RealBox rb_out;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        rb_out.setLo(d, plo[d] + (rlo[d] + 0.5 - 0.5 * s[d]) * dx[d]);
+        rb_out.setHi(d, rb_out.lo(d) + nout[d] * s[d] * dx[d]);
+    }
+    const Geometry geom_out(out_domain, rb_out, geom[lev].Coord(), Array<int,AMREX_SPACEDIM>{AMREX_D_DECL(0,0,0)});
+
+    const std::string plotfilename = Concatenate(reg.file, istep[0], 5);
+    amrex::Print() << "Writing region plotfile " << plotfilename << "\n";
+    WriteSingleLevelPlotfile(plotfilename, mf_out, reg.var_names, geom_out, t_new[lev], istep[lev]);
+
+    const Long nbytes = plot_data_bytes({&mf_out}, sizeof(Real));
+    Real t_write = amrex::second() - t_start;
+    ParallelDescriptor::ReduceRealMax(t_write, ParallelDescriptor::IOProcessorNumber());
+    amrex::Print() << "Wrote plotfile " << plotfilename << ": " << nbytes << " bytes of data in "
+                   << t_write << " s" << std::endl;
+}
+
+// Abort unless every variable is a state variable or a derived quantity evaluated cell by
+//    cell, i.e. one that ComputePlotVars can fill on part of a level
+void
+ERF::CheckPointwisePlotVars (const std::string& what, const Vector<std::string>& plot_var_names) const
+{
+    for (const auto& name : plot_var_names) {
+        if (!containerHasElement(cons_names, name) && !containerHasElement(pointwise_plot_names, name)) {
+            Abort(what + " " + name + " is only available for the whole level");
         }
-#elif defined(ERF_USE_WARM_NO_PRECIP)
-        calculate_derived("qv",          derived::erf_derQv);
-        calculate_derived("qc",          derived::erf_derQc);
-#endif
+    }
+}
 
-#ifdef ERF_COMPUTE_ERROR
-        // Next, check for error in velocities and if desired, output them -- note we output none or all, not just some
-        if (containerHasElement(plot_var_names, "xvel_err") ||
-            containerHasElement(plot_var_names, "yvel_err") ||
-            containerHasElement(plot_var_names, "zvel_err"))
-        {
-            //
-            // Moving terrain ANALYTICAL
-            //
-            Real H           = geom[lev].ProbHi()[2];
-            Real Ampl        = 0.16;
-            Real wavelength  = 100.;
-            Real kp          = 2. * PI / wavelength;
-            Real g           = CONST_GRAV;
-            Real omega       = std::sqrt(g * kp);
-            Real omega_t     = omega * t_new[lev];
+// Fill the plot variables (state, velocities and derived quantities) at this level into mf.
+//    If parent is given, mf only covers part of the level: box n of mf lies inside box
+//    (*parent)[n] of the level grids, on the same rank, and only the pointwise variables
+//    are available.
+void
+ERF::ComputePlotVars (int lev, const Vector<std::string>& plot_var_names, MultiFab& mf,
+                      const Vector<int>* parent)
+{
+    AMREX_ALWAYS_ASSERT(mf.nComp() == plot_var_names.size());
+    AMREX_ALWAYS_ASSERT(cons_names.size() == Cons::NumVars);
+
+    // Component of mf holding each plot variable (-1 if it is not requested)
+    auto plot_comp = [&] (const std::string& name) -> int {
+        auto it = std::find(plot_var_names.begin(), plot_var_names.end(), name);
+        return (it == plot_var_names.end()) ? -1 : static_cast<int>(it - plot_var_names.begin());
+    };
+
+    GpuArray<int,Cons::NumVars> cons_comp;
+    for (int n = 0; n < Cons::NumVars; ++n) {
+        cons_comp[n] = plot_comp(cons_names[n]);
+    }
 
-            const auto dx = geom[lev].CellSizeArray();
+    GpuArray<int,PlotVar::NumVars> comp;
+    bool any_pointwise = false;
+    for (int n = 0; n < Cons::NumVars; ++n) {
+        any_pointwise = any_pointwise || (cons_comp[n] >= 0);
+    }
+    for (int n = 0; n < PlotVar::NumVars; ++n) {
+        comp[n] = plot_comp(pointwise_plot_names[n]);
+        any_pointwise = any_pointwise || (comp[n] >= 0);
+    }
+
+    if (parent) CheckPointwisePlotVars("Plot variable", plot_var_names);
+
+    // Everything that only needs the state at a point (and the neighboring faces for the
+    //    velocities) is evaluated in a single pass over each tile, sharing rho, theta and
+    //    the dry pressure between the quantities
+    if (any_pointwise)
+    {
+        const bool need_p = (comp[PlotVar::pressure]  >= 0) || (comp[PlotVar::soundspeed] >= 0) ||
+                            (comp[PlotVar::pert_pres] >= 0);
+        const bool use_terrain = solverChoice.use_terrain;
 
 #ifdef _OPENMP
 #pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
-            for (MFIter mfi(mf[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                const Box& bx = mfi.validbox();
-                Box xbx(bx); xbx.surroundingNodes(0);
-                const Array4<Real> xvel_arr = vars_new[lev][Vars::xvel].array(mfi);
-                const Array4<Real> zvel_arr = vars_new[lev][Vars::zvel].array(mfi);
+        for (MFIter mfi(mf, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.tilebox();
+            const Array4<Real>& derdat = mf.array(mfi);
+
+            // Index of the level box this tile lies in
+            const int src = parent ? (*parent)[mfi.index()] : mfi.index();
+
+            const Array4<Real const>& S_arr  = vars_new[lev][Vars::cons].const_array(src);
+            const Array4<Real const>& u_arr  = vars_new[lev][Vars::xvel].const_array(src);
+            const Array4<Real const>& v_arr  = vars_new[lev][Vars::yvel].const_array(src);
+            const Array4<Real const>& w_arr  = vars_new[lev][Vars::zvel].const_array(src);
+            const Array4<Real const>& hse    = base_state[lev].const_array(src); // r_0, p_0
+            const Array4<Real const>& mf_m   = mapfac_m[lev]->const_array(src);
+            const Array4<Real const>  z_cc   = use_terrain ? z_phys_cc[lev]->const_array(src) : Array4<Real const>{};
+            const Array4<Real const>  dJ_cc  = use_terrain ?   detJ_cc[lev]->const_array(src) : Array4<Real const>{};
+#if defined(ERF_USE_MOISTURE)
+            const Array4<Real const>& qm_arr = qmoist[lev].const_array(src);
+#endif
 
-                const Array4<Real const>& z_nd = z_phys_nd[lev]->const_array(mfi);
+            ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+            {
+                for (int n = 0; n < Cons::NumVars; ++n) {
+                    if (cons_comp[n] >= 0) derdat(i,j,k,cons_comp[n]) = S_arr(i,j,k,n);
+                }
 
-                ParallelFor(xbx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
-                {
-                    Real x = i * dx[0];
-                    Real z = 0.25 * (z_nd(i,j,k) + z_nd(i,j+1,k) + z_nd(i,j,k+1) + z_nd(i,j+1,k+1));
+                if (comp[PlotVar::x_velocity] >= 0) {
+                    derdat(i,j,k,comp[PlotVar::x_velocity]) = 0.5 * (u_arr(i,j,k) + u_arr(i+1,j,k));
+                }
+                if (comp[PlotVar::y_velocity] >= 0) {
+                    derdat(i,j,k,comp[PlotVar::y_velocity]) = 0.5 * (v_arr(i,j,k) + v_arr(i,j+1,k));
+                }
+                if (comp[PlotVar::z_velocity] >= 0) {
+                    derdat(i,j,k,comp[PlotVar::z_velocity]) = 0.5 * (w_arr(i,j,k) + w_arr(i,j,k+1));
+                }
 
-                    Real z_base = Ampl * std::sin(kp * x - omega_t);
-                    z -= z_base;
+                const Real rho      = S_arr(i,j,k,Rho_comp);
+                const Real rhotheta = S_arr(i,j,k,RhoTheta_comp);
 
-                    Real fac = std::cosh( kp * (z - H) ) / std::sinh(kp * H);
+                // Pressure of the dry air
+                Real p_dry = 0.0;
+                if (need_p) {
+                    AMREX_ALWAYS_ASSERT(rhotheta > 0.);
+                    p_dry = getPgivenRTh(rhotheta);
+                }
 
-                    xvel_arr(i,j,k) -= -Ampl * omega * fac * std::sin(kp * x - omega_t);
-                });
+                if (comp[PlotVar::pressure] >= 0) {
+#if defined(ERF_USE_WARM_NO_PRECIP)
+                    derdat(i,j,k,comp[PlotVar::pressure]) = getPgivenRTh(rhotheta, S_arr(i,j,k,RhoQv_comp)/rho);
+#else
+                    // With ERF_USE_MOISTURE this is only the partial pressure of the dry air
+                    derdat(i,j,k,comp[PlotVar::pressure]) = p_dry;
+#endif
+                }
+                if (comp[PlotVar::soundspeed] >= 0) {
+                    // Sound speed of dry air -- we do not account for any moisture effects here
+                    derdat(i,j,k,comp[PlotVar::soundspeed]) = std::sqrt(Gamma * p_dry / rho);
+                }
+                if (comp[PlotVar::temp] >= 0) {
+                    AMREX_ALWAYS_ASSERT(rhotheta > 0.);
+                    derdat(i,j,k,comp[PlotVar::temp]) = getTgivenRandRTh(rho, rhotheta);
+                }
+                if (comp[PlotVar::theta]  >= 0) derdat(i,j,k,comp[PlotVar::theta])  = rhotheta / rho;
+                if (comp[PlotVar::KE]     >= 0) derdat(i,j,k,comp[PlotVar::KE])     = S_arr(i,j,k,RhoKE_comp) / rho;
+                if (comp[PlotVar::QKE]    >= 0) derdat(i,j,k,comp[PlotVar::QKE])    = S_arr(i,j,k,RhoQKE_comp) / rho;
+                if (comp[PlotVar::scalar] >= 0) derdat(i,j,k,comp[PlotVar::scalar]) = S_arr(i,j,k,RhoScalar_comp) / rho;
 
-                ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
-                {
-                    Real x   = (i + 0.5) * dx[0];
-                    Real z   = 0.25 * ( z_nd(i,j,k) + z_nd(i+1,j,k) + z_nd(i,j+1,k) + z_nd(i+1,j+1,k));
+                if (comp[PlotVar::pres_hse]  >= 0) derdat(i,j,k,comp[PlotVar::pres_hse])  = hse(i,j,k,1);
+                if (comp[PlotVar::dens_hse]  >= 0) derdat(i,j,k,comp[PlotVar::dens_hse])  = hse(i,j,k,0);
+                if (comp[PlotVar::pert_pres] >= 0) derdat(i,j,k,comp[PlotVar::pert_pres]) = p_dry - hse(i,j,k,1);
+                if (comp[PlotVar::pert_dens] >= 0) derdat(i,j,k,comp[PlotVar::pert_dens]) = rho   - hse(i,j,k,0);
 
-                    Real z_base = Ampl * std::sin(kp * x - omega_t);
-                    z -= z_base;
+                if (comp[PlotVar::z_phys] >= 0) derdat(i,j,k,comp[PlotVar::z_phys]) = z_cc(i,j,k);
+                if (comp[PlotVar::detJ]   >= 0) derdat(i,j,k,comp[PlotVar::detJ])   = dJ_cc(i,j,k);
+                if (comp[PlotVar::mapfac] >= 0) derdat(i,j,k,comp[PlotVar::mapfac]) = mf_m(i,j,0);
 
-                    Real fac = std::sinh( kp * (z - H) ) / std::sinh(kp * H);
+#if defined(ERF_USE_MOISTURE)
+                if (comp[PlotVar::qt]     >= 0) derdat(i,j,k,comp[PlotVar::qt])     = S_arr(i,j,k,RhoQt_comp) / rho;
+                if (comp[PlotVar::qp]     >= 0) derdat(i,j,k,comp[PlotVar::qp])     = S_arr(i,j,k,RhoQp_comp) / rho;
+                if (comp[PlotVar::qv]     >= 0) derdat(i,j,k,comp[PlotVar::qv])     = qm_arr(i,j,k,0);
+                if (comp[PlotVar::qc]     >= 0) derdat(i,j,k,comp[PlotVar::qc])     = qm_arr(i,j,k,1);
+                if (comp[PlotVar::qi]     >= 0) derdat(i,j,k,comp[PlotVar::qi])     = qm_arr(i,j,k,2);
+                if (comp[PlotVar::qrain]  >= 0) derdat(i,j,k,comp[PlotVar::qrain])  = qm_arr(i,j,k,3);
+                if (comp[PlotVar::qsnow]  >= 0) derdat(i,j,k,comp[PlotVar::qsnow])  = qm_arr(i,j,k,4);
+                if (comp[PlotVar::qgraup] >= 0) derdat(i,j,k,comp[PlotVar::qgraup]) = qm_arr(i,j,k,5);
+#elif defined(ERF_USE_WARM_NO_PRECIP)
+                if (comp[PlotVar::qv]     >= 0) derdat(i,j,k,comp[PlotVar::qv])     = S_arr(i,j,k,RhoQv_comp) / rho;
+                if (comp[PlotVar::qc]     >= 0) derdat(i,j,k,comp[PlotVar::qc])     = S_arr(i,j,k,RhoQc_comp) / rho;
+#endif
+            });
+        }
+    }
 
-                    zvel_arr(i,j,k) -= Ampl * omega * fac * std::cos(kp * x - omega_t);
-                });
-            }
+    MultiFab p_hse(base_state[lev], make_alias, 1, 1); // p_0 is second component
+#ifdef ERF_COMPUTE_ERROR
+    MultiFab r_hse(base_state[lev], make_alias, 0, 1); // r_0 is first  component
+#endif
 
-            MultiFab temp_mf(mf[lev].boxArray(), mf[lev].DistributionMap(), AMREX_SPACEDIM, 0);
-            average_face_to_cellcenter(temp_mf,0,
-                Array<const MultiFab*,3>{&vars_new[lev][Vars::xvel],&vars_new[lev][Vars::yvel],&vars_new[lev][Vars::zvel]});
+    // The pressure gradients share the dry pressure, with one ghost cell
+    MultiFab pres;
+    if (plot_comp("dpdx") >= 0 || plot_comp("dpdy") >= 0)
+    {
+        pres.define(vars_new[lev][Vars::cons].boxArray(), vars_new[lev][Vars::cons].DistributionMap(), 1, 1);
+#ifdef _OPENMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+        for ( MFIter mfi(pres,TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& gbx = mfi.growntilebox(1);
+            const Array4<Real> & p_arr  = pres.array(mfi);
+            const Array4<Real const>& S_arr = vars_new[lev][Vars::cons].const_array(mfi);
+            amrex::ParallelFor(gbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
+                p_arr(i,j,k) = getPgivenRTh(S_arr(i,j,k,RhoTheta_comp));
+            });
+        }
+        pres.FillBoundary(geom[lev].periodicity());
+    }
 
-            if (containerHasElement(plot_var_names, "xvel_err")) {
-                MultiFab::Copy(mf[lev],temp_mf,0,mf_comp,1,0);
-                mf_comp += 1;
-            }
-            if (containerHasElement(plot_var_names, "yvel_err")) {
-                MultiFab::Copy(mf[lev],temp_mf,1,mf_comp,1,0);
-                mf_comp += 1;
-            }
-            if (containerHasElement(plot_var_names, "zvel_err")) {
-                MultiFab::Copy(mf[lev],temp_mf,2,mf_comp,1,0);
-                mf_comp += 1;
-            }
+    int klo = geom[lev].Domain().smallEnd(2);
+    int khi = geom[lev].Domain().bigEnd(2);
 
-            // Now restore the velocities to what they were
+    if (containerHasElement(plot_var_names, "dpdx"))
+    {
+        const int mf_comp = plot_comp("dpdx");
+        auto dxInv = geom[lev].InvCellSizeArray();
 #ifdef _OPENMP
 #pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
-            for (MFIter mfi(mf[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                const Box& bx = mfi.validbox();
-                Box xbx(bx); xbx.surroundingNodes(0);
-
-                const Array4<Real> xvel_arr = vars_new[lev][Vars::xvel].array(mfi);
-                const Array4<Real> zvel_arr = vars_new[lev][Vars::zvel].array(mfi);
+        for ( MFIter mfi(mf,TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            // Now compute pressure gradient on valid box
+            const Box& bx = mfi.tilebox();
+            const Array4<Real>& derdat = mf.array(mfi);
+            const Array4<Real> & p_arr  = pres.array(mfi);
 
+            if (solverChoice.use_terrain) {
                 const Array4<Real const>& z_nd = z_phys_nd[lev]->const_array(mfi);
 
-                ParallelFor(xbx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
-                {
-                    Real x = i * dx[0];
-                    Real z = 0.25 * (z_nd(i,j,k) + z_nd(i,j+1,k) + z_nd(i,j,k+1) + z_nd(i,j+1,k+1));
-                    Real z_base = Ampl * std::sin(kp * x - omega_t);
-
-                    z -= z_base;
+                ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
 
-                    Real fac = std::cosh( kp * (z - H) ) / std::sinh(kp * H);
-                    xvel_arr(i,j,k) += -Ampl * omega * fac * std::sin(kp * x - omega_t);
-                });
-                ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
-                {
-                    Real x   = (i + 0.5) * dx[0];
-                    Real z   = 0.25 * ( z_nd(i,j,k) + z_nd(i+1,j,k) + z_nd(i,j+1,k) + z_nd(i+1,j+1,k));
-                    Real z_base = Ampl * std::sin(kp * x - omega_t);
+                    // Pgrad at lower I face
+                    Real met_h_xi_lo   = Compute_h_xi_AtIface  (i, j, k, dxInv, z_nd);
+                    Real met_h_zeta_lo = Compute_h_zeta_AtIface(i, j, k, dxInv, z_nd);
+                    Real gp_xi_lo = dxInv[0] * (p_arr(i,j,k) - p_arr(i-1,j,k));
+                    Real gp_zeta_on_iface_lo;
+                    if(k == klo) {
+                        gp_zeta_on_iface_lo = 0.5 * dxInv[2] * (
+                            p_arr(i-1,j,k+1) + p_arr(i,j,k+1)
+                            - p_arr(i-1,j,k  ) - p_arr(i,j,k  ) );
+                    } else if (k == khi) {
+                        gp_zeta_on_iface_lo = 0.5 * dxInv[2] * (
+                            p_arr(i-1,j,k  ) + p_arr(i,j,k  )
+                            - p_arr(i-1,j,k-1) - p_arr(i,j,k-1) );
+                    } else {
+                        gp_zeta_on_iface_lo = 0.25 * dxInv[2] * (
+                            p_arr(i-1,j,k+1) + p_arr(i,j,k+1)
+                            - p_arr(i-1,j,k-1) - p_arr(i,j,k-1) );
+                    }
+                    amrex::Real gpx_lo = gp_xi_lo - (met_h_xi_lo/ met_h_zeta_lo) * gp_zeta_on_iface_lo;
 
-                    z -= z_base;
-                    Real fac = std::sinh( kp * (z - H) ) / std::sinh(kp * H);
+                    // Pgrad at higher I face
+                    Real met_h_xi_hi   = Compute_h_xi_AtIface  (i+1, j, k, dxInv, z_nd);
+                    Real met_h_zeta_hi = Compute_h_zeta_AtIface(i+1, j, k, dxInv, z_nd);
+                    Real gp_xi_hi = dxInv[0] * (p_arr(i+1,j,k) - p_arr(i,j,k));
+                    Real gp_zeta_on_iface_hi;
+                    if(k == klo) {
+                        gp_zeta_on_iface_hi = 0.5 * dxInv[2] * (
+                            p_arr(i+1,j,k+1) + p_arr(i,j,k+1)
+                            - p_arr(i+1,j,k  ) - p_arr(i,j,k  ) );
+                    } else if (k == khi) {
+                        gp_zeta_on_iface_hi = 0.5 * dxInv[2] * (
+                            p_arr(i+1,j,k  ) + p_arr(i,j,k  )
+                            - p_arr(i+1,j,k-1) - p_arr(i,j,k-1) );
+                    } else {
+                        gp_zeta_on_iface_hi = 0.25 * dxInv[2] * (
+                            p_arr(i+1,j,k+1) + p_arr(i,j,k+1)
+                            - p_arr(i+1,j,k-1) - p_arr(i,j,k-1) );
+                    }
+                    amrex::Real gpx_hi = gp_xi_hi - (met_h_xi_hi/ met_h_zeta_hi) * gp_zeta_on_iface_hi;
 
-                    zvel_arr(i,j,k) += Ampl * omega * fac * std::cos(kp * x - omega_t);
+                    // Average P grad to CC
+                    derdat(i ,j ,k, mf_comp) = 0.5 * (gpx_lo + gpx_hi);
+                });
+            } else {
+                ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+                    derdat(i ,j ,k, mf_comp) = 0.5 * (p_arr(i+1,j,k) - p_arr(i-1,j,k)) * dxInv[0];
                 });
             }
-        } // end xvel_err, yvel_err, zvel_err
+        } // mfi
+    } // dpdx
 
-        if (containerHasElement(plot_var_names, "pp_err"))
-        {
-            // Moving terrain ANALYTICAL
+    if (containerHasElement(plot_var_names, "dpdy"))
+    {
+        const int mf_comp = plot_comp("dpdy");
+        auto dxInv = geom[lev].InvCellSizeArray();
 #ifdef _OPENMP
 #pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
-            for ( MFIter mfi(mf[lev],TilingIfNotGPU()); mfi.isValid(); ++mfi)
-            {
-                const Box& bx = mfi.tilebox();
-                const Array4<Real>& derdat = mf[lev].array(mfi);
-                const Array4<Real const>& p0_arr = p_hse.const_array(mfi);
-                const Array4<Real const>& S_arr = vars_new[lev][Vars::cons].const_array(mfi);
+        for ( MFIter mfi(mf,TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            // Now compute pressure gradient on valid box
+            const Box& bx = mfi.tilebox();
+            const Array4<Real>& derdat = mf.array(mfi);
+            const Array4<Real> & p_arr  = pres.array(mfi);
 
-                const auto dx = geom[lev].CellSizeArray();
+            if (solverChoice.use_terrain) {
                 const Array4<Real const>& z_nd = z_phys_nd[lev]->const_array(mfi);
-                const Array4<Real const>& r0_arr = r_hse.const_array(mfi);
-
-                Real H           = geom[lev].ProbHi()[2];
-                Real Ampl        = 0.16;
-                Real wavelength  = 100.;
-                Real kp          = 2. * PI / wavelength;
-                Real g           = CONST_GRAV;
-                Real omega       = std::sqrt(g * kp);
-                Real omega_t     = omega * t_new[lev];
-
-                ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept
-                {
-                    const Real rhotheta = S_arr(i,j,k,RhoTheta_comp);
-                    derdat(i, j, k, mf_comp) = getPgivenRTh(rhotheta) - p0_arr(i,j,k);
-
-                    Real rho_hse     = r0_arr(i,j,k);
-
-                    Real x   = (i + 0.5) * dx[0];
-                    Real z   = 0.125 * ( z_nd(i,j,k  ) + z_nd(i+1,j,k  ) + z_nd(i,j+1,k  ) + z_nd(i+1,j+1,k  )
-                                        +z_nd(i,j,k+1) + z_nd(i+1,j,k+1) + z_nd(i,j+1,k+1) + z_nd(i+1,j+1,k+1) );
-                    Real z_base = Ampl * std::sin(kp * x - omega_t);
-
-                    z -= z_base;
-                    Real fac = std::cosh( kp * (z - H) ) / std::sinh(kp * H);
-                    Real pprime_exact = -(Ampl * omega * omega / kp) * fac *
-                                              std::sin(kp * x - omega_t) * r0_arr(i,j,k);
-
-                    derdat(i,j,k,mf_comp) -= pprime_exact;
+
+                ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+
+                    Real met_h_eta_lo  = Compute_h_eta_AtJface (i, j, k, dxInv, z_nd);
+                    Real met_h_zeta_lo = Compute_h_zeta_AtJface(i, j, k, dxInv, z_nd);
+                    Real gp_eta_lo = dxInv[1] * (p_arr(i,j,k) - p_arr(i,j-1,k));
+                    Real gp_zeta_on_jface_lo;
+                    if (k == klo) {
+                        gp_zeta_on_jface_lo = 0.5 * dxInv[2] * (
+                            p_arr(i,j,k+1) + p_arr(i,j-1,k+1)
+                            - p_arr(i,j,k  ) - p_arr(i,j-1,k  ) );
+                    } else if (k == khi) {
+                        gp_zeta_on_jface_lo = 0.5 * dxInv[2] * (
+                            p_arr(i,j,k  ) + p_arr(i,j-1,k  )
+                            - p_arr(i,j,k-1) - p_arr(i,j-1,k-1) );
+                    } else {
+                        gp_zeta_on_jface_lo = 0.25 * dxInv[2] * (
+                            p_arr(i,j,k+1) + p_arr(i,j-1,k+1)
+                            - p_arr(i,j,k-1) - p_arr(i,j-1,k-1) );
+                    }
+                    amrex::Real gpy_lo = gp_eta_lo - (met_h_eta_lo / met_h_zeta_lo) * gp_zeta_on_jface_lo;
+
+                    Real met_h_eta_hi  = Compute_h_eta_AtJface (i, j+1, k, dxInv, z_nd);
+                    Real met_h_zeta_hi = Compute_h_zeta_AtJface(i, j+1, k, dxInv, z_nd);
+                    Real gp_eta_hi = dxInv[1] * (p_arr(i,j+1,k) - p_arr(i,j,k));
+                    Real gp_zeta_on_jface_hi;
+                    if (k == klo) {
+                        gp_zeta_on_jface_hi = 0.5 * dxInv[2] * (
+                            p_arr(i,j+1,k+1) + p_arr(i,j,k+1)
+                            - p_arr(i,j+1,k  ) - p_arr(i,j,k  ) );
+                    } else if (k == khi) {
+                        gp_zeta_on_jface_hi = 0.5 * dxInv[2] * (
+                            p_arr(i,j+1,k  ) + p_arr(i,j,k  )
+                            - p_arr(i,j+1,k-1) - p_arr(i,j,k-1) );
+                    } else {
+                        gp_zeta_on_jface_hi = 0.25 * dxInv[2] * (
+                            p_arr(i,j+1,k+1) + p_arr(i,j,k+1)
+                            - p_arr(i,j+1,k-1) - p_arr(i,j,k-1) );
+                    }
+                    amrex::Real gpy_hi = gp_eta_hi - (met_h_eta_hi / met_h_zeta_hi) * gp_zeta_on_jface_hi;
+
+                    derdat(i ,j ,k, mf_comp) = 0.5 * (gpy_lo + gpy_hi);
+                });
+            } else {
+                ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+                    derdat(i ,j ,k, mf_comp) = 0.5 * (p_arr(i,j+1,k) - p_arr(i,j-1,k)) * dxInv[1];
                 });
             }
-            mf_comp += 1;
-        }
+        } // mf
+    } // dpdy
+
+    if (containerHasElement(plot_var_names, "pres_hse_x"))
+    {
+        const int mf_comp = plot_comp("pres_hse_x");
+        auto dxInv = geom[lev].InvCellSizeArray();
+#ifdef _OPENMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
-    }
+        for ( MFIter mfi(mf,TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.tilebox();
+            const Array4<Real      >&  derdat = mf.array(mfi);
+            const Array4<Real const>&   p_arr = p_hse.const_array(mfi);
+
+            //USE_TERRAIN POSSIBLE ISSUE HERE
+            const Array4<Real const>& z_nd  = z_phys_nd[lev]->const_array(mfi);
+
+            ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+                Real met_h_xi_lo   = Compute_h_xi_AtIface  (i, j, k, dxInv, z_nd);
+                Real met_h_zeta_lo = Compute_h_zeta_AtIface(i, j, k, dxInv, z_nd);
+                Real gp_xi_lo = dxInv[0] * (p_arr(i,j,k) - p_arr(i-1,j,k));
+                Real gp_zeta_on_iface_lo;
+                if (k == klo) {
+                  gp_zeta_on_iface_lo = 0.5 * dxInv[2] * (
+                                                          p_arr(i-1,j,k+1) + p_arr(i,j,k+1)
+                                                        - p_arr(i-1,j,k  ) - p_arr(i,j,k  ) );
+                } else if (k == khi) {
+                  gp_zeta_on_iface_lo = 0.5 * dxInv[2] * (
+                                                          p_arr(i-1,j,k  ) + p_arr(i,j,k  )
+                                                        - p_arr(i-1,j,k-1) - p_arr(i,j,k-1) );
+                } else {
+                  gp_zeta_on_iface_lo = 0.25 * dxInv[2] * (
+                                                           p_arr(i-1,j,k+1) + p_arr(i,j,k+1)
+                                                         - p_arr(i-1,j,k-1) - p_arr(i,j,k-1) );
+                }
+                amrex::Real gpx_lo = gp_xi_lo - (met_h_xi_lo/ met_h_zeta_lo) * gp_zeta_on_iface_lo;
+
+                Real met_h_xi_hi   = Compute_h_xi_AtIface  (i+1, j, k, dxInv, z_nd);
+                Real met_h_zeta_hi = Compute_h_zeta_AtIface(i+1, j, k, dxInv, z_nd);
+                Real gp_xi_hi = dxInv[0] * (p_arr(i+1,j,k) - p_arr(i,j,k));
+                Real gp_zeta_on_iface_hi;
+                if (k == klo) {
+                  gp_zeta_on_iface_hi = 0.5 * dxInv[2] * (
+                                                          p_arr(i+1,j,k+1) + p_arr(i,j,k+1)
+                                                        - p_arr(i+1,j,k  ) - p_arr(i,j,k  ) );
+                } else if (k == khi) {
+                  gp_zeta_on_iface_hi = 0.5 * dxInv[2] * (
+                                                          p_arr(i+1,j,k  ) + p_arr(i,j,k  )
+                                                        - p_arr(i+1,j,k-1) - p_arr(i,j,k-1) );
+                } else {
+                  gp_zeta_on_iface_hi = 0.25 * dxInv[2] * (
+                                                           p_arr(i+1,j,k+1) + p_arr(i,j,k+1)
+                                                         - p_arr(i+1,j,k-1) - p_arr(i,j,k-1) );
+                }
+                amrex::Real gpx_hi = gp_xi_hi - (met_h_xi_hi/ met_h_zeta_hi) * gp_zeta_on_iface_hi;
 
-    // Fill terrain distortion MF
-    if (solverChoice.use_terrain) {
-        for (int lev(0); lev <= finest_level; ++lev) {
-            MultiFab::Copy(mf_nd[lev],*z_phys_nd[lev],0,2,1,0);
-            Real dz = Geom()[lev].CellSizeArray()[2];
-            for (MFIter mfi(mf_nd[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi) {
-                const Box& bx = mfi.tilebox();
-                Array4<      Real> mf_arr = mf_nd[lev].array(mfi);
-                ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) {
-                    mf_arr(i,j,k,2) -= k * dz;
-                });
-            }
+                derdat(i ,j ,k, mf_comp) = 0.5 * (gpx_lo + gpx_hi);
+            });
         }
-    }
+    } // pres_hse_x
 
-    std::string plotfilename;
-    if (which == 1)
-       plotfilename = Concatenate(plot_file_1, istep[0], 5);
-    else if (which == 2)
-       plotfilename = Concatenate(plot_file_2, istep[0], 5);
+    if (containerHasElement(plot_var_names, "pres_hse_y"))
+    {
+        const int mf_comp = plot_comp("pres_hse_y");
+        auto dxInv = geom[lev].InvCellSizeArray();
+#ifdef _OPENMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+        for ( MFIter mfi(mf,TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.tilebox();
+            const Array4<Real      >& derdat = mf.array(mfi);
+            const Array4<Real const>&   p_arr = p_hse.const_array(mfi);
+            const Array4<Real const>& z_nd    = z_phys_nd[lev]->const_array(mfi);
+            ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+                Real met_h_eta_lo  = Compute_h_eta_AtJface (i, j, k, dxInv, z_nd);
+                Real met_h_zeta_lo = Compute_h_zeta_AtJface(i, j, k, dxInv, z_nd);
+                Real gp_eta_lo = dxInv[1] * (p_arr(i,j,k) - p_arr(i,j-1,k));
+                Real gp_zeta_on_jface_lo;
+                if (k == klo) {
+                  gp_zeta_on_jface_lo = 0.5 * dxInv[2] * (
+                                                          p_arr(i,j,k+1) + p_arr(i,j-1,k+1)
+                                                        - p_arr(i,j,k  ) - p_arr(i,j-1,k  ) );
+                } else if (k == khi) {
+                  gp_zeta_on_jface_lo = 0.5 * dxInv[2] * (
+                                                          p_arr(i,j,k  ) + p_arr(i,j-1,k  )
+                                                        - p_arr(i,j,k-1) - p_arr(i,j-1,k-1) );
+                } else {
+                  gp_zeta_on_jface_lo = 0.25 * dxInv[2] * (
+                                                           p_arr(i,j,k+1) + p_arr(i,j-1,k+1)
+                                                         - p_arr(i,j,k-1) - p_arr(i,j-1,k-1) );
+                }
+                amrex::Real gpy_lo = gp_eta_lo - (met_h_eta_lo / met_h_zeta_lo) * gp_zeta_on_jface_lo;
+
+                Real met_h_eta_hi  = Compute_h_eta_AtJface (i, j+1, k, dxInv, z_nd);
+                Real met_h_zeta_hi = Compute_h_zeta_AtJface(i, j+1, k, dxInv, z_nd);
+                Real gp_eta_hi = dxInv[1] * (p_arr(i,j+1,k) - p_arr(i,j,k));
+                Real gp_zeta_on_jface_hi;
+                if (k == klo) {
+                  gp_zeta_on_jface_hi = 0.5 * dxInv[2] * (
+                                                          p_arr(i,j+1,k+1) + p_arr(i,j,k+1)
+                                                        - p_arr(i,j+1,k  ) - p_arr(i,j,k  ) );
+                } else if (k == khi) {
+                  gp_zeta_on_jface_hi = 0.5 * dxInv[2] * (
+                                                          p_arr(i,j+1,k  ) + p_arr(i,j,k  )
+                                                        - p_arr(i,j+1,k-1) - p_arr(i,j,k-1) );
+                } else {
+                  gp_zeta_on_jface_hi = 0.25 * dxInv[2] * (
+                                                           p_arr(i,j+1,k+1) + p_arr(i,j,k+1)
+                                                         - p_arr(i,j+1,k-1) - p_arr(i,j,k-1) );
+                }
+                amrex::Real gpy_hi = gp_eta_hi - (met_h_eta_hi / met_h_zeta_hi) * gp_zeta_on_jface_hi;
 
-    if (finest_level == 0)
+                derdat(i ,j ,k, mf_comp) = 0.5 * (gpy_lo + gpy_hi);
+            });
+        }
+    } // pres_hse_y
+
+#ifdef ERF_COMPUTE_ERROR
+    // Next, check for error in velocities and if desired, output them -- note we output none or all, not just some
+    if (containerHasElement(plot_var_names, "xvel_err") ||
+        containerHasElement(plot_var_names, "yvel_err") ||
+        containerHasElement(plot_var_names, "zvel_err"))
     {
-        if (plotfile_type == "amrex") {
-            amrex::Print() << "Writing plotfile " << plotfilename << "\n";
-            if (solverChoice.use_terrain) {
-                WriteMultiLevelPlotfileWithTerrain(plotfilename, finest_level+1,
-                                                   GetVecOfConstPtrs(mf),
-                                                   GetVecOfConstPtrs(mf_nd),
-                                                   varnames,
-                                                   t_new[0], istep);
-            } else {
-                WriteMultiLevelPlotfile(plotfilename, finest_level+1,
-                                        GetVecOfConstPtrs(mf),
-                                        varnames,
-                                        Geom(), t_new[0], istep, refRatio());
-            }
-            writeJobInfo(plotfilename);
+        //
+        // Moving terrain ANALYTICAL
+        //
+        Real H           = geom[lev].ProbHi()[2];
+        Real Ampl        = 0.16;
+        Real wavelength  = 100.;
+        Real kp          = 2. * PI / wavelength;
+        Real g           = CONST_GRAV;
+        Real omega       = std::sqrt(g * kp);
+        Real omega_t     = omega * t_new[lev];
 
-#ifdef ERF_USE_PARTICLES
-            if (use_tracer_particles) {
-                tracer_particles->Checkpoint(plotfilename, "tracers", true, tracer_particle_varnames);
-            }
-#endif
-#ifdef ERF_USE_HDF5
-        } else if (plotfile_type == "hdf5" || plotfile_type == "HDF5") {
-            amrex::Print() << "Writing plotfile " << plotfilename+"d01.h5" << "\n";
-            WriteMultiLevelPlotfileHDF5(plotfilename, finest_level+1,
-                                        GetVecOfConstPtrs(mf),
-                                        varnames,
-                                        Geom(), t_new[0], istep, refRatio());
-#endif
-#ifdef ERF_USE_NETCDF
-        } else if (plotfile_type == "netcdf" || plotfile_type == "NetCDF") {
-             int lev   = 0;
-             int l_which = 0;
-             writeNCPlotFile(lev, l_which, plotfilename, GetVecOfConstPtrs(mf), varnames, istep, t_new[0]);
+        const auto dx = geom[lev].CellSizeArray();
+
+#ifdef _OPENMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
-        } else {
-            amrex::Print() << "User specified plot_filetype = " << plotfile_type << std::endl;
-            amrex::Abort("Dont know this plot_filetype");
-        }
+        for (MFIter mfi(mf, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.validbox();
+            Box xbx(bx); xbx.surroundingNodes(0);
+            const Array4<Real> xvel_arr = vars_new[lev][Vars::xvel].array(mfi);
+            const Array4<Real> zvel_arr = vars_new[lev][Vars::zvel].array(mfi);
 
-    } else { // multilevel
+            const Array4<Real const>& z_nd = z_phys_nd[lev]->const_array(mfi);
 
-        Vector<IntVect>   r2(finest_level);
-        Vector<Geometry>  g2(finest_level+1);
-        Vector<MultiFab> mf2(finest_level+1);
+            ParallelFor(xbx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+            {
+                Real x = i * dx[0];
+                Real z = 0.25 * (z_nd(i,j,k) + z_nd(i,j+1,k) + z_nd(i,j,k+1) + z_nd(i,j+1,k+1));
 
-        mf2[0].define(grids[0], dmap[0], ncomp_mf, 0);
+                Real z_base = Ampl * std::sin(kp * x - omega_t);
+                z -= z_base;
 
-        // Copy level 0 as is
-        MultiFab::Copy(mf2[0],mf[0],0,0,mf[0].nComp(),0);
+                Real fac = std::cosh( kp * (z - H) ) / std::sinh(kp * H);
 
-        // Define a new multi-level array of Geometry's so that we pass the new "domain" at lev > 0
-        Array<int,AMREX_SPACEDIM> periodicity =
-                     {Geom()[0].isPeriodic(0),Geom()[0].isPeriodic(1),Geom()[0].isPeriodic(2)};
-        g2[0].define(Geom()[0].Domain(),&(Geom()[0].ProbDomain()),0,periodicity.data());
+                xvel_arr(i,j,k) -= -Ampl * omega * fac * std::sin(kp * x - omega_t);
+            });
 
-        if (plotfile_type == "amrex") {
-            r2[0] = IntVect(1,1,ref_ratio[0][0]);
-            for (int lev = 1; lev <= finest_level; ++lev) {
-                if (lev > 1) {
-                    r2[lev-1][0] = 1;
-                    r2[lev-1][1] = 1;
-                    r2[lev-1][2] = r2[lev-2][2] * ref_ratio[lev-1][0];
-                }
+            ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+            {
+                Real x   = (i + 0.5) * dx[0];
+                Real z   = 0.25 * ( z_nd(i,j,k) + z_nd(i+1,j,k) + z_nd(i,j+1,k) + z_nd(i+1,j+1,k));
 
-                mf2[lev].define(refine(grids[lev],r2[lev-1]), dmap[lev], ncomp_mf, 0);
+                Real z_base = Ampl * std::sin(kp * x - omega_t);
+                z -= z_base;
 
-                // Set the new problem domain
-                Box d2(Geom()[lev].Domain());
-                d2.refine(r2[lev-1]);
+                Real fac = std::sinh( kp * (z - H) ) / std::sinh(kp * H);
 
-                g2[lev].define(d2,&(Geom()[lev].ProbDomain()),0,periodicity.data());
-            }
+                zvel_arr(i,j,k) -= Ampl * omega * fac * std::cos(kp * x - omega_t);
+            });
+        }
 
-            // Do piecewise interpolation of mf into mf2
-            for (int lev = 1; lev <= finest_level; ++lev) {
+        MultiFab temp_mf(mf.boxArray(), mf.DistributionMap(), AMREX_SPACEDIM, 0);
+        average_face_to_cellcenter(temp_mf,0,
+            Array<const MultiFab*,3>{&vars_new[lev][Vars::xvel],&vars_new[lev][Vars::yvel],&vars_new[lev][Vars::zvel]});
+
+        if (containerHasElement(plot_var_names, "xvel_err")) {
+            MultiFab::Copy(mf,temp_mf,0,plot_comp("xvel_err"),1,0);
+        }
+        if (containerHasElement(plot_var_names, "yvel_err")) {
+            MultiFab::Copy(mf,temp_mf,1,plot_comp("yvel_err"),1,0);
+        }
+        if (containerHasElement(plot_var_names, "zvel_err")) {
+            MultiFab::Copy(mf,temp_mf,2,plot_comp("zvel_err"),1,0);
+        }
+
+        // Now restore the velocities to what they were
 #ifdef _OPENMP
 #pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
-                for (MFIter mfi(mf2[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi) {
-                    const Box& bx = mfi.tilebox();
-                    pcinterp_interp(bx,mf2[lev].array(mfi), 0, mf[lev].nComp(), mf[lev].const_array(mfi),0,r2[lev-1]);
-                }
-            }
+        for (MFIter mfi(mf, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.validbox();
+            Box xbx(bx); xbx.surroundingNodes(0);
 
-            // Define an effective ref_ratio which is isotropic to be passed into WriteMultiLevelPlotfile
-            Vector<IntVect> rr(finest_level);
-            for (int lev = 0; lev < finest_level; ++lev) {
-                rr[lev] = IntVect(ref_ratio[lev][0],ref_ratio[lev][1],ref_ratio[lev][0]);
-            }
+            const Array4<Real> xvel_arr = vars_new[lev][Vars::xvel].array(mfi);
+            const Array4<Real> zvel_arr = vars_new[lev][Vars::zvel].array(mfi);
 
-            amrex::Print() << "Writing plotfile " << plotfilename << "\n";
-            if (solverChoice.use_terrain) {
-                WriteMultiLevelPlotfileWithTerrain(plotfilename, finest_level+1,
-                                                   GetVecOfConstPtrs(mf),
-                                                   GetVecOfConstPtrs(mf_nd),
-                                                   varnames,
-                                                   t_new[0], istep);
-            } else {
-                WriteMultiLevelPlotfile(plotfilename, finest_level+1,
-                                        GetVecOfConstPtrs(mf2), varnames,
-                                        g2, t_new[0], istep, rr);
-            }
+            const Array4<Real const>& z_nd = z_phys_nd[lev]->const_array(mfi);
 
-            writeJobInfo(plotfilename);
+            ParallelFor(xbx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+            {
+                Real x = i * dx[0];
+                Real z = 0.25 * (z_nd(i,j,k) + z_nd(i,j+1,k) + z_nd(i,j,k+1) + z_nd(i,j+1,k+1));
+                Real z_base = Ampl * std::sin(kp * x - omega_t);
 
-#ifdef ERF_USE_PARTICLES
-            if (use_tracer_particles) {
-                tracer_particles->Checkpoint(plotfilename, "tracers", true, tracer_particle_varnames);
-            }
-#endif
-#ifdef ERF_USE_NETCDF
-        } else if (plotfile_type == "netcdf" || plotfile_type == "NetCDF") {
-             for (int lev = 0; lev <= finest_level; ++lev) {
-                 for (int which_box = 0; which_box < num_boxes_at_level[lev]; which_box++) {
-                     writeNCPlotFile(lev, which_box, plotfilename, GetVecOfConstPtrs(mf), varnames, istep, t_new[0]);
-                 }
-             }
+                z -= z_base;
+
+                Real fac = std::cosh( kp * (z - H) ) / std::sinh(kp * H);
+                xvel_arr(i,j,k) += -Ampl * omega * fac * std::sin(kp * x - omega_t);
+            });
+            ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+            {
+                Real x   = (i + 0.5) * dx[0];
+                Real z   = 0.25 * ( z_nd(i,j,k) + z_nd(i+1,j,k) + z_nd(i,j+1,k) + z_nd(i+1,j+1,k));
+                Real z_base = Ampl * std::sin(kp * x - omega_t);
+
+                z -= z_base;
+                Real fac = std::sinh( kp * (z - H) ) / std::sinh(kp * H);
+
+                zvel_arr(i,j,k) += Ampl * omega * fac * std::cos(kp * x - omega_t);
+            });
+        }
+    } // end xvel_err, yvel_err, zvel_err
+
+    if (containerHasElement(plot_var_names, "pp_err"))
+    {
+        const int mf_comp = plot_comp("pp_err");
+        // Moving terrain ANALYTICAL
+#ifdef _OPENMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
+        for ( MFIter mfi(mf,TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            const Box& bx = mfi.tilebox();
+            const Array4<Real>& derdat = mf.array(mfi);
+            const Array4<Real const>& p0_arr = p_hse.const_array(mfi);
+            const Array4<Real const>& S_arr = vars_new[lev][Vars::cons].const_array(mfi);
+
+            const auto dx = geom[lev].CellSizeArray();
+            const Array4<Real const>& z_nd = z_phys_nd[lev]->const_array(mfi);
+            const Array4<Real const>& r0_arr = r_hse.const_array(mfi);
+
+            Real H           = geom[lev].ProbHi()[2];
+            Real Ampl        = 0.16;
+            Real wavelength  = 100.;
+            Real kp          = 2. * PI / wavelength;
+            Real g           = CONST_GRAV;
+            Real omega       = std::sqrt(g * kp);
+            Real omega_t     = omega * t_new[lev];
+
+            ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept
+            {
+                const Real rhotheta = S_arr(i,j,k,RhoTheta_comp);
+                derdat(i, j, k, mf_comp) = getPgivenRTh(rhotheta) - p0_arr(i,j,k);
+
+                Real rho_hse     = r0_arr(i,j,k);
+
+                Real x   = (i + 0.5) * dx[0];
+                Real z   = 0.125 * ( z_nd(i,j,k  ) + z_nd(i+1,j,k  ) + z_nd(i,j+1,k  ) + z_nd(i+1,j+1,k  )
+                                    +z_nd(i,j,k+1) + z_nd(i+1,j,k+1) + z_nd(i,j+1,k+1) + z_nd(i+1,j+1,k+1) );
+                Real z_base = Ampl * std::sin(kp * x - omega_t);
+
+                z -= z_base;
+                Real fac = std::cosh( kp * (z - H) ) / std::sinh(kp * H);
+                Real pprime_exact = -(Ampl * omega * omega / kp) * fac *
+                                          std::sin(kp * x - omega_t) * r0_arr(i,j,k);
+
+                derdat(i,j,k,mf_comp) -= pprime_exact;
+            });
         }
-    } // end multi-level
+    }
+#endif
 }
 
 void
@@ -8,17 +8,18 @@ void
 read_from_metgrid(int lev,
                   const Box& domain,
                   const std::string& fname,
-                  FArrayBox& NC_xvel_fab, FArrayBox& NC_yvel_fab,
-                  FArrayBox& NC_temp_fab, FArrayBox& NC_rhum_fab,
-                  FArrayBox& NC_pres_fab, FArrayBox& NC_hgt_fab,
-                  FArrayBox& NC_msfu_fab, FArrayBox& NC_msfv_fab,
-                  FArrayBox& NC_msfm_fab)
+                  const Vector<Box>& regions,
+                  Vector<FArrayBox>& NC_xvel_fab, Vector<FArrayBox>& NC_yvel_fab,
+                  Vector<FArrayBox>& NC_temp_fab, Vector<FArrayBox>& NC_rhum_fab,
+                  Vector<FArrayBox>& NC_pres_fab, Vector<FArrayBox>& NC_hgt_fab,
+                  Vector<FArrayBox>& NC_msfu_fab, Vector<FArrayBox>& NC_msfv_fab,
+                  Vector<FArrayBox>& NC_msfm_fab)
 {
     amrex::Print() << "Loading initial data from NetCDF file at level " << lev << std::endl;
 
     int ncomp = 1;
 
-    Vector<FArrayBox*> NC_fabs;
+    Vector<Vector<FArrayBox>*> NC_fabs;
     Vector<std::string> NC_names;
     Vector<enum NC_Data_Dims_Type> NC_dim_types;
 
@@ -35,27 +36,32 @@ read_from_metgrid(int lev,
 
     // Read the netcdf file and fill these FABs
     amrex::Print() << "Building initial FABS from file " << fname << std::endl;
-    BuildFABsFromNetCDFFile(domain, fname, NC_names, NC_dim_types, NC_fabs);
+    BuildFABsFromNetCDFFile(domain, fname, regions, NC_names, NC_dim_types, NC_fabs);
 
 
     // TODO: FIND OUT IF WE NEED TO DIVIDE VELS BY MAPFAC
     //
     // Convert the velocities using the map factors
     //
-    const Box& uubx = NC_xvel_fab.box();
-    const Array4<Real>    u_arr = NC_xvel_fab.array();
-    const Array4<Real> msfu_arr = NC_msfu_fab.array();
-    ParallelFor(uubx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+    for (int n = 0; n < regions.size(); n++)
     {
-        // u_arr(i,j,k) /= msfu_arr(i,j,0);
-    });
+        if (!regions[n].ok()) continue;
 
-    const Box& vvbx = NC_yvel_fab.box();
-    const Array4<Real>    v_arr = NC_yvel_fab.array();
-    const Array4<Real> msfv_arr = NC_msfv_fab.array();
-    ParallelFor(vvbx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
-    {
-        // v_arr(i,j,k) /= msfv_arr(i,j,0);
-    });
+        const Box& uubx = NC_xvel_fab[n].box();
+        const Array4<Real>    u_arr = NC_xvel_fab[n].array();
+        const Array4<Real> msfu_arr = NC_msfu_fab[n].array();
+        ParallelFor(uubx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+        {
+            // u_arr(i,j,k) /= msfu_arr(i,j,0);
+        });
+
+        const Box& vvbx = NC_yvel_fab[n].box();
+        const Array4<Real>    v_arr = NC_yvel_fab[n].array();
+        const Array4<Real> msfv_arr = NC_msfv_fab[n].array();
+        ParallelFor(vvbx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+        {
+            // v_arr(i,j,k) /= msfv_arr(i,j,0);
+        });
+    }
 }
 #endif // ERF_USE_NETCDF
@@ -1,18 +1,17 @@
 #include "AMReX_FArrayBox.H"
-#include "NCWpsFile.H"
+#include "AMReX_MultiFab.H"
+#include "AMReX_Print.H"
 #include "IndexDefines.H"
 #include "EOS.H"
 
 #include <sstream>
 #include <string>
 #include <ctime>
-#include <atomic>
 
 #include "DataStruct.H"
 #include "NCInterface.H"
 #include "NCWpsFile.H"
-#include "AMReX_FArrayBox.H"
-#include "AMReX_Print.H"
+#include "ERF_ReadWRFBdy.H"
 
 using namespace amrex;
 
@@ -27,6 +26,15 @@ namespace WRFBdyTypes {
     };
 }
 
+namespace {
+    // NOTE: the order and number of these must match the WRFBdyVars enum!
+    // WRFBdyVars:  U, V, R, T, QV, MU, PC
+    const Vector<std::string> nc_var_prefix = {"U","V","R","T","QVAPOR","MU","PC"};
+
+    // NOTE: the order of these must match WRFBdyTypes
+    const Vector<std::string> nc_face_suffix = {"_BXS","_BXE","_BYS","_BYE"};
+}
+
 // Converts UTC time string to a time_t value.
 std::time_t getEpochTime(const std::string& dateTime, const std::string& dateTimeFormat)
 {
@@ -50,25 +58,13 @@ std::time_t getEpochTime(const std::string& dateTime, const std::string& dateTim
     return epoch;
 }
 
-Real
-read_from_wrfbdy(const std::string& nc_bdy_file, const Box& domain,
-                 Vector<Vector<FArrayBox>>& bdy_data_xlo,
-                 Vector<Vector<FArrayBox>>& bdy_data_xhi,
-                 Vector<Vector<FArrayBox>>& bdy_data_ylo,
-                 Vector<Vector<FArrayBox>>& bdy_data_yhi,
-                 int& width, Real& start_bdy_time)
+ReadWRFBdy::ReadWRFBdy (const std::string& nc_bdy_file, const Box& domain)
+    : m_filename(nc_bdy_file), m_domain(domain)
 {
-    amrex::Print() << "Loading boundary data from NetCDF file " << std::endl;
+    amrex::Print() << "Loading boundary data from NetCDF file " << nc_bdy_file << std::endl;
 
     int ioproc = ParallelDescriptor::IOProcessorNumber();  // I/O rank
 
-    const auto& lo = domain.loVect();
-    const auto& hi = domain.hiVect();
-
-    // *******************************************************************************
-
-    int ntimes;
-    Real timeInterval;
     const std::string dateTimeFormat ="%Y-%m-%d_%H:%M:%S";
 
     if (ParallelDescriptor::IOProcessor())
@@ -76,659 +72,417 @@ read_from_wrfbdy(const std::string& nc_bdy_file, const Box& domain,
         // Read the time stamps
         using CharArray = NDArray<char>;
         amrex::Vector<CharArray> array_ts(1);
-        ReadNetCDFFile(nc_bdy_file, {"Times"}, array_ts);
+        ReadNetCDFFile(m_filename, {"Times"}, array_ts);
 
-        ntimes = array_ts[0].get_vshape()[0];
+        m_ntimes = array_ts[0].get_vshape()[0];
         auto dateStrLen = array_ts[0].get_vshape()[1];
-        char timeStamps[ntimes][dateStrLen];
-
-        // Fill up the characters read
-        int str_len = static_cast<int>(dateStrLen);
-        for (int nt(0); nt < ntimes; nt++)
-            for (int dateStrCt(0); dateStrCt < str_len; dateStrCt++) {
-                auto n = nt*dateStrLen + dateStrCt;
-                timeStamps[nt][dateStrCt] = *(array_ts[0].get_data() + n);
-            }
 
         Vector<std::time_t> epochTimes;
-        for (int nt(0); nt < ntimes; nt++) {
-            std::string date(&timeStamps[nt][0], &timeStamps[nt][dateStrLen-1]+1);
+        for (int nt(0); nt < m_ntimes; nt++) {
+            const char* timeStamp = array_ts[0].get_data() + nt*dateStrLen;
+            std::string date(timeStamp, timeStamp + dateStrLen);
             auto epochTime = getEpochTime(date, dateTimeFormat);
             epochTimes.push_back(epochTime);
 
             if (nt == 1)
-                timeInterval = epochTimes[1] - epochTimes[0];
+                m_interval = epochTimes[1] - epochTimes[0];
             else if (nt >= 1)
-                AMREX_ALWAYS_ASSERT(epochTimes[nt] - epochTimes[nt-1] == timeInterval);
+                AMREX_ALWAYS_ASSERT(epochTimes[nt] - epochTimes[nt-1] == m_interval);
         }
-        start_bdy_time = epochTimes[0];
+        m_start_time = epochTimes[0];
+
+        // Width of the boundary region (all the variables have the same time snapshots and width)
+        auto ncf = ncutils::NCFile::open(m_filename, NC_NOWRITE);
+        auto shape = ncf.var("U_BXS").shape();
+        AMREX_ALWAYS_ASSERT(static_cast<int>(shape[0]) == m_ntimes);
+        m_width = static_cast<int>(shape[1]);
+
+        AMREX_ALWAYS_ASSERT(1 <= m_width && m_width <= 5);
     }
 
-    ParallelDescriptor::Bcast(&start_bdy_time,1,ioproc);
-    ParallelDescriptor::Bcast(&ntimes,1,ioproc);
-    ParallelDescriptor::Bcast(&timeInterval,1,ioproc);
+    ParallelDescriptor::Bcast(&m_start_time,1,ioproc);
+    ParallelDescriptor::Bcast(&m_ntimes,1,ioproc);
+    ParallelDescriptor::Bcast(&m_interval,1,ioproc);
+    ParallelDescriptor::Bcast(&m_width,1,ioproc);
 
-    // Even though we may not read in all the variables, we need to make the arrays big enough for them (for now)
-    int nvars = WRFBdyVars::NumTypes*4;
+    m_mub.resize(4);
+    m_ph.resize(4);
+    m_phb.resize(4);
+}
 
-    // Our outermost loop is time
-    bdy_data_xlo.resize(ntimes);
-    bdy_data_xhi.resize(ntimes);
-    bdy_data_ylo.resize(ntimes);
-    bdy_data_yhi.resize(ntimes);
+Box
+ReadWRFBdy::strip_box (int face, int ivar) const
+{
+    const auto& lo = m_domain.smallEnd();
+    const auto& hi = m_domain.bigEnd();
+
+    Box pbx(m_domain);
+    if        (face == WRFBdyTypes::x_lo) {
+        pbx.setBig  (0, lo[0]+m_width-1);
+    } else if (face == WRFBdyTypes::x_hi) {
+        pbx.setSmall(0, hi[0]-m_width+1);
+    } else if (face == WRFBdyTypes::y_lo) {
+        pbx.setBig  (1, lo[1]+m_width-1);
+    } else {
+        pbx.setSmall(1, hi[1]-m_width+1);
+    }
 
-    amrex::IntVect plo(lo);
-    amrex::IntVect phi(hi);
+    // The normal velocity lives on the faces shifted half a cell out of the domain,
+    //    the tangential one on all the faces of the strip
+    int  dir_n = (face == WRFBdyTypes::x_lo || face == WRFBdyTypes::x_hi) ? 0 : 1;
+    int half_n = (face == WRFBdyTypes::x_lo || face == WRFBdyTypes::y_lo) ? -1 : 1;
+    if (ivar == WRFBdyVars::U || ivar == WRFBdyVars::V) {
+        int dir = (ivar == WRFBdyVars::U) ? 0 : 1;
+        if (dir == dir_n) {
+            pbx.shiftHalf(dir, half_n);
+        } else {
+            pbx.surroundingNodes(dir);
+        }
+    } else if (ivar == WRFBdyVars::MU || ivar == WRFBdyVars::PC) {
+        pbx.setSmall(2, 0);
+        pbx.setBig  (2, 0);
+    }
+    return pbx;
+}
 
-    // ******************************************************************
-    // Read the netcdf file and fill these FABs
-    // NOTE: the order and number of these must match the WRFBdyVars enum!
-    // WRFBdyVars:  U, V, R, T, QV, MU, PC
-    // ******************************************************************
-    Vector<std::string> nc_var_names;
-    Vector<std::string> nc_var_prefix = {"U","V","R","T","QVAPOR","MU","PC"};
+int
+ReadWRFBdy::time_index (Real time) const
+{
+    // NOTE: this must match the time interpolation in fill_from_wrfbdy
+    //       and wrfbdy_compute_interior_ghost_RHS
+    Real time_since_start = (time - m_start_time) / 1.e10;
+    return static_cast<int>( time_since_start / m_interval );
+}
 
-    for (int ip = 0; ip < nc_var_prefix.size(); ++ip)
-    {
-       nc_var_names.push_back(nc_var_prefix[ip] + "_BXS");
-       nc_var_names.push_back(nc_var_prefix[ip] + "_BXE");
-       nc_var_names.push_back(nc_var_prefix[ip] + "_BYS");
-       nc_var_names.push_back(nc_var_prefix[ip] + "_BYE");
+void
+ReadWRFBdy::set_conversion_fields (const std::string& nc_init_file)
+{
+    // The I/O rank reads the wrfinput fields on each strip grown by one cell (for the
+    //    face averages); every rank takes part since the file is opened collectively
+    Vector<Box> regions(4);
+    if (ParallelDescriptor::IOProcessor()) {
+        for (int face = 0; face < 4; ++face) {
+            regions[face] = amrex::grow(strip_box(face, WRFBdyVars::T), IntVect(1,1,0)) & m_domain;
+        }
     }
 
-    using RARRAY = NDArray<float>;
-    amrex::Vector<RARRAY> arrays(nc_var_names.size());
+    // The columns come back once per strip; we keep the first
+    Vector<FArrayBox> c1h(4), c2h(4), rdnw(4);
+    BuildFABsFromNetCDFFile(m_domain, nc_init_file, regions,
+                            {"MUB", "PH", "PHB", "C1H", "C2H", "RDNW"},
+                            {NC_Data_Dims_Type::Time_SN_WE, NC_Data_Dims_Type::Time_BT_SN_WE,
+                             NC_Data_Dims_Type::Time_BT_SN_WE, NC_Data_Dims_Type::Time_BT,
+                             NC_Data_Dims_Type::Time_BT, NC_Data_Dims_Type::Time_BT},
+                            {&m_mub, &m_ph, &m_phb, &c1h, &c2h, &rdnw});
 
     if (ParallelDescriptor::IOProcessor())
     {
-        ReadNetCDFFile(nc_bdy_file, nc_var_names, arrays);
+        m_c1h  = std::move(c1h[0]);
+        m_c2h  = std::move(c2h[0]);
+        m_rdnw = std::move(rdnw[0]);
+    }
 
-        // Assert that the data has the same number of time snapshots
-        int itimes = static_cast<int>(arrays[0].get_vshape()[0]);
-        AMREX_ALWAYS_ASSERT(itimes == ntimes);
+    read_time(0);
+}
 
-        // Width of the boundary region
-        width = arrays[0].get_vshape()[1];
+Vector<FArrayBox*>
+ReadWRFBdy::conversion_fields ()
+{
+    Vector<FArrayBox*> fields;
+    for (int face = 0; face < 4; ++face) {
+        fields.push_back(&m_mub[face]);
+        fields.push_back(&m_ph[face]);
+        fields.push_back(&m_phb[face]);
+    }
+    fields.push_back(&m_c1h);
+    fields.push_back(&m_c2h);
+    fields.push_back(&m_rdnw);
+    return fields;
+}
 
-        AMREX_ALWAYS_ASSERT(1 <= width && width <= 5);
+void
+ReadWRFBdy::update (Real time, Real dt,
+                    const BoxArray& ba, const DistributionMapping& dm, int ng,
+                    BdyData& bdy_data_xlo, BdyData& bdy_data_xhi,
+                    BdyData& bdy_data_ylo, BdyData& bdy_data_yhi)
+{
+    BL_PROFILE("ReadWRFBdy::update()");
+
+    // We interpolate between n_time and n_time+1 at any time in [time, time+dt]
+    int n_lo = std::max(time_index(time), 0);
+    int n_hi = std::min(time_index(time + dt) + 1, m_ntimes-1);
+    AMREX_ALWAYS_ASSERT(n_lo < m_ntimes);
+
+    Array<BdyData*,4> bdy_data = {&bdy_data_xlo, &bdy_data_xhi, &bdy_data_ylo, &bdy_data_yhi};
+    for (auto* bdy : bdy_data) {
+        if (static_cast<int>(bdy->size()) != m_ntimes) {
+            bdy->clear();
+            bdy->resize(m_ntimes);
+            for (auto& bdy_time : *bdy) {
+                bdy_time.resize(WRFBdyVars::NumTypes);
+            }
+        }
     }
-    ParallelDescriptor::Bcast(&width,1,ioproc);
 
-    // This loops over every variable on every face, so nvars should be 4 * number of "ivartype" below
-    for (int iv = 0; iv < nvars; iv++)
-    {
-        amrex::Print() << "Building FAB for the NetCDF variable : " << nc_var_names[iv] << std::endl;
-
-        int bdyVarType;
-
-        std::string first1 = nc_var_names[iv].substr(0,1);
-        std::string first2 = nc_var_names[iv].substr(0,2);
-
-        if        (first1 == "U") {
-            bdyVarType = WRFBdyVars::U;
-        } else if (first1 == "V") {
-            bdyVarType = WRFBdyVars::V;
-        } else if (first1 == "R") {
-            bdyVarType = WRFBdyVars::R;
-        } else if (first1 == "T") {
-            bdyVarType = WRFBdyVars::T;
-        } else if (first2 == "QV") {
-            bdyVarType = WRFBdyVars::QV;
-        } else if (first2 == "MU") {
-            bdyVarType = WRFBdyVars::MU;
-        } else if (first2 == "PC") {
-            bdyVarType = WRFBdyVars::PC;
+    bool new_grids = (ng != m_ng) || (ba != m_ba) || (dm != m_dm);
+    m_ba = ba;
+    m_dm = dm;
+    m_ng = ng;
+
+    // Let go of the times we are done with
+    for (auto it = m_strips.begin(); it != m_strips.end(); ) {
+        if (it->first < n_lo || it->first > n_hi) {
+            for (auto* bdy : bdy_data) {
+                (*bdy)[it->first] = Vector<FArrayBox>(WRFBdyVars::NumTypes);
+            }
+            it = m_strips.erase(it);
         } else {
-            amrex::Print() << "Trying to read " << first1 << " or " << first2 << std::endl;
-            amrex::Abort("dont know this variable");
+            ++it;
         }
+    }
 
-        std::string  last3 = nc_var_names[iv].substr(nc_var_names[iv].size()-3, 3);
-        int bdyType;
-
-        if        (last3 == "BXS") {
-            bdyType = WRFBdyTypes::x_lo;
-        } else if (last3 == "BXE") {
-            bdyType = WRFBdyTypes::x_hi;
-        } else if (last3 == "BYS") {
-            bdyType = WRFBdyTypes::y_lo;
-        } else if (last3 == "BYE") {
-            bdyType = WRFBdyTypes::y_hi;
+    // A time is read the first time it is needed; nothing is read ahead since
+    //    NetCDF-C is not thread-safe and the other NetCDF I/O runs on the I/O rank too
+    for (int nt = n_lo; nt <= n_hi; ++nt) {
+        bool new_time = (m_strips.count(nt) == 0);
+        if (new_time) {
+            read_time(nt);
         }
+        if (new_time || new_grids) {
+            deliver(nt, bdy_data);
+        }
+    }
+}
 
-        Box y_line_no_stag(IntVect(lo[0], 0, 0), IntVect(hi[0], 0, 0));
-
-        if (bdyType == WRFBdyTypes::x_lo) {
+void
+ReadWRFBdy::read_time (int nt)
+{
+    BL_PROFILE("ReadWRFBdy::read_time()");
 
-                // *******************************************************************************
-                // xlo bdy
-                // *******************************************************************************
-                plo[0] = lo[0]        ; plo[1] = lo[1]; plo[2] = lo[2];
-                phi[0] = lo[0]+width-1; phi[1] = hi[1]; phi[2] = hi[2];
-                const Box pbx_xlo(plo, phi);
+    Vector<Vector<FArrayBox>> strips(4);
 
-                Box xlo_plane_no_stag(pbx_xlo);
-                Box xlo_plane_x_stag = pbx_xlo; xlo_plane_x_stag.shiftHalf(0,-1);
-                Box xlo_plane_y_stag = convert(pbx_xlo, {0, 1, 0});
+    if (ParallelDescriptor::IOProcessor())
+    {
+        amrex::Print() << "Reading boundary data at time " << nt << " of " << m_ntimes
+                       << " from " << m_filename << std::endl;
 
-                Box xlo_line(IntVect(lo[0], lo[1], 0), IntVect(lo[0]+width-1, hi[1], 0));
+        auto ncf = ncutils::NCFile::open(m_filename, NC_NOWRITE);
 
-                if        (bdyVarType == WRFBdyVars::U) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xlo[nt].push_back(FArrayBox(xlo_plane_x_stag, 1)); // U
-                    }
-                } else if (bdyVarType == WRFBdyVars::V) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xlo[nt].push_back(FArrayBox(xlo_plane_y_stag , 1)); // V
-                    }
-                } else if (bdyVarType == WRFBdyVars::R) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xlo[nt].push_back(FArrayBox(xlo_plane_no_stag, 1)); // R
-                    }
-                } else if (bdyVarType == WRFBdyVars::T) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xlo[nt].push_back(FArrayBox(xlo_plane_no_stag, 1)); // T
-                    }
-                } else if (bdyVarType == WRFBdyVars::QV) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xlo[nt].push_back(FArrayBox(xlo_plane_no_stag, 1)); // QV
-                    }
-                } else if (bdyVarType == WRFBdyVars::MU ||
-                           bdyVarType == WRFBdyVars::PC) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xlo[nt].push_back(FArrayBox(xlo_line, 1));
+        for (int face = 0; face < 4; ++face)
+        {
+            strips[face].resize(WRFBdyVars::NumTypes);
+            for (int ivar = 0; ivar < WRFBdyVars::NumTypes; ++ivar)
+            {
+                FArrayBox& fab = strips[face][ivar];
+                fab.resize(strip_box(face, ivar), 1);
+
+                // Density is diagnosed from MU and the geopotential when we convert
+                if (ivar == WRFBdyVars::R) continue;
+
+                // Dimensions are (Time, bdy_width, [bottom_top,] tangential)
+                auto var = ncf.var(nc_var_prefix[ivar] + nc_face_suffix[face]);
+                std::vector<size_t> count = var.shape();
+                std::vector<size_t> start(count.size(), 0);
+                start[0] = nt;
+                count[0] = 1;
+
+                int nk = (count.size() == 4) ? static_cast<int>(count[2]) : 1;
+                int nj = static_cast<int>(count.back());
+                Long num_pts = fab.box().numPts();
+                AMREX_ALWAYS_ASSERT(num_pts == Long(count[1])*nk*nj);
+
+                std::vector<float> buf(num_pts);
+                var.get(buf.data(), start, count);
+
+                // Index across the strip (counted from the domain boundary), in the
+                //    vertical, and along the strip
+                const Array4<Real>& fab_arr = fab.array();
+                const auto& bx = fab.box();
+                for (Long n(0); n < num_pts; ++n) {
+                    int ib = static_cast<int>(n / (nk * nj));
+                    int k  = static_cast<int>((n - ib * (nk * nj)) / nj);
+                    int it = static_cast<int>( n - ib * (nk * nj) - k * nj);
+                    Real val = static_cast<Real>(buf[n]);
+                    if        (face == WRFBdyTypes::x_lo) {
+                        fab_arr(bx.smallEnd(0)+ib, bx.smallEnd(1)+it, k, 0) = val;
+                    } else if (face == WRFBdyTypes::x_hi) {
+                        fab_arr(bx.bigEnd(0)  -ib, bx.smallEnd(1)+it, k, 0) = val;
+                    } else if (face == WRFBdyTypes::y_lo) {
+                        fab_arr(bx.smallEnd(0)+it, bx.smallEnd(1)+ib, k, 0) = val;
+                    } else {
+                        fab_arr(bx.smallEnd(0)+it, bx.bigEnd(1)  -ib, k, 0) = val;
                     }
                 }
+            } // ivar
 
-            } else if (bdyType == WRFBdyTypes::x_hi) {
-
-                // *******************************************************************************
-                // xhi bdy
-                // *******************************************************************************
-                plo[0] = hi[0]-width+1; plo[1] = lo[1]; plo[2] = lo[2];
-                phi[0] = hi[0]        ; phi[1] = hi[1]; phi[2] = hi[2];
-                const Box pbx_xhi(plo, phi);
+            convert(face, strips[face]);
+        } // face
+    } // IO
 
-                Box xhi_plane_no_stag(pbx_xhi);
-                Box xhi_plane_x_stag = pbx_xhi; xhi_plane_x_stag.shiftHalf(0,1);
-                Box xhi_plane_y_stag = convert(pbx_xhi, {0, 1, 0});
+    m_strips[nt] = std::move(strips);
+}
 
-                Box xhi_line(IntVect(hi[0]-width+1, lo[1], 0), IntVect(hi[0], hi[1], 0));
+void
+ReadWRFBdy::deliver (int nt, const Array<BdyData*,4>& bdy_data) const
+{
+    BL_PROFILE("ReadWRFBdy::deliver()");
 
-                //amrex::Print() << "HI XBX NO STAG " << pbx_xhi << std::endl;
-                //amrex::Print() << "HI XBX  X STAG " << xhi_plane_x_stag << std::endl;
-                //amrex::Print() << "HI XBX  Y STAG " << xhi_plane_y_stag << std::endl;
+    int ioproc = ParallelDescriptor::IOProcessorNumber();  // I/O rank
 
-                if        (bdyVarType == WRFBdyVars::U) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xhi[nt].push_back(FArrayBox(xhi_plane_x_stag, 1)); // U
-                    }
-                } else if (bdyVarType == WRFBdyVars::V) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xhi[nt].push_back(FArrayBox(xhi_plane_y_stag , 1)); // V
-                    }
-                } else if (bdyVarType == WRFBdyVars::R) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xhi[nt].push_back(FArrayBox(xhi_plane_no_stag, 1)); // R
-                    }
-                } else if (bdyVarType == WRFBdyVars::T) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xhi[nt].push_back(FArrayBox(xhi_plane_no_stag, 1)); // T
-                    }
-                } else if (bdyVarType == WRFBdyVars::QV) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xhi[nt].push_back(FArrayBox(xhi_plane_no_stag, 1)); // QV
-                    }
-                } else if (bdyVarType == WRFBdyVars::MU ||
-                           bdyVarType == WRFBdyVars::PC) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_xhi[nt].push_back(FArrayBox(xhi_line, 1)); // MU
-                    }
-                }
+    // The part of the domain each grid (grown by ng) touches; a rank whose grids
+    //    are far apart only gets the pieces around them
+    Vector<Box> need;
+    Vector<int> need_rank;
+    for (int i = 0; i < m_ba.size(); ++i) {
+        Box bx = amrex::grow(m_ba[i], IntVect(m_ng,m_ng,0)) & m_domain;
+        if (bx.ok()) {
+            need.push_back(bx);
+            need_rank.push_back(m_dm[i]);
+        }
+    }
 
-            } else if (bdyType == WRFBdyTypes::y_lo) {
+    DistributionMapping io_dm(Vector<int>{ioproc});
 
-                // *******************************************************************************
-                // ylo bdy
-                // *******************************************************************************
-                plo[1] = lo[1]        ; plo[0] = lo[0]; plo[2] = lo[2];
-                phi[1] = lo[1]+width-1; phi[0] = hi[0]; phi[2] = hi[2];
-                const Box pbx_ylo(plo, phi);
+    for (int face = 0; face < 4; ++face)
+    {
+        for (int ivar = 0; ivar < WRFBdyVars::NumTypes; ++ivar)
+        {
+            FArrayBox& fab = (*bdy_data[face])[nt][ivar];
+            fab = FArrayBox();
+
+            const Box strip = strip_box(face, ivar);
+            Vector<Box> boxes;
+            Vector<int> ranks;
+            for (int i = 0; i < need.size(); ++i) {
+                Box bx = amrex::convert(need[i], strip.ixType()) & strip;
+                if (bx.ok()) {
+                    boxes.push_back(bx);
+                    ranks.push_back(need_rank[i]);
+                }
+            }
+            if (boxes.empty()) continue;
 
-                Box ylo_plane_no_stag(pbx_ylo);
-                Box ylo_plane_x_stag = convert(pbx_ylo, {1, 0, 0});
-                Box ylo_plane_y_stag = pbx_ylo; ylo_plane_y_stag.shiftHalf(1,-1);
+            MultiFab src(BoxArray(strip), io_dm, 1, 0);
+            for (MFIter mfi(src); mfi.isValid(); ++mfi) {
+                src[mfi].template copy<RunOn::Device>(m_strips.at(nt)[face][ivar]);
+            }
 
-                Box ylo_line(IntVect(lo[0], lo[1], 0), IntVect(hi[0], lo[1]+width-1, 0));
+            MultiFab dst(BoxArray(boxes.data(), static_cast<int>(boxes.size())),
+                         DistributionMapping(std::move(ranks)), 1, 0);
+            dst.ParallelCopy(src);
 
-                if        (bdyVarType == WRFBdyVars::U) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_ylo[nt].push_back(FArrayBox(ylo_plane_x_stag , 1)); // U
-                    }
-                } else if (bdyVarType == WRFBdyVars::V) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_ylo[nt].push_back(FArrayBox(ylo_plane_y_stag, 1)); // V
-                    }
-                } else if (bdyVarType == WRFBdyVars::R) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_ylo[nt].push_back(FArrayBox(ylo_plane_no_stag, 1)); // R
-                    }
-                } else if (bdyVarType == WRFBdyVars::T) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_ylo[nt].push_back(FArrayBox(ylo_plane_no_stag, 1)); // T
-                    }
-                } else if (bdyVarType == WRFBdyVars::QV) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_ylo[nt].push_back(FArrayBox(ylo_plane_no_stag, 1)); // QV
-                    }
-                } else if (bdyVarType == WRFBdyVars::MU ||
-                           bdyVarType == WRFBdyVars::PC) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_ylo[nt].push_back(FArrayBox(ylo_line, 1)); // PC
-                    }
+            // The pieces of this rank go into one FAB indexed like the strip; the
+            //    cells between them are never used, but we zero them anyway
+            Box local_bx;
+            for (MFIter mfi(dst); mfi.isValid(); ++mfi) {
+                const Box& bx = dst[mfi].box();
+                local_bx = local_bx.ok() ? local_bx.minBox(bx) : bx;
+            }
+            if (local_bx.ok()) {
+                fab.resize(local_bx, 1);
+                fab.template setVal<RunOn::Device>(0.0);
+                for (MFIter mfi(dst); mfi.isValid(); ++mfi) {
+                    fab.template copy<RunOn::Device>(dst[mfi]);
                 }
+            }
+        } // ivar
+    } // face
+}
 
-            } else if (bdyType == WRFBdyTypes::y_hi) {
+void
+ReadWRFBdy::convert (int face, Vector<FArrayBox>& bdy) const
+{
+    // These were filled from wrfinput
+    Array4<Real const> c1h_arr  = m_c1h.const_array();
+    Array4<Real const> c2h_arr  = m_c2h.const_array();
+    Array4<Real const> rdnw_arr = m_rdnw.const_array();
+    Array4<Real const> mub_arr  = m_mub[face].const_array();
+
+    Array4<Real const>  ph_arr  = m_ph[face].const_array();
+    Array4<Real const> phb_arr  = m_phb[face].const_array();
+
+    Array4<Real> bdy_u_arr  = bdy[WRFBdyVars::U].array();  // This is face-centered
+    Array4<Real> bdy_v_arr  = bdy[WRFBdyVars::V].array();
+    Array4<Real> bdy_r_arr  = bdy[WRFBdyVars::R].array();
+    Array4<Real> bdy_t_arr  = bdy[WRFBdyVars::T].array();
+    Array4<Real> bdy_qv_arr = bdy[WRFBdyVars::QV].array();
+    Array4<Real> mu_arr     = bdy[WRFBdyVars::MU].array(); // This is cell-centered
+
+    int ilo  = m_domain.smallEnd()[0];
+    int ihi  = m_domain.bigEnd()[0];
+    int jlo  = m_domain.smallEnd()[1];
+    int jhi  = m_domain.bigEnd()[1];
+
+    const auto & bx_u  = bdy[WRFBdyVars::U].box();
+    amrex::ParallelFor(bx_u, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
+        Real xmu;
+        if (i == ilo) {
+            xmu  = mu_arr(i,j,0) + mub_arr(i,j,0);
+        } else if (i > ihi) {
+            xmu  = mu_arr(i-1,j,0) + mub_arr(i-1,j,0);
+        } else {
+            xmu = ( mu_arr(i,j,0) +  mu_arr(i-1,j,0)
+                  +mub_arr(i,j,0) + mub_arr(i-1,j,0)) * 0.5;
+        }
+        Real xmu_mult = c1h_arr(0,0,k) * xmu + c2h_arr(0,0,k);
+        Real new_bdy = bdy_u_arr(i,j,k) / xmu_mult;
+        bdy_u_arr(i,j,k) = new_bdy;
+    });
+
+    const auto & bx_v  = bdy[WRFBdyVars::V].box();
+    amrex::ParallelFor(bx_v, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
+        Real xmu;
+        if (j == jlo) {
+            xmu  = mu_arr(i,j,0) + mub_arr(i,j,0);
+        } else if (j > jhi) {
+            xmu  = mu_arr(i,j-1,0) + mub_arr(i,j-1,0);
+        } else {
+            xmu =  ( mu_arr(i,j,0) +  mu_arr(i,j-1,0)
+                   +mub_arr(i,j,0) + mub_arr(i,j-1,0) ) * 0.5;
+        }
+        Real xmu_mult = c1h_arr(0,0,k) * xmu + c2h_arr(0,0,k);
+        Real new_bdy = bdy_v_arr(i,j,k) / xmu_mult;
+        bdy_v_arr(i,j,k) = new_bdy;
+    });
 
-                // *******************************************************************************
-                // yhi bdy
-                // *******************************************************************************
-                plo[1] = hi[1]-width+1; plo[0] = lo[0]; plo[2] = lo[2];
-                phi[1] = hi[1]        ; phi[0] = hi[0]; phi[2] = hi[2];
-                const Box pbx_yhi(plo, phi);
+    const auto & bx_t = bdy[WRFBdyVars::T].box(); // Note this is currently "THM" aka the perturbational moist pot. temp.
 
-                Box yhi_plane_no_stag(pbx_yhi);
-                Box yhi_plane_x_stag = convert(pbx_yhi, {1, 0, 0});
-                Box yhi_plane_y_stag = pbx_yhi; yhi_plane_y_stag.shiftHalf(1,1);
+    // Define density
+    amrex::ParallelFor(bx_t, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
 
-                Box yhi_line(IntVect(lo[0], hi[1]-width+1, 0), IntVect(hi[0], hi[1], 0));
+        Real xmu = c1h_arr(0,0,k) * (mu_arr(i,j,0) + mub_arr(i,j,0)) + c2h_arr(0,0,k);
 
-                //amrex::Print() << "HI YBX NO STAG " << pbx_yhi << std::endl;
-                //amrex::Print() << "HI YBX  X STAG " << yhi_plane_x_stag << std::endl;
-                //amrex::Print() << "HI YBX  Y STAG " << yhi_plane_y_stag << std::endl;
+        Real dpht =  (ph_arr(i,j,k+1) + phb_arr(i,j,k+1)) - (ph_arr(i,j,k) + phb_arr(i,j,k));
 
-                if        (bdyVarType == WRFBdyVars::U) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_yhi[nt].push_back(FArrayBox(yhi_plane_x_stag , 1)); // U
-                    }
-                } else if (bdyVarType == WRFBdyVars::V) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_yhi[nt].push_back(FArrayBox(yhi_plane_y_stag, 1)); // V
-                    }
-                } else if (bdyVarType == WRFBdyVars::R) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_yhi[nt].push_back(FArrayBox(yhi_plane_no_stag, 1)); // R
-                    }
-                } else if (bdyVarType == WRFBdyVars::T) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_yhi[nt].push_back(FArrayBox(yhi_plane_no_stag, 1)); // T
-                    }
-                } else if (bdyVarType == WRFBdyVars::QV) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_yhi[nt].push_back(FArrayBox(yhi_plane_no_stag, 1)); // QV
-                    }
-                } else if (bdyVarType == WRFBdyVars::MU ||
-                           bdyVarType == WRFBdyVars::PC) {
-                    for (int nt(0); nt < ntimes; ++nt) {
-                        bdy_data_yhi[nt].push_back(FArrayBox(yhi_line, 1)); // PC
-                    }
-                }
-        }
+        bdy_r_arr(i,j,k) = -xmu / ( dpht * rdnw_arr(0,0,k) );
+    });
 
-        long num_pts;
+    // Define theta
+    amrex::Real theta_ref = 300.;
+    amrex::ParallelFor(bx_t, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
 
-        // Now fill the data
-        if (ParallelDescriptor::IOProcessor())
-        {
-            // amrex::Print() << "SHAPE0 " << arrays[iv].get_vshape()[0] << std::endl;
-            // amrex::Print() << "SHAPE1 " << arrays[iv].get_vshape()[1] << std::endl;
-            // amrex::Print() << "SHAPE2 " << arrays[iv].get_vshape()[2] << std::endl;
-            // amrex::Print() << "SHAPE3 " << arrays[iv].get_vshape()[3] << std::endl;
-
-            Array4<Real> fab_arr;
-            if (bdyVarType == WRFBdyVars::U || bdyVarType == WRFBdyVars::V ||
-                bdyVarType == WRFBdyVars::R || bdyVarType == WRFBdyVars::T ||
-                bdyVarType == WRFBdyVars::QV)
-            {
-                int ns2 = arrays[iv].get_vshape()[2];
-                int ns3 = arrays[iv].get_vshape()[3];
-
-                if (bdyType == WRFBdyTypes::x_lo) {
-                    num_pts  = bdy_data_xlo[0][bdyVarType].box().numPts();
-                    int ioff = bdy_data_xlo[0][bdyVarType].smallEnd()[0];
-                    for (int nt(0); nt < ntimes; ++nt)
-                    {
-                        fab_arr  = bdy_data_xlo[nt][bdyVarType].array();
-                        int n_off = nt * num_pts;
-                        for (int n(0); n < num_pts; ++n) {
-                            int i = n / (ns2 * ns3);
-                            int k = (n - i * (ns2 * ns3)) / ns3;
-                            int j =  n - i * (ns2 * ns3) - k * ns3;
-                            fab_arr(ioff+i, j, k, 0) = static_cast<Real>(*(arrays[iv].get_data() + n + n_off));
-                        }
-                    }
-                } else if (bdyType == WRFBdyTypes::x_hi) {
-                    num_pts  = bdy_data_xhi[0][bdyVarType].box().numPts();
-                    int ioff = bdy_data_xhi[0][bdyVarType].bigEnd()[0];
-                    for (int nt(0); nt < ntimes; ++nt)
-                    {
-                        fab_arr  = bdy_data_xhi[nt][bdyVarType].array();
-                        int n_off = nt * num_pts;
-                        for (int n(0); n < num_pts; ++n) {
-                            int i = n / (ns2 * ns3);
-                            int k = (n - i * (ns2 * ns3)) / ns3;
-                            int j =  n - i * (ns2 * ns3) - k * ns3;
-                            fab_arr(ioff-i, j, k, 0) = static_cast<Real>(*(arrays[iv].get_data() + n + n_off));
-                        }
-                    }
-                } else if (bdyType == WRFBdyTypes::y_lo) {
-                    num_pts  = bdy_data_ylo[0][bdyVarType].box().numPts();
-                    int joff = bdy_data_ylo[0][bdyVarType].smallEnd()[1];
-                    for (int nt(0); nt < ntimes; ++nt)
-                    {
-                        fab_arr  = bdy_data_ylo[nt][bdyVarType].array();
-                        int n_off = nt * num_pts;
-                        for (int n(0); n < num_pts; ++n) {
-                            int j = n / (ns2 * ns3);
-                            int k = (n - j * (ns2 * ns3)) / ns3;
-                            int i =  n - j * (ns2 * ns3) - k * ns3;
-                            fab_arr(i, joff+j, k, 0) = static_cast<Real>(*(arrays[iv].get_data() + n + n_off));
-                        }
-                    }
-                } else if (bdyType == WRFBdyTypes::y_hi) {
-                    num_pts  = bdy_data_yhi[0][bdyVarType].box().numPts();
-                    int joff = bdy_data_yhi[0][bdyVarType].bigEnd()[1];
-                    for (int nt(0); nt < ntimes; ++nt)
-                    {
-                        fab_arr  = bdy_data_yhi[nt][bdyVarType].array();
-                        int n_off = nt * num_pts;
-                        for (int n(0); n < num_pts; ++n) {
-                            int j = n / (ns2 * ns3);
-                            int k = (n - j * (ns2 * ns3)) / ns3;
-                            int i =  n - j * (ns2 * ns3) - k * ns3;
-                            fab_arr(i, joff-j, k, 0) = static_cast<Real>(*(arrays[iv].get_data() + n + n_off));
-                        }
-                    }
-                } // bdyType
-
-            } else if (bdyVarType == WRFBdyVars::MU || bdyVarType == WRFBdyVars::PC) {
-
-                if (bdyType == WRFBdyTypes::x_lo) {
-                    num_pts  = bdy_data_xlo[0][bdyVarType].box().numPts();
-                    int ioff = bdy_data_xlo[0][bdyVarType].smallEnd()[0];
-                    int ns2 = arrays[iv].get_vshape()[2];
-                    for (int nt(0); nt < ntimes; ++nt)
-                    {
-                        fab_arr  = bdy_data_xlo[nt][bdyVarType].array();
-
-                        int n_off = nt * num_pts;
-                        for (int n(0); n < num_pts; ++n) {
-                            int i = n / ns2;
-                            int j = n - i * ns2;
-                            fab_arr(ioff+i, j, 0, 0) = static_cast<Real>(*(arrays[iv].get_data() + n + n_off));
-                        }
-                    }
-                } else if (bdyType == WRFBdyTypes::x_hi) {
-                    num_pts  = bdy_data_xhi[0][bdyVarType].box().numPts();
-                    int ioff = bdy_data_xhi[0][bdyVarType].bigEnd()[0];
-                    int ns2 = arrays[iv].get_vshape()[2];
-                    for (int nt(0); nt < ntimes; ++nt)
-                    {
-                        fab_arr  = bdy_data_xhi[nt][bdyVarType].array();
-
-                        int n_off = nt * num_pts;
-                        for (int n(0); n < num_pts; ++n) {
-                            int i = n / ns2;
-                            int j = n - i * ns2;
-                            fab_arr(ioff-i, j, 0, 0) = static_cast<Real>(*(arrays[iv].get_data() + n + n_off));
-                        }
-                    }
-                } else if (bdyType == WRFBdyTypes::y_lo) {
-                    num_pts  = bdy_data_ylo[0][bdyVarType].box().numPts();
-                    int joff = bdy_data_ylo[0][bdyVarType].smallEnd()[1];
-                    int ns2 = arrays[iv].get_vshape()[2];
-                    for (int nt(0); nt < ntimes; ++nt)
-                    {
-                        fab_arr  = bdy_data_ylo[nt][bdyVarType].array();
-
-                        int n_off = nt * num_pts;
-                        for (int n(0); n < num_pts; ++n) {
-                            int j = n / ns2;
-                            int i = n - j * ns2;
-                            fab_arr(i, joff+j, 0, 0) = static_cast<Real>(*(arrays[iv].get_data() + n + n_off));
-                        }
-                    }
-                } else if (bdyType == WRFBdyTypes::y_hi) {
-                    num_pts  = bdy_data_yhi[0][bdyVarType].box().numPts();
-                    int joff = bdy_data_yhi[0][bdyVarType].bigEnd()[1];
-                    int ns2 = arrays[iv].get_vshape()[2];
-                    for (int nt(0); nt < ntimes; ++nt)
-                    {
-                        fab_arr  = bdy_data_yhi[nt][bdyVarType].array();
-
-                        int n_off = nt * num_pts;
-                        for (int n(0); n < num_pts; ++n) {
-                            int j = n / ns2;
-                            int i = n - j * ns2;
-                            fab_arr(i, joff-j, 0, 0) = static_cast<Real>(*(arrays[iv].get_data() + n + n_off));
-                        }
-                    }
-                }
-            } // bdyVarType
-        } // if ParalleDescriptor::IOProcessor()
-    } // nc_var_names
-
-    // We put a barrier here so the rest of the processors wait to do anything until they have the data
-    amrex::ParallelDescriptor::Barrier();
-
-    // When an FArrayBox is built, space is allocated on every rank.  However, we only
-    //    filled the data in these FABs on the IOProcessor.  So here we broadcast
-    //    the data to every rank.
-    int n_per_time = nc_var_prefix.size();
-    for (int nt = 0; nt < ntimes; nt++)
-    {
-        for (int i = 0; i < n_per_time; i++)
-        {
-            ParallelDescriptor::Bcast(bdy_data_xlo[nt][i].dataPtr(),bdy_data_xlo[nt][i].box().numPts(),ioproc);
-            ParallelDescriptor::Bcast(bdy_data_xhi[nt][i].dataPtr(),bdy_data_xhi[nt][i].box().numPts(),ioproc);
-            ParallelDescriptor::Bcast(bdy_data_ylo[nt][i].dataPtr(),bdy_data_ylo[nt][i].box().numPts(),ioproc);
-            ParallelDescriptor::Bcast(bdy_data_yhi[nt][i].dataPtr(),bdy_data_yhi[nt][i].box().numPts(),ioproc);
-        }
-    }
+        Real xmu  = (mu_arr(i,j,0) + mub_arr(i,j,0));
+        Real xmu_mult = c1h_arr(0,0,k) * xmu + c2h_arr(0,0,k);
 
-    // Make sure all processors know how timeInterval
-    ParallelDescriptor::Bcast(&timeInterval,1,ioproc);
+        Real new_bdy_Th = bdy_t_arr(i,j,k) / xmu_mult + theta_ref;
 
-    // Make sure all processors know how many times are stored
-    ParallelDescriptor::Bcast(&ntimes,1,ioproc);
+        Real qv_fac = (1. + bdy_qv_arr(i,j,k) / 0.622 / xmu_mult);
 
-    // Return the number of seconds between the boundary plane data
-    return timeInterval;
-}
+        new_bdy_Th /= qv_fac;
 
-void
-convert_wrfbdy_data(int which, const Box& domain, Vector<Vector<FArrayBox>>& bdy_data,
-                    const FArrayBox& NC_MUB_fab,
-                    const FArrayBox& NC_MSFU_fab, const FArrayBox& NC_MSFV_fab,
-                    const FArrayBox& NC_MSFM_fab,
-                    const FArrayBox& NC_PH_fab, const FArrayBox& NC_PHB_fab,
-                    const FArrayBox& NC_C1H_fab, const FArrayBox& NC_C2H_fab,
-                    const FArrayBox& NC_RDNW_fab,
-                    const FArrayBox& NC_xvel_fab, const FArrayBox& NC_yvel_fab,
-                    const FArrayBox& NC_rho_fab, const FArrayBox& NC_rhotheta_fab)
-{
-    // These were filled from wrfinput
-    Array4<Real const> c1h_arr  = NC_C1H_fab.const_array();
-    Array4<Real const> c2h_arr  = NC_C2H_fab.const_array();
-    Array4<Real const> rdnw_arr = NC_RDNW_fab.const_array();
-    Array4<Real const> mub_arr  = NC_MUB_fab.const_array();
-    Array4<Real const> msfu_arr = NC_MSFU_fab.const_array();
-    Array4<Real const> msfv_arr = NC_MSFV_fab.const_array();
-
-    Array4<Real const>  ph_arr  = NC_PH_fab.const_array();
-    Array4<Real const> phb_arr  = NC_PHB_fab.const_array();
-
-    Array4<Real const> u_arr   = NC_xvel_fab.const_array();
-    Array4<Real const> v_arr   = NC_yvel_fab.const_array();
-    Array4<Real const> r_arr   = NC_rho_fab.const_array();
-    Array4<Real const> rth_arr = NC_rhotheta_fab.const_array();
-
-    int ntimes = bdy_data.size();
-    for (int nt = 0; nt < ntimes; nt++)
-    {
-        Array4<Real> bdy_u_arr  = bdy_data[nt][WRFBdyVars::U].array();  // This is face-centered
-        Array4<Real> bdy_v_arr  = bdy_data[nt][WRFBdyVars::V].array();
-        Array4<Real> bdy_r_arr  = bdy_data[nt][WRFBdyVars::R].array();
-        Array4<Real> bdy_t_arr  = bdy_data[nt][WRFBdyVars::T].array();
-        Array4<Real> bdy_qv_arr = bdy_data[nt][WRFBdyVars::QV].array();
-        Array4<Real> mu_arr     = bdy_data[nt][WRFBdyVars::MU].array(); // This is cell-centered
-
-        int ilo  = domain.smallEnd()[0];
-        int ihi  = domain.bigEnd()[0];
-        int jlo  = domain.smallEnd()[1];
-        int jhi  = domain.bigEnd()[1];
-
-        const auto & bx_u  = bdy_data[0][WRFBdyVars::U].box();
-        amrex::ParallelFor(bx_u, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
-            Real xmu;
-            if (i == ilo) {
-                xmu  = mu_arr(i,j,0) + mub_arr(i,j,0);
-            } else if (i > ihi) {
-                xmu  = mu_arr(i-1,j,0) + mub_arr(i-1,j,0);
-            } else {
-                xmu = ( mu_arr(i,j,0) +  mu_arr(i-1,j,0)
-                      +mub_arr(i,j,0) + mub_arr(i-1,j,0)) * 0.5;
-            }
-            Real xmu_mult = c1h_arr(0,0,k) * xmu + c2h_arr(0,0,k);
-            Real new_bdy = bdy_u_arr(i,j,k) / xmu_mult;
-            bdy_u_arr(i,j,k) = new_bdy;
-        });
-
-#ifndef AMREX_USE_GPU
-        if (nt == 0) {
-            FArrayBox diff(bx_u,1);
-            diff.template copy<RunOn::Device>(bdy_data[0][WRFBdyVars::U]);
-            diff.template minus<RunOn::Device>(NC_xvel_fab);
-            if (which == 0)
-                amrex::Print() << "Max norm of diff between initial U and bdy U on lo x face: " << diff.norm(0) << std::endl;
-            if (which == 1)
-                amrex::Print() << "Max norm of diff between initial U and bdy U on hi x face: " << diff.norm(0) << std::endl;
-            if (which == 2)
-                amrex::Print() << "Max norm of diff between initial U and bdy U on lo y face: " << diff.norm(0) << std::endl;
-            if (which == 3)
-                amrex::Print() << "Max norm of diff between initial U and bdy U on hi y face: " << diff.norm(0) << std::endl;
-        }
-#endif
-
-        const auto & bx_v  = bdy_data[0][WRFBdyVars::V].box();
-        amrex::ParallelFor(bx_v, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
-            Real xmu;
-            if (j == jlo) {
-                xmu  = mu_arr(i,j,0) + mub_arr(i,j,0);
-            } else if (j > jhi) {
-                xmu  = mu_arr(i,j-1,0) + mub_arr(i,j-1,0);
-            } else {
-                xmu =  ( mu_arr(i,j,0) +  mu_arr(i,j-1,0)
-                       +mub_arr(i,j,0) + mub_arr(i,j-1,0) ) * 0.5;
-            }
-            Real xmu_mult = c1h_arr(0,0,k) * xmu + c2h_arr(0,0,k);
-            Real new_bdy = bdy_v_arr(i,j,k) / xmu_mult;
-            bdy_v_arr(i,j,k) = new_bdy;
-        });
-
-#ifndef AMREX_USE_GPU
-        if (nt == 0) {
-            FArrayBox diff(bx_v,1);
-            diff.template copy<RunOn::Device>(bdy_data[0][WRFBdyVars::V]);
-            diff.template minus<RunOn::Device>(NC_yvel_fab);
-            if (which == 0)
-                amrex::Print() << "Max norm of diff between initial V and bdy V on lo x face: " << diff.norm(0) << std::endl;
-            if (which == 1)
-                amrex::Print() << "Max norm of diff between initial V and bdy V on hi x face: " << diff.norm(0) << std::endl;
-            if (which == 2)
-                amrex::Print() << "Max norm of diff between initial V and bdy V on lo y face: " << diff.norm(0) << std::endl;
-            if (which == 3)
-                amrex::Print() << "Max norm of diff between initial V and bdy V on hi y face: " << diff.norm(0) << std::endl;
-        }
-#endif
-
-        const auto & bx_t = bdy_data[0][WRFBdyVars::T].box(); // Note this is currently "THM" aka the perturbational moist pot. temp.
-
-        // Define density
-        amrex::ParallelFor(bx_t, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
-
-            Real xmu = c1h_arr(0,0,k) * (mu_arr(i,j,0) + mub_arr(i,j,0)) + c2h_arr(0,0,k);
-
-            Real dpht =  (ph_arr(i,j,k+1) + phb_arr(i,j,k+1)) - (ph_arr(i,j,k) + phb_arr(i,j,k));
-
-            bdy_r_arr(i,j,k) = -xmu / ( dpht * rdnw_arr(0,0,k) );
-
-            //if (nt == 0 and std::abs(r_arr(i,j,k) - bdy_r_arr(i,j,k)) > 0.) {
-            //    amrex::Print() << "INIT VS BDY DEN " << IntVect(i,j,k) << " " << r_arr(i,j,k) << " " << bdy_r_arr(i,j,k) <<
-            //                    " " << std::abs(r_arr(i,j,k) - bdy_r_arr(i,j,k)) << std::endl;
-            //}
-        });
-
-        // Define theta
-        amrex::Real theta_ref = 300.;
-        amrex::ParallelFor(bx_t, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
-
-            Real xmu  = (mu_arr(i,j,0) + mub_arr(i,j,0));
-            Real xmu_mult = c1h_arr(0,0,k) * xmu + c2h_arr(0,0,k);
-
-            Real new_bdy_Th = bdy_t_arr(i,j,k) / xmu_mult + theta_ref;
-
-            Real qv_fac = (1. + bdy_qv_arr(i,j,k) / 0.622 / xmu_mult);
-
-            new_bdy_Th /= qv_fac;
-
-            bdy_t_arr(i,j,k) = new_bdy_Th * bdy_r_arr(i,j,k);
-
-            //if (nt == 0 and std::abs(rth_arr(i,j,k) - bdy_t_arr(i,j,k)) > 0.) {
-            //    amrex::Print() << "INIT VS BDY TH " << IntVect(i,j,k) << " " << rth_arr(i,j,k) << " " << bdy_t_arr(i,j,k) <<
-            //                    " " << std::abs(th_arr(i,j,k) - bdy_t_arr(i,j,k)) << std::endl;
-            //}
-        });
-
-#ifndef AMREX_USE_GPU
-        if (nt == 0) {
-            FArrayBox diff(bx_t,1);
-            diff.template copy<RunOn::Device>(bdy_data[0][WRFBdyVars::R]);
-            //diff.template mult<RunOn::Device>(NC_rho_fab);
-            diff.template minus<RunOn::Device>(NC_rho_fab);
-            if (which == 0)
-                amrex::Print() << "Max norm of diff between initial r and bdy r on lo x face: " << diff.norm(0) << std::endl;
-            if (which == 1)
-                amrex::Print() << "Max norm of diff between initial r and bdy r on hi x face: " << diff.norm(0) << std::endl;
-            if (which == 2)
-                amrex::Print() << "Max norm of diff between initial r and bdy r on lo y face: " << diff.norm(0) << std::endl;
-            if (which == 3)
-                amrex::Print() << "Max norm of diff between initial r and bdy r on hi y face: " << diff.norm(0) << std::endl;
-
-            diff.template copy<RunOn::Device>(bdy_data[0][WRFBdyVars::T]);
-            diff.template minus<RunOn::Device>(NC_rhotheta_fab);
-            if (which == 0)
-                amrex::Print() << "Max norm of diff between initial rTh and bdy rTh on lo x face: " << diff.norm(0) << std::endl;
-            if (which == 1)
-                amrex::Print() << "Max norm of diff between initial rTh and bdy rTh on hi x face: " << diff.norm(0) << std::endl;
-            if (which == 2)
-                amrex::Print() << "Max norm of diff between initial rTh and bdy rTh on lo y face: " << diff.norm(0) << std::endl;
-            if (which == 3)
-                amrex::Print() << "Max norm of diff between initial rTh and bdy rTh on hi y face: " << diff.norm(0) << std::endl;
-        }
-#endif
+        bdy_t_arr(i,j,k) = new_bdy_Th * bdy_r_arr(i,j,k);
+    });
 
-        // Define Qv
-        const auto & bx_qv = bdy_data[0][WRFBdyVars::QV].box();
-        amrex::ParallelFor(bx_qv, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
+    // Define Qv
+    const auto & bx_qv = bdy[WRFBdyVars::QV].box();
+    amrex::ParallelFor(bx_qv, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept {
 
-            Real xmu  = (mu_arr(i,j,0) + mub_arr(i,j,0));
-            Real xmu_mult = c1h_arr(0,0,k) * xmu + c2h_arr(0,0,k);
+        Real xmu  = (mu_arr(i,j,0) + mub_arr(i,j,0));
+        Real xmu_mult = c1h_arr(0,0,k) * xmu + c2h_arr(0,0,k);
 
-            Real new_bdy_QV = bdy_qv_arr(i,j,k) / xmu_mult;
+        Real new_bdy_QV = bdy_qv_arr(i,j,k) / xmu_mult;
 
-            bdy_qv_arr(i,j,k) = new_bdy_QV * bdy_r_arr(i,j,k);
-        });
-    } // ntimes
+        bdy_qv_arr(i,j,k) = new_bdy_QV * bdy_r_arr(i,j,k);
+    });
 }
 #endif // ERF_USE_NETCDF
@@ -8,28 +8,29 @@ void
 read_from_wrfinput(int lev,
                    const Box& domain,
                    const std::string& fname,
-                   FArrayBox& NC_xvel_fab, FArrayBox& NC_yvel_fab,
-                   FArrayBox& NC_zvel_fab, FArrayBox& NC_rho_fab,
-                   FArrayBox& NC_rhop_fab, FArrayBox& NC_rhotheta_fab,
-                   FArrayBox& NC_MUB_fab ,
-                   FArrayBox& NC_MSFU_fab, FArrayBox& NC_MSFV_fab,
-                   FArrayBox& NC_MSFM_fab, FArrayBox& NC_SST_fab,
-                   FArrayBox& NC_C1H_fab , FArrayBox& NC_C2H_fab,
-                   FArrayBox& NC_RDNW_fab,
+                   const Vector<Box>& regions,
+                   Vector<FArrayBox>& NC_xvel_fab, Vector<FArrayBox>& NC_yvel_fab,
+                   Vector<FArrayBox>& NC_zvel_fab, Vector<FArrayBox>& NC_rho_fab,
+                   Vector<FArrayBox>& NC_rhop_fab, Vector<FArrayBox>& NC_rhotheta_fab,
+                   Vector<FArrayBox>& NC_MUB_fab ,
+                   Vector<FArrayBox>& NC_MSFU_fab, Vector<FArrayBox>& NC_MSFV_fab,
+                   Vector<FArrayBox>& NC_MSFM_fab, Vector<FArrayBox>& NC_SST_fab,
+                   Vector<FArrayBox>& NC_C1H_fab , Vector<FArrayBox>& NC_C2H_fab,
+                   Vector<FArrayBox>& NC_RDNW_fab,
 #if defined(ERF_USE_MOISTURE)
-                   FArrayBox& NC_QVAPOR_fab,
-                   FArrayBox& NC_QCLOUD_fab,
-                   FArrayBox& NC_QRAIN_fab,
+                   Vector<FArrayBox>& NC_QVAPOR_fab,
+                   Vector<FArrayBox>& NC_QCLOUD_fab,
+                   Vector<FArrayBox>& NC_QRAIN_fab,
 #elif defined(ERF_USE_WARM_NO_PRECIP)
 #endif
-                   FArrayBox& NC_PH_fab  , FArrayBox& NC_PHB_fab,
-                   FArrayBox& NC_ALB_fab , FArrayBox& NC_PB_fab)
+                   Vector<FArrayBox>& NC_PH_fab  , Vector<FArrayBox>& NC_PHB_fab,
+                   Vector<FArrayBox>& NC_ALB_fab , Vector<FArrayBox>& NC_PB_fab)
 {
     amrex::Print() << "Loading initial data from NetCDF file at level " << lev << std::endl;
 
     int ncomp = 1;
 
-    Vector<FArrayBox*> NC_fabs;
+    Vector<Vector<FArrayBox>*> NC_fabs;
     Vector<std::string> NC_names;
     Vector<enum NC_Data_Dims_Type> NC_dim_types;
 
@@ -60,45 +61,50 @@ read_from_wrfinput(int lev,
 
     // Read the netcdf file and fill these FABs
     amrex::Print() << "Building initial FABS from file " << fname << std::endl;
-    BuildFABsFromNetCDFFile(domain, fname, NC_names, NC_dim_types, NC_fabs);
+    BuildFABsFromNetCDFFile(domain, fname, regions, NC_names, NC_dim_types, NC_fabs);
 
-    //
-    // Convert the velocities using the map factors
-    //
-    const Box& uubx = NC_xvel_fab.box();
-    const Array4<Real>    u_arr = NC_xvel_fab.array();
-    const Array4<Real> msfu_arr = NC_MSFU_fab.array();
-    ParallelFor(uubx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+    for (int n = 0; n < regions.size(); n++)
     {
-        u_arr(i,j,k) /= msfu_arr(i,j,0);
-    });
+        if (!regions[n].ok()) continue;
 
-    const Box& vvbx = NC_yvel_fab.box();
-    const Array4<Real>    v_arr = NC_yvel_fab.array();
-    const Array4<Real> msfv_arr = NC_MSFV_fab.array();
-    ParallelFor(vvbx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
-    {
-        v_arr(i,j,k) /= msfv_arr(i,j,0);
-    });
+        //
+        // Convert the velocities using the map factors
+        //
+        const Box& uubx = NC_xvel_fab[n].box();
+        const Array4<Real>    u_arr = NC_xvel_fab[n].array();
+        const Array4<Real> msfu_arr = NC_MSFU_fab[n].array();
+        ParallelFor(uubx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+        {
+            u_arr(i,j,k) /= msfu_arr(i,j,0);
+        });
 
-    const Box& wwbx = NC_zvel_fab.box();
-    const Array4<Real>    w_arr = NC_zvel_fab.array();
-    const Array4<Real> msfw_arr = NC_MSFM_fab.array();
-    ParallelFor(wwbx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
-    {
-        w_arr(i,j,k) /= msfw_arr(i,j,0);
-    });
+        const Box& vvbx = NC_yvel_fab[n].box();
+        const Array4<Real>    v_arr = NC_yvel_fab[n].array();
+        const Array4<Real> msfv_arr = NC_MSFV_fab[n].array();
+        ParallelFor(vvbx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+        {
+            v_arr(i,j,k) /= msfv_arr(i,j,0);
+        });
+
+        const Box& wwbx = NC_zvel_fab[n].box();
+        const Array4<Real>    w_arr = NC_zvel_fab[n].array();
+        const Array4<Real> msfw_arr = NC_MSFM_fab[n].array();
+        ParallelFor(wwbx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
+        {
+            w_arr(i,j,k) /= msfw_arr(i,j,0);
+        });
 
-    //
-    // WRF decomposes (1/rho) rather than rho so rho = 1/(ALB + AL)
-    //
-    NC_rho_fab.template plus<RunOn::Device>(NC_rhop_fab, 0, 0, 1);
-    NC_rho_fab.template invert<RunOn::Device>(1.0);
+        //
+        // WRF decomposes (1/rho) rather than rho so rho = 1/(ALB + AL)
+        //
+        NC_rho_fab[n].template plus<RunOn::Device>(NC_rhop_fab[n], 0, 0, 1);
+        NC_rho_fab[n].template invert<RunOn::Device>(1.0);
 
-    const Real theta_ref = 300.0;
-    NC_rhotheta_fab.template plus<RunOn::Device>(theta_ref);
+        const Real theta_ref = 300.0;
+        NC_rhotheta_fab[n].template plus<RunOn::Device>(theta_ref);
 
-    // Now multiply by rho to get (rho theta) instead of theta
-    NC_rhotheta_fab.template mult<RunOn::Device>(NC_rho_fab,0,0,1);
+        // Now multiply by rho to get (rho theta) instead of theta
+        NC_rhotheta_fab[n].template mult<RunOn::Device>(NC_rho_fab[n],0,0,1);
+    }
 }
 #endif // ERF_USE_NETCDF
@@ -12,41 +12,42 @@ using namespace amrex;
 
 void
 read_from_metgrid(int lev, const Box& domain, const std::string& fname,
-                  FArrayBox& NC_xvel_fab, FArrayBox& NC_yvel_fab,
-                  FArrayBox& NC_temp_fab, FArrayBox& NC_rhum_fab,
-                  FArrayBox& NC_pres_fab, FArrayBox& NC_hgt_fab,
-                  FArrayBox& NC_msfu_fab, FArrayBox& NC_msfv_fab,
-                  FArrayBox& NC_msfm_fab);
+                  const Vector<Box>& regions,
+                  Vector<FArrayBox>& NC_xvel_fab, Vector<FArrayBox>& NC_yvel_fab,
+                  Vector<FArrayBox>& NC_temp_fab, Vector<FArrayBox>& NC_rhum_fab,
+                  Vector<FArrayBox>& NC_pres_fab, Vector<FArrayBox>& NC_hgt_fab,
+                  Vector<FArrayBox>& NC_msfu_fab, Vector<FArrayBox>& NC_msfv_fab,
+                  Vector<FArrayBox>& NC_msfm_fab);
 void
 interpolate_column(int i, int j, int src_comp, int dest_comp,
                    const Array4<Real const>& orig_z, const Array4<Real const>& orig_data,
                    const Array4<Real const>&  new_z, const Array4<Real>&  new_data);
 
 void
-init_terrain_from_metgrid(int lev, FArrayBox& z_phys_nd_fab,
-                          const Vector<FArrayBox>& NC_hgt_fab);
+init_terrain_from_metgrid(int lev, const Box& nc_box, FArrayBox& z_phys_nd_fab,
+                          const FArrayBox& NC_hgt_fab);
 
 void
 init_state_from_metgrid(int lev, FArrayBox& state_fab,
                         FArrayBox& x_vel_fab, FArrayBox& y_vel_fab,
                         FArrayBox& z_vel_fab, FArrayBox& z_phys_nd_fab,
-                        const Vector<FArrayBox>& NC_hgt_fab,
-                        const Vector<FArrayBox>& NC_xvel_fab,
-                        const Vector<FArrayBox>& NC_yvel_fab,
-                        const Vector<FArrayBox>& NC_zvel_fab,
-                        const Vector<FArrayBox>& NC_rho_fab,
-                        const Vector<FArrayBox>& NC_rhotheta_fab);
+                        const FArrayBox& NC_hgt_fab,
+                        const FArrayBox& NC_xvel_fab,
+                        const FArrayBox& NC_yvel_fab,
+                        const FArrayBox& NC_zvel_fab,
+                        const FArrayBox& NC_rho_fab,
+                        const FArrayBox& NC_rhotheta_fab);
 void
 init_msfs_from_metgrid(int lev, FArrayBox& msfu_fab,
                        FArrayBox& msfv_fab, FArrayBox& msfm_fab,
-                       const Vector<FArrayBox>& NC_MSFU_fab,
-                       const Vector<FArrayBox>& NC_MSFV_fab,
-                       const Vector<FArrayBox>& NC_MSFM_fab);
+                       const FArrayBox& NC_MSFU_fab,
+                       const FArrayBox& NC_MSFV_fab,
+                       const FArrayBox& NC_MSFM_fab);
 void
 init_base_state_from_metgrid(int lev, const Box& valid_bx, Real l_rdOcp,
                              FArrayBox& p_hse, FArrayBox& pi_hse, FArrayBox& r_hse,
-                             const Vector<FArrayBox>& NC_ALB_fab,
-                             const Vector<FArrayBox>& NC_PB_fab);
+                             const FArrayBox& NC_ALB_fab,
+                             const FArrayBox& NC_PB_fab);
 
 #ifdef ERF_USE_NETCDF
 /**
@@ -57,18 +58,32 @@ init_base_state_from_metgrid(int lev, const Box& valid_bx, Real l_rdOcp,
 void
 ERF::init_from_metgrid(int lev)
 {
+    auto& lev_new = vars_new[lev];
+
+    // Each rank only reads the columns under its own grids (grown by enough cells to fill
+    //    the ghost cells and the terrain), so we hold one FArrayBox per local grid
+    int ngrow = mapfac_u[lev]->nGrow();
+    for (const auto& mf : lev_new) ngrow = std::max(ngrow, mf.nGrow());
+    if (z_phys_nd[lev]) ngrow = std::max(ngrow, z_phys_nd[lev]->nGrow());
+    ngrow += 1;
+
+    const int nlocal = lev_new[Vars::cons].local_size();
+
     // *** FArrayBox's at this level for holding the INITIAL data
-    Vector<FArrayBox> NC_xvel_fab ; NC_xvel_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_yvel_fab ; NC_yvel_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_temp_fab ; NC_temp_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_rhum_fab ; NC_rhum_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_pres_fab ; NC_pres_fab.resize(num_boxes_at_level[lev]);
+    Vector<FArrayBox> NC_xvel_fab ; NC_xvel_fab.resize(nlocal);
+    Vector<FArrayBox> NC_yvel_fab ; NC_yvel_fab.resize(nlocal);
+    Vector<FArrayBox> NC_temp_fab ; NC_temp_fab.resize(nlocal);
+    Vector<FArrayBox> NC_rhum_fab ; NC_rhum_fab.resize(nlocal);
+    Vector<FArrayBox> NC_pres_fab ; NC_pres_fab.resize(nlocal);
+
+    Vector<FArrayBox> NC_hgt_fab ; NC_hgt_fab.resize(nlocal);
 
-    Vector<FArrayBox> NC_hgt_fab ; NC_hgt_fab.resize(num_boxes_at_level[lev]);
+    Vector<FArrayBox> NC_MSFU_fab ; NC_MSFU_fab.resize(nlocal);
+    Vector<FArrayBox> NC_MSFV_fab ; NC_MSFV_fab.resize(nlocal);
+    Vector<FArrayBox> NC_MSFM_fab ; NC_MSFM_fab.resize(nlocal);
 
-    Vector<FArrayBox> NC_MSFU_fab ; NC_MSFU_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_MSFV_fab ; NC_MSFV_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_MSFM_fab ; NC_MSFM_fab.resize(num_boxes_at_level[lev]);
+    // Index of the file each local grid takes its data from
+    Vector<int> nc_file_idx(nlocal,-1);
 
     int nboxes = num_boxes_at_level[lev];
 
@@ -80,14 +95,25 @@ ERF::init_from_metgrid(int lev)
 
     for (int idx = 0; idx < nboxes; idx++)
     {
-        read_from_metgrid(lev, boxes_at_level[lev][idx], nc_init_file[lev][idx],
-                          NC_xvel_fab[idx], NC_yvel_fab[idx],
-                          NC_temp_fab[idx], NC_rhum_fab[idx],
-                          NC_pres_fab[idx], NC_hgt_fab[idx],
-                          NC_MSFU_fab[idx], NC_MSFV_fab[idx], NC_MSFM_fab[idx] );
-    }
+        // Local grids (not already covered by an earlier file) that this file touches
+        Vector<Box> regions(nlocal);
+        for ( MFIter mfi(lev_new[Vars::cons], false); mfi.isValid(); ++mfi )
+        {
+            const int li = mfi.LocalIndex();
+            Box bx = amrex::grow(mfi.validbox(), IntVect(ngrow,ngrow,0));
+            if (nc_file_idx[li] < 0 && bx.intersects(boxes_at_level[lev][idx])) {
+                regions[li]     = bx;
+                nc_file_idx[li] = idx;
+            }
+        }
 
-    auto& lev_new = vars_new[lev];
+        // Every rank calls this since the file is opened collectively
+        read_from_metgrid(lev, boxes_at_level[lev][idx], nc_init_file[lev][idx], regions,
+                          NC_xvel_fab, NC_yvel_fab,
+                          NC_temp_fab, NC_rhum_fab,
+                          NC_pres_fab, NC_hgt_fab,
+                          NC_MSFU_fab, NC_MSFV_fab, NC_MSFM_fab);
+    }
 
     std::unique_ptr<MultiFab>& z_phys = z_phys_nd[lev];
 
@@ -99,7 +125,8 @@ ERF::init_from_metgrid(int lev)
     {
         // This defines only the z(i,j,0) values given the FAB filled from the NetCDF input
         FArrayBox& z_phys_nd_fab = (*z_phys)[mfi];
-        init_terrain_from_metgrid(lev, z_phys_nd_fab, NC_hgt_fab);
+        const int li = mfi.LocalIndex();
+        init_terrain_from_metgrid(lev, boxes_at_level[lev][nc_file_idx[li]], z_phys_nd_fab, NC_hgt_fab[li]);
     } // mf
 
     // This defines all the z(i,j,k) values given z(i,j,0) from above.
@@ -123,10 +150,11 @@ ERF::init_from_metgrid(int lev)
         FArrayBox &zvel_fab = lev_new[Vars::zvel][mfi];
 
         FArrayBox& z_phys_nd_fab = (*z_phys)[mfi];
+        const int li = mfi.LocalIndex();
         init_state_from_metgrid(lev, cons_fab, xvel_fab, yvel_fab, zvel_fab,
                                 z_phys_nd_fab,
-                                NC_hgt_fab, NC_xvel_fab, NC_yvel_fab, NC_temp_fab,
-                                NC_rhum_fab, NC_pres_fab);
+                                NC_hgt_fab[li], NC_xvel_fab[li], NC_yvel_fab[li], NC_temp_fab[li],
+                                NC_rhum_fab[li], NC_pres_fab[li]);
     } // mf
 
 #ifdef _OPENMP
@@ -140,8 +168,10 @@ ERF::init_from_metgrid(int lev)
         FArrayBox &msfv_fab = (*mapfac_v[lev])[mfi];
         FArrayBox &msfm_fab = (*mapfac_m[lev])[mfi];
 
+        // The map factors share the BoxArray and DistributionMapping of the state
+        const int li = mfi.LocalIndex();
         init_msfs_from_metgrid(lev, msfu_fab, msfv_fab, msfm_fab,
-                               NC_MSFU_fab, NC_MSFV_fab, NC_MSFM_fab);
+                               NC_MSFU_fab[li], NC_MSFV_fab[li], NC_MSFM_fab[li]);
     } // mf
 
     MultiFab r_hse (base_state[lev], make_alias, 0, 1); // r_0  is first  component
@@ -171,56 +201,53 @@ ERF::init_from_metgrid(int lev)
  * given metgrid data.
  *
  * @param lev Integer specifying the current level
+ * @param nc_box Box specifying the cells covered by the metgrid data
  * @param z_phys_nd_fab FArrayBox (Fab) holding the nodal z coordinates for terrain data we want to fill
- * @param NC_hgt_fab Vector of FArrayBox objects holding height data read from NetCDF files for metgrid data
+ * @param NC_hgt_fab FArrayBox holding height data read from NetCDF files for metgrid data
  */
 void
-init_terrain_from_metgrid(int lev, FArrayBox& z_phys_nd_fab,
-                          const Vector<FArrayBox>& NC_hgt_fab)
+init_terrain_from_metgrid(int lev, const Box& nc_box, FArrayBox& z_phys_nd_fab,
+                          const FArrayBox& NC_hgt_fab)
 {
-   int nboxes = NC_hgt_fab.size();
-
    // NOTE NOTE NOTE -- this routine currently only fills the k=0 value
    // TODO: we need to fill the rest of the values from the pressure (?) variable...
 
-   for (int idx = 0; idx < nboxes; idx++)
-   {
 #ifndef AMREX_USE_GPU
-        amrex::Print() << " SIZE OF HGT FAB " << NC_hgt_fab[idx].box() << std::endl;
-        amrex::Print() << " SIZE OF ZP FAB "  << z_phys_nd_fab.box() << std::endl;
+    amrex::Print() << " SIZE OF HGT FAB " << NC_hgt_fab.box() << std::endl;
+    amrex::Print() << " SIZE OF ZP FAB "  << z_phys_nd_fab.box() << std::endl;
 #endif
 
-        // This copies from NC_zphys on z-faces to z_phys_nd on nodes
-        const Array4<Real      >&      z_arr = z_phys_nd_fab.array();
-        const Array4<Real const>& nc_hgt_arr = NC_hgt_fab[idx].const_array();
+    // This copies from NC_zphys on z-faces to z_phys_nd on nodes
+    const Array4<Real      >&      z_arr = z_phys_nd_fab.array();
+    const Array4<Real const>& nc_hgt_arr = NC_hgt_fab.const_array();
 
-        const Box z_hgt_box = NC_hgt_fab[idx].box();
+    // The data under this grid only, but we clamp to the edges of the whole dataset
+    const Box z_hgt_box = nc_box;
 
-        int ilo = z_hgt_box.smallEnd()[0];
-        int ihi = z_hgt_box.bigEnd()[0];
-        int jlo = z_hgt_box.smallEnd()[1];
-        int jhi = z_hgt_box.bigEnd()[1];
+    int ilo = z_hgt_box.smallEnd()[0];
+    int ihi = z_hgt_box.bigEnd()[0];
+    int jlo = z_hgt_box.smallEnd()[1];
+    int jhi = z_hgt_box.bigEnd()[1];
 
-        Box z_phys_box = z_phys_nd_fab.box();
-        Box   from_box = surroundingNodes(NC_hgt_fab[idx].box()); from_box.growHi(2,-1);
-        Box bx = z_phys_box & from_box;
+    Box z_phys_box = z_phys_nd_fab.box();
+    Box   from_box = surroundingNodes(NC_hgt_fab.box()); from_box.growHi(2,-1);
+    Box bx = z_phys_box & from_box;
 
 #ifndef AMREX_USE_GPU
-        amrex::Print() << "FROM BOX " << from_box << std::endl;
-        amrex::Print() << "BX " << bx << std::endl;
+    amrex::Print() << "FROM BOX " << from_box << std::endl;
+    amrex::Print() << "BX " << bx << std::endl;
 #endif
 
-        //
-        // We must be careful not to read out of bounds of the WPS data
-        //
-        amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept
-        {
-            int ii = std::max(std::min(i,ihi-1),ilo+1);
-            int jj = std::max(std::min(j,jhi-1),jlo+1);
-            z_arr(i,j,k) =  0.25 * ( nc_hgt_arr (ii,jj  ,k) + nc_hgt_arr(ii-1,jj  ,k) +
-                                     nc_hgt_arr (ii,jj-1,k) + nc_hgt_arr(ii-1,jj-1,k) );
-        });
-    } // idx
+    //
+    // We must be careful not to read out of bounds of the WPS data
+    //
+    amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept
+    {
+        int ii = std::max(std::min(i,ihi-1),ilo+1);
+        int jj = std::max(std::min(j,jhi-1),jlo+1);
+        z_arr(i,j,k) =  0.25 * ( nc_hgt_arr (ii,jj  ,k) + nc_hgt_arr(ii-1,jj  ,k) +
+                                 nc_hgt_arr (ii,jj-1,k) + nc_hgt_arr(ii-1,jj-1,k) );
+    });
 }
 
 /**
@@ -233,110 +260,105 @@ init_terrain_from_metgrid(int lev, FArrayBox& z_phys_nd_fab,
  * @param y_vel_fab FArrayBox holding the y-velocity data to initialize
  * @param z_vel_fab FArrayBox holding the z-velocity data to initialize
  * @param z_phys_nd_fab FArrayBox holding nodal z coordinate data for terrain
- * @param NC_hgt_fab Vector of FArrayBox obects holding metgrid data for height
- * @param NC_xvel_fab Vector of FArrayBox obects holding metgrid data for x-velocity
- * @param NC_yvel_fab Vector of FArrayBox obects holding metgrid data for y-velocity
- * @param NC_zvel_fab Vector of FArrayBox obects holding metgrid data for z-velocity
- * @param NC_rho_fab Vector of FArrayBox obects holding metgrid data for density
- * @param NC_rhotheta_fab Vector of FArrayBox obects holding metgrid data for (density * potential temperature)
+ * @param NC_hgt_fab FArrayBox holding metgrid data for height
+ * @param NC_xvel_fab FArrayBox holding metgrid data for x-velocity
+ * @param NC_yvel_fab FArrayBox holding metgrid data for y-velocity
+ * @param NC_zvel_fab FArrayBox holding metgrid data for z-velocity
+ * @param NC_rho_fab FArrayBox holding metgrid data for density
+ * @param NC_rhotheta_fab FArrayBox holding metgrid data for (density * potential temperature)
  */
 void
 init_state_from_metgrid(int lev, FArrayBox& state_fab,
                         FArrayBox& x_vel_fab, FArrayBox& y_vel_fab,
                         FArrayBox& z_vel_fab, FArrayBox& z_phys_nd_fab,
-                        const Vector<FArrayBox>& NC_hgt_fab,
-                        const Vector<FArrayBox>& NC_xvel_fab,
-                        const Vector<FArrayBox>& NC_yvel_fab,
-                        const Vector<FArrayBox>& NC_zvel_fab,
-                        const Vector<FArrayBox>& NC_rho_fab,
-                        const Vector<FArrayBox>& NC_rhotheta_fab)
+                        const FArrayBox& NC_hgt_fab,
+                        const FArrayBox& NC_xvel_fab,
+                        const FArrayBox& NC_yvel_fab,
+                        const FArrayBox& NC_zvel_fab,
+                        const FArrayBox& NC_rho_fab,
+                        const FArrayBox& NC_rhotheta_fab)
 {
-    int nboxes = NC_hgt_fab.size();
-
 #ifndef AMREX_USE_GPU
-    amrex::Print() << " U FROM NC " << NC_xvel_fab[0].box() << std::endl;
+    amrex::Print() << " U FROM NC " << NC_xvel_fab.box() << std::endl;
     amrex::Print() << " U INTO FAB " << x_vel_fab.box() << std::endl;
     exit(0);
 #endif
-    for (int idx = 0; idx < nboxes; idx++)
+    // ********************************************************
+    // U
+    // ********************************************************
     {
-        // ********************************************************
-        // U
-        // ********************************************************
-        {
-        Box bx2d = NC_xvel_fab[idx].box() & x_vel_fab.box();
-        bx2d.setRange(2,0);
-        auto const orig_data = NC_xvel_fab[idx].const_array();
-        auto const orig_z    = NC_hgt_fab[idx].const_array();
+    Box bx2d = NC_xvel_fab.box() & x_vel_fab.box();
+    bx2d.setRange(2,0);
+    auto const orig_data = NC_xvel_fab.const_array();
+    auto const orig_z    = NC_hgt_fab.const_array();
 
-        auto       new_data  = x_vel_fab.array();
-        auto const new_z     = z_phys_nd_fab.const_array();
+    auto       new_data  = x_vel_fab.array();
+    auto const new_z     = z_phys_nd_fab.const_array();
 
-        ParallelFor(bx2d, [=] AMREX_GPU_DEVICE (int i, int j, int)
-        {
-            interpolate_column(i,j,0,0,orig_z,orig_data,new_z,new_data);
-        });
-        }
+    ParallelFor(bx2d, [=] AMREX_GPU_DEVICE (int i, int j, int)
+    {
+        interpolate_column(i,j,0,0,orig_z,orig_data,new_z,new_data);
+    });
+    }
 
-        // ********************************************************
-        // V
-        // ********************************************************
-        {
-        Box bx2d = NC_yvel_fab[idx].box() & y_vel_fab.box();
-        bx2d.setRange(2,0);
-        auto const orig_data = NC_yvel_fab[idx].const_array();
-        auto const orig_z    = NC_hgt_fab[idx].const_array();
+    // ********************************************************
+    // V
+    // ********************************************************
+    {
+    Box bx2d = NC_yvel_fab.box() & y_vel_fab.box();
+    bx2d.setRange(2,0);
+    auto const orig_data = NC_yvel_fab.const_array();
+    auto const orig_z    = NC_hgt_fab.const_array();
 
-        auto       new_data  = y_vel_fab.array();
-        auto const new_z     = z_phys_nd_fab.const_array();
+    auto       new_data  = y_vel_fab.array();
+    auto const new_z     = z_phys_nd_fab.const_array();
 
-        ParallelFor(bx2d, [=] AMREX_GPU_DEVICE (int i, int j, int)
-        {
-            interpolate_column(i,j,0,0,orig_z,orig_data,new_z,new_data);
-        });
-        }
+    ParallelFor(bx2d, [=] AMREX_GPU_DEVICE (int i, int j, int)
+    {
+        interpolate_column(i,j,0,0,orig_z,orig_data,new_z,new_data);
+    });
+    }
 
-        // ********************************************************
-        // W
-        // ********************************************************
-        z_vel_fab.template setVal<RunOn::Device>(0.);
+    // ********************************************************
+    // W
+    // ********************************************************
+    z_vel_fab.template setVal<RunOn::Device>(0.);
 
-        // ********************************************************
-        // rho
-        // ********************************************************
-        {
-        Box bx2d = NC_rho_fab[idx].box() & state_fab.box();
-        bx2d.setRange(2,0);
+    // ********************************************************
+    // rho
+    // ********************************************************
+    {
+    Box bx2d = NC_rho_fab.box() & state_fab.box();
+    bx2d.setRange(2,0);
 
-        auto const orig_data = NC_rho_fab[idx].const_array();
-        auto const orig_z    = NC_hgt_fab[idx].const_array();
-        auto        new_data  = state_fab.array();
-        auto const new_z     = z_phys_nd_fab.const_array();
+    auto const orig_data = NC_rho_fab.const_array();
+    auto const orig_z    = NC_hgt_fab.const_array();
+    auto        new_data  = state_fab.array();
+    auto const new_z     = z_phys_nd_fab.const_array();
 
-        ParallelFor(bx2d, [=] AMREX_GPU_DEVICE (int i, int j, int)
-        {
-            interpolate_column(i,j,0,Rho_comp,orig_z,orig_data,new_z,new_data);
-        });
-        }
+    ParallelFor(bx2d, [=] AMREX_GPU_DEVICE (int i, int j, int)
+    {
+        interpolate_column(i,j,0,Rho_comp,orig_z,orig_data,new_z,new_data);
+    });
+    }
 
-        // ********************************************************
-        // rho_theta
-        // ********************************************************
-        {
-        Box bx2d = NC_rhotheta_fab[idx].box() & state_fab.box();
-        bx2d.setRange(2,0);
+    // ********************************************************
+    // rho_theta
+    // ********************************************************
+    {
+    Box bx2d = NC_rhotheta_fab.box() & state_fab.box();
+    bx2d.setRange(2,0);
 
-        auto const orig_data = NC_rhotheta_fab[idx].const_array();
-        auto const orig_z    = NC_hgt_fab[idx].const_array();
-        auto       new_data  = state_fab.array();
-        auto const new_z     = z_phys_nd_fab.const_array();
+    auto const orig_data = NC_rhotheta_fab.const_array();
+    auto const orig_z    = NC_hgt_fab.const_array();
+    auto       new_data  = state_fab.array();
+    auto const new_z     = z_phys_nd_fab.const_array();
 
-        ParallelFor(bx2d, [=] AMREX_GPU_DEVICE (int i, int j, int)
-        {
-            interpolate_column(i,j,0,RhoTheta_comp,orig_z,orig_data,new_z,new_data);
-        });
-        }
-    } // idx
+    ParallelFor(bx2d, [=] AMREX_GPU_DEVICE (int i, int j, int)
+    {
+        interpolate_column(i,j,0,RhoTheta_comp,orig_z,orig_data,new_z,new_data);
+    });
+    }
 }
 
 /**
@@ -346,34 +368,29 @@ init_state_from_metgrid(int lev, FArrayBox& state_fab,
  * @param msfu_fab FArrayBox specifying x-velocity map factors
  * @param msfv_fab FArrayBox specifying y-velocity map factors
  * @param msfm_fab FArrayBox specifying z-velocity map factors
- * @param NC_MSFU_fab Vector of FArrayBox objects holding metgrid data for x-velocity map factors
- * @param NC_MSFV_fab Vector of FArrayBox objects holding metgrid data for y-velocity map factors
- * @param NC_MSFM_fab Vector of FArrayBox objects holding metgrid data for z-velocity map factors
+ * @param NC_MSFU_fab FArrayBox holding metgrid data for x-velocity map factors
+ * @param NC_MSFV_fab FArrayBox holding metgrid data for y-velocity map factors
+ * @param NC_MSFM_fab FArrayBox holding metgrid data for z-velocity map factors
  */
 void
 init_msfs_from_metgrid(int lev, FArrayBox& msfu_fab,
                        FArrayBox& msfv_fab, FArrayBox& msfm_fab,
-                       const Vector<FArrayBox>& NC_MSFU_fab,
-                       const Vector<FArrayBox>& NC_MSFV_fab,
-                       const Vector<FArrayBox>& NC_MSFM_fab)
+                       const FArrayBox& NC_MSFU_fab,
+                       const FArrayBox& NC_MSFV_fab,
+                       const FArrayBox& NC_MSFM_fab)
 {
-    int nboxes = NC_MSFU_fab.size();
-
-    for (int idx = 0; idx < nboxes; idx++)
-    {
-        //
-        // FArrayBox to FArrayBox copy does "copy on intersection"
-        // This only works here because we have broadcast the FArrayBox of data from the netcdf file to all ranks
-        //
-        // This copies mapfac_u
-        msfu_fab.template copy<RunOn::Device>(NC_MSFU_fab[idx]);
-
-        // This copies mapfac_v
-        msfv_fab.template copy<RunOn::Device>(NC_MSFV_fab[idx]);
-
-        // This copies mapfac_m
-        msfm_fab.template copy<RunOn::Device>(NC_MSFM_fab[idx]);
-    } // idx
+    //
+    // FArrayBox to FArrayBox copy does "copy on intersection"
+    // This only works here because each rank has read the data from the netcdf file under its own grids
+    //
+    // This copies mapfac_u
+    msfu_fab.template copy<RunOn::Device>(NC_MSFU_fab);
+
+    // This copies mapfac_v
+    msfv_fab.template copy<RunOn::Device>(NC_MSFV_fab);
+
+    // This copies mapfac_m
+    msfm_fab.template copy<RunOn::Device>(NC_MSFM_fab);
 }
 
 /**
@@ -385,36 +402,31 @@ init_msfs_from_metgrid(int lev, FArrayBox& msfu_fab,
  * @param p_hse FArrayBox holding the hydrostatic base state pressure we are initializing
  * @param pi_hse FArrayBox holding the hydrostatic base Exner pressure we are initializing
  * @param r_hse FArrayBox holding the hydrostatic base state density we are initializing
- * @param NC_ALB_fab Vector of FArrayBox objects holding metgrid data specifying 1/density
- * @param NC_PB_fab Vector of FArrayBox objects holding metgrid data specifying pressure
+ * @param NC_ALB_fab FArrayBox holding metgrid data specifying 1/density
+ * @param NC_PB_fab FArrayBox holding metgrid data specifying pressure
  */
 void
 init_base_state_from_metgrid(int lev, const Box& valid_bx, const Real l_rdOcp,
                              FArrayBox& p_hse, FArrayBox& pi_hse, FArrayBox& r_hse,
-                             const Vector<FArrayBox>& NC_ALB_fab,
-                             const Vector<FArrayBox>& NC_PB_fab)
+                             const FArrayBox& NC_ALB_fab,
+                             const FArrayBox& NC_PB_fab)
 {
-    int nboxes = NC_ALB_fab.size();
-
-    for (int idx = 0; idx < nboxes; idx++)
-    {
-        //
-        // FArrayBox to FArrayBox copy does "copy on intersection"
-        // This only works here because we have broadcast the FArrayBox of data from the netcdf file to all ranks
-        //
-        const Array4<Real      >&  p_hse_arr =  p_hse.array();
-        const Array4<Real      >& pi_hse_arr = pi_hse.array();
-        const Array4<Real      >&  r_hse_arr =  r_hse.array();
-        const Array4<Real const>& alpha_arr = NC_ALB_fab[idx].const_array();
-        const Array4<Real const>& nc_pb_arr = NC_PB_fab[idx].const_array();
-
-        amrex::ParallelFor(valid_bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
-            p_hse_arr(i,j,k)  = nc_pb_arr(i,j,k);
-            pi_hse_arr(i,j,k) = getExnergivenP(p_hse_arr(i,j,k), l_rdOcp);
-            r_hse_arr(i,j,k)  = 1.0 / alpha_arr(i,j,k);
-
-        });
-    } // idx
+    //
+    // FArrayBox to FArrayBox copy does "copy on intersection"
+    // This only works here because each rank has read the data from the netcdf file under its own grids
+    //
+    const Array4<Real      >&  p_hse_arr =  p_hse.array();
+    const Array4<Real      >& pi_hse_arr = pi_hse.array();
+    const Array4<Real      >&  r_hse_arr =  r_hse.array();
+    const Array4<Real const>& alpha_arr = NC_ALB_fab.const_array();
+    const Array4<Real const>& nc_pb_arr = NC_PB_fab.const_array();
+
+    amrex::ParallelFor(valid_bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+        p_hse_arr(i,j,k)  = nc_pb_arr(i,j,k);
+        pi_hse_arr(i,j,k) = getExnergivenP(p_hse_arr(i,j,k), l_rdOcp);
+        r_hse_arr(i,j,k)  = 1.0 / alpha_arr(i,j,k);
+
+    });
 }
 
 /**
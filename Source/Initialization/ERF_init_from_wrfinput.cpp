@@ -14,81 +14,58 @@ using namespace amrex;
 
 void
 read_from_wrfinput(int lev, const Box& domain, const std::string& fname,
-                   FArrayBox& NC_xvel_fab, FArrayBox& NC_yvel_fab,
-                   FArrayBox& NC_zvel_fab, FArrayBox& NC_rho_fab,
-                   FArrayBox& NC_rhop_fab, FArrayBox& NC_rhotheta_fab,
-                   FArrayBox& NC_MUB_fab ,
-                   FArrayBox& NC_MSFU_fab, FArrayBox& NC_MSFV_fab,
-                   FArrayBox& NC_MSFM_fab, FArrayBox& NC_SST_fab,
-                   FArrayBox& NC_C1H_fab , FArrayBox& NC_C2H_fab,
-                   FArrayBox& NC_RDNW_fab,
+                   const Vector<Box>& regions,
+                   Vector<FArrayBox>& NC_xvel_fab, Vector<FArrayBox>& NC_yvel_fab,
+                   Vector<FArrayBox>& NC_zvel_fab, Vector<FArrayBox>& NC_rho_fab,
+                   Vector<FArrayBox>& NC_rhop_fab, Vector<FArrayBox>& NC_rhotheta_fab,
+                   Vector<FArrayBox>& NC_MUB_fab ,
+                   Vector<FArrayBox>& NC_MSFU_fab, Vector<FArrayBox>& NC_MSFV_fab,
+                   Vector<FArrayBox>& NC_MSFM_fab, Vector<FArrayBox>& NC_SST_fab,
+                   Vector<FArrayBox>& NC_C1H_fab , Vector<FArrayBox>& NC_C2H_fab,
+                   Vector<FArrayBox>& NC_RDNW_fab,
 #if defined(ERF_USE_MOISTURE)
-                   FArrayBox& NC_QVAPOR_fab,
-                   FArrayBox& NC_QCLOUD_fab,
-                   FArrayBox& NC_QRAIN_fab,
+                   Vector<FArrayBox>& NC_QVAPOR_fab,
+                   Vector<FArrayBox>& NC_QCLOUD_fab,
+                   Vector<FArrayBox>& NC_QRAIN_fab,
 #elif defined(ERF_USE_WARM_NO_PRECIP)
 #endif
-                   FArrayBox& NC_PH_fab  , FArrayBox& NC_PHB_fab,
-                   FArrayBox& NC_ALB_fab , FArrayBox& NC_PB_fab);
-
-Real
-read_from_wrfbdy(const std::string& nc_bdy_file, const Box& domain,
-                 Vector<Vector<FArrayBox>>& bdy_data_xlo,
-                 Vector<Vector<FArrayBox>>& bdy_data_xhi,
-                 Vector<Vector<FArrayBox>>& bdy_data_ylo,
-                 Vector<Vector<FArrayBox>>& bdy_data_yhi,
-                 int& width, amrex::Real& start_bdy_time);
-
-void
-convert_wrfbdy_data(int which, const Box& domain,
-                    Vector<Vector<FArrayBox>>& bdy_data,
-                    const FArrayBox& NC_MUB_fab,
-                    const FArrayBox& NC_MSFU_fab,
-                    const FArrayBox& NC_MSFV_fab,
-                    const FArrayBox& NC_MSFM_fab,
-                    const FArrayBox& NC_PH_fab,
-                    const FArrayBox& NC_PHB_fab,
-                    const FArrayBox& NC_C1H_fab,
-                    const FArrayBox& NC_C2H_fab,
-                    const FArrayBox& NC_RDNW_fab,
-                    const FArrayBox& NC_xvel_fab,
-                    const FArrayBox& NC_yvel_fab,
-                    const FArrayBox& NC_rho_fab,
-                    const FArrayBox& NC_rhoth_fab);
+                   Vector<FArrayBox>& NC_PH_fab  , Vector<FArrayBox>& NC_PHB_fab,
+                   Vector<FArrayBox>& NC_ALB_fab , Vector<FArrayBox>& NC_PB_fab);
 
 void
 init_state_from_wrfinput(int lev, FArrayBox& state_fab,
                          FArrayBox& x_vel_fab, FArrayBox& y_vel_fab,
                          FArrayBox& z_vel_fab,
 #if defined(ERF_USE_MOISTURE)
-                         const Vector<FArrayBox>& NC_QVAPOR_fab,
-                         const Vector<FArrayBox>& NC_QCLOUD_fab,
-                         const Vector<FArrayBox>& NC_QRAIN_fab,
+                         const FArrayBox& NC_QVAPOR_fab,
+                         const FArrayBox& NC_QCLOUD_fab,
+                         const FArrayBox& NC_QRAIN_fab,
 #elif defined(ERF_USE_WARM_NO_PRECIP)
 #endif
-                         const Vector<FArrayBox>& NC_xvel_fab,
-                         const Vector<FArrayBox>& NC_yvel_fab,
-                         const Vector<FArrayBox>& NC_zvel_fab,
-                         const Vector<FArrayBox>& NC_rho_fab,
-                         const Vector<FArrayBox>& NC_rhotheta_fab);
+                         const FArrayBox& NC_xvel_fab,
+                         const FArrayBox& NC_yvel_fab,
+                         const FArrayBox& NC_zvel_fab,
+                         const FArrayBox& NC_rho_fab,
+                         const FArrayBox& NC_rhotheta_fab);
 
 void
 init_msfs_from_wrfinput(int lev, FArrayBox& msfu_fab,
                         FArrayBox& msfv_fab, FArrayBox& msfm_fab,
-                        const Vector<FArrayBox>& NC_MSFU_fab,
-                        const Vector<FArrayBox>& NC_MSFV_fab,
-                        const Vector<FArrayBox>& NC_MSFM_fab);
+                        const FArrayBox& NC_MSFU_fab,
+                        const FArrayBox& NC_MSFV_fab,
+                        const FArrayBox& NC_MSFM_fab);
 void
-init_terrain_from_wrfinput(int lev, const Box& domain, FArrayBox& z_phys,
-                           const Vector<FArrayBox>& NC_PH_fab,
-                           const Vector<FArrayBox>& NC_PHB_fab);
+init_terrain_from_wrfinput(int lev, const Box& domain, const Box& nc_box,
+                           FArrayBox& z_phys,
+                           const FArrayBox& NC_PH_fab,
+                           const FArrayBox& NC_PHB_fab);
 
 void
 init_base_state_from_wrfinput(int lev, const Box& bx, Real l_rdOcp,
                               FArrayBox& p_hse, FArrayBox& pi_hse,
                               FArrayBox& r_hse,
-                              const Vector<FArrayBox>& NC_ALB_fab,
-                              const Vector<FArrayBox>& NC_PB_fab);
+                              const FArrayBox& NC_ALB_fab,
+                              const FArrayBox& NC_PB_fab);
 
 /**
  * ERF function that initializes data from a WRF dataset
@@ -98,52 +75,77 @@ init_base_state_from_wrfinput(int lev, const Box& bx, Real l_rdOcp,
 void
 ERF::init_from_wrfinput(int lev)
 {
+    auto& lev_new = vars_new[lev];
+
+    // Each rank only reads the columns under its own grids (grown by enough cells to fill
+    //    the ghost cells and the terrain), so we hold one FArrayBox per local grid
+    int ngrow = mapfac_u[lev]->nGrow();
+    for (const auto& mf : lev_new) ngrow = std::max(ngrow, mf.nGrow());
+    if (z_phys_nd[lev]) ngrow = std::max(ngrow, z_phys_nd[lev]->nGrow());
+    ngrow += 1;
+
+    const int nlocal = lev_new[Vars::cons].local_size();
+
     // *** FArrayBox's at this level for holding the INITIAL data
-    Vector<FArrayBox> NC_xvel_fab ; NC_xvel_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_yvel_fab ; NC_yvel_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_zvel_fab ; NC_zvel_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_rho_fab  ; NC_rho_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_rhop_fab ; NC_rhop_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_rhoth_fab; NC_rhoth_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_MUB_fab  ; NC_MUB_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_MSFU_fab ; NC_MSFU_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_MSFV_fab ; NC_MSFV_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_MSFM_fab ; NC_MSFM_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_SST_fab  ; NC_SST_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_C1H_fab  ; NC_C1H_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_C2H_fab  ; NC_C2H_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_RDNW_fab ; NC_RDNW_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_PH_fab   ; NC_PH_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_PHB_fab  ; NC_PHB_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_ALB_fab  ; NC_ALB_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_PB_fab   ; NC_PB_fab.resize(num_boxes_at_level[lev]);
+    Vector<FArrayBox> NC_xvel_fab ; NC_xvel_fab.resize(nlocal);
+    Vector<FArrayBox> NC_yvel_fab ; NC_yvel_fab.resize(nlocal);
+    Vector<FArrayBox> NC_zvel_fab ; NC_zvel_fab.resize(nlocal);
+    Vector<FArrayBox> NC_rho_fab  ; NC_rho_fab.resize(nlocal);
+    Vector<FArrayBox> NC_rhop_fab ; NC_rhop_fab.resize(nlocal);
+    Vector<FArrayBox> NC_rhoth_fab; NC_rhoth_fab.resize(nlocal);
+    Vector<FArrayBox> NC_MUB_fab  ; NC_MUB_fab.resize(nlocal);
+    Vector<FArrayBox> NC_MSFU_fab ; NC_MSFU_fab.resize(nlocal);
+    Vector<FArrayBox> NC_MSFV_fab ; NC_MSFV_fab.resize(nlocal);
+    Vector<FArrayBox> NC_MSFM_fab ; NC_MSFM_fab.resize(nlocal);
+    Vector<FArrayBox> NC_SST_fab  ; NC_SST_fab.resize(nlocal);
+    Vector<FArrayBox> NC_C1H_fab  ; NC_C1H_fab.resize(nlocal);
+    Vector<FArrayBox> NC_C2H_fab  ; NC_C2H_fab.resize(nlocal);
+    Vector<FArrayBox> NC_RDNW_fab ; NC_RDNW_fab.resize(nlocal);
+    Vector<FArrayBox> NC_PH_fab   ; NC_PH_fab.resize(nlocal);
+    Vector<FArrayBox> NC_PHB_fab  ; NC_PHB_fab.resize(nlocal);
+    Vector<FArrayBox> NC_ALB_fab  ; NC_ALB_fab.resize(nlocal);
+    Vector<FArrayBox> NC_PB_fab   ; NC_PB_fab.resize(nlocal);
 #if defined(ERF_USE_MOISTURE)
-    Vector<FArrayBox> NC_QVAPOR_fab; NC_QVAPOR_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_QCLOUD_fab; NC_QCLOUD_fab.resize(num_boxes_at_level[lev]);
-    Vector<FArrayBox> NC_QRAIN_fab ; NC_QRAIN_fab.resize(num_boxes_at_level[lev]);
+    Vector<FArrayBox> NC_QVAPOR_fab; NC_QVAPOR_fab.resize(nlocal);
+    Vector<FArrayBox> NC_QCLOUD_fab; NC_QCLOUD_fab.resize(nlocal);
+    Vector<FArrayBox> NC_QRAIN_fab ; NC_QRAIN_fab.resize(nlocal);
 #elif defined(ERF_USE_WARM_NO_PRECIP)
 #endif
 
+    // Index of the file each local grid takes its data from
+    Vector<int> nc_file_idx(nlocal,-1);
+
     // amrex::Print() << "Building initial FABS from file " << nc_init_file[lev][idx] << std::endl;
     if (nc_init_file.empty())
         amrex::Error("NetCDF initialization file name must be provided via input");
 
     for (int idx = 0; idx < num_boxes_at_level[lev]; idx++)
     {
-        read_from_wrfinput(lev, boxes_at_level[lev][idx], nc_init_file[lev][idx],
-                           NC_xvel_fab[idx], NC_yvel_fab[idx],  NC_zvel_fab[idx], NC_rho_fab[idx],
-                           NC_rhop_fab[idx], NC_rhoth_fab[idx], NC_MUB_fab[idx],
-                           NC_MSFU_fab[idx], NC_MSFV_fab[idx],  NC_MSFM_fab[idx],
-                           NC_SST_fab[idx],  NC_C1H_fab[idx],   NC_C2H_fab[idx],  NC_RDNW_fab[idx],
+        // Local grids (not already covered by an earlier file) that this file touches
+        Vector<Box> regions(nlocal);
+        for ( MFIter mfi(lev_new[Vars::cons], false); mfi.isValid(); ++mfi )
+        {
+            const int li = mfi.LocalIndex();
+            Box bx = amrex::grow(mfi.validbox(), IntVect(ngrow,ngrow,0));
+            if (nc_file_idx[li] < 0 && bx.intersects(boxes_at_level[lev][idx])) {
+                regions[li]     = bx;
+                nc_file_idx[li] = idx;
+            }
+        }
+
+        // Every rank calls this since the file is opened collectively
+        read_from_wrfinput(lev, boxes_at_level[lev][idx], nc_init_file[lev][idx], regions,
+                           NC_xvel_fab, NC_yvel_fab,  NC_zvel_fab, NC_rho_fab,
+                           NC_rhop_fab, NC_rhoth_fab, NC_MUB_fab,
+                           NC_MSFU_fab, NC_MSFV_fab,  NC_MSFM_fab,
+                           NC_SST_fab,  NC_C1H_fab,   NC_C2H_fab,  NC_RDNW_fab,
 #if defined(ERF_USE_MOISTURE)
-                           NC_QVAPOR_fab[idx], NC_QCLOUD_fab[idx], NC_QRAIN_fab[idx],
+                           NC_QVAPOR_fab, NC_QCLOUD_fab, NC_QRAIN_fab,
 #elif defined(ERF_USE_WARM_NO_PRECIP)
 #endif
-                           NC_PH_fab[idx],NC_PHB_fab[idx],NC_ALB_fab[idx],NC_PB_fab[idx]);
+                           NC_PH_fab, NC_PHB_fab, NC_ALB_fab, NC_PB_fab);
     }
 
-    auto& lev_new = vars_new[lev];
-
 #ifdef _OPENMP
 #pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
@@ -157,13 +159,14 @@ ERF::init_from_wrfinput(int lev)
         FArrayBox &yvel_fab = lev_new[Vars::yvel][mfi];
         FArrayBox &zvel_fab = lev_new[Vars::zvel][mfi];
 
+        const int li = mfi.LocalIndex();
         init_state_from_wrfinput(lev, cons_fab, xvel_fab, yvel_fab, zvel_fab,
 #if defined(ERF_USE_MOISTURE)
-                                 NC_QVAPOR_fab, NC_QCLOUD_fab, NC_QRAIN_fab,
+                                 NC_QVAPOR_fab[li], NC_QCLOUD_fab[li], NC_QRAIN_fab[li],
 #elif defined(ERF_USE_WARM_NO_PRECIP)
 #endif
-                                 NC_xvel_fab, NC_yvel_fab, NC_zvel_fab,
-                                 NC_rho_fab, NC_rhoth_fab);
+                                 NC_xvel_fab[li], NC_yvel_fab[li], NC_zvel_fab[li],
+                                 NC_rho_fab[li], NC_rhoth_fab[li]);
     } // mf
 
 #ifdef _OPENMP
@@ -177,8 +180,10 @@ ERF::init_from_wrfinput(int lev)
         FArrayBox &msfv_fab = (*mapfac_v[lev])[mfi];
         FArrayBox &msfm_fab = (*mapfac_m[lev])[mfi];
 
+        // The map factors share the BoxArray and DistributionMapping of the state
+        const int li = mfi.LocalIndex();
         init_msfs_from_wrfinput(lev, msfu_fab, msfv_fab, msfm_fab,
-                                NC_MSFU_fab, NC_MSFV_fab, NC_MSFM_fab);
+                                NC_MSFU_fab[li], NC_MSFV_fab[li], NC_MSFM_fab[li]);
     } // mf
 
     const Box& domain = geom[lev].Domain();
@@ -189,7 +194,9 @@ ERF::init_from_wrfinput(int lev)
         for ( MFIter mfi(lev_new[Vars::cons], TilingIfNotGPU()); mfi.isValid(); ++mfi )
         {
             FArrayBox& z_phys_nd_fab = (*z_phys)[mfi];
-            init_terrain_from_wrfinput(lev, domain, z_phys_nd_fab, NC_PH_fab, NC_PHB_fab);
+            const int li = mfi.LocalIndex();
+            init_terrain_from_wrfinput(lev, domain, boxes_at_level[lev][nc_file_idx[li]],
+                                       z_phys_nd_fab, NC_PH_fab[li], NC_PHB_fab[li]);
         } // mf
 
         make_J  (geom[lev],*z_phys_nd[lev],*  detJ_cc[lev]);
@@ -211,18 +218,20 @@ ERF::init_from_wrfinput(int lev)
             FArrayBox&  r_hse_fab = r_hse[mfi];
 
             const Box valid_bx = mfi.validbox();
+            const int li = mfi.LocalIndex();
             init_base_state_from_wrfinput(lev, valid_bx, l_rdOcp,
                                           p_hse_fab, pi_hse_fab, r_hse_fab,
-                                          NC_ALB_fab, NC_PB_fab);
+                                          NC_ALB_fab[li], NC_PB_fab[li]);
         }
     }
 
     if (init_type == "real" && (lev == 0)) {
         if (nc_bdy_file.empty())
             amrex::Error("NetCDF boundary file name must be provided via input");
-        bdy_time_interval = read_from_wrfbdy(nc_bdy_file,geom[0].Domain(),
-                                             bdy_data_xlo,bdy_data_xhi,bdy_data_ylo,bdy_data_yhi,
-                                             wrfbdy_width, start_bdy_time);
+        m_wrfbdy = std::make_unique<ReadWRFBdy>(nc_bdy_file,geom[0].Domain());
+        bdy_time_interval = m_wrfbdy->interval();
+        start_bdy_time    = m_wrfbdy->start_time();
+        wrfbdy_width      = m_wrfbdy->width();
 
         if (wrfbdy_width-1 <= wrfbdy_set_width) wrfbdy_set_width = wrfbdy_width;
         amrex::Print() << "Read in boundary data with width "  << wrfbdy_width << std::endl;
@@ -233,26 +242,46 @@ ERF::init_from_wrfinput(int lev)
         //       Without relaxation zones, we must augment this value by 1.
         if (wrfbdy_width == wrfbdy_set_width) wrfbdy_width += 1;
 
-        convert_wrfbdy_data(0,domain,bdy_data_xlo,
-                            NC_MUB_fab[0], NC_MSFU_fab[0], NC_MSFV_fab[0], NC_MSFM_fab[0],
-                            NC_PH_fab[0] , NC_PHB_fab[0],
-                            NC_C1H_fab[0], NC_C2H_fab[0], NC_RDNW_fab[0],
-                            NC_xvel_fab[0],NC_yvel_fab[0],NC_rho_fab[0],NC_rhoth_fab[0]);
-        convert_wrfbdy_data(1,domain,bdy_data_xhi,
-                            NC_MUB_fab[0], NC_MSFU_fab[0], NC_MSFV_fab[0], NC_MSFM_fab[0],
-                            NC_PH_fab[0] , NC_PHB_fab[0],
-                            NC_C1H_fab[0], NC_C2H_fab[0], NC_RDNW_fab[0],
-                            NC_xvel_fab[0],NC_yvel_fab[0],NC_rho_fab[0],NC_rhoth_fab[0]);
-        convert_wrfbdy_data(2,domain,bdy_data_ylo,
-                            NC_MUB_fab[0], NC_MSFU_fab[0], NC_MSFV_fab[0], NC_MSFM_fab[0],
-                            NC_PH_fab[0] , NC_PHB_fab[0],
-                            NC_C1H_fab[0], NC_C2H_fab[0], NC_RDNW_fab[0],
-                            NC_xvel_fab[0],NC_yvel_fab[0],NC_rho_fab[0],NC_rhoth_fab[0]);
-        convert_wrfbdy_data(3,domain,bdy_data_yhi,
-                            NC_MUB_fab[0], NC_MSFU_fab[0], NC_MSFV_fab[0], NC_MSFM_fab[0],
-                            NC_PH_fab[0] , NC_PHB_fab[0],
-                            NC_C1H_fab[0], NC_C2H_fab[0], NC_RDNW_fab[0],
-                            NC_xvel_fab[0],NC_yvel_fab[0],NC_rho_fab[0],NC_rhoth_fab[0]);
+        m_wrfbdy->set_conversion_fields(nc_init_file[0][0]);
+
+        // Hand out what we need to fill the ghost cells at the initial time
+        update_wrfbdy(t_new[0], 0.0);
+
+#ifndef AMREX_USE_GPU
+        // How far the first boundary time is from the initial data, on the grids of each rank
+        const Vector<std::string> face_name = {"lo x", "hi x", "lo y", "hi y"};
+        const Vector<Vector<Vector<FArrayBox>>*> bdy_data = {&bdy_data_xlo, &bdy_data_xhi,
+                                                             &bdy_data_ylo, &bdy_data_yhi};
+        auto report = [&] (const std::string& name, int face, int ivar,
+                           const MultiFab& mf, int comp)
+        {
+            Real diff = 0.0;
+            const auto& bdy = *bdy_data[face];
+            if (!bdy.empty() && !bdy[0].empty()) {
+                const FArrayBox& bdy_fab = bdy[0][ivar];
+                for ( MFIter mfi(mf); mfi.isValid(); ++mfi )
+                {
+                    const Box bx = mfi.validbox() & bdy_fab.box();
+                    if (!bx.ok()) continue;
+                    const Array4<Real const>& bdy_arr = bdy_fab.const_array();
+                    const Array4<Real const>& mf_arr  = mf.const_array(mfi);
+                    amrex::LoopOnCpu(bx, [&] (int i, int j, int k) noexcept {
+                        diff = std::max(diff, std::abs(bdy_arr(i,j,k) - mf_arr(i,j,k,comp)));
+                    });
+                }
+            }
+            ParallelDescriptor::ReduceRealMax(diff);
+            amrex::Print() << "Max norm of diff between initial " << name << " and bdy " << name
+                           << " on " << face_name[face] << " face: " << diff << std::endl;
+        };
+
+        for (int face = 0; face < 4; ++face) {
+            report("U"  , face, WRFBdyVars::U, lev_new[Vars::xvel], 0);
+            report("V"  , face, WRFBdyVars::V, lev_new[Vars::yvel], 0);
+            report("r"  , face, WRFBdyVars::R, lev_new[Vars::cons], Rho_comp);
+            report("rTh", face, WRFBdyVars::T, lev_new[Vars::cons], RhoTheta_comp);
+        }
+#endif
     }
 }
 
@@ -264,11 +293,11 @@ ERF::init_from_wrfinput(int lev)
  * @param x_vel_fab FArrayBox object holding the x-velocity data we initialize
  * @param y_vel_fab FArrayBox object holding the y-velocity data we initialize
  * @param z_vel_fab FArrayBox object holding the z-velocity data we initialize
- * @param NC_xvel_fab Vector of FArrayBox objects with the WRF dataset specifying x-velocity
- * @param NC_yvel_fab Vector of FArrayBox objects with the WRF dataset specifying y-velocity
- * @param NC_zvel_fab Vector of FArrayBox objects with the WRF dataset specifying z-velocity
- * @param NC_rho_fab Vector of FArrayBox objects with the WRF dataset specifying density
- * @param NC_rhotheta_fab Vector of FArrayBox objects with the WRF dataset specifying density*(potential temperature)
+ * @param NC_xvel_fab FArrayBox object with the WRF dataset specifying x-velocity
+ * @param NC_yvel_fab FArrayBox object with the WRF dataset specifying y-velocity
+ * @param NC_zvel_fab FArrayBox object with the WRF dataset specifying z-velocity
+ * @param NC_rho_fab FArrayBox object with the WRF dataset specifying density
+ * @param NC_rhotheta_fab FArrayBox object with the WRF dataset specifying density*(potential temperature)
  */
 void
 init_state_from_wrfinput(int lev,
@@ -277,52 +306,48 @@ init_state_from_wrfinput(int lev,
                          FArrayBox& y_vel_fab,
                          FArrayBox& z_vel_fab,
 #if defined(ERF_USE_MOISTURE)
-                         const Vector<FArrayBox>& NC_QVAPOR_fab,
-                         const Vector<FArrayBox>& NC_QCLOUD_fab,
-                         const Vector<FArrayBox>& NC_QRAIN_fab,
+                         const FArrayBox& NC_QVAPOR_fab,
+                         const FArrayBox& NC_QCLOUD_fab,
+                         const FArrayBox& NC_QRAIN_fab,
 #elif defined(ERF_USE_WARM_NO_PRECIP)
 #endif
-                         const Vector<FArrayBox>& NC_xvel_fab,
-                         const Vector<FArrayBox>& NC_yvel_fab,
-                         const Vector<FArrayBox>& NC_zvel_fab,
-                         const Vector<FArrayBox>& NC_rho_fab,
-                         const Vector<FArrayBox>& NC_rhotheta_fab)
+                         const FArrayBox& NC_xvel_fab,
+                         const FArrayBox& NC_yvel_fab,
+                         const FArrayBox& NC_zvel_fab,
+                         const FArrayBox& NC_rho_fab,
+                         const FArrayBox& NC_rhotheta_fab)
 {
-    int nboxes = NC_xvel_fab.size();
-    for (int idx = 0; idx < nboxes; idx++)
-    {
-        //
-        // FArrayBox to FArrayBox copy does "copy on intersection"
-        // This only works here because we have broadcast the FArrayBox of data from the netcdf file to all ranks
-        //
-        // This copies x-vel
-        x_vel_fab.template copy<RunOn::Device>(NC_xvel_fab[idx]);
+    //
+    // FArrayBox to FArrayBox copy does "copy on intersection"
+    // This only works here because each rank has read the data from the netcdf file under its own grids
+    //
+    // This copies x-vel
+    x_vel_fab.template copy<RunOn::Device>(NC_xvel_fab);
 
-        // This copies y-vel
-        y_vel_fab.template copy<RunOn::Device>(NC_yvel_fab[idx]);
+    // This copies y-vel
+    y_vel_fab.template copy<RunOn::Device>(NC_yvel_fab);
 
-        // This copies z-vel
-        z_vel_fab.template copy<RunOn::Device>(NC_zvel_fab[idx]);
+    // This copies z-vel
+    z_vel_fab.template copy<RunOn::Device>(NC_zvel_fab);
 
-        // We first initialize all state_fab variables to zero
-        state_fab.template setVal<RunOn::Device>(0.);
+    // We first initialize all state_fab variables to zero
+    state_fab.template setVal<RunOn::Device>(0.);
 
-        // This copies the density
-        state_fab.template copy<RunOn::Device>(NC_rho_fab[idx], 0, Rho_comp, 1);
+    // This copies the density
+    state_fab.template copy<RunOn::Device>(NC_rho_fab, 0, Rho_comp, 1);
 
-        // This copies (rho*theta)
-        state_fab.template copy<RunOn::Device>(NC_rhotheta_fab[idx], 0, RhoTheta_comp, 1);
+    // This copies (rho*theta)
+    state_fab.template copy<RunOn::Device>(NC_rhotheta_fab, 0, RhoTheta_comp, 1);
 
 #if defined(ERF_USE_MOISTURE)
-        state_fab.template copy<RunOn::Device>(NC_QVAPOR_fab[idx], 0, RhoQt_comp, 1);
-        state_fab.template plus<RunOn::Device>(NC_QCLOUD_fab[idx], 0, RhoQt_comp, 1);
-        state_fab.template mult<RunOn::Device>(NC_rho_fab[idx]   , 0, RhoQt_comp, 1);
+    state_fab.template copy<RunOn::Device>(NC_QVAPOR_fab, 0, RhoQt_comp, 1);
+    state_fab.template plus<RunOn::Device>(NC_QCLOUD_fab, 0, RhoQt_comp, 1);
+    state_fab.template mult<RunOn::Device>(NC_rho_fab   , 0, RhoQt_comp, 1);
 
-        state_fab.template copy<RunOn::Device>(NC_QRAIN_fab[idx], 0, RhoQp_comp, 1);
-        state_fab.template mult<RunOn::Device>(NC_rho_fab[idx]  , 0, RhoQp_comp, 1);
+    state_fab.template copy<RunOn::Device>(NC_QRAIN_fab, 0, RhoQp_comp, 1);
+    state_fab.template mult<RunOn::Device>(NC_rho_fab  , 0, RhoQp_comp, 1);
 # elif defined(ERF_USE_WARM_NO_PRECIP)
 #endif
-    } // idx
 }
 
 /**
@@ -332,33 +357,29 @@ init_state_from_wrfinput(int lev,
  * @param msfu_fab FArrayBox specifying the x-velocity map factors we initialize
  * @param msfv_fab FArrayBox specifying the y-velocity map factors we initialize
  * @param msfm_fab FArrayBox specifying the z-velocity map factors we initialize
- * @param NC_MSFU_fab Vector of FArrayBoxes holding WRF data specifying x-velocity map factors
- * @param NC_MSFV_fab Vector of FArrayBoxes holding WRF data specifying y-velocity map factors
- * @param NC_MSFM_fab Vector of FArrayBoxes holding WRF data specifying z-velocity map factors
+ * @param NC_MSFU_fab FArrayBox holding WRF data specifying x-velocity map factors
+ * @param NC_MSFV_fab FArrayBox holding WRF data specifying y-velocity map factors
+ * @param NC_MSFM_fab FArrayBox holding WRF data specifying z-velocity map factors
  */
 void
 init_msfs_from_wrfinput(int lev, FArrayBox& msfu_fab,
                         FArrayBox& msfv_fab, FArrayBox& msfm_fab,
-                        const Vector<FArrayBox>& NC_MSFU_fab,
-                        const Vector<FArrayBox>& NC_MSFV_fab,
-                        const Vector<FArrayBox>& NC_MSFM_fab)
+                        const FArrayBox& NC_MSFU_fab,
+                        const FArrayBox& NC_MSFV_fab,
+                        const FArrayBox& NC_MSFM_fab)
 {
-    int nboxes = NC_MSFU_fab.size();
-    for (int idx = 0; idx < nboxes; idx++)
-    {
-        //
-        // FArrayBox to FArrayBox copy does "copy on intersection"
-        // This only works here because we have broadcast the FArrayBox of data from the netcdf file to all ranks
-        //
-        // This copies mapfac_u
-        msfu_fab.template copy<RunOn::Device>(NC_MSFU_fab[idx]);
-
-        // This copies mapfac_v
-        msfv_fab.template copy<RunOn::Device>(NC_MSFV_fab[idx]);
-
-        // This copies mapfac_m
-        msfm_fab.template copy<RunOn::Device>(NC_MSFM_fab[idx]);
-    } // idx
+    //
+    // FArrayBox to FArrayBox copy does "copy on intersection"
+    // This only works here because each rank has read the data from the netcdf file under its own grids
+    //
+    // This copies mapfac_u
+    msfu_fab.template copy<RunOn::Device>(NC_MSFU_fab);
+
+    // This copies mapfac_v
+    msfv_fab.template copy<RunOn::Device>(NC_MSFV_fab);
+
+    // This copies mapfac_m
+    msfm_fab.template copy<RunOn::Device>(NC_MSFM_fab);
 }
 
 /**
@@ -370,118 +391,112 @@ init_msfs_from_wrfinput(int lev, FArrayBox& msfu_fab,
  * @param p_hse FArrayBox specifying the hydrostatic base state pressure we initialize
  * @param pi_hse FArrayBox specifying the hydrostatic base state Exner pressure we initialize
  * @param r_hse FArrayBox specifying the hydrostatic base state density we initialize
- * @param NC_ALB_fab Vector of FArrayBox objects containing WRF data specifying 1/density
- * @param NC_PB_fab Vector of FArrayBox objects containing WRF data specifying pressure
+ * @param NC_ALB_fab FArrayBox object containing WRF data specifying 1/density
+ * @param NC_PB_fab FArrayBox object containing WRF data specifying pressure
  */
 void
 init_base_state_from_wrfinput(int lev, const Box& valid_bx, const Real l_rdOcp,
                               FArrayBox& p_hse, FArrayBox& pi_hse, FArrayBox& r_hse,
-                              const Vector<FArrayBox>& NC_ALB_fab,
-                              const Vector<FArrayBox>& NC_PB_fab)
+                              const FArrayBox& NC_ALB_fab,
+                              const FArrayBox& NC_PB_fab)
 {
-    int nboxes = NC_ALB_fab.size();
-    for (int idx = 0; idx < nboxes; idx++)
-    {
-        //
-        // FArrayBox to FArrayBox copy does "copy on intersection"
-        // This only works here because we have broadcast the FArrayBox of data from the netcdf file to all ranks
-        //
-        const Array4<Real      >&  p_hse_arr =  p_hse.array();
-        const Array4<Real      >& pi_hse_arr = pi_hse.array(); const Array4<Real      >&  r_hse_arr =  r_hse.array();
-        const Array4<Real const>& alpha_arr = NC_ALB_fab[idx].const_array();
-        const Array4<Real const>& nc_pb_arr = NC_PB_fab[idx].const_array();
-
-        amrex::ParallelFor(valid_bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
-            p_hse_arr(i,j,k)  = nc_pb_arr(i,j,k);
-            pi_hse_arr(i,j,k) = getExnergivenP(p_hse_arr(i,j,k), l_rdOcp);
-            r_hse_arr(i,j,k)  = 1.0 / alpha_arr(i,j,k);
-
-        });
-    } // idx
+    const Array4<Real      >&  p_hse_arr =  p_hse.array();
+    const Array4<Real      >& pi_hse_arr = pi_hse.array();
+    const Array4<Real      >&  r_hse_arr =  r_hse.array();
+    const Array4<Real const>& alpha_arr = NC_ALB_fab.const_array();
+    const Array4<Real const>& nc_pb_arr = NC_PB_fab.const_array();
+
+    amrex::ParallelFor(valid_bx, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+        p_hse_arr(i,j,k)  = nc_pb_arr(i,j,k);
+        pi_hse_arr(i,j,k) = getExnergivenP(p_hse_arr(i,j,k), l_rdOcp);
+        r_hse_arr(i,j,k)  = 1.0 / alpha_arr(i,j,k);
+    });
 }
 
 /**
  * Helper function for initializing terrain coordinates from a WRF dataset.
  *
  * @param lev Integer specifying the current level
+ * @param domain Box specifying the domain at this level
+ * @param nc_box Box specifying the cells covered by the WRF dataset
  * @param z_phys FArrayBox specifying the node-centered z coordinates of the terrain
- * @param NC_PH_fab Vector of FArrayBox objects storing WRF terrain coordinate data (PH)
- * @param NC_PHB_fab Vector of FArrayBox objects storing WRF terrain coordinate data (PHB)
+ * @param NC_PH_fab FArrayBox object storing WRF terrain coordinate data (PH)
+ * @param NC_PHB_fab FArrayBox object storing WRF terrain coordinate data (PHB)
  */
 void
-init_terrain_from_wrfinput(int lev, const Box& domain, FArrayBox& z_phys,
-                           const Vector<FArrayBox>& NC_PH_fab,
-                           const Vector<FArrayBox>& NC_PHB_fab)
+init_terrain_from_wrfinput(int lev, const Box& domain, const Box& nc_box,
+                           FArrayBox& z_phys,
+                           const FArrayBox& NC_PH_fab,
+                           const FArrayBox& NC_PHB_fab)
 {
-    int nboxes = NC_PH_fab.size();
-    for (int idx = 0; idx < nboxes; idx++)
-    {
-        // This copies from NC_zphys on z-faces to z_phys_nd on nodes
-        const Array4<Real      >&      z_arr = z_phys.array();
-        const Array4<Real const>& nc_phb_arr = NC_PHB_fab[idx].const_array();
-        const Array4<Real const>& nc_ph_arr  = NC_PH_fab[idx].const_array();
-
-        const Box& z_phys_box(z_phys.box());
-
-        Box nodal_box = amrex::surroundingNodes(NC_PHB_fab[idx].box());
-
-        int ilo = nodal_box.smallEnd()[0];
-        int ihi = nodal_box.bigEnd()[0];
-        int jlo = nodal_box.smallEnd()[1];
-        int jhi = nodal_box.bigEnd()[1];
-        int klo = nodal_box.smallEnd()[2];
-        int khi = nodal_box.bigEnd()[2]-1;
-
-        const auto domlo = amrex::lbound(domain);
-        const auto domhi = amrex::ubound(domain);
-
-        //
-        // We must be careful not to read out of bounds of the WPS data
-        //
-        amrex::ParallelFor(z_phys_box, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
-            int ii = std::max(std::min(i,ihi-1),ilo+1);
-            int jj = std::max(std::min(j,jhi-1),jlo+1);
-            if (k < 0) {
-                Real z_klo   =  0.25 * ( nc_ph_arr (ii,jj  ,klo  ) +  nc_ph_arr(ii-1,jj  ,klo  ) +
-                                         nc_ph_arr (ii,jj-1,klo  ) + nc_ph_arr (ii-1,jj-1,klo) +
-                                         nc_phb_arr(ii,jj  ,klo  ) + nc_phb_arr(ii-1,jj  ,klo  ) +
-                                         nc_phb_arr(ii,jj-1,klo  ) + nc_phb_arr(ii-1,jj-1,klo) ) / CONST_GRAV;
-                Real z_klop1 =  0.25 * ( nc_ph_arr (ii,jj  ,klo+1) +  nc_ph_arr(ii-1,jj  ,klo+1) +
-                                         nc_ph_arr (ii,jj-1,klo+1) + nc_ph_arr (ii-1,jj-1,klo+1) +
-                                         nc_phb_arr(ii,jj  ,klo+1) + nc_phb_arr(ii-1,jj  ,klo+1) +
-                                         nc_phb_arr(ii,jj-1,klo+1) + nc_phb_arr(ii-1,jj-1,klo+1) ) / CONST_GRAV;
-                z_arr(i, j, k) = 2.0 * z_klo - z_klop1;
-            } else if (k > khi) {
-                Real z_khi   =  0.25 * ( nc_ph_arr (ii,jj  ,khi  ) + nc_ph_arr (ii-1,jj  ,khi  ) +
-                                         nc_ph_arr (ii,jj-1,khi  ) + nc_ph_arr (ii-1,jj-1,khi) +
-                                         nc_phb_arr(ii,jj  ,khi  ) + nc_phb_arr(ii-1,jj  ,khi  ) +
-                                         nc_phb_arr(ii,jj-1,khi  ) + nc_phb_arr(ii-1,jj-1,khi) ) / CONST_GRAV;
-                Real z_khim1 =  0.25 * ( nc_ph_arr (ii,jj  ,khi-1) + nc_ph_arr (ii-1,jj  ,khi-1) +
-                                         nc_ph_arr (ii,jj-1,khi-1) + nc_ph_arr (ii-1,jj-1,khi-1) +
-                                         nc_phb_arr(ii,jj  ,khi-1) + nc_phb_arr(ii-1,jj  ,khi-1) +
-                                         nc_phb_arr(ii,jj-1,khi-1) + nc_phb_arr(ii-1,jj-1,khi-1) ) / CONST_GRAV;
-                z_arr(i, j, k) = 2.0 * z_khi - z_khim1;
-              } else {
-                z_arr(i, j, k) = 0.25 * ( nc_ph_arr (ii,jj  ,k) + nc_ph_arr (ii-1,jj  ,k) +
-                                          nc_ph_arr (ii,jj-1,k) + nc_ph_arr (ii-1,jj-1,k) +
-                                          nc_phb_arr(ii,jj  ,k) + nc_phb_arr(ii-1,jj  ,k) +
-                                          nc_phb_arr(ii,jj-1,k) + nc_phb_arr(ii-1,jj-1,k) ) / CONST_GRAV;
-
-             //
-             // Fill values outside the domain on the fly (we will need these to make detJ in ghost cells)
-             //
-             if (i == domlo.x) z_arr(i-1,j,k) = z_arr(i,j,k);
-             if (i == domhi.x) z_arr(i+1,j,k) = z_arr(i,j,k);
-             if (j == domlo.y) z_arr(i,j-1,k) = z_arr(i,j,k);
-             if (j == domhi.y) z_arr(i,j+1,k) = z_arr(i,j,k);
-
-             if (i == domlo.x && j == domlo.y) z_arr(i-1,j-1,k) = z_arr(i,j,k);
-             if (i == domlo.x && j == domhi.y) z_arr(i-1,j+1,k) = z_arr(i,j,k);
-             if (i == domhi.x && j == domlo.y) z_arr(i+1,j-1,k) = z_arr(i,j,k);
-             if (i == domhi.x && j == domhi.y) z_arr(i+1,j+1,k) = z_arr(i,j,k);
-
-            } // k
-        });
-    } // idx
+    // This copies from NC_zphys on z-faces to z_phys_nd on nodes
+    const Array4<Real      >&      z_arr = z_phys.array();
+    const Array4<Real const>& nc_phb_arr = NC_PHB_fab.const_array();
+    const Array4<Real const>& nc_ph_arr  = NC_PH_fab.const_array();
+
+    const Box& z_phys_box(z_phys.box());
+
+    // The data under this grid only, but we clamp to the edges of the whole dataset
+    Box nodal_box = amrex::surroundingNodes(NC_PHB_fab.box());
+    nodal_box.setRange(0, nc_box.smallEnd(0), nc_box.length(0)+1);
+    nodal_box.setRange(1, nc_box.smallEnd(1), nc_box.length(1)+1);
+
+    int ilo = nodal_box.smallEnd()[0];
+    int ihi = nodal_box.bigEnd()[0];
+    int jlo = nodal_box.smallEnd()[1];
+    int jhi = nodal_box.bigEnd()[1];
+    int klo = nodal_box.smallEnd()[2];
+    int khi = nodal_box.bigEnd()[2]-1;
+
+    const auto domlo = amrex::lbound(domain);
+    const auto domhi = amrex::ubound(domain);
+
+    //
+    // We must be careful not to read out of bounds of the WPS data
+    //
+    amrex::ParallelFor(z_phys_box, [=] AMREX_GPU_DEVICE(int i, int j, int k) noexcept {
+        int ii = std::max(std::min(i,ihi-1),ilo+1);
+        int jj = std::max(std::min(j,jhi-1),jlo+1);
+        if (k < 0) {
+            Real z_klo   =  0.25 * ( nc_ph_arr (ii,jj  ,klo  ) +  nc_ph_arr(ii-1,jj  ,klo  ) +
+                                     nc_ph_arr (ii,jj-1,klo  ) + nc_ph_arr (ii-1,jj-1,klo) +
+                                     nc_phb_arr(ii,jj  ,klo  ) + nc_phb_arr(ii-1,jj  ,klo  ) +
+                                     nc_phb_arr(ii,jj-1,klo  ) + nc_phb_arr(ii-1,jj-1,klo) ) / CONST_GRAV;
+            Real z_klop1 =  0.25 * ( nc_ph_arr (ii,jj  ,klo+1) +  nc_ph_arr(ii-1,jj  ,klo+1) +
+                                     nc_ph_arr (ii,jj-1,klo+1) + nc_ph_arr (ii-1,jj-1,klo+1) +
+                                     nc_phb_arr(ii,jj  ,klo+1) + nc_phb_arr(ii-1,jj  ,klo+1) +
+                                     nc_phb_arr(ii,jj-1,klo+1) + nc_phb_arr(ii-1,jj-1,klo+1) ) / CONST_GRAV;
+            z_arr(i, j, k) = 2.0 * z_klo - z_klop1;
+        } else if (k > khi) {
+            Real z_khi   =  0.25 * ( nc_ph_arr (ii,jj  ,khi  ) + nc_ph_arr (ii-1,jj  ,khi  ) +
+                                     nc_ph_arr (ii,jj-1,khi  ) + nc_ph_arr (ii-1,jj-1,khi) +
+                                     nc_phb_arr(ii,jj  ,khi  ) + nc_phb_arr(ii-1,jj  ,khi  ) +
+                                     nc_phb_arr(ii,jj-1,khi  ) + nc_phb_arr(ii-1,jj-1,khi) ) / CONST_GRAV;
+            Real z_khim1 =  0.25 * ( nc_ph_arr (ii,jj  ,khi-1) + nc_ph_arr (ii-1,jj  ,khi-1) +
+                                     nc_ph_arr (ii,jj-1,khi-1) + nc_ph_arr (ii-1,jj-1,khi-1) +
+                                     nc_phb_arr(ii,jj  ,khi-1) + nc_phb_arr(ii-1,jj  ,khi-1) +
+                                     nc_phb_arr(ii,jj-1,khi-1) + nc_phb_arr(ii-1,jj-1,khi-1) ) / CONST_GRAV;
+            z_arr(i, j, k) = 2.0 * z_khi - z_khim1;
+          } else {
+            z_arr(i, j, k) = 0.25 * ( nc_ph_arr (ii,jj  ,k) + nc_ph_arr (ii-1,jj  ,k) +
+                                      nc_ph_arr (ii,jj-1,k) + nc_ph_arr (ii-1,jj-1,k) +
+                                      nc_phb_arr(ii,jj  ,k) + nc_phb_arr(ii-1,jj  ,k) +
+                                      nc_phb_arr(ii,jj-1,k) + nc_phb_arr(ii-1,jj-1,k) ) / CONST_GRAV;
+
+         //
+         // Fill values outside the domain on the fly (we will need these to make detJ in ghost cells)
+         //
+         if (i == domlo.x) z_arr(i-1,j,k) = z_arr(i,j,k);
+         if (i == domhi.x) z_arr(i+1,j,k) = z_arr(i,j,k);
+         if (j == domlo.y) z_arr(i,j-1,k) = z_arr(i,j,k);
+         if (j == domhi.y) z_arr(i,j+1,k) = z_arr(i,j,k);
+
+         if (i == domlo.x && j == domlo.y) z_arr(i-1,j-1,k) = z_arr(i,j,k);
+         if (i == domlo.x && j == domhi.y) z_arr(i-1,j+1,k) = z_arr(i,j,k);
+         if (i == domhi.x && j == domlo.y) z_arr(i+1,j-1,k) = z_arr(i,j,k);
+         if (i == domhi.x && j == domhi.y) z_arr(i+1,j+1,k) = z_arr(i,j,k);
+
+        } // k
+    });
 }
 #endif // ERF_USE_NETCDF
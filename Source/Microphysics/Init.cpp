@@ -2,7 +2,6 @@
 #include <AMReX_GpuContainers.H>
 #include "Microphysics.H"
 #include "IndexDefines.H"
-#include "PlaneAverage.H"
 #include "EOS.H"
 #include "TileNoZ.H"
 
@@ -17,11 +16,13 @@ using namespace amrex;
  * @param[in] qi_in Ice variables input
  * @param[in] grids_to_evolve The boxes on which we will evolve the solution
  * @param[in] geom Geometry associated with these MultiFabs and grids
+ * @param[in] plane_avg Horizontal averages of cons_in
  * @param[in] dt_advance Timestep for the advance
  */
 void Microphysics::Init(const MultiFab& cons_in, MultiFab& qmoist,
                         const BoxArray& grids_to_evolve,
                         const Geometry& geom,
+                        const MultiPlaneAverage& plane_avg,
                         const Real& dt_advance)
  {
   m_geom = geom;
@@ -147,25 +148,10 @@ void Microphysics::Init(const MultiFab& cons_in, MultiFab& qmoist,
      });
   }
 
-  // calculate the plane average variables
-  PlaneAverage cons_ave(&cons_in, m_geom, m_axis);
-  cons_ave.compute_averages(ZDir(), cons_ave.field());
-
-  // get host variable rho, and rhotheta
-  int ncell = cons_ave.ncell_line();
-
-  Gpu::HostVector<Real> rho_h(ncell), rhotheta_h(ncell);
-  cons_ave.line_average(Rho_comp, rho_h);
-  cons_ave.line_average(RhoTheta_comp, rhotheta_h);
-
-  // copy data to device
-  Gpu::DeviceVector<Real> rho_d(ncell), rhotheta_d(ncell);
-  Gpu::copyAsync(Gpu::hostToDevice, rho_h.begin(), rho_h.end(), rho_d.begin());
-  Gpu::copyAsync(Gpu::hostToDevice, rhotheta_h.begin(), rhotheta_h.end(), rhotheta_d.begin());
-  Gpu::streamSynchronize();
-
-  Real* rho_dptr      = rho_d.data();
-  Real* rhotheta_dptr = rhotheta_d.data();
+  // plane averages of rho and rhotheta
+  AMREX_ALWAYS_ASSERT(plane_avg.valid());
+  const Real* rho_dptr      = plane_avg.line_average_device(PlaneAvg::rho);
+  const Real* rhotheta_dptr = plane_avg.line_average_device(PlaneAvg::rhotheta);
 
   Real gOcp = m_gOcp;
 
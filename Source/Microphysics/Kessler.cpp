@@ -0,0 +1,273 @@
+
+#include <AMReX_ParReduce.H>
+#include "Kessler.H"
+#include "IndexDefines.H"
+#include "EOS.H"
+#include "TileNoZ.H"
+
+using namespace amrex;
+
+// Coefficients of the WRF Kessler scheme
+namespace {
+    constexpr Real kes_c1    = 0.001;   // autoconversion rate [1/s]
+    constexpr Real kes_c2    = 0.001;   // autoconversion threshold [kg/kg]
+    constexpr Real kes_c3    = 2.2;     // accretion rate coefficient
+    constexpr Real kes_c4    = 0.875;   // accretion exponent
+    constexpr Real kes_svp1  = 0.6112;  // saturation vapor pressure coefficients
+    constexpr Real kes_svp2  = 17.67;
+    constexpr Real kes_svp3  = 29.65;
+    constexpr Real kes_svpt0 = 273.15;
+    constexpr Real kes_ep2   = R_d / R_v;
+    constexpr Real kes_rho0  = 1.29;    // reference density for the terminal velocity correction
+    constexpr Real kes_cfl   = 0.8;     // maximum CFL number per sedimentation substep
+}
+
+/**
+ * Initializes the Kessler module for the current step by copying density, theta, pressure
+ * and the water species out of the conserved state.
+ *
+ * @param[in] cons_in Conserved variables input
+ * @param[in] qmoist Moisture variables input (qv, qc, qi, qr, qs, qg); only qc is read
+ * @param[in] grids_to_evolve The boxes on which we will evolve the solution
+ * @param[in] geom Geometry associated with these MultiFabs and grids
+ * @param[in] dt_advance Timestep for the advance
+ */
+void Kessler::Init(const MultiFab& cons_in, const MultiFab& qmoist,
+                   const BoxArray& grids_to_evolve,
+                   const Geometry& geom,
+                   const Real& dt_advance)
+{
+  m_geom = geom;
+  m_gtoe = grids_to_evolve;
+
+  dt = dt_advance;
+
+  // Only (re)allocate if the grids have changed since the last call
+  if (!mic_fab_vars[0] ||
+      mic_fab_vars[0]->boxArray()        != cons_in.boxArray() ||
+      mic_fab_vars[0]->DistributionMap() != cons_in.DistributionMap())
+  {
+      for (auto ivar = 0; ivar < KesVar::NumVars; ++ivar) {
+         mic_fab_vars[ivar] = std::make_shared<MultiFab>(cons_in.boxArray(), cons_in.DistributionMap(),
+                                                         1, cons_in.nGrowVect());
+         mic_fab_vars[ivar]->setVal(0.);
+      }
+  }
+
+  for ( MFIter mfi(cons_in, TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+     auto states_array = cons_in.const_array(mfi);
+     auto qc_in_array  = qmoist.const_array(mfi);
+
+     auto rho_array   = mic_fab_vars[KesVar::rho]->array(mfi);
+     auto theta_array = mic_fab_vars[KesVar::theta]->array(mfi);
+     auto pres_array  = mic_fab_vars[KesVar::pres]->array(mfi);
+     auto qv_array    = mic_fab_vars[KesVar::qv]->array(mfi);
+     auto qcl_array   = mic_fab_vars[KesVar::qcl]->array(mfi);
+     auto qpl_array   = mic_fab_vars[KesVar::qpl]->array(mfi);
+
+     const auto& box3d = mfi.tilebox();
+
+     // The non-precipitating water qt is split into vapor and cloud water using the
+     // cloud water diagnosed at the end of the previous step
+     ParallelFor( box3d, [=] AMREX_GPU_DEVICE (int i, int j, int k) {
+       Real rho = states_array(i,j,k,Rho_comp);
+       Real qt  = std::max(0.0, states_array(i,j,k,RhoQt_comp)/rho);
+       Real qc  = std::min(qt, std::max(0.0, qc_in_array(i,j,k,1)));
+
+       rho_array(i,j,k)   = rho;
+       theta_array(i,j,k) = states_array(i,j,k,RhoTheta_comp)/rho;
+       qcl_array(i,j,k)   = qc;
+       qv_array(i,j,k)    = qt - qc;
+       qpl_array(i,j,k)   = std::max(0.0, states_array(i,j,k,RhoQp_comp)/rho);
+       pres_array(i,j,k)  = getPgivenRTh(states_array(i,j,k,RhoTheta_comp), qv_array(i,j,k));
+     });
+  }
+}
+
+/**
+ * Computes autoconversion and accretion of cloud water into rain, saturation
+ * adjustment between vapor and cloud water, and evaporation of rain.
+ */
+void Kessler::AdvanceKessler() {
+
+  Real dtn      = dt;
+  Real rdOcp    = m_rdOcp;
+  Real fac_cond = m_fac_cond;
+  Real f5       = kes_svp2*(kes_svpt0-kes_svp3)*fac_cond;
+  bool precip   = doprecip;
+
+  for ( MFIter mfi(*mic_fab_vars[KesVar::rho], TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+     auto rho_array   = mic_fab_vars[KesVar::rho]->const_array(mfi);
+     auto pres_array  = mic_fab_vars[KesVar::pres]->const_array(mfi);
+     auto theta_array = mic_fab_vars[KesVar::theta]->array(mfi);
+     auto qv_array    = mic_fab_vars[KesVar::qv]->array(mfi);
+     auto qcl_array   = mic_fab_vars[KesVar::qcl]->array(mfi);
+     auto qpl_array   = mic_fab_vars[KesVar::qpl]->array(mfi);
+
+     const auto& box3d = mfi.tilebox() & m_gtoe[mfi.index()];
+
+     ParallelFor(box3d, [=] AMREX_GPU_DEVICE (int i, int j, int k) {
+        Real qv = qv_array(i,j,k);
+        Real qc = qcl_array(i,j,k);
+        Real qr = qpl_array(i,j,k);
+
+        // Autoconversion and accretion, implicit in qr
+        if (precip) {
+            Real factorn = 1.0 / (1.0 + kes_c3*dtn*std::pow(qr, kes_c4));
+            Real qrprod  = qc - (qc - dtn*std::max(kes_c1*(qc-kes_c2), 0.0))*factorn;
+            qc  = std::max(qc - qrprod, 0.0);
+            qr += qrprod;
+        }
+
+        // Saturation adjustment and evaporation of rain
+        Real pressure = pres_array(i,j,k);
+        Real pii      = getExnergivenP(pressure, rdOcp);
+        Real tabs     = pii * theta_array(i,j,k);
+        Real gam      = fac_cond / pii;
+        Real rcgs     = 0.001 * rho_array(i,j,k);
+
+        Real es   = 1000.0*kes_svp1*std::exp(kes_svp2*(tabs-kes_svpt0)/(tabs-kes_svp3));
+        Real qvs  = kes_ep2*es/(pressure-es);
+        Real prod = (qv-qvs) / (1.0 + pressure/(pressure-es)*qvs*f5/((tabs-kes_svp3)*(tabs-kes_svp3)));
+
+        Real ern = 0.0;
+        if (qr > 0.0) {
+            Real rqr = rcgs*qr;
+            ern = dtn*((1.6+124.9*std::pow(rqr,0.2046))*std::pow(rqr,0.525))
+                / (2.55e8/(pressure*qvs) + 5.4e5) * (std::max(qvs-qv,0.0)/(rcgs*qvs));
+            ern = std::min(ern, std::min(std::max(-prod-qc, 0.0), qr));
+        }
+
+        Real cond = std::max(prod, -qc);
+
+        theta_array(i,j,k) += gam*(cond - ern);
+        qv_array(i,j,k)     = std::max(qv - cond + ern, 0.0);
+        qcl_array(i,j,k)    = qc + cond;
+        qpl_array(i,j,k)    = qr - ern;
+     });
+  }
+}
+
+/**
+ * Computes the sedimentation of rain with the Klemp and Wilhelmson (1978)
+ * terminal velocity, using an upwind flux and as many substeps as needed
+ * to keep the fall CFL number below one.
+ */
+void Kessler::RainFall() {
+
+  auto rho = mic_fab_vars[KesVar::rho];
+  auto qpl = mic_fab_vars[KesVar::qpl];
+
+  Real dz  = m_geom.CellSize(2);
+  int  khi = m_geom.Domain().bigEnd(2);
+
+  auto const& rho_arrays = rho->const_arrays();
+  auto const& qpl_arrays = qpl->const_arrays();
+
+  // Maximum terminal velocity over the domain sets the number of substeps
+  Real wmax = ParReduce(TypeList<ReduceOpMax>{}, TypeList<Real>{},
+                       *qpl, IntVect::TheZeroVector(),
+       [=] AMREX_GPU_DEVICE (int box_no, int i, int j, int k) noexcept -> GpuTuple<Real>
+       {
+           Real rqr = 0.001*rho_arrays[box_no](i,j,k)*qpl_arrays[box_no](i,j,k);
+           return { (rqr > 0.0) ? 36.34*std::pow(rqr,0.1364)*std::sqrt(kes_rho0/rho_arrays[box_no](i,j,k)) : 0.0 };
+       });
+  ParallelDescriptor::ReduceRealMax(wmax);
+
+  if (wmax <= 0.0) return;
+
+  int  nsub  = static_cast<int>(std::ceil(wmax*dt/(kes_cfl*dz)));
+  nsub       = std::max(nsub, 1);
+  Real dtsub = dt / static_cast<Real>(nsub);
+
+  // Downward flux of rain at cell centers, with one ghost cell so that the flux
+  //    entering from the box above is available
+  MultiFab fz(qpl->boxArray(), qpl->DistributionMap(), 1, IntVect(0,0,1));
+  fz.setVal(0.);
+
+  for (int n = 0; n < nsub; ++n) {
+     for ( MFIter mfi(fz, TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+        auto rho_array = rho->const_array(mfi);
+        auto qpl_array = qpl->const_array(mfi);
+        auto fz_array  = fz.array(mfi);
+
+        const auto& box3d = mfi.tilebox();
+
+        ParallelFor(box3d, [=] AMREX_GPU_DEVICE (int i, int j, int k) {
+           Real rqr = 0.001*rho_array(i,j,k)*qpl_array(i,j,k);
+           Real vt  = (rqr > 0.0) ? 36.34*std::pow(rqr,0.1364)*std::sqrt(kes_rho0/rho_array(i,j,k)) : 0.0;
+           fz_array(i,j,k) = rho_array(i,j,k)*qpl_array(i,j,k)*vt;
+        });
+     }
+     fz.FillBoundary(m_geom.periodicity());
+
+     for ( MFIter mfi(fz, TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+        auto rho_array = rho->const_array(mfi);
+        auto qpl_array = qpl->array(mfi);
+        auto fz_array  = fz.const_array(mfi);
+
+        const auto& box3d = mfi.tilebox() & m_gtoe[mfi.index()];
+
+        ParallelFor(box3d, [=] AMREX_GPU_DEVICE (int i, int j, int k) {
+           Real flux_in = (k < khi) ? fz_array(i,j,k+1) : 0.0;
+           qpl_array(i,j,k) = std::max(0.0, qpl_array(i,j,k)
+                            + dtsub*(flux_in - fz_array(i,j,k))/(rho_array(i,j,k)*dz));
+        });
+     }
+  }
+}
+
+/**
+ * Updates conserved and moisture variables in the provided MultiFabs from
+ * the internal MultiFabs that store Kessler module data.
+ *
+ * @param[out] cons Conserved variables
+ * @param[out] qmoist: qv, qc, qi, qr, qs, qg (ice species are zero)
+ */
+void Kessler::Update(MultiFab& cons,
+                     MultiFab& qmoist)
+{
+  for ( MFIter mfi(cons,TilingIfNotGPU()); mfi.isValid(); ++mfi) {
+     auto states_arr = cons.array(mfi);
+     auto qmoist_arr = qmoist.array(mfi);
+
+     auto rho_arr    = mic_fab_vars[KesVar::rho]->const_array(mfi);
+     auto theta_arr  = mic_fab_vars[KesVar::theta]->const_array(mfi);
+     auto qv_arr     = mic_fab_vars[KesVar::qv]->const_array(mfi);
+     auto qcl_arr    = mic_fab_vars[KesVar::qcl]->const_array(mfi);
+     auto qpl_arr    = mic_fab_vars[KesVar::qpl]->const_array(mfi);
+
+     const auto& box3d = mfi.tilebox();
+
+     ParallelFor( box3d, [=] AMREX_GPU_DEVICE (int i, int j, int k) {
+       states_arr(i,j,k,RhoTheta_comp) = rho_arr(i,j,k)*theta_arr(i,j,k);
+       states_arr(i,j,k,RhoQt_comp)    = rho_arr(i,j,k)*(qv_arr(i,j,k)+qcl_arr(i,j,k));
+       states_arr(i,j,k,RhoQp_comp)    = rho_arr(i,j,k)*qpl_arr(i,j,k);
+
+       qmoist_arr(i,j,k,0) = qv_arr(i,j,k);  // vapor
+       qmoist_arr(i,j,k,1) = qcl_arr(i,j,k); // cloud water
+       qmoist_arr(i,j,k,2) = 0.0;            // cloud ice
+       qmoist_arr(i,j,k,3) = qpl_arr(i,j,k); // rain
+       qmoist_arr(i,j,k,4) = 0.0;            // snow
+       qmoist_arr(i,j,k,5) = 0.0;            // graupel
+     });
+  }
+
+  // Fill interior ghost cells and periodic boundaries
+  cons.FillBoundary(m_geom.periodicity());
+  qmoist.FillBoundary(m_geom.periodicity());
+}
+
+/**
+ * Wrapper for the Kessler source terms and rain sedimentation.
+ */
+void Kessler::Proc() {
+
+    if (docloud) {
+        AdvanceKessler();
+    }
+
+    if (doprecip) {
+        RainFall();
+    }
+}
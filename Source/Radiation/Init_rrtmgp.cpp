@@ -10,6 +10,16 @@
 // Rrtmgp
 #include "Rrtmgp.H"
 
+Rrtmgp::Rrtmgp(const std::vector<std::string>& gas_names_in,
+               const std::string& coeff_file_sw,
+               const std::string& coeff_file_lw)
+    : ngas(static_cast<int>(gas_names_in.size())),
+      gas_names(gas_names_in),
+      coefficients_file_sw(coeff_file_sw),
+      coefficients_file_lw(coeff_file_lw)
+{
+}
+
 void Rrtmgp::initialize()
 {
     // First, make sure yakl has been initialized
@@ -26,7 +36,8 @@ void Rrtmgp::initialize()
     // impossible from this initialization routine because I do not think the
     // rad_cnst objects are setup yet.
     // the other tasks!
-    auto active_gases = string1d("active_gases", ngas);
+    // NOTE: this is the member used by the sw/lw drivers, don't shadow it here
+    active_gases = string1d("active_gases", ngas);
     for (int igas=0; igas<ngas; igas++) {
         active_gases(igas+1) = gas_names[igas];
     }
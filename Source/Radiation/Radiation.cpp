@@ -0,0 +1,1056 @@
+#include <AMReX_MultiFabUtil.H>
+#include <EOS.H>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Radiation.H"
+
+using namespace amrex;
+
+Radiation::Radiation (int nlevs_max, const SolverChoice& sc)
+    : m_c_p(sc.c_p), m_rdOcp(sc.rdOcp)
+{
+    ParmParse pp("erf");
+
+    // How often we call RRTMGP
+    pp.query("rad.interval", rad_int);
+    pp.query("rad.period"  , rad_per);
+    if (rad_int <= 0 && rad_per <= 0.0) {
+        amrex::Abort("Radiation: one of erf.rad.interval or erf.rad.period must be positive");
+    }
+
+    pp.query("rad.coeff_file_sw", m_coeff_file_sw);
+    pp.query("rad.coeff_file_lw", m_coeff_file_lw);
+
+    pp.query("rad.albedo"    , m_albedo);
+    pp.query("rad.emissivity", m_emissivity);
+
+    pp.query("rad.latitude"   , m_lat);
+    pp.query("rad.longitude"  , m_lon);
+    pp.query("rad.day_of_year", m_day_of_year);
+    pp.query("rad.start_hour" , m_start_hour);
+    pp.query("rad.tsi_scaling", m_tsi_scaling);
+
+    pp.query("rad.co2_vmr", m_gas_vmr[1]);
+    pp.query("rad.o3_vmr" , m_gas_vmr[2]);
+
+    pp.query("rad.reff_liq", m_reff_liq);
+    pp.query("rad.kappa_lw", m_kappa_lw);
+
+    // Horizontal coarsening of the radiation columns; one value per level, or a single
+    //    value used at every level
+    m_coarsen_factor.resize(nlevs_max, 1);
+    int ncf = pp.countval("rad.coarsen_factor");
+    if (ncf == 1) {
+        int cf; pp.get("rad.coarsen_factor", cf);
+        for (auto& c : m_coarsen_factor) c = cf;
+    } else if (ncf > 1) {
+        amrex::Vector<int> cf_in;
+        pp.queryarr("rad.coarsen_factor", cf_in);
+        for (int lev = 0; lev < std::min(ncf, nlevs_max); ++lev) m_coarsen_factor[lev] = cf_in[lev];
+    }
+    for (auto& c : m_coarsen_factor) {
+        if (c < 1) amrex::Abort("Radiation: erf.rad.coarsen_factor must be >= 1");
+    }
+    pp.query("rad.check_coarsening", m_check_coarsening);
+    pp.query("rad.coarsening_tol"  , m_coarsening_tol);
+
+    // Lagged, asynchronous radiation
+    pp.query("rad.lag"          , rad_lag);
+    pp.query("rad.async_threads", m_async_threads);
+    if (rad_lag < 0) {
+        amrex::Abort("Radiation: erf.rad.lag must be >= 0");
+    }
+    if (m_async_threads < 1) {
+        amrex::Abort("Radiation: erf.rad.async_threads must be >= 1");
+    }
+#ifdef _OPENMP
+    // The radiation thread runs next to the main OpenMP team, so keep the two within the
+    //    cores this rank may use
+    if (rad_lag > 0) {
+        const int ncores = omp_get_num_procs();
+        const int nmain  = omp_get_max_threads();
+        if (nmain + m_async_threads > ncores) {
+            const int nasync = std::max(1, ncores - nmain);
+            amrex::Print() << "Radiation: " << nmain << " OpenMP threads + " << m_async_threads
+                           << " radiation threads exceed the " << ncores << " cores available;"
+                           << " using " << nasync << " radiation thread(s)."
+                           << " Reduce OMP_NUM_THREADS to leave cores for radiation." << std::endl;
+            m_async_threads = nasync;
+        }
+    }
+#endif
+
+    // Distribution of the shortwave work over the ranks
+    pp.query("rad.sw_load_balance", m_sw_load_balance);
+    pp.query("rad.sw_batch_size"  , m_sw_batch_size);
+    pp.query("rad.timing_report"  , m_timing_report);
+    if (m_sw_batch_size < 0) {
+        amrex::Abort("Radiation: erf.rad.sw_batch_size must be >= 0");
+    }
+
+    m_qrad.resize(nlevs_max);
+    m_qrad_geom.resize(nlevs_max);
+    m_pending.resize(nlevs_max);
+
+    m_rrtmgp = std::make_unique<Rrtmgp>(m_gas_names, m_coeff_file_sw, m_coeff_file_lw);
+    m_rrtmgp->initialize();
+}
+
+Radiation::~Radiation ()
+{
+    for (int lev = 0; lev < static_cast<int>(m_pending.size()); ++lev) {
+        discard_heating_rate(lev);
+    }
+    if (m_rrtmgp) m_rrtmgp->finalize();
+}
+
+/**
+ * Compute the radiative heating rate on one level now and store it in m_qrad[lev]
+ *
+ * @param[in] lev    level of refinement
+ * @param[in] cons   cell-centered conserved state
+ * @param[in] qmoist moisture variables (qv, qc, ...) or nullptr if there are none
+ * @param[in] geom   geometry at this level
+ * @param[in] time   simulation time
+ */
+void
+Radiation::compute_heating_rate (int lev,
+                                 const MultiFab& cons,
+                                 const MultiFab* qmoist,
+                                 const Geometry& geom,
+                                 Real time)
+{
+    begin_heating_rate(lev, cons, qmoist, geom, time, false);
+    end_heating_rate(lev);
+}
+
+/**
+ * Take a snapshot of the column state on one level and start the radiative transfer
+ *
+ * With rad.coarsen_factor > 1 at this level the state is block averaged over
+ * cf x cf columns, RRTMGP is run on the averaged columns and the heating rate is
+ * interpolated bilinearly back to every column in end_heating_rate.
+ *
+ * If async is true the column solves run on a separate host thread and the state
+ * may be advanced while they do; the result is only picked up by end_heating_rate.
+ *
+ * @param[in] lev        level of refinement
+ * @param[in] cons       cell-centered conserved state
+ * @param[in] qmoist     moisture variables (qv, qc, ...) or nullptr if there are none
+ * @param[in] geom       geometry at this level
+ * @param[in] time       simulation time
+ * @param[in] async      run the column solves on a separate host thread
+ * @param[in] ready_step step at which the caller will pick up the result
+ */
+void
+Radiation::begin_heating_rate (int lev,
+                               const MultiFab& cons,
+                               const MultiFab* qmoist,
+                               const Geometry& geom,
+                               Real time,
+                               bool async,
+                               int ready_step)
+{
+    BL_PROFILE("Radiation::begin_heating_rate()");
+
+    // Only one calculation in flight per level
+    discard_heating_rate(lev);
+
+    m_pending[lev] = std::make_unique<RadColumns>();
+    RadColumns& rc = *m_pending[lev];
+
+    rc.ba         = cons.boxArray();
+    rc.dm         = cons.DistributionMap();
+    rc.geom       = geom;
+    rc.cf         = m_coarsen_factor[lev];
+    rc.time       = time;
+    rc.ready_step = ready_step;
+
+    const Box& domain = geom.Domain();
+
+    AMREX_ALWAYS_ASSERT(domain.length(2) > 1);
+
+    // Column state on the level grids
+    rc.state = std::make_unique<MultiFab>(rc.ba, rc.dm, RadVar::NumVars, 0);
+
+    // Each column has its own latitude/longitude on the tangent plane through the
+    //    reference location, which sits at the center of the domain
+    const Real r_earth = 6.371e6;
+    const Real rad2deg = 180.0 / PI;
+    const Real lat0    = m_lat;
+    const Real lon0    = m_lon;
+    const Real doy     = m_day_of_year;
+    const Real hour0   = m_start_hour;
+    const Real coslat0 = std::max(std::cos(lat0 / rad2deg), 1.0e-3);
+    const Real xc      = 0.5 * (geom.ProbLo(0) + geom.ProbHi(0));
+    const Real yc      = 0.5 * (geom.ProbLo(1) + geom.ProbHi(1));
+    const auto dx      = geom.CellSizeArray();
+    const auto prob_lo = geom.ProbLoArray();
+
+    const Real rdOcp = m_rdOcp;
+    for (MFIter mfi(*rc.state, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        const Array4<const Real>& cons_arr  = cons.const_array(mfi);
+        const Array4<      Real>& state_arr = rc.state->array(mfi);
+#if defined(ERF_USE_MOISTURE)
+        const Array4<const Real>& qm_arr = qmoist->const_array(mfi);
+#else
+        amrex::ignore_unused(qmoist);
+#endif
+        ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            Real qv = 0.0;
+            Real qc = 0.0;
+#if defined(ERF_USE_MOISTURE)
+            qv = qm_arr(i,j,k,0);
+            qc = qm_arr(i,j,k,1);
+#elif defined(ERF_USE_WARM_NO_PRECIP)
+            qv = cons_arr(i,j,k,RhoQv_comp) / cons_arr(i,j,k,Rho_comp);
+            qc = cons_arr(i,j,k,RhoQc_comp) / cons_arr(i,j,k,Rho_comp);
+#endif
+            Real theta = cons_arr(i,j,k,RhoTheta_comp) / cons_arr(i,j,k,Rho_comp);
+            Real pres  = getPgivenRTh(cons_arr(i,j,k,RhoTheta_comp), qv);
+
+            Real x   = prob_lo[0] + (i + 0.5) * dx[0];
+            Real y   = prob_lo[1] + (j + 0.5) * dx[1];
+            Real lat = lat0 + rad2deg * (y - yc) / r_earth;
+            Real lon = lon0 + rad2deg * (x - xc) / (r_earth * coslat0);
+
+            state_arr(i,j,k,RadVar::pmid  ) = pres;
+            state_arr(i,j,k,RadVar::tmid  ) = theta * getExnergivenP(pres, rdOcp);
+            state_arr(i,j,k,RadVar::qv    ) = std::max(qv, 0.0);
+            state_arr(i,j,k,RadVar::qc    ) = std::max(qc, 0.0);
+            state_arr(i,j,k,RadVar::coszrs) = rad_cos_zenith(time, lat, lon, doy, hour0);
+            state_arr(i,j,k,RadVar::qrad  ) = 0.0;
+        });
+    }
+
+    if (rc.cf == 1) {
+        rc.cols = gather_columns(*rc.state, domain);
+    } else {
+        // Block averages of cf x cf columns
+        const IntVect ratio(AMREX_D_DECL(rc.cf,rc.cf,1));
+        if (!rc.ba.coarsenable(ratio)) {
+            amrex::Abort("Radiation: grids must be coarsenable by erf.rad.coarsen_factor");
+        }
+        BoxArray ba_c(rc.ba);
+        ba_c.coarsen(ratio);
+
+        rc.state_c = std::make_unique<MultiFab>(ba_c, rc.dm, RadVar::NumVars, 0);
+        amrex::average_down(*rc.state, *rc.state_c, 0, RadVar::NumVars, ratio);
+
+        rc.cols = gather_columns(*rc.state_c, amrex::coarsen(domain, ratio));
+    }
+
+    if (async) {
+        ColumnSet* cs = &rc.cols;
+        const int nthreads = m_async_threads;
+        rc.task = std::async(std::launch::async, [this, cs, nthreads] ()
+        {
+#ifdef _OPENMP
+            omp_set_num_threads(nthreads);
+#else
+            amrex::ignore_unused(nthreads);
+#endif
+            solve_columns(*cs);
+        });
+    } else {
+        solve_columns(rc.cols);
+    }
+}
+
+/**
+ * Wait for the radiative transfer started by begin_heating_rate and store the
+ * resulting heating rate in m_qrad[lev]
+ *
+ * @param[in] lev level of refinement
+ */
+void
+Radiation::end_heating_rate (int lev)
+{
+    BL_PROFILE("Radiation::end_heating_rate()");
+
+    AMREX_ALWAYS_ASSERT(m_pending[lev]);
+    RadColumns& rc = *m_pending[lev];
+
+    if (rc.task.valid()) rc.task.get();
+
+    finish_columns(rc.cols);
+
+    if (m_timing_report) report_timing(lev, rc.cols);
+
+    const BoxArray&            ba = rc.ba;
+    const DistributionMapping& dm = rc.dm;
+    const int                  cf = rc.cf;
+
+    if (cf == 1) {
+        rc.state->ParallelCopy(*rc.cols.col, RadVar::qrad, RadVar::qrad, 1);
+
+        m_qrad[lev] = std::make_unique<MultiFab>(ba, dm, 1, 0);
+        m_qrad_geom[lev] = rc.geom;
+        MultiFab::Copy(*m_qrad[lev], *rc.state, RadVar::qrad, 0, 1, 0);
+        fill_uncovered_columns(lev, rc);
+        m_pending[lev].reset();
+        return;
+    }
+
+    const IntVect ratio(AMREX_D_DECL(cf,cf,1));
+    const Box domain_c = amrex::coarsen(rc.geom.Domain(), ratio);
+    rc.state_c->ParallelCopy(*rc.cols.col, RadVar::qrad, RadVar::qrad, 1);
+
+    // One ghost cell in each horizontal direction for the interpolation; ghost cells not
+    //    overwritten by FillBoundary (domain or coarse-fine boundaries) use the nearest value
+    MultiFab qrad_c(rc.state_c->boxArray(), dm, 1, IntVect(AMREX_D_DECL(1,1,0)));
+    MultiFab::Copy(qrad_c, *rc.state_c, RadVar::qrad, 0, 1, 0);
+    for (MFIter mfi(qrad_c); mfi.isValid(); ++mfi)
+    {
+        const Box& vbx = mfi.validbox();
+        const Box& gbx = mfi.fabbox();
+        const auto& vlo = lbound(vbx);
+        const auto& vhi = ubound(vbx);
+        const Array4<Real>& qc_arr = qrad_c.array(mfi);
+        ParallelFor(gbx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            int ii = amrex::min(amrex::max(i, vlo.x), vhi.x);
+            int jj = amrex::min(amrex::max(j, vlo.y), vhi.y);
+            if (ii != i || jj != j) qc_arr(i,j,k) = qc_arr(ii,jj,k);
+        });
+    }
+    qrad_c.FillBoundary(rc.geom.periodicity(domain_c));
+
+    // Bilinear interpolation of the coarse heating rate back to every column
+    m_qrad[lev] = std::make_unique<MultiFab>(ba, dm, 1, 0);
+    m_qrad_geom[lev] = rc.geom;
+    for (MFIter mfi(*m_qrad[lev], TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        const Array4<const Real>& qc_arr = qrad_c.const_array(mfi);
+        const Array4<      Real>& qf_arr = m_qrad[lev]->array(mfi);
+        const Real rcf = 1.0 / static_cast<Real>(cf);
+        ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            Real xc = (i + 0.5) * rcf - 0.5;
+            Real yc = (j + 0.5) * rcf - 0.5;
+            int ic = static_cast<int>(amrex::Math::floor(xc));
+            int jc = static_cast<int>(amrex::Math::floor(yc));
+            Real wx = xc - ic;
+            Real wy = yc - jc;
+            qf_arr(i,j,k) = (1.0-wx) * (1.0-wy) * qc_arr(ic  ,jc  ,k)
+                          +      wx  * (1.0-wy) * qc_arr(ic+1,jc  ,k)
+                          + (1.0-wx) *      wy  * qc_arr(ic  ,jc+1,k)
+                          +      wx  *      wy  * qc_arr(ic+1,jc+1,k);
+        });
+    }
+
+    // Report the error relative to radiation on every column of the same snapshot
+    if (m_check_coarsening) {
+        ColumnSet cs_f = gather_columns(*rc.state, rc.geom.Domain());
+        solve_columns(cs_f);
+        finish_columns(cs_f);
+        rc.state->ParallelCopy(*cs_f.col, RadVar::qrad, RadVar::qrad, 1);
+
+        MultiFab err(ba, dm, 1, 0);
+        MultiFab::Copy(err, *m_qrad[lev], 0, 0, 1, 0);
+        MultiFab::Subtract(err, *rc.state, RadVar::qrad, 0, 1, 0);
+
+        Real max_full = rc.state->norm0(RadVar::qrad);
+        Real max_err  = err.norm0(0);
+        Real l2_err   = err.norm2(0) / std::sqrt(static_cast<Real>(ba.numPts()));
+        amrex::Print() << "Radiation at level " << lev << " coarsened by " << cf
+                       << ": max |qrad| = " << max_full
+                       << "  max error = " << max_err
+                       << "  rms error = " << l2_err << " [K/s]" << std::endl;
+        if (m_coarsening_tol >= 0.0 && max_err > m_coarsening_tol * max_full) {
+            amrex::Abort("Radiation: error of the coarsened heating rate exceeds erf.rad.coarsening_tol");
+        }
+    }
+
+    fill_uncovered_columns(lev, rc);
+    m_pending[lev].reset();
+}
+
+/**
+ * Fill the columns of a level that its grids do not cover over the full height of the
+ * domain, and so were not solved, with the heating rate of the next coarser level
+ * interpolated bilinearly in the horizontal (and piecewise constant in the vertical)
+ *
+ * @param[in] lev level of refinement
+ * @param[in] rc  calculation whose result is in m_qrad[lev]
+ */
+void
+Radiation::fill_uncovered_columns (int lev, const RadColumns& rc)
+{
+    if (rc.cols.missing.isEmpty()) return;
+
+    AMREX_ALWAYS_ASSERT_WITH_MESSAGE(lev > 0 && m_qrad[lev-1],
+        "Radiation: no coarser heating rate for the columns not covered over the full height");
+
+    // Cells of this level in the uncovered columns
+    const IntVect cf_ratio(AMREX_D_DECL(rc.cf,rc.cf,1));
+    BoxList bl_fine;
+    for (Box b : rc.cols.missing) {
+        b.refine(cf_ratio);
+        for (const auto& is : rc.ba.intersections(b)) bl_fine.push_back(is.second);
+    }
+    BoxArray ba_f(std::move(bl_fine));
+    DistributionMapping dm_f(ba_f);
+
+    const Box& dom_f = rc.geom.Domain();
+    const Box& dom_c = m_qrad_geom[lev-1].Domain();
+    IntVect ratio;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) ratio[d] = dom_f.length(d) / dom_c.length(d);
+
+    // Coarse cells under them, with their horizontal neighbours where the coarse grids
+    //    have them; elsewhere the interpolation falls back to the nearest coarse value
+    const BoxArray& ba_crse = m_qrad[lev-1]->boxArray();
+    BoxList bl_c;
+    for (int n = 0; n < ba_f.size(); ++n) {
+        const Box bc = amrex::coarsen(ba_f[n], ratio);
+        const Box bg = amrex::grow(bc, IntVect(AMREX_D_DECL(1,1,0))) & dom_c;
+        bl_c.push_back(ba_crse.contains(bg) ? bg : bc);
+    }
+    MultiFab qrad_c(BoxArray(std::move(bl_c)), dm_f, 1, 0);
+    qrad_c.ParallelCopy(*m_qrad[lev-1], 0, 0, 1);
+
+    MultiFab qrad_f(ba_f, dm_f, 1, 0);
+    const Real rx = 1.0 / static_cast<Real>(ratio[0]);
+    const Real ry = 1.0 / static_cast<Real>(ratio[1]);
+    const int  rz = ratio[2];
+    for (MFIter mfi(qrad_f, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        const auto& clo = lbound(qrad_c.box(mfi.index()));
+        const auto& chi = ubound(qrad_c.box(mfi.index()));
+        const Array4<const Real>& qc_arr = qrad_c.const_array(mfi);
+        const Array4<      Real>& qf_arr = qrad_f.array(mfi);
+        ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            Real xc = (i + 0.5) * rx - 0.5;
+            Real yc = (j + 0.5) * ry - 0.5;
+            int ic = static_cast<int>(amrex::Math::floor(xc));
+            int jc = static_cast<int>(amrex::Math::floor(yc));
+            Real wx = xc - ic;
+            Real wy = yc - jc;
+            int i0 = amrex::min(amrex::max(ic  , clo.x), chi.x);
+            int i1 = amrex::min(amrex::max(ic+1, clo.x), chi.x);
+            int j0 = amrex::min(amrex::max(jc  , clo.y), chi.y);
+            int j1 = amrex::min(amrex::max(jc+1, clo.y), chi.y);
+            int kc = k / rz;
+            qf_arr(i,j,k) = (1.0-wx) * (1.0-wy) * qc_arr(i0,j0,kc)
+                          +      wx  * (1.0-wy) * qc_arr(i1,j0,kc)
+                          + (1.0-wx) *      wy  * qc_arr(i0,j1,kc)
+                          +      wx  *      wy  * qc_arr(i1,j1,kc);
+        });
+    }
+
+    m_qrad[lev]->ParallelCopy(qrad_f, 0, 0, 1);
+}
+
+/**
+ * Drop a calculation in flight on this level (e.g. after a regrid)
+ *
+ * @param[in] lev level of refinement
+ */
+void
+Radiation::discard_heating_rate (int lev)
+{
+    if (m_pending[lev]) {
+        if (m_pending[lev]->task.valid()) m_pending[lev]->task.wait();
+        m_pending[lev].reset();
+    }
+}
+
+/**
+ * Copy a column state into host accessible memory, extending every grid over the
+ * full height of the domain so each column lives in a single box, and pack the
+ * sunlit columns for the shortwave
+ *
+ * The sunlit columns are numbered consecutively over the ranks (rank 0 first) in a
+ * 1D index space of nsunlit x nlay cells. sw_own holds each rank's own sunlit columns;
+ * sw_bal holds the same index space chopped into batches dealt out round-robin over
+ * the ranks, so a ParallelCopy between the two moves the work where it is done.
+ *
+ * @param[in] state  column state (see RadVar) on grids that may be split in the vertical
+ * @param[in] domain index space of the state
+ */
+Radiation::ColumnSet
+Radiation::gather_columns (const MultiFab& state, const Box& domain)
+{
+    BL_PROFILE("Radiation::gather_columns()");
+
+    ColumnSet cs;
+
+    const BoxArray& ba_state = state.boxArray();
+
+    BoxList bl_full = ba_state.boxList();
+    for (auto& b : bl_full) {
+        b.setSmall(2, domain.smallEnd(2));
+        b.setBig  (2, domain.bigEnd(2));
+    }
+    BoxArray ba_full(std::move(bl_full));
+    ba_full.removeOverlap();
+
+    // Only the columns the grids cover over the full height can be solved; the others
+    //    take the heating rate of the coarser level (see fill_uncovered_columns)
+    BoxList bl_missing;
+    for (int n = 0; n < ba_full.size(); ++n) {
+        for (Box b : ba_state.complementIn(ba_full[n])) {
+            b.setSmall(2, domain.smallEnd(2));
+            b.setBig  (2, domain.bigEnd(2));
+            bl_missing.push_back(b);
+        }
+    }
+    BoxList bl_col;
+    if (bl_missing.isEmpty()) {
+        bl_col = ba_full.boxList();
+    } else {
+        amrex::Print() << "Radiation: " << bl_missing.numPts() / domain.length(2)
+                       << " columns are not covered over the full height and are"
+                       << " interpolated from the coarser level" << std::endl;
+        for (int n = 0; n < ba_full.size(); ++n) {
+            bl_col.join(amrex::complementIn(ba_full[n], bl_missing));
+        }
+    }
+    cs.missing = bl_missing;
+    BoxArray ba_col(std::move(bl_col));
+    DistributionMapping dm_col = ba_col.empty() ? DistributionMapping(Vector<int>{})
+                                                : DistributionMapping(ba_col);
+
+    // RRTMGP takes host pointers so we gather the columns into host accessible memory
+    cs.col = std::make_unique<MultiFab>(ba_col, dm_col, RadVar::NumVars, 0,
+                                        MFInfo().SetArena(The_Pinned_Arena()));
+    cs.col->ParallelCopy(state, 0, 0, RadVar::NumVars);
+    Gpu::streamSynchronize();
+
+    const int nlay   = domain.length(2);
+    const int klo    = domain.smallEnd(2);
+    const int nprocs = ParallelDescriptor::NProcs();
+    const int myproc = ParallelDescriptor::MyProc();
+
+    cs.ncolumns = ba_col.numPts() / nlay;
+
+    // Number of sunlit columns on each rank
+    Vector<Long> nsun(nprocs, 0);
+    for (int K : cs.col->IndexArray()) {
+        const Box bx = cs.col->box(K);
+        const Array4<const Real>& col_arr = cs.col->const_array(K);
+        for (int j = bx.smallEnd(1); j <= bx.bigEnd(1); ++j) {
+            for (int i = bx.smallEnd(0); i <= bx.bigEnd(0); ++i) {
+                if (col_arr(i,j,klo,RadVar::coszrs) > 0.0) ++nsun[myproc];
+            }
+        }
+    }
+    ParallelDescriptor::ReduceLongSum(nsun.data(), nprocs);
+
+    Vector<Long> offset(nprocs+1, 0);
+    for (int p = 0; p < nprocs; ++p) offset[p+1] = offset[p] + nsun[p];
+    cs.nsunlit = offset[nprocs];
+
+    // Nothing to do for the shortwave if the sun is down everywhere
+    if (cs.nsunlit == 0) return cs;
+
+    // Each rank's own sunlit columns
+    BoxList bl_own;
+    Vector<int> pmap_own;
+    for (int p = 0; p < nprocs; ++p) {
+        if (nsun[p] > 0) {
+            bl_own.push_back(Box(IntVect(AMREX_D_DECL(static_cast<int>(offset[p])    ,0,0)),
+                                 IntVect(AMREX_D_DECL(static_cast<int>(offset[p+1])-1,0,nlay-1))));
+            pmap_own.push_back(p);
+        }
+    }
+    cs.sw_own = std::make_unique<MultiFab>(BoxArray(std::move(bl_own)),
+                                           DistributionMapping(std::move(pmap_own)),
+                                           RadVar::NumVars, 0,
+                                           MFInfo().SetArena(The_Pinned_Arena()));
+
+    for (int K : cs.sw_own->IndexArray()) {
+        const Array4<Real>& own_arr = cs.sw_own->array(K);
+        int n = static_cast<int>(offset[myproc]);
+        for (int Kc : cs.col->IndexArray()) {
+            const Box bx = cs.col->box(Kc);
+            const Array4<const Real>& col_arr = cs.col->const_array(Kc);
+            for (int j = bx.smallEnd(1); j <= bx.bigEnd(1); ++j) {
+                for (int i = bx.smallEnd(0); i <= bx.bigEnd(0); ++i) {
+                    if (col_arr(i,j,klo,RadVar::coszrs) > 0.0) {
+                        for (int k = 0; k < nlay; ++k) {
+                            for (int c = 0; c < RadVar::NumVars; ++c) {
+                                own_arr(n,0,k,c) = col_arr(i,j,klo+k,c);
+                            }
+                        }
+                        ++n;
+                    }
+                }
+            }
+        }
+    }
+
+    if (!m_sw_load_balance) return cs;
+
+    // The same columns in batches spread evenly over the ranks
+    const Long batch = (m_sw_batch_size > 0) ? static_cast<Long>(m_sw_batch_size)
+                                             : (cs.nsunlit + nprocs - 1) / nprocs;
+    BoxList bl_bal;
+    Vector<int> pmap_bal;
+    int ibatch = 0;
+    for (Long lo = 0; lo < cs.nsunlit; lo += batch, ++ibatch) {
+        Long hi = std::min(lo + batch, cs.nsunlit) - 1;
+        bl_bal.push_back(Box(IntVect(AMREX_D_DECL(static_cast<int>(lo),0,0)),
+                             IntVect(AMREX_D_DECL(static_cast<int>(hi),0,nlay-1))));
+        pmap_bal.push_back(ibatch % nprocs);
+    }
+    cs.sw_bal = std::make_unique<MultiFab>(BoxArray(std::move(bl_bal)),
+                                           DistributionMapping(std::move(pmap_bal)),
+                                           RadVar::NumVars, 0,
+                                           MFInfo().SetArena(The_Pinned_Arena()));
+    cs.sw_bal->ParallelCopy(*cs.sw_own, 0, 0, RadVar::NumVars);
+    Gpu::streamSynchronize();
+
+    return cs;
+}
+
+/**
+ * Run RRTMGP on the local columns and batches of a ColumnSet: the longwave on every
+ * column (into the qrad component of col) and the shortwave on the sunlit batches
+ * (into the qrad component of sw_bal, or of sw_own if we are not balancing)
+ *
+ * NOTE: this may run on a separate host thread, so it only touches local data
+ *       (no MPI, no MFIter) and serializes the calls into RRTMGP/YAKL
+ *
+ * @param[inout] cs columns gathered by gather_columns
+ */
+void
+Radiation::solve_columns (ColumnSet& cs)
+{
+    BL_PROFILE("Radiation::solve_columns()");
+
+    std::lock_guard<std::mutex> lock(m_solve_mutex);
+
+    const Real rdOcp = m_rdOcp;
+
+    // Longwave on every column
+    Real t0 = amrex::second();
+    for (int K : cs.col->IndexArray())
+    {
+        const Box bx = cs.col->box(K);
+        const auto& lo = lbound(bx);
+        const auto& hi = ubound(bx);
+
+        const int nx   = bx.length(0);
+        const int ncol = bx.length(0) * bx.length(1);
+        const int nlay = bx.length(2);
+
+        const Array4<Real>& col_arr = cs.col->array(K);
+
+        // RRTMGP ordering: column index fastest, layer 1 at the top of the domain
+        std::vector<double> pmid(ncol*nlay), tmid(ncol*nlay), qv(ncol*nlay), qc(ncol*nlay);
+        std::vector<double> hrate(ncol*nlay, 0.0);
+        for (int k = lo.z; k <= hi.z; ++k) {
+            for (int j = lo.y; j <= hi.y; ++j) {
+                for (int i = lo.x; i <= hi.x; ++i) {
+                    int icol = (i-lo.x) + nx*(j-lo.y);
+                    int ilay = hi.z - k;
+                    pmid[icol+ncol*ilay] = col_arr(i,j,k,RadVar::pmid);
+                    tmid[icol+ncol*ilay] = col_arr(i,j,k,RadVar::tmid);
+                    qv  [icol+ncol*ilay] = col_arr(i,j,k,RadVar::qv  );
+                    qc  [icol+ncol*ilay] = col_arr(i,j,k,RadVar::qc  );
+                }
+            }
+        }
+
+        compute_lw_heating(ncol, nlay, pmid, tmid, qv, qc, hrate);
+
+        // Convert d(T)/dt to d(theta)/dt
+        for (int k = lo.z; k <= hi.z; ++k) {
+            for (int j = lo.y; j <= hi.y; ++j) {
+                for (int i = lo.x; i <= hi.x; ++i) {
+                    int icol = (i-lo.x) + nx*(j-lo.y);
+                    int ilay = hi.z - k;
+                    Real exner = getExnergivenP(col_arr(i,j,k,RadVar::pmid), rdOcp);
+                    col_arr(i,j,k,RadVar::qrad) = hrate[icol+ncol*ilay] / exner;
+                }
+            }
+        }
+    }
+    cs.t_lw = amrex::second() - t0;
+
+    // Shortwave on the sunlit batches only
+    t0 = amrex::second();
+    MultiFab* sw = (cs.sw_bal) ? cs.sw_bal.get() : cs.sw_own.get();
+    if (sw) {
+        for (int K : sw->IndexArray())
+        {
+            const Box bx = sw->box(K);
+            const int ilo  = bx.smallEnd(0);
+            const int ncol = bx.length(0);
+            const int nlay = bx.length(2);
+
+            const Array4<Real>& sw_arr = sw->array(K);
+
+            std::vector<double> pmid(ncol*nlay), tmid(ncol*nlay), qv(ncol*nlay), qc(ncol*nlay);
+            std::vector<double> mu0(ncol), hrate(ncol*nlay, 0.0);
+            for (int k = 0; k < nlay; ++k) {
+                for (int icol = 0; icol < ncol; ++icol) {
+                    int ilay = nlay - 1 - k;
+                    pmid[icol+ncol*ilay] = sw_arr(ilo+icol,0,k,RadVar::pmid);
+                    tmid[icol+ncol*ilay] = sw_arr(ilo+icol,0,k,RadVar::tmid);
+                    qv  [icol+ncol*ilay] = sw_arr(ilo+icol,0,k,RadVar::qv  );
+                    qc  [icol+ncol*ilay] = sw_arr(ilo+icol,0,k,RadVar::qc  );
+                }
+            }
+            for (int icol = 0; icol < ncol; ++icol) {
+                mu0[icol] = sw_arr(ilo+icol,0,0,RadVar::coszrs);
+            }
+
+            compute_sw_heating(ncol, nlay, pmid, tmid, qv, qc, mu0, hrate);
+
+            for (int k = 0; k < nlay; ++k) {
+                for (int icol = 0; icol < ncol; ++icol) {
+                    int ilay = nlay - 1 - k;
+                    Real exner = getExnergivenP(sw_arr(ilo+icol,0,k,RadVar::pmid), rdOcp);
+                    sw_arr(ilo+icol,0,k,RadVar::qrad) = hrate[icol+ncol*ilay] / exner;
+                }
+            }
+        }
+    }
+    cs.t_sw = amrex::second() - t0;
+}
+
+/**
+ * Return the shortwave heating of the sunlit columns to the ranks that own them and
+ * add it to the longwave heating in col
+ *
+ * @param[inout] cs columns solved by solve_columns
+ */
+void
+Radiation::finish_columns (ColumnSet& cs)
+{
+    BL_PROFILE("Radiation::finish_columns()");
+
+    if (!cs.sw_own) return;
+
+    if (cs.sw_bal) {
+        cs.sw_own->ParallelCopy(*cs.sw_bal, RadVar::qrad, RadVar::qrad, 1);
+        Gpu::streamSynchronize();
+    }
+
+    // Unpack in the same order the columns were packed in gather_columns
+    for (int K : cs.sw_own->IndexArray()) {
+        const Box obx = cs.sw_own->box(K);
+        const int nlay = obx.length(2);
+        const Array4<const Real>& own_arr = cs.sw_own->const_array(K);
+        int n = obx.smallEnd(0);
+        for (int Kc : cs.col->IndexArray()) {
+            const Box bx = cs.col->box(Kc);
+            const int klo = bx.smallEnd(2);
+            const Array4<Real>& col_arr = cs.col->array(Kc);
+            for (int j = bx.smallEnd(1); j <= bx.bigEnd(1); ++j) {
+                for (int i = bx.smallEnd(0); i <= bx.bigEnd(0); ++i) {
+                    if (col_arr(i,j,klo,RadVar::coszrs) > 0.0) {
+                        for (int k = 0; k < nlay; ++k) {
+                            col_arr(i,j,klo+k,RadVar::qrad) += own_arr(n,0,k,RadVar::qrad);
+                        }
+                        ++n;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Print the min/avg/max over ranks of the time spent in the longwave and shortwave
+ *
+ * @param[in] lev level of refinement
+ * @param[in] cs  columns solved by solve_columns
+ */
+void
+Radiation::report_timing (int lev, const ColumnSet& cs) const
+{
+    const int nprocs = ParallelDescriptor::NProcs();
+
+    Real tmin[2] = {cs.t_lw, cs.t_sw};
+    Real tmax[2] = {cs.t_lw, cs.t_sw};
+    Real tsum[2] = {cs.t_lw, cs.t_sw};
+    ParallelDescriptor::ReduceRealMin(tmin, 2);
+    ParallelDescriptor::ReduceRealMax(tmax, 2);
+    ParallelDescriptor::ReduceRealSum(tsum, 2);
+
+    amrex::Print() << "Radiation at level " << lev << ": "
+                   << cs.nsunlit << " of " << cs.ncolumns << " columns sunlit" << std::endl;
+    amrex::Print() << "    longwave  time per rank (min/avg/max) = "
+                   << tmin[0] << " " << tsum[0]/nprocs << " " << tmax[0] << std::endl;
+    amrex::Print() << "    shortwave time per rank (min/avg/max) = "
+                   << tmin[1] << " " << tsum[1]/nprocs << " " << tmax[1] << std::endl;
+}
+
+/**
+ * Inputs to RRTMGP that the longwave and shortwave share
+ *
+ * @param[in]  ncol    number of columns
+ * @param[in]  nlay    number of layers in each column
+ * @param[in]  pmid    layer pressure [Pa]
+ * @param[in]  tmid    layer temperature [K]
+ * @param[in]  qv      layer water vapor mixing ratio
+ * @param[in]  qc      layer cloud water mixing ratio
+ * @param[out] play    layer pressure [Pa]
+ * @param[out] tlay    layer temperature limited to the k-distribution range [K]
+ * @param[out] pint    interface pressure [Pa]
+ * @param[out] tint    interface temperature [K]
+ * @param[out] gas_vmr gas volume mixing ratios
+ * @param[out] lwp     layer liquid water path [kg/m^2]
+ */
+void
+Radiation::column_inputs (int ncol, int nlay,
+                          const std::vector<double>& pmid,
+                          const std::vector<double>& tmid,
+                          const std::vector<double>& qv,
+                          const std::vector<double>& qc,
+                          std::vector<double>& play,
+                          std::vector<double>& tlay,
+                          std::vector<double>& pint,
+                          std::vector<double>& tint,
+                          std::vector<double>& gas_vmr,
+                          std::vector<double>& lwp)
+{
+    const int ngas = static_cast<int>(m_gas_names.size());
+    const int nlev = nlay + 1;
+
+    const double tmin = m_rrtmgp->get_min_temperature();
+    const double tmax = m_rrtmgp->get_max_temperature();
+    const double pmin = 1.01; // lowest pressure in the k-distribution tables [Pa]
+
+    // Interface pressure and temperature; layer ilay lies between interfaces ilay and ilay+1
+    play = pmid;
+    tlay.resize(ncol*nlay);
+    pint.resize(ncol*nlev);
+    tint.resize(ncol*nlev);
+    for (int icol = 0; icol < ncol; ++icol) {
+        for (int ilay = 0; ilay < nlay; ++ilay) {
+            tlay[icol+ncol*ilay] = std::min(std::max(tmid[icol+ncol*ilay], tmin), tmax);
+        }
+        for (int ilev = 1; ilev < nlay; ++ilev) {
+            pint[icol+ncol*ilev] = 0.5 * (pmid[icol+ncol*(ilev-1)] + pmid[icol+ncol*ilev]);
+            tint[icol+ncol*ilev] = 0.5 * (tlay[icol+ncol*(ilev-1)] + tlay[icol+ncol*ilev]);
+        }
+        int top = icol;
+        int bot = icol + ncol*nlay;
+        pint[top] = pmid[icol] - 0.5 * (pmid[icol+ncol] - pmid[icol]);
+        tint[top] = tlay[icol] - 0.5 * (tlay[icol+ncol] - tlay[icol]);
+        pint[bot] = pmid[icol+ncol*(nlay-1)] + 0.5 * (pmid[icol+ncol*(nlay-1)] - pmid[icol+ncol*(nlay-2)]);
+        tint[bot] = tlay[icol+ncol*(nlay-1)] + 0.5 * (tlay[icol+ncol*(nlay-1)] - tlay[icol+ncol*(nlay-2)]);
+        pint[top] = std::max(pint[top], pmin);
+        tint[top] = std::min(std::max(tint[top], tmin), tmax);
+        tint[bot] = std::min(std::max(tint[bot], tmin), tmax);
+    }
+
+    // Gas volume mixing ratios; h2o from qv using the ratio of molecular weights
+    gas_vmr.resize(ngas*ncol*nlay);
+    for (int ilay = 0; ilay < nlay; ++ilay) {
+        for (int icol = 0; icol < ncol; ++icol) {
+            gas_vmr[ngas*(icol+ncol*ilay)] = qv[icol+ncol*ilay] * (R_v / R_d);
+            for (int igas = 1; igas < ngas; ++igas) {
+                gas_vmr[igas+ngas*(icol+ncol*ilay)] = m_gas_vmr[igas];
+            }
+        }
+    }
+
+    // Liquid water path of each layer
+    lwp.resize(ncol*nlay);
+    for (int ilay = 0; ilay < nlay; ++ilay) {
+        for (int icol = 0; icol < ncol; ++icol) {
+            double dp = pint[icol+ncol*(ilay+1)] - pint[icol+ncol*ilay];
+            lwp[icol+ncol*ilay] = qc[icol+ncol*ilay] * dp / CONST_GRAV;
+        }
+    }
+}
+
+namespace {
+// Heating rate from the divergence of the net (downward) flux across each layer
+void
+flux_divergence_heating (int ncol, int nlay, Real c_p,
+                         const std::vector<double>& pint,
+                         const std::vector<double>& flux_up,
+                         const std::vector<double>& flux_dn,
+                         std::vector<double>& hrate)
+{
+    for (int ilay = 0; ilay < nlay; ++ilay) {
+        for (int icol = 0; icol < ncol; ++icol) {
+            int itop = icol + ncol*ilay;
+            int ibot = icol + ncol*(ilay+1);
+            double fnet_top = flux_dn[itop] - flux_up[itop];
+            double fnet_bot = flux_dn[ibot] - flux_up[ibot];
+            double dp = pint[ibot] - pint[itop];
+            hrate[icol+ncol*ilay] = CONST_GRAV * (fnet_top - fnet_bot) / (c_p * dp);
+        }
+    }
+}
+}
+
+/**
+ * Run the longwave RRTMGP solver on a set of columns
+ *
+ * @param[in]  ncol  number of columns
+ * @param[in]  nlay  number of layers in each column
+ * @param[in]  pmid  layer pressure [Pa]
+ * @param[in]  tmid  layer temperature [K]
+ * @param[in]  qv    layer water vapor mixing ratio
+ * @param[in]  qc    layer cloud water mixing ratio
+ * @param[out] hrate layer heating rate d(T)/dt [K/s]
+ */
+void
+Radiation::compute_lw_heating (int ncol, int nlay,
+                               const std::vector<double>& pmid,
+                               const std::vector<double>& tmid,
+                               const std::vector<double>& qv,
+                               const std::vector<double>& qc,
+                               std::vector<double>& hrate)
+{
+    BL_PROFILE("Radiation::compute_lw_heating()");
+
+    const int ngas     = static_cast<int>(m_gas_names.size());
+    const int nlwbands = m_rrtmgp->get_nband_lw();
+    const int nlwgpts  = m_rrtmgp->get_ngpt_lw();
+    const int nlev     = nlay + 1;
+
+    std::vector<double> play, tlay, pint, tint, gas_vmr, lwp;
+    column_inputs(ncol, nlay, pmid, tmid, qv, qc, play, tlay, pint, tint, gas_vmr, lwp);
+
+    // Gray liquid cloud absorption
+    std::vector<double> cld_tau(ncol*nlay*nlwgpts);
+    for (int igpt = 0; igpt < nlwgpts; ++igpt) {
+        for (int n = 0; n < ncol*nlay; ++n) {
+            cld_tau[n + ncol*nlay*igpt] = m_kappa_lw * lwp[n];
+        }
+    }
+
+    // No aerosol for now
+    std::vector<double> aer_tau(ncol*nlay*nlwbands, 0.0);
+
+    std::vector<double> emis(nlwbands*ncol, m_emissivity);
+
+    // Broadband and by-band fluxes; only the all-sky broadband fluxes are used
+    std::vector<double> flux_up(ncol*nlev, 0.0), flux_dn(ncol*nlev, 0.0);
+    std::vector<double> flx_a(ncol*nlev), flx_b(ncol*nlev), flx_c(ncol*nlev), flx_d(ncol*nlev);
+    std::vector<double> bnd_a(ncol*nlev*nlwbands), bnd_b(ncol*nlev*nlwbands), bnd_c(ncol*nlev*nlwbands);
+    std::vector<double> bnd_d(ncol*nlev*nlwbands), bnd_e(ncol*nlev*nlwbands), bnd_f(ncol*nlev*nlwbands);
+
+    m_rrtmgp->run_longwave_rrtmgp(
+        ngas, ncol, nlay,
+        gas_vmr.data(),
+        play.data(), tlay.data(), pint.data(),
+        tint.data(), emis.data(),
+        cld_tau.data(), aer_tau.data(),
+        flux_up.data(), flux_dn.data(), flx_a.data(),
+        bnd_a.data(), bnd_b.data(), bnd_c.data(),
+        flx_b.data(), flx_c.data(), flx_d.data(),
+        bnd_d.data(), bnd_e.data(), bnd_f.data());
+
+    flux_divergence_heating(ncol, nlay, m_c_p, pint, flux_up, flux_dn, hrate);
+}
+
+/**
+ * Run the shortwave RRTMGP solver on a set of sunlit columns
+ *
+ * @param[in]  ncol   number of columns
+ * @param[in]  nlay   number of layers in each column
+ * @param[in]  pmid   layer pressure [Pa]
+ * @param[in]  tmid   layer temperature [K]
+ * @param[in]  qv     layer water vapor mixing ratio
+ * @param[in]  qc     layer cloud water mixing ratio
+ * @param[in]  coszrs cosine of the solar zenith angle of each column
+ * @param[out] hrate  layer heating rate d(T)/dt [K/s]
+ */
+void
+Radiation::compute_sw_heating (int ncol, int nlay,
+                               const std::vector<double>& pmid,
+                               const std::vector<double>& tmid,
+                               const std::vector<double>& qv,
+                               const std::vector<double>& qc,
+                               const std::vector<double>& coszrs,
+                               std::vector<double>& hrate)
+{
+    BL_PROFILE("Radiation::compute_sw_heating()");
+
+    const int ngas     = static_cast<int>(m_gas_names.size());
+    const int nswbands = m_rrtmgp->get_nband_sw();
+    const int nswgpts  = m_rrtmgp->get_ngpt_sw();
+    const int nlev     = nlay + 1;
+
+    std::vector<double> play, tlay, pint, tint, gas_vmr, lwp;
+    column_inputs(ncol, nlay, pmid, tmid, qv, qc, play, tlay, pint, tint, gas_vmr, lwp);
+
+    // Gray liquid cloud optics from the layer liquid water path
+    std::vector<double> cld_tau(ncol*nlay*nswgpts), cld_ssa(ncol*nlay*nswgpts), cld_asm(ncol*nlay*nswgpts);
+    for (int igpt = 0; igpt < nswgpts; ++igpt) {
+        for (int n = 0; n < ncol*nlay; ++n) {
+            cld_tau[n + ncol*nlay*igpt] = 1.5 * lwp[n] / (rhor * m_reff_liq);
+            cld_ssa[n + ncol*nlay*igpt] = 0.9999;
+            cld_asm[n + ncol*nlay*igpt] = 0.85;
+        }
+    }
+
+    // No aerosol for now
+    std::vector<double> aer_tau(ncol*nlay*nswbands, 0.0);
+    std::vector<double> aer_ssa(ncol*nlay*nswbands, 0.0);
+    std::vector<double> aer_asm(ncol*nlay*nswbands, 0.0);
+
+    std::vector<double> albedo(nswbands*ncol, m_albedo);
+    std::vector<double> mu0(coszrs);
+
+    // Broadband and by-band fluxes; only the all-sky broadband fluxes are used
+    std::vector<double> flux_up(ncol*nlev, 0.0), flux_dn(ncol*nlev, 0.0);
+    std::vector<double> flx_a(ncol*nlev), flx_b(ncol*nlev), flx_c(ncol*nlev);
+    std::vector<double> flx_d(ncol*nlev), flx_e(ncol*nlev), flx_f(ncol*nlev);
+    std::vector<double> bnd_a(ncol*nlev*nswbands), bnd_b(ncol*nlev*nswbands), bnd_c(ncol*nlev*nswbands);
+    std::vector<double> bnd_d(ncol*nlev*nswbands), bnd_e(ncol*nlev*nswbands), bnd_f(ncol*nlev*nswbands);
+    std::vector<double> bnd_g(ncol*nlev*nswbands), bnd_h(ncol*nlev*nswbands);
+
+    m_rrtmgp->run_shortwave_rrtmgp(
+        ngas, ncol, nlay,
+        gas_vmr.data(), play.data(), tlay.data(), pint.data(),
+        mu0.data(), albedo.data(), albedo.data(),
+        cld_tau.data(), cld_ssa.data(), cld_asm.data(),
+        aer_tau.data(), aer_ssa.data(), aer_asm.data(),
+        flux_up.data(), flux_dn.data(), flx_a.data(), flx_b.data(),
+        bnd_a.data(), bnd_b.data(), bnd_c.data(), bnd_d.data(),
+        flx_c.data(), flx_d.data(), flx_e.data(), flx_f.data(),
+        bnd_e.data(), bnd_f.data(), bnd_g.data(), bnd_h.data(),
+        m_tsi_scaling);
+
+    flux_divergence_heating(ncol, nlay, m_c_p, pint, flux_up, flux_dn, hrate);
+}
+
+/**
+ * Add the stored radiative heating to the source term for (rho theta)
+ *
+ * @param[in]    lev    level of refinement
+ * @param[in]    cons   cell-centered conserved state
+ * @param[inout] source source terms for the conserved variables
+ */
+void
+Radiation::add_theta_source (int lev,
+                             const MultiFab& cons,
+                             MultiFab& source) const
+{
+    BL_PROFILE("Radiation::add_theta_source()");
+
+    const MultiFab& qrad = *m_qrad[lev];
+
+    for (MFIter mfi(source, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        const Array4<const Real>& cons_arr = cons.const_array(mfi);
+        const Array4<const Real>& qrad_arr = qrad.const_array(mfi);
+        const Array4<      Real>& src_arr  = source.array(mfi);
+
+        ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            src_arr(i,j,k,RhoTheta_comp) += cons_arr(i,j,k,Rho_comp) * qrad_arr(i,j,k,0);
+        });
+    }
+}
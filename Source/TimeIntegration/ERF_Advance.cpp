@@ -42,6 +42,10 @@ ERF::Advance (int lev, Real time, Real dt_lev, int /*iteration*/, int /*ncycle*/
         // NOTE: std::swap above causes the field ptrs to be out of date.
         //       Reassign the field ptrs for MAC avg computation.
         m_most->update_mac_ptrs(lev, vars_old, Theta_prim);
+        // The averaging maps follow the terrain when it moves
+        if (solverChoice.use_terrain && solverChoice.terrain_type == 1) {
+            m_most->update_terrain(lev);
+        }
         m_most->update_fluxes(lev);
       }
     }
@@ -109,6 +113,13 @@ ERF::Advance (int lev, Real time, Real dt_lev, int /*iteration*/, int /*ncycle*/
     condensation_source(source, S_new, tau_cond, c_p);
 #endif
 
+#if defined(ERF_USE_RRTMGP)
+    // Add the radiative heating (only recomputed every rad.interval steps)
+    if (m_rad) {
+        advance_radiation(lev, S_old, source, time, dt_lev);
+    }
+#endif
+
     // We don't need to call FillPatch on cons_mf because we have fillpatch'ed S_old above
     MultiFab cons_mf(ba,dm,nvars,S_old.nGrowVect());
     MultiFab::Copy(cons_mf,S_old,0,0,S_old.nComp(),S_old.nGrowVect());
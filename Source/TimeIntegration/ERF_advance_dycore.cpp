@@ -6,7 +6,6 @@
 #include <ERF.H>
 #include <TerrainMetrics.H>
 #include <TI_headers.H>
-#include <PlaneAverage.H>
 #include <Diffusion.H>
 #include <TileNoZ.H>
 #include <Utils.H>
@@ -64,12 +63,6 @@ void ERF::advance_dycore(int level,
     MultiFab p_hse (base_state[level], make_alias, 1, 1); // p_0 is second component
     MultiFab pi_hse(base_state[level], make_alias, 2, 1); // pi_0 is second component
 
-#if defined(ERF_USE_MOISTURE)
-    MultiFab qvapor (qmoist[level], make_alias, 0, 1);
-    MultiFab qcloud (qmoist[level], make_alias, 1, 1);
-    MultiFab qice   (qmoist[level], make_alias, 2, 1);
-#endif
-
     MultiFab* r0  = &r_hse;
     MultiFab* p0  = &p_hse;
     MultiFab* pi0 = &pi_hse;
@@ -248,34 +241,6 @@ void ERF::advance_dycore(int level,
     cons_to_prim(state_old[IntVar::cons], state_old[IntVar::cons].nGrow());
     } // profile
 
-#ifdef ERF_USE_MOISTURE
-    PlaneAverage qv_ave(&qvapor, geom[level], solverChoice.ave_plane);
-    PlaneAverage qc_ave(&qcloud, geom[level], solverChoice.ave_plane);
-    PlaneAverage qi_ave(&qice, geom[level], solverChoice.ave_plane);
-
-    // Compute plane averages
-    qv_ave.compute_averages(ZDir(), qv_ave.field());
-    qc_ave.compute_averages(ZDir(), qc_ave.field());
-    qi_ave.compute_averages(ZDir(), qi_ave.field());
-
-    // get plane averaged data
-    int ncell = qv_ave.ncell_line();
-
-    Gpu::HostVector  <Real> qv_h(ncell), qi_h(ncell), qc_h(ncell);
-    Gpu::DeviceVector<Real> qv_d(ncell), qc_d(ncell), qi_d(ncell);
-
-    // Fill the vectors with the line averages computed above
-    qv_ave.line_average(0, qv_h);
-    qi_ave.line_average(0, qi_h);
-    qc_ave.line_average(0, qc_h);
-
-    // Copy data to device
-    Gpu::copyAsync(Gpu::hostToDevice, qv_h.begin(), qv_h.end(), qv_d.begin());
-    Gpu::copyAsync(Gpu::hostToDevice, qi_h.begin(), qi_h.end(), qi_d.begin());
-    Gpu::copyAsync(Gpu::hostToDevice, qc_h.begin(), qc_h.end(), qc_d.begin());
-    Gpu::streamSynchronize();
-#endif
-
 #include "TI_no_substep_fun.H"
 #include "TI_slow_rhs_fun.H"
 #include "TI_fast_rhs_fun.H"
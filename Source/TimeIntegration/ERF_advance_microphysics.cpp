@@ -7,17 +7,33 @@ void ERF::advance_microphysics(int lev,
                                MultiFab& cons,
                                const Real& dt_advance)
 {
-    micro.Init(cons, qmoist[lev],
-               grids_to_evolve[lev],
-               Geom(lev),
-               dt_advance);
+    if (solverChoice.moisture_type == MoistureType::Kessler) {
+        kessler.Init(cons, qmoist[lev],
+                     grids_to_evolve[lev],
+                     Geom(lev),
+                     dt_advance);
 
-    micro.Cloud();
-    micro.Diagnose();
-    micro.IceFall();
-    micro.Precip();
-    micro.MicroPrecipFall();
+        kessler.Proc();
 
-    micro.Update(cons, qmoist[lev]);
+        kessler.Update(cons, qmoist[lev]);
+    } else {
+        // The state has just been advanced to t_new
+        m_plane_avg[lev]->compute(cons, &qmoist[lev], t_new[lev]);
+
+        micro.Init(cons, qmoist[lev],
+                   grids_to_evolve[lev],
+                   Geom(lev),
+                   *m_plane_avg[lev],
+                   dt_advance);
+
+        micro.Cloud();
+        micro.Diagnose();
+        micro.IceFall();
+        micro.Precip();
+        micro.MicroPrecipFall();
+
+        micro.Update(cons, qmoist[lev]);
+        m_plane_avg[lev]->invalidate();
+    }
 }
 #endif
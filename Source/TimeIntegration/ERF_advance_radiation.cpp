@@ -0,0 +1,62 @@
+#include <ERF.H>
+
+using namespace amrex;
+
+#if defined(ERF_USE_RRTMGP)
+#include <Radiation.H>
+
+/**
+ * Add the radiative heating to the (rho theta) source term.
+ *
+ * The heating rate is only recomputed every rad.interval steps at this level (or
+ * whenever a rad.period boundary is crossed during this step) and is otherwise
+ * reused; it is also recomputed if the level has been regridded since the last call.
+ *
+ * With rad.lag > 0 the calculation started at step n runs on a separate host thread
+ * while the dycore advances, and its heating rate is applied from step n + rad.lag on.
+ *
+ * @param[in]    lev        level of refinement
+ * @param[in]    cons       cell-centered conserved state at the start of the step
+ * @param[inout] source     source terms for the conserved variables
+ * @param[in]    time       start time of this step
+ * @param[in]    dt_advance time step at this level
+ */
+void ERF::advance_radiation (int lev,
+                             MultiFab& cons,
+                             MultiFab& source,
+                             const Real& time,
+                             const Real& dt_advance)
+{
+    const MultiFab* qm = nullptr;
+#if defined(ERF_USE_MOISTURE)
+    qm = &qmoist[lev];
+#endif
+
+    bool time_to_call = is_it_time_for_action(istep[lev], time+dt_advance, dt_advance,
+                                              m_rad->rad_int, m_rad->rad_per);
+
+    if (m_rad->rad_lag == 0)
+    {
+        if (!m_rad->has_heating_rate(lev, cons.boxArray(), cons.DistributionMap()) || time_to_call) {
+            m_rad->compute_heating_rate(lev, cons, qm, Geom(lev), time);
+        }
+    }
+    else
+    {
+        // Pick up the result of the snapshot taken rad_lag steps ago
+        if (m_rad->is_pending(lev) && istep[lev] >= m_rad->ready_step(lev)) {
+            m_rad->end_heating_rate(lev);
+        }
+
+        if (!m_rad->has_heating_rate(lev, cons.boxArray(), cons.DistributionMap())) {
+            // First step or regrid -- nothing to lag behind so compute it now
+            m_rad->compute_heating_rate(lev, cons, qm, Geom(lev), time);
+        } else if (time_to_call && !m_rad->is_pending(lev)) {
+            m_rad->begin_heating_rate(lev, cons, qm, Geom(lev), time,
+                                      true, istep[lev] + m_rad->rad_lag);
+        }
+    }
+
+    m_rad->add_theta_source(lev, cons, source);
+}
+#endif
@@ -12,7 +12,7 @@
 
 #include <TerrainMetrics.H>
 #include <IndexDefines.H>
-#include <PlaneAverage.H>
+#include <MultiPlaneAverage.H>
 
 using namespace amrex;
 
@@ -25,12 +25,9 @@ using namespace amrex;
  * @param[in]  S_data current solution
  * @param[in]  S_prim primitive variables (i.e. conserved variables divided by density)
  * @param[out] buoyancy the buoyancy term computed here
- * @param[in]  qvapor water vapor
- * @param[in]  qcloud cloud water
- * @param[in]  qice   cloud ice
- * @param[in]  qv_d   lateral average of cloud vapor
- * @param[in]  qc_d   lateral average of cloud vapor
- * @param[in]  qd_d   lateral average of cloud vapor
+ * @param[in]  qmoist moisture variables (water vapor, cloud water, cloud ice)
+ * @param[in]  plane_avg  horizontal averages of the state of this level
+ * @param[in]  time   time of S_data, which tags its horizontal averages
  * @param[in]  geom   Container for geometric informaiton
  * @param[in]  solverChoice  Container for solver parameters
  * @param[in]  r0     Reference (hydrostatically stratified) density
@@ -42,10 +39,9 @@ void make_buoyancy (BoxArray& grids_to_evolve,
                           MultiFab& buoyancy,
 #if defined(ERF_USE_MOISTURE)
                     const MultiFab& qmoist,
-                    Gpu::DeviceVector<Real> qv_d,
-                    Gpu::DeviceVector<Real> qc_d,
-                    Gpu::DeviceVector<Real> qi_d,
 #endif
+                    MultiPlaneAverage& plane_avg,
+                    const Real time,
                     const amrex::Geometry geom,
                     const SolverChoice& solverChoice,
                     const MultiFab* r0)
@@ -69,6 +65,8 @@ void make_buoyancy (BoxArray& grids_to_evolve,
     // ******************************************************************************************
 #if !defined(ERF_USE_MOISTURE) && !defined(ERF_USE_WARM_NO_PRECIP)
 
+    amrex::ignore_unused(S_prim);
+
     if (solverChoice.buoyancy_type == 1) {
         for ( MFIter mfi(buoyancy,TilingIfNotGPU()); mfi.isValid(); ++mfi)
         {
@@ -96,26 +94,11 @@ void make_buoyancy (BoxArray& grids_to_evolve,
 
     } else if (solverChoice.buoyancy_type == 2 || solverChoice.buoyancy_type == 3) {
 
-        PlaneAverage state_ave(&(S_data[IntVar::cons]), geom, solverChoice.ave_plane);
-        PlaneAverage prim_ave(&S_prim, geom, solverChoice.ave_plane);
-
-        int ncell = state_ave.ncell_line();
-
-        state_ave.compute_averages(ZDir(), state_ave.field());
-        prim_ave.compute_averages(ZDir(), prim_ave.field());
-
-        Gpu::HostVector<Real> rho_h(ncell), theta_h(ncell);
-        state_ave.line_average(Rho_comp, rho_h);
-        prim_ave.line_average(PrimTheta_comp, theta_h);
+        // Horizontal averages (only computed once for this time)
+        plane_avg.compute(S_data[IntVar::cons], nullptr, time);
 
-        Gpu::DeviceVector<Real>   rho_d(ncell);
-        Gpu::DeviceVector<Real> theta_d(ncell);
-
-        Gpu::copyAsync(Gpu::hostToDevice, rho_h.begin(), rho_h.end(), rho_d.begin());
-        Gpu::copyAsync(Gpu::hostToDevice, theta_h.begin(), theta_h.end(), theta_d.begin());
-
-        Real*   rho_d_ptr =   rho_d.data();
-        Real* theta_d_ptr = theta_d.data();
+        const Real*   rho_d_ptr = plane_avg.line_average_device(PlaneAvg::rho);
+        const Real* theta_d_ptr = plane_avg.line_average_device(PlaneAvg::theta);
 
 #ifdef _OPENMP
 #pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
@@ -193,41 +176,18 @@ void make_buoyancy (BoxArray& grids_to_evolve,
 
     } else {
 
-    PlaneAverage state_ave(&(S_data[IntVar::cons]), geom, solverChoice.ave_plane);
-    PlaneAverage  prim_ave(&S_prim                , geom, solverChoice.ave_plane);
-
-    // Compute horizontal averages of all components of each field
-    state_ave.compute_averages(ZDir(), state_ave.field());
-     prim_ave.compute_averages(ZDir(), prim_ave.field());
+    // Horizontal averages of all the fields (only computed once for this time)
+    plane_avg.compute(S_data[IntVar::cons], &qmoist, time);
 
-    int ncell = state_ave.ncell_line();
-
-    Gpu::HostVector  <Real> rho_h(ncell), theta_h(ncell), qp_h(ncell);
-    Gpu::DeviceVector<Real> rho_d(ncell), theta_d(ncell);
-
-    state_ave.line_average(Rho_comp, rho_h);
-    Gpu::copyAsync(Gpu::hostToDevice, rho_h.begin(), rho_h.end(), rho_d.begin());
-
-    prim_ave.line_average(PrimTheta_comp, theta_h);
-    Gpu::copyAsync(Gpu::hostToDevice, theta_h.begin(), theta_h.end(), theta_d.begin());
-
-    Real*   rho_d_ptr =   rho_d.data();
-    Real* theta_d_ptr = theta_d.data();
+    const Real*   rho_d_ptr = plane_avg.line_average_device(PlaneAvg::rho);
+    const Real* theta_d_ptr = plane_avg.line_average_device(PlaneAvg::theta);
 
     if (solverChoice.buoyancy_type == 2) {
 
-        prim_ave.line_average(PrimQp_comp, qp_h);
-
-        Gpu::DeviceVector<Real>    qp_d(ncell);
-
-        // Copy data to device
-        Gpu::copyAsync(Gpu::hostToDevice, qp_h.begin(), qp_h.end(), qp_d.begin());
-        Gpu::streamSynchronize();
-
-        Real*    qp_d_ptr =    qp_d.data();
-        Real*    qv_d_ptr =    qv_d.data();
-        Real*    qc_d_ptr =    qc_d.data();
-        Real*    qi_d_ptr =    qi_d.data();
+        const Real*    qp_d_ptr = plane_avg.line_average_device(PlaneAvg::qp);
+        const Real*    qv_d_ptr = plane_avg.line_average_device(PlaneAvg::qv);
+        const Real*    qc_d_ptr = plane_avg.line_average_device(PlaneAvg::qc);
+        const Real*    qi_d_ptr = plane_avg.line_average_device(PlaneAvg::qi);
 
 #ifdef _OPENMP
 #pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
@@ -329,6 +289,7 @@ void make_buoyancy (BoxArray& grids_to_evolve,
 #if defined(ERF_USE_WARM_NO_PRECIP)
 
     AMREX_ALWAYS_ASSERT(solverChoice.buoyancy_type == 1);
+    amrex::ignore_unused(plane_avg, time);
 
         for ( MFIter mfi(buoyancy,TilingIfNotGPU()); mfi.isValid(); ++mfi)
         {
@@ -133,7 +133,7 @@ wrfbdy_compute_interior_ghost_RHS(const Real& bdy_time_interval,
     AMREX_ALWAYS_ASSERT( alpha >= 0. && alpha <= 1.0);
     amrex::Real oma   = 1.0 - alpha;
 
-    // Temporary FABs for storage (owned/filled on all ranks)
+    // Temporary FABs for storage (filled around the grids of this rank)
     FArrayBox U_xlo, U_xhi, U_ylo, U_yhi;
     FArrayBox V_xlo, V_xhi, V_ylo, V_yhi;
     FArrayBox R_xlo, R_xhi, R_ylo, R_yhi;
@@ -149,6 +149,29 @@ wrfbdy_compute_interior_ghost_RHS(const Real& bdy_time_interval,
     // End of loop for WRFBdyVars
     int WRFBdyEnd = WRFBdyVars::NumTypes-3;
 
+    // Only the part of the halo around this rank's grids is filled (and we only
+    //    hold the boundary data there)
+    Box local_bx;
+    for (MFIter mfi(S_data[IntVar::cons]); mfi.isValid(); ++mfi) {
+        const Box& vbx = mfi.validbox();
+        local_bx = local_bx.ok() ? local_bx.minBox(vbx) : vbx;
+    }
+    auto local_region = [&local_bx] (int ivar, const Box& domain)
+    {
+        // NOTE: 1 cell is needed for the Laplacian, and 1 more of rho for U -> rho*U
+        int ng = (ivar == WRFBdyVars::R || ivar == WRFBdyVars::T) ? 4 : 3;
+        return amrex::convert(amrex::grow(local_bx, IntVect(ng,ng,0)), domain.ixType());
+    };
+    auto restrict_to = [] (const Box& region, Box& bx_xlo, Box& bx_xhi, Box& bx_ylo, Box& bx_yhi)
+    {
+        bx_xlo &= region; bx_xhi &= region;
+        bx_ylo &= region; bx_yhi &= region;
+    };
+    auto resize = [] (FArrayBox& fab, const Box& bx)
+    {
+        if (bx.ok()) fab.resize(bx,1);
+    };
+
 
     // Size the FABs
     //==========================================================
@@ -167,19 +190,20 @@ wrfbdy_compute_interior_ghost_RHS(const Real& bdy_time_interval,
                                       bx_xlo, bx_xhi,
                                       bx_ylo, bx_yhi,
                                       ng_vect, true);
+        restrict_to(local_region(ivar, domain), bx_xlo, bx_xhi, bx_ylo, bx_yhi);
 
         if (ivar  == WRFBdyVars::U) {
-            U_xlo.resize(bx_xlo,1); U_xhi.resize(bx_xhi,1);
-            U_ylo.resize(bx_ylo,1); U_yhi.resize(bx_yhi,1);
+            resize(U_xlo,bx_xlo); resize(U_xhi,bx_xhi);
+            resize(U_ylo,bx_ylo); resize(U_yhi,bx_yhi);
         } else if (ivar  == WRFBdyVars::V) {
-            V_xlo.resize(bx_xlo,1); V_xhi.resize(bx_xhi,1);
-            V_ylo.resize(bx_ylo,1); V_yhi.resize(bx_yhi,1);
+            resize(V_xlo,bx_xlo); resize(V_xhi,bx_xhi);
+            resize(V_ylo,bx_ylo); resize(V_yhi,bx_yhi);
         } else if (ivar  == WRFBdyVars::R) {
-            R_xlo.resize(bx_xlo,1); R_xhi.resize(bx_xhi,1);
-            R_ylo.resize(bx_ylo,1); R_yhi.resize(bx_yhi,1);
+            resize(R_xlo,bx_xlo); resize(R_xhi,bx_xhi);
+            resize(R_ylo,bx_ylo); resize(R_yhi,bx_yhi);
         } else if (ivar  == WRFBdyVars::T){
-            T_xlo.resize(bx_xlo,1); T_xhi.resize(bx_xhi,1);
-            T_ylo.resize(bx_ylo,1); T_yhi.resize(bx_yhi,1);
+            resize(T_xlo,bx_xlo); resize(T_xhi,bx_xhi);
+            resize(T_ylo,bx_ylo); resize(T_yhi,bx_yhi);
         } else {
             continue;
         }
@@ -218,6 +242,7 @@ wrfbdy_compute_interior_ghost_RHS(const Real& bdy_time_interval,
                                       bx_xlo, bx_xhi,
                                       bx_ylo, bx_yhi,
                                       ng_vect, true);
+        restrict_to(local_region(ivar, domain), bx_xlo, bx_xhi, bx_ylo, bx_yhi);
 
         Array4<Real> arr_xlo;  Array4<Real> arr_xhi;
         Array4<Real> arr_ylo;  Array4<Real> arr_yhi;
@@ -307,6 +332,7 @@ wrfbdy_compute_interior_ghost_RHS(const Real& bdy_time_interval,
                                       bx_xlo, bx_xhi,
                                       bx_ylo, bx_yhi,
                                       ng_vect, true);
+        restrict_to(local_region(ivar, domain), bx_xlo, bx_xhi, bx_ylo, bx_yhi);
 
         Array4<Real> rarr_xlo = R_xlo.array();  Array4<Real> rarr_xhi = R_xhi.array();
         Array4<Real> rarr_ylo = R_ylo.array();  Array4<Real> rarr_yhi = R_yhi.array();
@@ -0,0 +1,104 @@
+#include <MultiPlaneAverage.H>
+#include <IndexDefines.H>
+#include <EOS.H>
+
+using namespace amrex;
+
+/**
+ * Set up the line storage for averages over the horizontal planes of geom
+ *
+ * @param[in] geom Geometry of the level whose state will be averaged
+ */
+MultiPlaneAverage::MultiPlaneAverage (const Geometry& geom)
+    : m_geom(geom)
+{
+    const Box& domain = m_geom.Domain();
+
+    m_ncell_line  = domain.length(2);
+    m_ncell_plane = domain.length(0) * domain.length(1);
+
+    m_line_h.resize(static_cast<std::size_t>(PlaneAvg::NumVars) * m_ncell_line, 0.0);
+    m_line_d.resize(m_line_h.size());
+}
+
+/**
+ * Compute all the horizontal averages of the state at the given time, unless they
+ * are already held for that time
+ *
+ * @param[in] cons   conserved variables
+ * @param[in] qmoist moisture variables (qv, qc, qi), only used with moisture
+ * @param[in] time   time of the state
+ */
+void
+MultiPlaneAverage::compute (const MultiFab& cons, const MultiFab* qmoist, Real time)
+{
+    if (m_valid && m_time == time) return;
+
+    BL_PROFILE("MultiPlaneAverage::compute()");
+
+#if defined(ERF_USE_MOISTURE)
+    AMREX_ALWAYS_ASSERT(qmoist != nullptr);
+#else
+    amrex::ignore_unused(qmoist);
+#endif
+
+    const int nz   = m_ncell_line;
+    const int klo  = m_geom.Domain().smallEnd(2);
+    const int ntot = static_cast<int>(m_line_d.size());
+    const Real denom = 1.0 / static_cast<Real>(m_ncell_plane);
+
+    Real* line = m_line_d.data();
+
+    ParallelFor(ntot, [=] AMREX_GPU_DEVICE (int n) noexcept { line[n] = 0.0; });
+
+    // All tiles add into the same line, so the tiles are not threaded on the CPU
+    for (MFIter mfi(cons, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        const Box pbx = makeSlab(bx, 2, bx.smallEnd(2));
+        const int kmin = bx.smallEnd(2);
+        const int kmax = bx.bigEnd(2);
+
+        const Array4<const Real>& cons_arr = cons.const_array(mfi);
+#if defined(ERF_USE_MOISTURE)
+        const Array4<const Real>& qm_arr = qmoist->const_array(mfi);
+#endif
+
+        // Each thread walks one column, which keeps the reductions to one per cell and variable
+        ParallelFor(Gpu::KernelInfo().setReduction(true), pbx, [=]
+            AMREX_GPU_DEVICE (int i, int j, int, Gpu::Handler const& handler) noexcept
+        {
+            for (int k = kmin; k <= kmax; ++k) {
+                Real* lk = line + (k - klo);
+
+                const Real rho      = cons_arr(i,j,k,Rho_comp);
+                const Real rhotheta = cons_arr(i,j,k,RhoTheta_comp);
+#if defined(ERF_USE_MOISTURE)
+                const Real qv = qm_arr(i,j,k,0);
+                const Real p  = getPgivenRTh(rhotheta, qv);
+#else
+                const Real p  = getPgivenRTh(rhotheta);
+#endif
+                Gpu::deviceReduceSum(lk + PlaneAvg::rho     *nz, rho           * denom, handler);
+                Gpu::deviceReduceSum(lk + PlaneAvg::theta   *nz, rhotheta/rho  * denom, handler);
+                Gpu::deviceReduceSum(lk + PlaneAvg::rhotheta*nz, rhotheta      * denom, handler);
+                Gpu::deviceReduceSum(lk + PlaneAvg::pres    *nz, p             * denom, handler);
+#if defined(ERF_USE_MOISTURE)
+                const Real qp = cons_arr(i,j,k,RhoQp_comp) / rho;
+                Gpu::deviceReduceSum(lk + PlaneAvg::qp      *nz, qp            * denom, handler);
+                Gpu::deviceReduceSum(lk + PlaneAvg::qv      *nz, qv            * denom, handler);
+                Gpu::deviceReduceSum(lk + PlaneAvg::qc      *nz, qm_arr(i,j,k,1) * denom, handler);
+                Gpu::deviceReduceSum(lk + PlaneAvg::qi      *nz, qm_arr(i,j,k,2) * denom, handler);
+#endif
+            }
+        });
+    }
+
+    // One reduction across ranks for all the variables, then the sums go back to the device
+    Gpu::copy(Gpu::deviceToHost, m_line_d.begin(), m_line_d.end(), m_line_h.begin());
+    ParallelDescriptor::ReduceRealSum(m_line_h.data(), static_cast<int>(m_line_h.size()));
+    Gpu::copy(Gpu::hostToDevice, m_line_h.begin(), m_line_h.end(), m_line_d.begin());
+
+    m_valid = true;
+    m_time  = time;
+}
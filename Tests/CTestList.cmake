@@ -71,6 +71,86 @@ function(add_test_0 TEST_NAME TEST_EXE PLTFILE)
     )
 endfunction(add_test_0)
 
+# Restart test -- compare a run straight through with one restarted from CHKFILE
+function(add_test_restart TEST_NAME TEST_EXE PLTFILE CHKFILE)
+    setup_test()
+
+    set(TEST_EXE ${CMAKE_BINARY_DIR}/Exec/${TEST_EXE})
+    set(FCOMPARE_TOLERANCE "-r 1e-12 --abs_tol 1.0e-12")
+    set(FCOMPARE_FLAGS "-a ${FCOMPARE_TOLERANCE}")
+    string(REPLACE ";" " " TEST_OPTIONS "${ARGN}")
+    set(RUN_COMMAND "${MPI_COMMANDS} ${TEST_EXE} ${CURRENT_TEST_BINARY_DIR}/${TEST_NAME}.i ${TEST_OPTIONS} ${RUNTIME_OPTIONS}")
+    set(test_command sh -c "${RUN_COMMAND} > ${TEST_NAME}.log && ${RUN_COMMAND} erf.restart=${CHKFILE} erf.plot_file_1=rst_plt erf.check_int=-1 > ${TEST_NAME}_restart.log && ${FCOMPARE_EXE} ${FCOMPARE_FLAGS} ${CURRENT_TEST_BINARY_DIR}/${PLTFILE} ${CURRENT_TEST_BINARY_DIR}/rst_${PLTFILE}")
+
+    add_test(${TEST_NAME} ${test_command})
+    set_tests_properties(${TEST_NAME}
+        PROPERTIES
+        TIMEOUT 5400
+        PROCESSORS ${NP}
+        WORKING_DIRECTORY "${CURRENT_TEST_BINARY_DIR}/"
+        LABELS "regression"
+        ATTACHED_FILES_ON_FAIL "${CURRENT_TEST_BINARY_DIR}/${TEST_NAME}.log;${CURRENT_TEST_BINARY_DIR}/${TEST_NAME}_restart.log"
+    )
+endfunction(add_test_restart)
+
+# Restart test of an output file -- run twice from scratch and once from CHKFILE, and check that
+#    OUTFILE comes out the same each time (a new run starts it afresh, a restart carries it on)
+function(add_test_restart_file TEST_NAME TEST_EXE OUTFILE CHKFILE)
+    setup_test()
+
+    set(TEST_EXE ${CMAKE_BINARY_DIR}/Exec/${TEST_EXE})
+    string(REPLACE ";" " " TEST_OPTIONS "${ARGN}")
+    set(RUN_COMMAND "${MPI_COMMANDS} ${TEST_EXE} ${CURRENT_TEST_BINARY_DIR}/${TEST_NAME}.i ${TEST_OPTIONS} ${RUNTIME_OPTIONS}")
+    set(test_command sh -c "${RUN_COMMAND} > ${TEST_NAME}.log && cp ${OUTFILE} ${OUTFILE}.ref && ${RUN_COMMAND} > ${TEST_NAME}_rerun.log && cmp ${OUTFILE} ${OUTFILE}.ref && ${RUN_COMMAND} erf.restart=${CHKFILE} erf.check_int=-1 > ${TEST_NAME}_restart.log && cmp ${OUTFILE} ${OUTFILE}.ref")
+
+    add_test(${TEST_NAME} ${test_command})
+    set_tests_properties(${TEST_NAME}
+        PROPERTIES
+        TIMEOUT 5400
+        PROCESSORS ${NP}
+        WORKING_DIRECTORY "${CURRENT_TEST_BINARY_DIR}/"
+        LABELS "regression"
+        ATTACHED_FILES_ON_FAIL "${CURRENT_TEST_BINARY_DIR}/${TEST_NAME}.log;${CURRENT_TEST_BINARY_DIR}/${TEST_NAME}_rerun.log;${CURRENT_TEST_BINARY_DIR}/${TEST_NAME}_restart.log"
+    )
+endfunction(add_test_restart_file)
+
+# Check test -- the run itself checks its answer and aborts on failure
+function(add_test_c TEST_NAME TEST_EXE)
+    setup_test()
+
+    set(TEST_EXE ${CMAKE_BINARY_DIR}/Exec/${TEST_EXE})
+    string(REPLACE ";" " " TEST_OPTIONS "${ARGN}")
+    set(test_command sh -c "${MPI_COMMANDS} ${TEST_EXE} ${CURRENT_TEST_BINARY_DIR}/${TEST_NAME}.i ${TEST_OPTIONS} ${RUNTIME_OPTIONS} > ${TEST_NAME}.log")
+
+    add_test(${TEST_NAME} ${test_command})
+    set_tests_properties(${TEST_NAME}
+        PROPERTIES
+        TIMEOUT 5400
+        PROCESSORS ${NP}
+        WORKING_DIRECTORY "${CURRENT_TEST_BINARY_DIR}/"
+        LABELS "regression"
+        ATTACHED_FILES_ON_FAIL "${CURRENT_TEST_BINARY_DIR}/${TEST_NAME}.log"
+    )
+endfunction(add_test_c)
+
+# NaN test -- check that the run leaves no NaNs (e.g. from amrex.init_snan) in PLTFILE
+function(add_test_nan TEST_NAME TEST_EXE PLTFILE)
+    setup_test()
+
+    set(TEST_EXE ${CMAKE_BINARY_DIR}/Exec/${TEST_EXE})
+    set(test_command sh -c "${MPI_COMMANDS} ${TEST_EXE} ${CURRENT_TEST_BINARY_DIR}/${TEST_NAME}.i ${RUNTIME_OPTIONS} > ${TEST_NAME}.log && ${FCOMPARE_EXE} ${CURRENT_TEST_BINARY_DIR}/${PLTFILE} ${CURRENT_TEST_BINARY_DIR}/${PLTFILE}")
+
+    add_test(${TEST_NAME} ${test_command})
+    set_tests_properties(${TEST_NAME}
+        PROPERTIES
+        TIMEOUT 5400
+        PROCESSORS ${NP}
+        WORKING_DIRECTORY "${CURRENT_TEST_BINARY_DIR}/"
+        LABELS "regression"
+        ATTACHED_FILES_ON_FAIL "${CURRENT_TEST_BINARY_DIR}/${TEST_NAME}.log"
+    )
+endfunction(add_test_nan)
+
 # Standard unit test
 function(add_test_u TEST_NAME)
     setup_test()
@@ -125,6 +205,19 @@ add_test_r(MSF_NoSub_IsentropicVortexAdv     "RegTests/IsentropicVortex/erf_isen
 add_test_r(MSF_Sub_IsentropicVortexAdv       "RegTests/IsentropicVortex/erf_isentropic_vortex" "plt00010")
 
 add_test_0(Deardorff_stationary              "ABL/erf_abl" "plt00010")
+add_test_restart(Restart_AsyncCheckpoint      "RegTests/ScalarAdvDiff/erf_scalar_advdiff" "plt00020" "chk00010")
+add_test_nan(PlotRegion_PartlyCovered        "RegTests/ScalarAdvDiff/erf_scalar_advdiff" "reg00004")
+add_test_restart_file(Restart_ProbeFile       "RegTests/ScalarAdvDiff/erf_scalar_advdiff" "samples" "chk00010")
+
+if(ERF_ENABLE_RRTMGP)
+  set(RRTMGP_DATA ${CMAKE_SOURCE_DIR}/Submodules/RRTMGP/rrtmgp/data)
+  set(RRTMGP_COEFFS erf.rad.coeff_file_sw=${RRTMGP_DATA}/rrtmgp-data-sw-g224-2018-12-04.nc
+                    erf.rad.coeff_file_lw=${RRTMGP_DATA}/rrtmgp-data-lw-g256-2018-12-04.nc)
+  add_test_c(RadCoarsening_ClearSky          "RegTests/EkmanSpiral_input_sounding/ekman_spiral_input_sounding" ${RRTMGP_COEFFS})
+  if(ERF_ENABLE_MOISTURE)
+    add_test_c(RadCoarsening_Cloudy          "RegTests/EkmanSpiral_input_sounding/ekman_spiral_input_sounding" ${RRTMGP_COEFFS})
+  endif()
+endif()
 
 #=============================================================================
 # Performance tests
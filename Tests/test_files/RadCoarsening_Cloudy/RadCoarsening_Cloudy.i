@@ -0,0 +1,61 @@
+# ------------------  INPUTS TO MAIN PROGRAM  -------------------
+max_step = 2
+
+amrex.fpe_trap_invalid = 1
+
+fabarray.mfiter_tile_size = 1024 1024 1024
+
+# PROBLEM SIZE & GEOMETRY
+geometry.prob_extent =  4000     4000    4000
+amr.n_cell           =    32       32      32
+
+geometry.is_periodic = 1 1 0
+
+zlo.type = "SlipWall"
+zhi.type = "SlipWall"
+
+# TIME STEP CONTROL
+erf.fixed_dt       = 1.0
+erf.fixed_fast_dt  = 0.25
+
+# DIAGNOSTICS & VERBOSITY
+erf.sum_interval   = 1       # timesteps between computing mass
+erf.v              = 1       # verbosity in ERF.cpp
+amr.v              = 1       # verbosity in Amr.cpp
+
+# REFINEMENT / REGRIDDING
+amr.max_level       = 0       # maximum level number allowed
+
+# CHECKPOINT FILES
+erf.check_file      = chk        # root name of checkpoint file
+erf.check_int       = -1         # number of timesteps between checkpoints
+
+# PLOTFILES
+erf.plot_file_1     = plt        # prefix of plotfile name
+erf.plot_int_1      = -1         # number of timesteps between plotfiles
+
+# SOLVER CHOICE
+erf.alpha_T = 0.0
+erf.alpha_C = 0.0
+erf.use_gravity = true
+
+erf.les_type         = "None"
+erf.molec_diff_type  = "None"
+
+# INITIALIZATION -- hydrostatic, horizontally uniform sounding
+erf.init_type = "input_sounding"
+erf.init_sounding_ideal = 1
+erf.input_sounding_file = "input_sounding"
+
+# RADIATION -- every column against 2x2 block averages under a cloud deck
+#    The sounding is supersaturated between 1000 and 1500 m, so the deck is there from
+#    the first call. The columns are identical, so the two differ only through the
+#    zenith angle, whose interpolated block average is within 3.2e-5 of its value at
+#    every column on this grid; 1e-3 leaves room for the response of the heating to it
+erf.use_radiation         = true
+erf.rad.interval          = 1
+erf.rad.latitude          = 35.0
+erf.rad.start_hour        = 12.0
+erf.rad.coarsen_factor    = 2
+erf.rad.check_coarsening  = true
+erf.rad.coarsening_tol    = 1.0e-3